@@ -1,22 +1,82 @@
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <cassert>
 #include <cstddef>
 #include <cstdint>
 #include <optional>
+#include <span>
+#include <utility>
 #include <vector>
 
 namespace busarb {
 
-inline constexpr std::uint32_t kApiVersionMajor = 1;
-inline constexpr std::uint32_t kApiVersionMinor = 1;
+inline constexpr std::uint32_t kApiVersionMajor = 2;
+inline constexpr std::uint32_t kApiVersionMinor = 0;
 inline constexpr std::uint32_t kApiVersionPatch = 0;
 
+// Any id below kMaxBusMasters is a master; how masters rank against each other
+// is data (BusMasterTopology), not part of the id. The named ids are the
+// Saturn's bus masters.
 enum class BusMasterId : std::uint8_t {
   SH2_A = 0,
   SH2_B = 1,
   DMA = 2,
+  SCU_DSP = 3,
+  SCU_DMA0 = 4,
+  SCU_DMA1 = 5,
+  SCU_DMA2 = 6,
+  M68K = 7,
+  CD_BLOCK = 8,
 };
 
+inline constexpr std::size_t kMaxBusMasters = 32;
+
+// One bit per master, bit i for BusMasterId i.
+using BusMasterMask = std::uint32_t;
+
+[[nodiscard]] constexpr BusMasterMask bus_master_bit(BusMasterId id) {
+  assert(static_cast<std::size_t>(id) < kMaxBusMasters && "BusMasterId must be below kMaxBusMasters");
+  return BusMasterMask{1} << static_cast<std::uint32_t>(id);
+}
+
+// Same-tick arbitration order. The highest priority class with a contender
+// wins; within it the lowest-numbered contending master wins, unless that
+// master rotates with others, in which case its group's round robin picks.
+struct BusMasterTopology {
+  // Masks of masters, highest priority first, ending at the first 0 entry.
+  // Masters in no class rank below every class, as one class.
+  std::array<BusMasterMask, kMaxBusMasters> priority_classes{};
+  // round_robin_groups[m]: the masters m rotates with, m included, or 0 when m
+  // does not rotate. Groups are disjoint and lie within one class.
+  std::array<BusMasterMask, kMaxBusMasters> round_robin_groups{};
+};
+
+// DMA over the two SH-2s, which alternate; the order busarb has always used.
+[[nodiscard]] constexpr BusMasterTopology default_bus_topology() {
+  constexpr BusMasterMask cpus = bus_master_bit(BusMasterId::SH2_A) | bus_master_bit(BusMasterId::SH2_B);
+  BusMasterTopology topology{};
+  topology.priority_classes[0] = bus_master_bit(BusMasterId::DMA);
+  topology.priority_classes[1] = cpus;
+  topology.round_robin_groups[static_cast<std::size_t>(BusMasterId::SH2_A)] = cpus;
+  topology.round_robin_groups[static_cast<std::size_t>(BusMasterId::SH2_B)] = cpus;
+  return topology;
+}
+
+// Checks the BusMasterTopology invariants: disjoint classes, and disjoint
+// round-robin groups that each contain their members and sit in one class.
+[[nodiscard]] bool valid_bus_topology(const BusMasterTopology &topology);
+
+// Round-robin state after a grant to `master`: the master's bit replaces its
+// group's previous holder in `round_robin_last`. Masters that do not rotate
+// leave it unchanged.
+[[nodiscard]] constexpr BusMasterMask note_round_robin_grant(const BusMasterTopology &topology, BusMasterMask round_robin_last, BusMasterId master) {
+  const BusMasterMask bit = bus_master_bit(master);
+  const BusMasterMask group = topology.round_robin_groups[static_cast<std::size_t>(master)];
+  return (round_robin_last & ~group) | (bit & group);
+}
+
 struct TimingCallbacks {
   // Returns service duration in caller-defined tick units for a granted access.
   // Determinism contract: identical inputs must produce identical outputs.
@@ -42,35 +102,190 @@ struct BusWaitResult {
   std::uint32_t wait_cycles = 0;
 };
 
+// Everything an Arbiter carries between commits. Restoring a snapshot into a
+// fresh Arbiter with the same callbacks/config resumes the exact same grant
+// sequence.
+struct ArbiterState {
+  std::uint64_t bus_free_tick = 0;
+  bool has_last_granted_addr = false;
+  std::uint32_t last_granted_addr = 0;
+  // Per round-robin group, the bit of its last granted master (none yet: 0).
+  BusMasterMask round_robin_last = 0;
+};
+
+// One grant from commit_grants(...), in the order the grants were made.
+struct BusGrant {
+  std::size_t request_index = 0; // position of the granted request in the batch
+  std::uint64_t start_tick = 0;  // max(now_tick, bus free tick) at the commit
+  std::uint64_t end_tick = 0;    // bus free tick after the commit
+  // start_tick - now_tick, saturated like BusWaitResult::wait_cycles.
+  std::uint32_t wait_cycles = 0;
+  bool had_tie = false;
+};
+
 struct ArbiterConfig {
   std::uint32_t same_address_contention = 2;
   std::uint32_t tie_turnaround = 1;
+  BusMasterTopology topology = default_bus_topology();
 };
 
-class Arbiter {
+// Same-tick winner selection shared by every arbiter: the index of the request
+// to grant first, or nullopt for an empty set. The winning master comes from
+// a bitmask scan of `topology`, with `round_robin_last` driving its round
+// robins; among that master's requests the lowest address wins, then writes,
+// then smaller sizes. Timing does not enter into it.
+[[nodiscard]] std::optional<std::size_t> pick_same_tick_winner(std::span<const BusRequest> same_tick_requests, const BusMasterTopology &topology,
+                                                              BusMasterMask round_robin_last);
+
+// Grant order for one same-tick group, as repeated pick_same_tick_winner()
+// calls over the requests not yet granted would produce it. grants[k] gets the
+// group index of the k-th grant and whether it won a tie against another
+// request of its priority class; `grants` must hold at least group.size()
+// entries.
+void order_same_tick_grants(std::span<const BusRequest> group, const BusMasterTopology &topology, BusMasterMask round_robin_last,
+                            std::span<BusGrant> grants);
+
+// The arbiter with its timing source fixed at compile time. TimingPolicy
+// provides
+//   std::uint32_t access_cycles(std::uint32_t addr, bool is_write, std::uint8_t size_bytes) const;
+// under the TimingCallbacks::access_cycles contract. The call is resolved
+// statically, so an inline policy such as YmirTiming (ymir_timing.hpp) folds
+// into commit_grant. For equal cycle counts every policy grants exactly as
+// Arbiter does.
+template <typename TimingPolicy>
+class BasicArbiter {
 public:
-  explicit Arbiter(TimingCallbacks callbacks, ArbiterConfig config = {});
+  explicit BasicArbiter(TimingPolicy timing = TimingPolicy{}, ArbiterConfig config = {}) : timing_(std::move(timing)), config_(config) {
+    assert(valid_bus_topology(config_.topology) && "ArbiterConfig.topology must satisfy valid_bus_topology");
+  }
 
   // Non-mutating wait query.
-  [[nodiscard]] BusWaitResult query_wait(const BusRequest &req) const;
+  [[nodiscard]] BusWaitResult query_wait(const BusRequest &req) const {
+    if (req.now_tick >= state_.bus_free_tick) {
+      return BusWaitResult{false, 0U};
+    }
+    const std::uint64_t delta = state_.bus_free_tick - req.now_tick;
+    return BusWaitResult{true, static_cast<std::uint32_t>(std::min<std::uint64_t>(delta, 0xFFFFFFFFULL))};
+  }
+
   // Mutating grant commit. Does not require a prior query_wait call.
   // duplicate commit_grant calls intentionally model duplicate grants.
   // had_tie indicates this request won a same-tick equal-priority tie.
-  void commit_grant(const BusRequest &req, std::uint64_t tick_start, bool had_tie = false);
+  void commit_grant(const BusRequest &req, std::uint64_t tick_start, bool had_tie = false) { static_cast<void>(grant(state_, req, tick_start, had_tie)); }
+
+  // Grants `req` at the first tick the query -> wait -> retry loop would,
+  // max(now_tick, bus free tick), commits it, and returns that tick. The
+  // caller can sleep until it instead of polling query_wait every tick; the
+  // state afterwards is bit-identical to the retry loop's.
+  std::uint64_t reserve(const BusRequest &req, bool had_tie = false) { return grant(state_, req, req.now_tick, had_tie); }
+
+  // query_wait for each request against the current state. Returns the number
+  // of results written: requests.size(), or 0 when `results` is too small.
+  std::size_t query_wait_batch(std::span<const BusRequest> requests, std::span<BusWaitResult> results) const {
+    if (results.size() < requests.size()) {
+      return 0U;
+    }
+    for (std::size_t i = 0; i < requests.size(); ++i) {
+      results[i] = query_wait(requests[i]);
+    }
+    return requests.size();
+  }
 
-  [[nodiscard]] std::optional<std::size_t> pick_winner(const std::vector<BusRequest> &same_tick_requests) const;
-  [[nodiscard]] std::uint64_t bus_free_tick() const;
+  // Grants a block of requests in one call. Adjacent requests with equal
+  // now_tick are one same-tick group: it is granted in pick_winner order, each
+  // grant at its now_tick with had_tie set when it beat an equal-priority
+  // contender. The result equals the query -> pick_winner -> commit_grant loop
+  // over the block. Returns the number of grants written: requests.size(), or
+  // 0 without committing anything when `grants` is too small. The state is
+  // carried in a local for the whole block, so stores into `grants` cannot
+  // force it back to memory between commits.
+  std::size_t commit_grants(std::span<const BusRequest> requests, std::span<BusGrant> grants) {
+    if (grants.size() < requests.size()) {
+      return 0U;
+    }
+    ArbiterState state = state_;
+    const std::size_t count = requests.size();
+    std::size_t begin = 0;
+    while (begin < count) {
+      if (begin + 1U == count || requests[begin + 1U].now_tick != requests[begin].now_tick) {
+        record_grant(state, requests, begin, false, grants[begin]);
+        ++begin;
+        continue;
+      }
+      std::size_t end = begin + 2U;
+      while (end < count && requests[end].now_tick == requests[begin].now_tick) {
+        ++end;
+      }
+      const std::span<BusGrant> group = grants.subspan(begin, end - begin);
+      order_same_tick_grants(requests.subspan(begin, end - begin), config_.topology, state.round_robin_last, group);
+      for (BusGrant &grant : group) {
+        record_grant(state, requests, begin + grant.request_index, grant.had_tie, grant);
+      }
+      begin = end;
+    }
+    state_ = state;
+    return requests.size();
+  }
+
+  [[nodiscard]] std::optional<std::size_t> pick_winner(std::span<const BusRequest> same_tick_requests) const {
+    return pick_same_tick_winner(same_tick_requests, config_.topology, state_.round_robin_last);
+  }
+  // The original signature, so callers passing braced lists keep compiling.
+  [[nodiscard]] std::optional<std::size_t> pick_winner(const std::vector<BusRequest> &same_tick_requests) const {
+    return pick_winner(std::span<const BusRequest>(same_tick_requests));
+  }
+  [[nodiscard]] std::uint64_t bus_free_tick() const { return state_.bus_free_tick; }
+  [[nodiscard]] ArbiterState state() const { return state_; }
+  void restore(const ArbiterState &state) { state_ = state; }
+
+  [[nodiscard]] const TimingPolicy &timing() const { return timing_; }
 
 private:
-  [[nodiscard]] std::uint32_t service_cycles(const BusRequest &req) const;
-  [[nodiscard]] static int priority(BusMasterId id);
+  [[nodiscard]] std::uint32_t service_cycles(const BusRequest &req) const {
+    return std::max(1U, timing_.access_cycles(req.addr, req.is_write, req.size_bytes));
+  }
+
+  // Commits into `state`; returns the tick the grant starts at.
+  std::uint64_t grant(ArbiterState &state, const BusRequest &req, std::uint64_t tick_start, bool had_tie) const {
+    const std::uint64_t actual_start = std::max(tick_start, state.bus_free_tick);
+    std::uint64_t duration = service_cycles(req);
+    if (state.has_last_granted_addr && req.addr == state.last_granted_addr) {
+      duration += config_.same_address_contention;
+    }
+    if (had_tie) {
+      duration += config_.tie_turnaround;
+    }
+    state.bus_free_tick = actual_start + duration;
+    state.has_last_granted_addr = true;
+    state.last_granted_addr = req.addr;
+    state.round_robin_last = note_round_robin_grant(config_.topology, state.round_robin_last, req.master_id);
+    return actual_start;
+  }
+
+  void record_grant(ArbiterState &state, std::span<const BusRequest> requests, std::size_t index, bool had_tie, BusGrant &out) const {
+    const BusRequest &req = requests[index];
+    const std::uint64_t start = grant(state, req, req.now_tick, had_tie);
+    out = BusGrant{index, start, state.bus_free_tick, static_cast<std::uint32_t>(std::min<std::uint64_t>(start - req.now_tick, 0xFFFFFFFFULL)), had_tie};
+  }
 
-  TimingCallbacks callbacks_{};
+  TimingPolicy timing_;
   ArbiterConfig config_{};
-  std::uint64_t bus_free_tick_ = 0;
-  bool has_last_granted_addr_ = false;
-  std::uint32_t last_granted_addr_ = 0;
-  std::optional<BusMasterId> last_granted_cpu_ = std::nullopt;
+  ArbiterState state_{};
+};
+
+// TimingPolicy that calls through a runtime TimingCallbacks pair.
+struct CallbackTiming {
+  TimingCallbacks callbacks{};
+
+  [[nodiscard]] std::uint32_t access_cycles(std::uint32_t addr, bool is_write, std::uint8_t size_bytes) const {
+    return callbacks.access_cycles(callbacks.ctx, addr, is_write, size_bytes);
+  }
+};
+
+// The arbiter over runtime callbacks; the original API.
+class Arbiter : public BasicArbiter<CallbackTiming> {
+public:
+  explicit Arbiter(TimingCallbacks callbacks, ArbiterConfig config = {});
 };
 
 } // namespace busarb
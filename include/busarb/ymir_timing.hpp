@@ -1,9 +1,71 @@
 #pragma once
 
+#include "busarb/busarb.hpp"
+
+#include <array>
+#include <cstddef>
 #include <cstdint>
+#include <span>
 
 namespace busarb {
 
+// One row of the region timing table behind ymir_access_cycles. Rows are
+// matched first-to-last; addresses outside every row use the unmapped cycles.
+struct YmirRegionTiming {
+  std::uint32_t start;
+  std::uint32_t end;
+  std::uint32_t read_cycles;
+  std::uint32_t write_cycles;
+  const char *name;
+};
+
+inline constexpr std::uint32_t kYmirUnmappedReadCycles = 4U;
+inline constexpr std::uint32_t kYmirUnmappedWriteCycles = 2U;
+// Rows in ymir_region_timings(); region ids run 0..kYmirRegionCount, the last
+// one meaning unmapped.
+inline constexpr std::size_t kYmirRegionCount = 16;
+
+// What an address maps to: its row index (kYmirRegionCount if unmapped) and
+// that row's cycles. Addresses are looked up in a constexpr-generated table of
+// 64 KB pages, so a lookup is a single load.
+struct YmirRegionPage {
+  std::uint8_t region;
+  std::uint8_t read_cycles;
+  std::uint8_t write_cycles;
+  std::uint8_t reserved;
+};
+
+inline constexpr std::uint32_t kYmirRegionPageShift = 16U;
+inline constexpr std::size_t kYmirRegionPageCount = std::size_t{1} << (32U - kYmirRegionPageShift);
+// The one row that starts mid-page (SH-2 on-chip registers). Its entry
+// follows the page entries.
+inline constexpr std::uint32_t kYmirSplitRegionStart = 0xFFFFFE00U;
+
+namespace detail {
+// Generated from the timing rows in ymir_timing.cpp.
+extern const std::array<YmirRegionPage, kYmirRegionPageCount + 1U> kYmirRegionPages;
+} // namespace detail
+
 std::uint32_t ymir_access_cycles(void *ctx, std::uint32_t addr, bool is_write, std::uint8_t size_bytes);
 
+[[nodiscard]] std::span<const YmirRegionTiming> ymir_region_timings();
+// Index of the row `addr` falls in, or ymir_region_timings().size() if unmapped.
+[[nodiscard]] std::size_t ymir_region_index(std::uint32_t addr);
+
+[[nodiscard]] inline YmirRegionPage ymir_region_lookup(std::uint32_t addr) {
+  const std::size_t page = addr >= kYmirSplitRegionStart ? kYmirRegionPageCount : (addr >> kYmirRegionPageShift);
+  return detail::kYmirRegionPages[page];
+}
+
+// ymir_access_cycles as a BasicArbiter timing policy, inlined into the
+// arbiter instead of called through TimingCallbacks.
+struct YmirTiming {
+  [[nodiscard]] std::uint32_t access_cycles(std::uint32_t addr, bool is_write, std::uint8_t) const {
+    const YmirRegionPage page = ymir_region_lookup(addr);
+    return is_write ? page.write_cycles : page.read_cycles;
+  }
+};
+
+using YmirArbiter = BasicArbiter<YmirTiming>;
+
 } // namespace busarb
@@ -1,115 +1,169 @@
 #include "busarb/busarb.hpp"
 
 #include <algorithm>
+#include <bit>
 #include <cassert>
 
 namespace busarb {
-
-Arbiter::Arbiter(TimingCallbacks callbacks, ArbiterConfig config) : callbacks_(callbacks), config_(config) {
-  assert(callbacks_.access_cycles != nullptr && "TimingCallbacks.access_cycles must be non-null");
+namespace {
+
+// Masters in some priority class; the rest form the implicit lowest class.
+BusMasterMask classified_masters(const BusMasterTopology &topology) {
+  BusMasterMask classified = 0;
+  for (const BusMasterMask cls : topology.priority_classes) {
+    if (cls == 0U) {
+      break;
+    }
+    classified |= cls;
+  }
+  return classified;
 }
 
-BusWaitResult Arbiter::query_wait(const BusRequest &req) const {
-  if (req.now_tick >= bus_free_tick_) {
-    return BusWaitResult{false, 0U};
+// The class `master` (one bit) arbitrates in, as a mask.
+BusMasterMask class_of(const BusMasterTopology &topology, BusMasterMask master) {
+  for (const BusMasterMask cls : topology.priority_classes) {
+    if (cls == 0U) {
+      break;
+    }
+    if ((cls & master) != 0U) {
+      return cls;
+    }
   }
-  const std::uint64_t delta = bus_free_tick_ - req.now_tick;
-  return BusWaitResult{true, static_cast<std::uint32_t>(std::min<std::uint64_t>(delta, 0xFFFFFFFFULL))};
+  return ~classified_masters(topology);
 }
 
-void Arbiter::commit_grant(const BusRequest &req, std::uint64_t tick_start, bool had_tie) {
-  const std::uint64_t actual_start = std::max(tick_start, bus_free_tick_);
-  std::uint64_t duration = service_cycles(req);
-  if (has_last_granted_addr_ && req.addr == last_granted_addr_) {
-    duration += config_.same_address_contention;
-  }
-  if (had_tie) {
-    duration += config_.tie_turnaround;
+// The master granted first among `contending` (non-empty), as its bit.
+BusMasterMask winning_master(const BusMasterTopology &topology, BusMasterMask contending, BusMasterMask round_robin_last) {
+  BusMasterMask classified = 0;
+  BusMasterMask candidates = 0;
+  for (const BusMasterMask cls : topology.priority_classes) {
+    if (cls == 0U) {
+      break;
+    }
+    candidates = contending & cls;
+    if (candidates != 0U) {
+      break;
+    }
+    classified |= cls;
   }
-  bus_free_tick_ = actual_start + duration;
-  has_last_granted_addr_ = true;
-  last_granted_addr_ = req.addr;
-  if (req.master_id == BusMasterId::SH2_A || req.master_id == BusMasterId::SH2_B) {
-    last_granted_cpu_ = req.master_id;
+  if (candidates == 0U) {
+    candidates = contending & ~classified;
   }
+  // Round robin over the lowest candidate's group: the first contending
+  // member above the group's last grant, wrapping to the lowest. A master
+  // outside every group has no group bits and wins as the lowest candidate.
+  const BusMasterMask group_mask = topology.round_robin_groups[static_cast<std::size_t>(std::countr_zero(candidates))];
+  const BusMasterMask group = candidates & group_mask;
+  const BusMasterMask last = round_robin_last & group_mask;
+  const BusMasterMask after = group & ~((last << 1U) - 1U);
+  const BusMasterMask pool = group == 0U ? candidates : (after != 0U ? after : group);
+  return pool & (~pool + 1U);
 }
 
-std::optional<std::size_t> Arbiter::pick_winner(const std::vector<BusRequest> &same_tick_requests) const {
-  if (same_tick_requests.empty()) {
-    return std::nullopt;
+// Among one master's requests: true when `cand` is granted ahead of `cur`,
+// the scan's best so far.
+bool same_master_precedes(const BusRequest &cand, const BusRequest &cur) {
+  if (cand.addr != cur.addr) {
+    return cand.addr < cur.addr;
   }
+  if (cand.is_write && !cur.is_write) {
+    return true;
+  }
+  return cand.size_bytes < cur.size_bytes;
+}
 
-  std::size_t best = 0U;
-  for (std::size_t i = 1; i < same_tick_requests.size(); ++i) {
-    const auto &cand = same_tick_requests[i];
-    const auto &cur = same_tick_requests[best];
-
-    const int cprio = priority(cand.master_id);
-    const int bprio = priority(cur.master_id);
-    if (cprio > bprio) {
-      best = i;
-      continue;
-    }
-    if (cprio < bprio) {
-      continue;
-    }
+} // namespace
 
-    if (cand.master_id != BusMasterId::DMA && cur.master_id != BusMasterId::DMA && cand.master_id != cur.master_id) {
-      BusMasterId preferred = BusMasterId::SH2_A;
-      if (last_granted_cpu_.has_value()) {
-        preferred = (*last_granted_cpu_ == BusMasterId::SH2_A) ? BusMasterId::SH2_B : BusMasterId::SH2_A;
-      }
-      if (cand.master_id == preferred) {
-        best = i;
-      }
-      continue;
-    }
+Arbiter::Arbiter(TimingCallbacks callbacks, ArbiterConfig config) : BasicArbiter(CallbackTiming{callbacks}, config) {
+  assert(callbacks.access_cycles != nullptr && "TimingCallbacks.access_cycles must be non-null");
+}
 
-    if (static_cast<int>(cand.master_id) < static_cast<int>(cur.master_id)) {
-      best = i;
-      continue;
+bool valid_bus_topology(const BusMasterTopology &topology) {
+  BusMasterMask classified = 0;
+  bool ended = false;
+  for (const BusMasterMask cls : topology.priority_classes) {
+    ended = ended || cls == 0U;
+    if (ended ? cls != 0U : (classified & cls) != 0U) {
+      return false; // overlapping, or after the terminating 0 and so ignored
     }
-    if (cand.master_id != cur.master_id) {
+    classified |= cls;
+  }
+  for (std::size_t m = 0; m < kMaxBusMasters; ++m) {
+    const BusMasterMask group = topology.round_robin_groups[m];
+    const BusMasterMask self = BusMasterMask{1} << m;
+    if (group == 0U) {
       continue;
     }
-
-    if (cand.addr < cur.addr) {
-      best = i;
-      continue;
+    if ((group & self) == 0U || (group & ~class_of(topology, self)) != 0U) {
+      return false;
     }
-    if (cand.addr > cur.addr) {
-      continue;
+    for (std::size_t n = 0; n < kMaxBusMasters; ++n) {
+      if ((group & (BusMasterMask{1} << n)) != 0U && topology.round_robin_groups[n] != group) {
+        return false;
+      }
     }
+  }
+  return true;
+}
 
-    if (cand.is_write != cur.is_write && cand.is_write) {
-      best = i;
-      continue;
-    }
+std::optional<std::size_t> pick_same_tick_winner(std::span<const BusRequest> same_tick_requests, const BusMasterTopology &topology,
+                                                 BusMasterMask round_robin_last) {
+  if (same_tick_requests.empty()) {
+    return std::nullopt;
+  }
+
+  BusMasterMask contending = 0;
+  for (const BusRequest &req : same_tick_requests) {
+    contending |= bus_master_bit(req.master_id);
+  }
+  const BusMasterMask winner = winning_master(topology, contending, round_robin_last);
 
-    if (cand.size_bytes < cur.size_bytes) {
+  std::size_t best = same_tick_requests.size();
+  for (std::size_t i = 0; i < same_tick_requests.size(); ++i) {
+    const BusRequest &req = same_tick_requests[i];
+    if (bus_master_bit(req.master_id) == winner && (best == same_tick_requests.size() || same_master_precedes(req, same_tick_requests[best]))) {
       best = i;
     }
   }
   return best;
 }
 
-std::uint64_t Arbiter::bus_free_tick() const { return bus_free_tick_; }
-
-std::uint32_t Arbiter::service_cycles(const BusRequest &req) const {
-  const std::uint32_t cycles = callbacks_.access_cycles(callbacks_.ctx, req.addr, req.is_write, req.size_bytes);
-  return std::max(1U, cycles);
-}
-
-int Arbiter::priority(BusMasterId id) {
-  switch (id) {
-  case BusMasterId::DMA:
-    return 2;
-  case BusMasterId::SH2_A:
-    return 1;
-  case BusMasterId::SH2_B:
-    return 1;
+void order_same_tick_grants(std::span<const BusRequest> group, const BusMasterTopology &topology, BusMasterMask round_robin_last,
+                            std::span<BusGrant> grants) {
+  const std::size_t count = std::min(group.size(), grants.size());
+  // grants[k..count) holds the requests not yet granted, in arrival order,
+  // which is the order pick_same_tick_winner() would scan them in.
+  for (std::size_t k = 0; k < count; ++k) {
+    grants[k].request_index = k;
+  }
+  for (std::size_t k = 0; k < count; ++k) {
+    BusMasterMask contending = 0;
+    for (std::size_t i = k; i < count; ++i) {
+      contending |= bus_master_bit(group[grants[i].request_index].master_id);
+    }
+    const BusMasterMask winner = winning_master(topology, contending, round_robin_last);
+
+    std::size_t best = count;
+    std::size_t winner_requests = 0;
+    for (std::size_t i = k; i < count; ++i) {
+      const BusRequest &req = group[grants[i].request_index];
+      if (bus_master_bit(req.master_id) != winner) {
+        continue;
+      }
+      ++winner_requests;
+      if (best == count || same_master_precedes(req, group[grants[best].request_index])) {
+        best = i;
+      }
+    }
+    const std::size_t index = grants[best].request_index;
+    const bool had_tie = winner_requests > 1U || (contending & class_of(topology, winner) & ~winner) != 0U;
+    for (std::size_t i = best; i > k; --i) {
+      grants[i].request_index = grants[i - 1U].request_index;
+    }
+    grants[k].request_index = index;
+    grants[k].had_tie = had_tie;
+    round_robin_last = note_round_robin_grant(topology, round_robin_last, group[index].master_id);
   }
-  return 0;
 }
 
 } // namespace busarb
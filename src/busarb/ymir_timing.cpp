@@ -1,45 +1,97 @@
 #include "busarb/ymir_timing.hpp"
 
+#include <array>
 #include <cstdint>
+#include <iterator>
 
 namespace busarb {
 namespace {
 
-struct RegionTiming {
-  std::uint32_t start;
-  std::uint32_t end;
-  std::uint32_t read_cycles;
-  std::uint32_t write_cycles;
+constexpr YmirRegionTiming kRegionTimings[] = {
+    {0x00000000U, 0x00FFFFFFU, 2U, 2U, "BIOS ROM"},
+    {0x01000000U, 0x017FFFFFU, 4U, 2U, "SMPC"},
+    {0x01800000U, 0x01FFFFFFU, 2U, 2U, "Backup RAM"},
+    {0x02000000U, 0x02FFFFFFU, 2U, 2U, "Low WRAM"},
+    {0x10000000U, 0x1FFFFFFFU, 4U, 2U, "MINIT/SINIT"},
+    {0x20000000U, 0x4FFFFFFFU, 2U, 2U, "A-Bus CS0/CS1"},
+    {0x05000000U, 0x057FFFFFU, 8U, 2U, "A-Bus dummy"},
+    {0x05800000U, 0x058FFFFFU, 40U, 40U, "CD Block CS2"},
+    {0x05A00000U, 0x05BFFFFFU, 40U, 2U, "SCSP"},
+    {0x05C00000U, 0x05C7FFFFU, 22U, 2U, "VDP1 VRAM"},
+    {0x05C80000U, 0x05CFFFFFU, 22U, 2U, "VDP1 FB"},
+    {0x05D00000U, 0x05D7FFFFU, 14U, 2U, "VDP1 regs"},
+    {0x05E00000U, 0x05FBFFFFU, 20U, 2U, "VDP2"},
+    {0x05FE0000U, 0x05FEFFFFU, 4U, 2U, "SCU regs"},
+    {0x06000000U, 0x07FFFFFFU, 2U, 2U, "High WRAM"},
+    {0xFFFFFE00U, 0xFFFFFFFFU, 2U, 2U, "SH-2 on-chip regs"},
 };
 
-constexpr RegionTiming kRegionTimings[] = {
-    {0x00000000U, 0x00FFFFFFU, 2U, 2U}, // BIOS ROM
-    {0x01000000U, 0x017FFFFFU, 4U, 2U}, // SMPC
-    {0x01800000U, 0x01FFFFFFU, 2U, 2U}, // Backup RAM
-    {0x02000000U, 0x02FFFFFFU, 2U, 2U}, // Low WRAM
-    {0x10000000U, 0x1FFFFFFFU, 4U, 2U}, // MINIT/SINIT
-    {0x20000000U, 0x4FFFFFFFU, 2U, 2U}, // A-Bus CS0/CS1
-    {0x05000000U, 0x057FFFFFU, 8U, 2U}, // A-Bus dummy
-    {0x05800000U, 0x058FFFFFU, 40U, 40U}, // CD Block CS2
-    {0x05A00000U, 0x05BFFFFFU, 40U, 2U}, // SCSP
-    {0x05C00000U, 0x05C7FFFFU, 22U, 2U}, // VDP1 VRAM
-    {0x05C80000U, 0x05CFFFFFU, 22U, 2U}, // VDP1 FB
-    {0x05D00000U, 0x05D7FFFFU, 14U, 2U}, // VDP1 regs
-    {0x05E00000U, 0x05FBFFFFU, 20U, 2U}, // VDP2
-    {0x05FE0000U, 0x05FEFFFFU, 4U, 2U}, // SCU regs
-    {0x06000000U, 0x07FFFFFFU, 2U, 2U}, // High WRAM
-    {0xFFFFFE00U, 0xFFFFFFFFU, 2U, 2U}, // SH-2 on-chip regs
+static_assert(std::size(kRegionTimings) == kYmirRegionCount, "kYmirRegionCount must match the timing table");
+
+// Page table over the whole 32-bit address space, generated from
+// kRegionTimings at compile time. Rows must start and end on page bounds,
+// except for the one row at kYmirSplitRegionStart, which runs to 0xFFFFFFFF
+// and has the extra entry after the pages.
+constexpr std::uint32_t kPageMask = (1U << kYmirRegionPageShift) - 1U;
+constexpr std::size_t kSplitEntry = kYmirRegionPageCount;
+
+struct RegionPageTable {
+  std::array<YmirRegionPage, kYmirRegionPageCount + 1U> pages{};
+  bool valid = true;
 };
 
-} // namespace
+constexpr YmirRegionPage make_region_page(std::size_t region) {
+  if (region == std::size(kRegionTimings)) {
+    return YmirRegionPage{static_cast<std::uint8_t>(region), static_cast<std::uint8_t>(kYmirUnmappedReadCycles),
+                          static_cast<std::uint8_t>(kYmirUnmappedWriteCycles), 0U};
+  }
+  return YmirRegionPage{static_cast<std::uint8_t>(region), static_cast<std::uint8_t>(kRegionTimings[region].read_cycles),
+                        static_cast<std::uint8_t>(kRegionTimings[region].write_cycles), 0U};
+}
 
-std::uint32_t ymir_access_cycles(void *, std::uint32_t addr, bool is_write, std::uint8_t) {
-  for (const auto &region : kRegionTimings) {
-    if (addr >= region.start && addr <= region.end) {
-      return is_write ? region.write_cycles : region.read_cycles;
+constexpr RegionPageTable build_region_pages() {
+  RegionPageTable table{};
+  table.pages.fill(make_region_page(std::size(kRegionTimings)));
+  // Last row first, so that earlier rows win where rows overlap, as in a
+  // first-to-last scan.
+  for (std::size_t i = std::size(kRegionTimings); i-- > 0U;) {
+    const YmirRegionTiming &row = kRegionTimings[i];
+    if (row.read_cycles > 0xFFU || row.write_cycles > 0xFFU || row.end < row.start) {
+      table.valid = false;
+      return table;
+    }
+    if (row.end >= kYmirSplitRegionStart) {
+      table.pages[kSplitEntry] = make_region_page(i);
+    }
+    if (row.start == kYmirSplitRegionStart && row.end == 0xFFFFFFFFU) {
+      continue;
+    }
+    if ((row.start & kPageMask) != 0U || (row.end & kPageMask) != kPageMask) {
+      table.valid = false;
+      return table;
+    }
+    for (std::uint32_t page = row.start >> kYmirRegionPageShift; page <= (row.end >> kYmirRegionPageShift); ++page) {
+      table.pages[page] = make_region_page(i);
     }
   }
-  return is_write ? 2U : 4U;
+  return table;
+}
+
+constexpr RegionPageTable kRegionPages = build_region_pages();
+static_assert(kRegionPages.valid, "kRegionTimings rows must be page aligned and fit 8-bit cycle counts");
+
+} // namespace
+
+namespace detail {
+constexpr std::array<YmirRegionPage, kYmirRegionPageCount + 1U> kYmirRegionPages = kRegionPages.pages;
+} // namespace detail
+
+std::span<const YmirRegionTiming> ymir_region_timings() { return kRegionTimings; }
+
+std::size_t ymir_region_index(std::uint32_t addr) { return ymir_region_lookup(addr).region; }
+
+std::uint32_t ymir_access_cycles(void *, std::uint32_t addr, bool is_write, std::uint8_t size_bytes) {
+  return YmirTiming{}.access_cycles(addr, is_write, size_bytes);
 }
 
 } // namespace busarb
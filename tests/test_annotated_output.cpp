@@ -0,0 +1,87 @@
+#include "trace_replay/annotated_output.hpp"
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <limits>
+#include <string>
+
+namespace {
+
+using trace_replay::AnnotatedFile;
+using trace_replay::AnnotatedFormat;
+using trace_replay::BinaryAnnotatedRecordV1;
+using trace_replay::OutputBuffer;
+
+void check(bool cond, const char *msg) {
+  if (!cond) {
+    std::cerr << "FAIL: " << msg << '\n';
+    std::exit(1);
+  }
+}
+
+std::string read_file(const std::filesystem::path &path) {
+  std::ifstream in(path, std::ios::binary);
+  return {std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+}
+
+void test_buffer_formatting() {
+  OutputBuffer out;
+  out.append("{\"a\":");
+  out.append_int(std::numeric_limits<std::int64_t>::min());
+  out.append(',');
+  out.append_int(std::numeric_limits<std::uint64_t>::max());
+  out.append(',');
+  out.append_int(std::uint8_t{4});
+  out.append(",\"s\":\"");
+  out.append_escaped("a\"b\\c");
+  out.append("\"}");
+  check(out.view() == "{\"a\":-9223372036854775808,18446744073709551615,4,\"s\":\"a\\\"b\\\\c\"}", "to_chars and escaping");
+  out.clear();
+  check(out.size() == 0U, "clear empties the buffer");
+}
+
+// Rows are written whole and in order across block flushes, after the header.
+void test_binary_file() {
+  const auto path = std::filesystem::temp_directory_path() / "annotated_output_test.bta";
+  constexpr std::uint64_t kRows = 25000; // > kFlushBytes worth of rows
+  AnnotatedFile file;
+  check(file.open(path.string(), AnnotatedFormat::Binary), "binary file opens");
+  for (std::uint64_t i = 0; i < kRows; ++i) {
+    BinaryAnnotatedRecordV1 row{};
+    row.seq = i + 1U;
+    row.cumulative_drift_wait = -static_cast<std::int64_t>(i);
+    row.flags = trace_replay::kAnnotatedHasModel;
+    file.buffer().append_raw(row);
+    file.commit();
+    check(file.buffer().size() < AnnotatedFile::kFlushBytes, "commit bounds the pending bytes");
+  }
+  check(file.close(), "binary file closes");
+
+  const std::string bytes = read_file(path);
+  check(bytes.size() == 8U + kRows * sizeof(BinaryAnnotatedRecordV1), "header plus fixed-size rows");
+  check(bytes.compare(0, 4, "BTA1") == 0 && bytes[4] == 1 && bytes[5] == 0 && bytes[6] == 104 && bytes[7] == 0, "binary header");
+  for (std::uint64_t i : {std::uint64_t{0}, std::uint64_t{9999}, kRows - 1U}) {
+    BinaryAnnotatedRecordV1 row{};
+    std::memcpy(&row, bytes.data() + 8U + i * sizeof(row), sizeof(row));
+    check(row.seq == i + 1U && row.cumulative_drift_wait == -static_cast<std::int64_t>(i) && row.flags == 1U, "row round trips");
+  }
+
+  check(file.open(path.string(), AnnotatedFormat::Jsonl), "jsonl file reopens");
+  file.buffer().append("{}\n");
+  check(file.close() && read_file(path) == "{}\n", "jsonl output has no header");
+  std::filesystem::remove(path);
+}
+
+} // namespace
+
+int main() {
+  test_buffer_formatting();
+  test_binary_file();
+  std::cout << "annotated output tests passed\n";
+  return 0;
+}
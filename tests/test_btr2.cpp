@@ -0,0 +1,168 @@
+#include "trace_replay/btr2.hpp"
+
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+using trace_replay::Btr2Column;
+using trace_replay::TraceRecord;
+
+void check(bool cond, const char *msg) {
+  if (!cond) {
+    std::cerr << "FAIL: " << msg << '\n';
+    std::exit(1);
+  }
+}
+
+std::vector<TraceRecord> sample_records(std::size_t count) {
+  static constexpr std::uint32_t kAddrs[] = {0x06004000U, 0x02000000U, 0x05C00100U, 0x05FE0020U, 0x00001000U, 0xFFFFFE10U};
+  std::vector<TraceRecord> records;
+  std::uint64_t state = 0x9E3779B97F4A7C15ULL;
+  std::uint64_t tick = 1000;
+  for (std::size_t i = 0; i < count; ++i) {
+    state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+    const auto r = static_cast<std::uint32_t>(state >> 33);
+    tick += r % 4U;
+    TraceRecord rec{};
+    rec.seq = (r % 50U == 0U) ? i : i + 1U; // occasional duplicate/backwards seq
+    rec.master = static_cast<trace_replay::Master>((r >> 3) % 3U);
+    rec.tick_complete = tick;
+    // Proxy-tick records have tick_complete < tick_first_attempt.
+    rec.tick_first_attempt = (r % 97U == 0U) ? tick + 5U : tick - (r >> 7) % 9U;
+    rec.addr = kAddrs[(r >> 11) % 6U] + ((r >> 13) % 64U) * 4U;
+    rec.region = trace_replay::region_of(rec.addr);
+    rec.size = static_cast<std::uint8_t>(1U << ((r >> 17) % 3U));
+    rec.rw = static_cast<trace_replay::Rw>((r >> 19) % 2U);
+    rec.kind = static_cast<trace_replay::AccessKind>((r >> 20) % 5U);
+    rec.service_cycles = 1U + (r >> 23) % 20U;
+    rec.retries = (r % 1000U == 0U) ? 0xFFFFFFFFU : (r >> 27) % 3U;
+    rec.source_line = i + 1U;
+    records.push_back(rec);
+  }
+  return records;
+}
+
+std::string encode(const std::vector<TraceRecord> &records, std::uint32_t block_records) {
+  std::ostringstream out(std::ios::binary);
+  trace_replay::Btr2Writer writer(out, block_records);
+  for (const auto &rec : records) {
+    check(writer.append(rec), "canonical record encodes");
+  }
+  check(writer.finish(), "writer finishes");
+  check(writer.records_written() == records.size(), "all records written");
+  return out.str();
+}
+
+std::span<const std::uint8_t> as_bytes(const std::string &data) {
+  return {reinterpret_cast<const std::uint8_t *>(data.data()), data.size()};
+}
+
+void test_round_trip() {
+  const auto records = sample_records(2500);
+  const std::string data = encode(records, 1000);
+  const auto view = trace_replay::open_btr2_view(as_bytes(data));
+  check(view.has_value(), "view opens");
+  check(view->blocks.size() == 3U, "2500 records in 1000-record blocks");
+  check(view->record_count == records.size(), "record count");
+
+  std::vector<TraceRecord> decoded;
+  std::vector<std::uint32_t> malformed;
+  std::uint64_t first_index = 0;
+  for (std::size_t block = 0; block < view->blocks.size(); ++block) {
+    check(trace_replay::decode_btr2_block(*view, block, trace_replay::kBtr2AllColumns, first_index, decoded, malformed), "block decodes");
+    check(malformed.empty(), "no malformed records");
+    const auto &info = view->blocks[block];
+    check(info.first_seq == records[first_index].seq, "index first_seq");
+    check(info.first_tick_complete == records[first_index].tick_complete, "index first_tick_complete");
+    for (std::size_t i = 0; i < decoded.size(); ++i) {
+      const auto &a = records[first_index + i];
+      const auto &b = decoded[i];
+      check(a.seq == b.seq && a.tick_first_attempt == b.tick_first_attempt && a.tick_complete == b.tick_complete, "ticks/seq round-trip");
+      check(a.addr == b.addr && a.region == b.region && a.size == b.size, "addr/size round-trip");
+      check(a.master == b.master && a.rw == b.rw && a.kind == b.kind, "attrs round-trip");
+      check(a.service_cycles == b.service_cycles && a.retries == b.retries, "service/retries round-trip");
+      check(b.source_line == first_index + i + 1U, "source_line is index + 1");
+      check(info.min_tick_complete <= b.tick_complete && b.tick_complete <= info.max_tick_complete, "index tick bounds");
+      check(info.min_seq <= b.seq && b.seq <= info.max_seq, "index seq bounds");
+    }
+    first_index += decoded.size();
+  }
+
+  // Typical captures should be far below BTR1's 48 bytes per record.
+  check(data.size() * 5U < records.size() * 48U, "BTR2 is at least 5x smaller than BTR1");
+}
+
+void test_column_skipping() {
+  const auto records = sample_records(300);
+  const std::string data = encode(records, 128);
+  const auto view = trace_replay::open_btr2_view(as_bytes(data));
+  check(view.has_value(), "view opens");
+  std::vector<TraceRecord> decoded;
+  std::vector<std::uint32_t> malformed;
+  check(trace_replay::decode_btr2_block(*view, 0, trace_replay::btr2_column_bit(Btr2Column::TickFirstAttempt), 0, decoded, malformed),
+        "partial decode");
+  for (std::size_t i = 0; i < decoded.size(); ++i) {
+    check(decoded[i].tick_complete == records[i].tick_complete, "tick_first_attempt pulls in tick_complete");
+    check(decoded[i].tick_first_attempt == records[i].tick_first_attempt, "tick_first_attempt decoded");
+    check(decoded[i].seq == 0U && decoded[i].addr == 0U && decoded[i].service_cycles == 0U, "skipped columns stay default");
+  }
+}
+
+void test_rejects_unencodable_and_corrupt() {
+  std::ostringstream out(std::ios::binary);
+  trace_replay::Btr2Writer writer(out, 16);
+  TraceRecord bad{};
+  bad.size = 8;
+  check(!writer.append(bad), "size 8 has no BTR2 encoding");
+  bad.size = 4;
+  bad.master = static_cast<trace_replay::Master>(7);
+  check(!writer.append(bad), "interned master has no BTR2 encoding");
+  check(writer.finish(), "empty file finishes");
+  const std::string empty = out.str();
+  const auto view = trace_replay::open_btr2_view(as_bytes(empty));
+  check(view.has_value() && view->blocks.empty(), "empty file has no blocks");
+
+  const std::string data = encode(sample_records(100), 64);
+  check(!trace_replay::open_btr2_view(as_bytes(data.substr(0, data.size() - 3))).has_value(), "truncated trailer rejected");
+  std::string wrong_version = data;
+  wrong_version[4] = 9;
+  check(!trace_replay::open_btr2_view(as_bytes(wrong_version)).has_value(), "unknown version rejected");
+  // A block index entry claiming more records than the block has bytes.
+  std::string huge_count = data;
+  const std::size_t index_start =
+      data.size() - trace_replay::kBtr2TrailerSize - trace_replay::open_btr2_view(as_bytes(data))->blocks.size() * trace_replay::kBtr2IndexEntrySize;
+  huge_count.replace(index_start + 12U, 4U, 4U, '\xFF');
+  check(!trace_replay::open_btr2_view(as_bytes(huge_count)).has_value(), "oversized block record count rejected");
+
+  // Attribute byte with master=3 decodes as a malformed record, not an error.
+  std::string bad_attrs = data;
+  const auto corrupt_view = trace_replay::open_btr2_view(as_bytes(bad_attrs));
+  check(corrupt_view.has_value(), "view opens");
+  const std::size_t block_offset = static_cast<std::size_t>(corrupt_view->blocks[0].offset);
+  std::size_t attrs_offset = block_offset + 5U + 7U * 5U;
+  for (std::size_t id = 0; id < static_cast<std::size_t>(Btr2Column::Attrs); ++id) {
+    const auto *entry = reinterpret_cast<const std::uint8_t *>(bad_attrs.data()) + block_offset + 5U + id * 5U;
+    attrs_offset += static_cast<std::size_t>(entry[1] | (entry[2] << 8) | (entry[3] << 16) | (entry[4] << 24));
+  }
+  bad_attrs[attrs_offset + 2U] = static_cast<char>(bad_attrs[attrs_offset + 2U] | 0x3);
+  const auto reopened = trace_replay::open_btr2_view(as_bytes(bad_attrs));
+  std::vector<TraceRecord> decoded;
+  std::vector<std::uint32_t> malformed;
+  check(trace_replay::decode_btr2_block(*reopened, 0, trace_replay::kBtr2AllColumns, 0, decoded, malformed), "block still decodes");
+  check(malformed.size() == 1U && malformed[0] == 2U, "bad attrs reported by index");
+}
+
+} // namespace
+
+int main() {
+  test_round_trip();
+  test_column_skipping();
+  test_rejects_unencodable_and_corrupt();
+  std::cout << "btr2 tests passed\n";
+  return 0;
+}
@@ -1,8 +1,11 @@
 #include "busarb/busarb.hpp"
+#include "busarb/ymir_timing.hpp"
 
+#include <algorithm>
 #include <array>
 #include <cstdlib>
 #include <iostream>
+#include <span>
 #include <vector>
 
 namespace {
@@ -164,6 +167,322 @@ void test_round_robin_cpu_tie_break_alternates() {
   auto third = arb.pick_winner(tie);
   check(third.has_value() && tie[*third].master_id == busarb::BusMasterId::SH2_A,
         "third CPU tie should alternate back to SH2_A");
+  check(arb.pick_winner({tie[1], tie[0]}) == 1U, "braced request lists still pick the round-robin winner");
+}
+
+void test_state_snapshot_restore_resumes_identically() {
+  busarb::Arbiter original({fixed_cycles, nullptr});
+  original.commit_grant({busarb::BusMasterId::SH2_A, 0x1000U, false, 4U, 0U}, 0U);
+  original.commit_grant({busarb::BusMasterId::SH2_B, 0x1000U, true, 2U, 3U}, 3U);
+  const busarb::ArbiterState snapshot = original.state();
+  check(snapshot.bus_free_tick == original.bus_free_tick(), "snapshot carries bus_free_tick");
+  check(snapshot.has_last_granted_addr && snapshot.last_granted_addr == 0x1000U, "snapshot carries last granted addr");
+  check(snapshot.round_robin_last == busarb::bus_master_bit(busarb::BusMasterId::SH2_B), "snapshot carries last granted cpu");
+
+  busarb::Arbiter resumed({fixed_cycles, nullptr});
+  resumed.restore(snapshot);
+  const busarb::BusRequest next{busarb::BusMasterId::DMA, 0x1000U, false, 4U, 5U};
+  original.commit_grant(next, 5U);
+  resumed.commit_grant(next, 5U);
+  check(resumed.bus_free_tick() == original.bus_free_tick(), "restored arbiter applies same-address contention");
+  const std::vector<busarb::BusRequest> tie{{busarb::BusMasterId::SH2_A, 0x10U, false, 4U, 20U}, {busarb::BusMasterId::SH2_B, 0x10U, false, 4U, 20U}};
+  check(resumed.pick_winner(tie) == original.pick_winner(tie), "restored arbiter keeps round-robin state");
+}
+
+struct ZeroTiming {
+  [[nodiscard]] std::uint32_t access_cycles(std::uint32_t, bool, std::uint8_t) const { return 0U; }
+};
+
+// A statically bound policy grants exactly like the callback arbiter over the
+// same timing function.
+void test_static_policy_matches_callback_arbiter() {
+  const busarb::ArbiterConfig config{3U, 2U};
+  busarb::Arbiter dynamic({busarb::ymir_access_cycles, nullptr}, config);
+  busarb::YmirArbiter fixed(busarb::YmirTiming{}, config);
+  constexpr std::array<std::uint32_t, 6> kAddrs = {0x06000000U, 0x05E00000U, 0x00001000U, 0xFFFFFE10U, 0x05800000U, 0x09000000U};
+  std::uint32_t lcg = 12345U;
+  std::uint64_t tick = 0;
+  for (int i = 0; i < 5000; ++i) {
+    lcg = lcg * 1664525U + 1013904223U;
+    tick += (lcg >> 28U) % 4U;
+    const busarb::BusRequest req{static_cast<busarb::BusMasterId>((lcg >> 8U) % 3U), kAddrs[(lcg >> 12U) % kAddrs.size()], ((lcg >> 16U) & 1U) != 0U,
+                                 static_cast<std::uint8_t>(1U << ((lcg >> 20U) % 3U)), tick};
+    const auto dynamic_wait = dynamic.query_wait(req);
+    const auto fixed_wait = fixed.query_wait(req);
+    check(dynamic_wait.should_wait == fixed_wait.should_wait && dynamic_wait.wait_cycles == fixed_wait.wait_cycles, "static policy query_wait");
+    const std::vector<busarb::BusRequest> tie{req, {busarb::BusMasterId::SH2_A, req.addr, false, 4U, tick}};
+    check(dynamic.pick_winner(tie) == fixed.pick_winner(tie), "static policy pick_winner");
+    const bool had_tie = ((lcg >> 24U) & 3U) == 0U;
+    dynamic.commit_grant(req, tick, had_tie);
+    fixed.commit_grant(req, tick, had_tie);
+    check(dynamic.bus_free_tick() == fixed.bus_free_tick(), "static policy commit_grant");
+  }
+  const busarb::ArbiterState a = dynamic.state();
+  const busarb::ArbiterState b = fixed.state();
+  check(a.bus_free_tick == b.bus_free_tick && a.last_granted_addr == b.last_granted_addr && a.round_robin_last == b.round_robin_last, "static policy state");
+
+  busarb::BasicArbiter<ZeroTiming> zero;
+  zero.commit_grant({busarb::BusMasterId::DMA, 0x10U, false, 4U, 7U}, 7U);
+  check(zero.bus_free_tick() == 8U, "static policy zero cycles clamp to one tick");
+}
+
+bool same_priority(busarb::BusMasterId a, busarb::BusMasterId b) { return (a == busarb::BusMasterId::DMA) == (b == busarb::BusMasterId::DMA); }
+
+// commit_grants over a block equals the adapter loop: per same-tick group,
+// pick_winner over the requests left, commit at now_tick, repeat.
+void test_commit_grants_matches_adapter_loop() {
+  const busarb::ArbiterConfig config{2U, 1U};
+  busarb::Arbiter looped({fixed_cycles, nullptr}, config);
+  busarb::Arbiter batched({fixed_cycles, nullptr}, config);
+  std::vector<busarb::BusRequest> block;
+  std::vector<busarb::BusGrant> grants;
+  std::vector<busarb::BusWaitResult> waits;
+  std::uint32_t lcg = 777U;
+  std::uint64_t tick = 0;
+  for (int round = 0; round < 400; ++round) {
+    block.clear();
+    while (block.size() < 24U) {
+      lcg = lcg * 1664525U + 1013904223U;
+      tick += (lcg >> 28U) % 5U;
+      const std::size_t group = 1U + ((lcg >> 4U) % 4U);
+      for (std::size_t i = 0; i < group; ++i) {
+        lcg = lcg * 1664525U + 1013904223U;
+        block.push_back({static_cast<busarb::BusMasterId>((lcg >> 8U) % 3U), 0x1000U + ((lcg >> 12U) % 3U) * 4U, ((lcg >> 16U) & 1U) != 0U,
+                         static_cast<std::uint8_t>(1U << ((lcg >> 20U) % 3U)), tick});
+      }
+    }
+
+    waits.assign(block.size(), {});
+    check(batched.query_wait_batch(block, waits) == block.size(), "query_wait_batch fills every result");
+    for (std::size_t i = 0; i < block.size(); ++i) {
+      const auto wait = looped.query_wait(block[i]);
+      check(waits[i].should_wait == wait.should_wait && waits[i].wait_cycles == wait.wait_cycles, "query_wait_batch matches query_wait");
+    }
+
+    grants.assign(block.size(), {});
+    check(batched.commit_grants(block, grants) == block.size(), "commit_grants grants every request");
+    std::size_t next = 0;
+    for (std::size_t begin = 0; begin < block.size();) {
+      std::size_t end = begin;
+      std::vector<std::size_t> left;
+      while (end < block.size() && block[end].now_tick == block[begin].now_tick) {
+        left.push_back(end++);
+      }
+      while (!left.empty()) {
+        std::vector<busarb::BusRequest> contenders;
+        for (const std::size_t i : left) {
+          contenders.push_back(block[i]);
+        }
+        const std::size_t pick = *looped.pick_winner(contenders);
+        bool had_tie = false;
+        for (std::size_t i = 0; i < contenders.size(); ++i) {
+          had_tie = had_tie || (i != pick && same_priority(contenders[i].master_id, contenders[pick].master_id));
+        }
+        const busarb::BusRequest &req = contenders[pick];
+        const std::uint64_t start = std::max(req.now_tick, looped.bus_free_tick());
+        looped.commit_grant(req, req.now_tick, had_tie);
+        const busarb::BusGrant &grant = grants[next++];
+        check(grant.request_index == left[pick] && grant.had_tie == had_tie, "commit_grants grant order and tie flag");
+        check(grant.start_tick == start && grant.end_tick == looped.bus_free_tick() && grant.wait_cycles == start - req.now_tick,
+              "commit_grants grant ticks");
+        left.erase(left.begin() + static_cast<std::ptrdiff_t>(pick));
+      }
+      begin = end;
+    }
+    const busarb::ArbiterState a = looped.state();
+    const busarb::ArbiterState b = batched.state();
+    check(a.bus_free_tick == b.bus_free_tick && a.last_granted_addr == b.last_granted_addr && a.round_robin_last == b.round_robin_last,
+          "commit_grants leaves the adapter loop's state");
+  }
+
+  std::array<busarb::BusGrant, 1> small{};
+  const std::uint64_t before = batched.bus_free_tick();
+  check(batched.commit_grants(block, small) == 0U && batched.bus_free_tick() == before, "short grant buffer commits nothing");
+  check(batched.query_wait_batch(block, std::span<busarb::BusWaitResult>(waits.data(), 1U)) == 0U, "short result buffer");
+}
+
+// reserve() lands on the tick a per-tick query/retry caller would, and leaves
+// the same state.
+void test_reserve_matches_retry_loop() {
+  const busarb::ArbiterConfig config{2U, 1U};
+  busarb::Arbiter polled({fixed_cycles, nullptr}, config);
+  busarb::Arbiter reserved({fixed_cycles, nullptr}, config);
+  std::uint32_t lcg = 4242U;
+  std::uint64_t tick = 0;
+  for (int i = 0; i < 3000; ++i) {
+    lcg = lcg * 1664525U + 1013904223U;
+    tick += (lcg >> 27U) % 9U;
+    busarb::BusRequest req{static_cast<busarb::BusMasterId>((lcg >> 8U) % 3U), 0x2000U + ((lcg >> 12U) % 4U) * 4U, ((lcg >> 16U) & 1U) != 0U,
+                           static_cast<std::uint8_t>(1U << ((lcg >> 20U) % 3U)), tick};
+    const bool had_tie = ((lcg >> 24U) & 7U) == 0U;
+
+    busarb::BusRequest retry = req;
+    while (polled.query_wait(retry).should_wait) {
+      ++retry.now_tick;
+    }
+    polled.commit_grant(retry, retry.now_tick, had_tie);
+
+    const std::uint64_t grant_tick = reserved.reserve(req, had_tie);
+    check(grant_tick == retry.now_tick, "reserve returns the retry loop's grant tick");
+    check(reserved.bus_free_tick() == polled.bus_free_tick(), "reserve commits like the retry loop");
+  }
+  const busarb::ArbiterState a = polled.state();
+  const busarb::ArbiterState b = reserved.state();
+  check(a.has_last_granted_addr == b.has_last_granted_addr && a.last_granted_addr == b.last_granted_addr && a.round_robin_last == b.round_robin_last,
+        "reserve leaves the retry loop's state");
+}
+
+busarb::BusMasterId master(std::uint32_t id) { return static_cast<busarb::BusMasterId>(id); }
+
+busarb::BusMasterMask bit(busarb::BusMasterId id) { return busarb::bus_master_bit(id); }
+
+void test_topology_validation() {
+  using busarb::BusMasterId;
+  check(busarb::valid_bus_topology(busarb::default_bus_topology()), "default topology is valid");
+  check(busarb::valid_bus_topology(busarb::BusMasterTopology{}), "empty topology is valid");
+
+  busarb::BusMasterTopology overlap = busarb::default_bus_topology();
+  overlap.priority_classes[2] = bit(BusMasterId::DMA);
+  check(!busarb::valid_bus_topology(overlap), "overlapping classes are rejected");
+
+  busarb::BusMasterTopology gap = busarb::default_bus_topology();
+  gap.priority_classes[3] = bit(BusMasterId::M68K);
+  check(!busarb::valid_bus_topology(gap), "a class after the terminating 0 is rejected");
+
+  busarb::BusMasterTopology split = busarb::default_bus_topology();
+  split.round_robin_groups[static_cast<std::size_t>(BusMasterId::DMA)] = bit(BusMasterId::DMA) | bit(BusMasterId::SH2_A);
+  check(!busarb::valid_bus_topology(split), "a group across classes is rejected");
+
+  busarb::BusMasterTopology lopsided = busarb::default_bus_topology();
+  lopsided.round_robin_groups[static_cast<std::size_t>(BusMasterId::SH2_B)] = bit(BusMasterId::SH2_B);
+  check(!busarb::valid_bus_topology(lopsided), "members must agree on their group");
+}
+
+// SCU DMA levels above the SCU DSP and A-bus DMA, the SH-2s rotating with the
+// M68K, and the CD block left unclassified below everything.
+busarb::BusMasterTopology extended_topology() {
+  using busarb::BusMasterId;
+  busarb::BusMasterTopology topology{};
+  const busarb::BusMasterMask rotating = bit(BusMasterId::SH2_A) | bit(BusMasterId::SH2_B) | bit(BusMasterId::M68K);
+  topology.priority_classes[0] = bit(BusMasterId::SCU_DMA0);
+  topology.priority_classes[1] = bit(BusMasterId::SCU_DMA1) | bit(BusMasterId::SCU_DMA2);
+  topology.priority_classes[2] = bit(BusMasterId::SCU_DSP) | bit(BusMasterId::DMA);
+  topology.priority_classes[3] = rotating;
+  for (const BusMasterId id : {BusMasterId::SH2_A, BusMasterId::SH2_B, BusMasterId::M68K}) {
+    topology.round_robin_groups[static_cast<std::size_t>(id)] = rotating;
+  }
+  return topology;
+}
+
+busarb::BusRequest at(busarb::BusMasterId id, std::uint32_t addr, std::uint64_t tick) { return {id, addr, false, 4U, tick}; }
+
+void test_extended_masters_arbitrate_by_topology() {
+  using busarb::BusMasterId;
+  const busarb::BusMasterTopology topology = extended_topology();
+  check(busarb::valid_bus_topology(topology), "extended topology is valid");
+  busarb::Arbiter arb({fixed_cycles, nullptr}, {.same_address_contention = 0, .tie_turnaround = 0, .topology = topology});
+
+  const std::vector<busarb::BusRequest> all{at(BusMasterId::CD_BLOCK, 0x10U, 0U), at(BusMasterId::SH2_A, 0x10U, 0U), at(BusMasterId::SCU_DSP, 0x10U, 0U),
+                                            at(BusMasterId::SCU_DMA2, 0x10U, 0U), at(BusMasterId::SCU_DMA1, 0x10U, 0U), at(BusMasterId::SCU_DMA0, 0x10U, 0U)};
+  check(arb.pick_winner(all) == 5U, "highest class wins");
+  check(arb.pick_winner(std::span(all).first(5)) == 4U, "lowest-numbered master wins a class without round robin");
+  check(arb.pick_winner(std::span(all).first(3)) == 2U, "SCU DSP class outranks the SH-2s");
+  check(arb.pick_winner(std::span(all).first(1)) == 0U, "unclassified master wins alone");
+  check(arb.pick_winner(std::span(all).first(2)) == 1U, "unclassified master ranks last");
+
+  // Three-way rotation A -> B -> M68K -> A, skipping members that are idle.
+  const std::vector<busarb::BusRequest> rotating{at(BusMasterId::M68K, 0x20U, 1U), at(BusMasterId::SH2_B, 0x20U, 1U), at(BusMasterId::SH2_A, 0x20U, 1U)};
+  const BusMasterId expected[] = {BusMasterId::SH2_A, BusMasterId::SH2_B, BusMasterId::M68K, BusMasterId::SH2_A, BusMasterId::SH2_B};
+  for (const BusMasterId id : expected) {
+    const auto winner = arb.pick_winner(rotating);
+    check(winner.has_value() && rotating[*winner].master_id == id, "round robin rotates through all three members");
+    arb.commit_grant(rotating[*winner], 1U);
+  }
+  const std::vector<busarb::BusRequest> no_b{rotating[0], rotating[2]};
+  check(arb.pick_winner(no_b) == 0U, "round robin skips an idle member");
+  arb.commit_grant(no_b[0], 1U);
+  check(arb.state().round_robin_last == bit(BusMasterId::M68K), "state keeps one bit per group");
+  arb.commit_grant(at(BusMasterId::SCU_DMA0, 0x30U, 1U), 1U);
+  check(arb.state().round_robin_last == bit(BusMasterId::M68K), "masters outside a group leave the round robin alone");
+  check(arb.pick_winner(no_b) == 1U, "and the rotation wraps");
+}
+
+// Straightforward id-by-id version of the topology rules, to check the bitmask
+// scan against: class rank, lowest id, round robin from the last grant.
+std::size_t reference_winner(const std::vector<busarb::BusRequest> &reqs, const busarb::BusMasterTopology &topology, busarb::BusMasterMask last) {
+  const auto rank = [&](std::uint32_t id) {
+    std::size_t k = 0;
+    while (k < busarb::kMaxBusMasters && topology.priority_classes[k] != 0U) {
+      if ((topology.priority_classes[k] >> id) & 1U) {
+        return k;
+      }
+      ++k;
+    }
+    return k;
+  };
+  std::uint32_t lowest = 32U;
+  for (const auto &req : reqs) {
+    const auto id = static_cast<std::uint32_t>(req.master_id);
+    if (lowest == 32U || rank(id) < rank(lowest) || (rank(id) == rank(lowest) && id < lowest)) {
+      lowest = id;
+    }
+  }
+  std::uint32_t chosen = lowest;
+  const busarb::BusMasterMask group = topology.round_robin_groups[lowest];
+  if (group != 0U) {
+    std::uint32_t last_id = 32U;
+    for (std::uint32_t id = 0; id < 32U; ++id) {
+      if (((group & last) >> id & 1U) != 0U) {
+        last_id = id;
+      }
+    }
+    std::uint32_t first = 32U;
+    std::uint32_t after = 32U;
+    for (const auto &req : reqs) {
+      const auto id = static_cast<std::uint32_t>(req.master_id);
+      if (((group >> id) & 1U) == 0U) continue;
+      first = std::min(first, id);
+      if (last_id != 32U && id > last_id) after = std::min(after, id);
+    }
+    chosen = after != 32U ? after : first;
+  }
+  std::size_t best = reqs.size();
+  for (std::size_t i = 0; i < reqs.size(); ++i) {
+    if (static_cast<std::uint32_t>(reqs[i].master_id) != chosen) continue;
+    if (best == reqs.size() || reqs[i].addr < reqs[best].addr ||
+        (reqs[i].addr == reqs[best].addr && ((reqs[i].is_write && !reqs[best].is_write) || reqs[i].size_bytes < reqs[best].size_bytes))) {
+      best = i;
+    }
+  }
+  return best;
+}
+
+void test_bitmask_pick_matches_reference_for_32_masters() {
+  busarb::BusMasterTopology topology{};
+  topology.priority_classes[0] = 0x0000000FU;
+  topology.priority_classes[1] = 0x00F000F0U;
+  topology.priority_classes[2] = 0xE0000000U;
+  for (std::size_t id = 20; id < 24U; ++id) topology.round_robin_groups[id] = 0x00F00000U;
+  for (std::size_t id = 29; id < 32U; ++id) topology.round_robin_groups[id] = 0xE0000000U;
+  topology.round_robin_groups[9] = topology.round_robin_groups[10] = 0x00000600U; // unclassified group
+  check(busarb::valid_bus_topology(topology), "32-master topology is valid");
+
+  std::uint32_t lcg = 99U;
+  std::vector<busarb::BusRequest> reqs;
+  for (int i = 0; i < 20000; ++i) {
+    lcg = lcg * 1664525U + 1013904223U;
+    // At most one bit per group: none, or the group's last granted member.
+    const std::uint32_t low = (lcg >> 3U) % 5U;
+    const std::uint32_t high = (lcg >> 6U) % 4U;
+    const busarb::BusMasterMask last = (low < 4U ? 1U << (20U + low) : 0U) | (high < 3U ? 1U << (29U + high) : 0U);
+    reqs.clear();
+    const std::size_t count = 1U + (lcg >> 28U) % 6U;
+    for (std::size_t k = 0; k < count; ++k) {
+      lcg = lcg * 1664525U + 1013904223U;
+      reqs.push_back({master(lcg >> 27U), (lcg >> 8U) % 3U, ((lcg >> 12U) & 1U) != 0U, static_cast<std::uint8_t>(1U << ((lcg >> 14U) % 3U)), 0U});
+    }
+    check(busarb::pick_same_tick_winner(reqs, topology, last) == reference_winner(reqs, topology, last), "bitmask scan matches the reference rules");
+  }
 }
 
 } // namespace
@@ -178,6 +497,13 @@ int main() {
   test_different_address_has_no_contention_penalty();
   test_tie_turnaround_penalty_applies_only_after_tie_pick();
   test_round_robin_cpu_tie_break_alternates();
+  test_state_snapshot_restore_resumes_identically();
+  test_static_policy_matches_callback_arbiter();
+  test_commit_grants_matches_adapter_loop();
+  test_reserve_matches_retry_loop();
+  test_topology_validation();
+  test_extended_masters_arbitrate_by_topology();
+  test_bitmask_pick_matches_reference_for_32_masters();
   std::cout << "busarb tests passed\n";
   return 0;
 }
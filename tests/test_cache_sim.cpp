@@ -0,0 +1,109 @@
+#include "trace_replay/cache_sim.hpp"
+
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+
+namespace {
+
+using trace_replay::AccessKind;
+using trace_replay::CacheBucket;
+using trace_replay::CachePrediction;
+using trace_replay::Master;
+using trace_replay::Rw;
+using trace_replay::TraceRecord;
+
+void check(bool cond, const char *msg) {
+  if (!cond) {
+    std::cerr << "FAIL: " << msg << '\n';
+    std::exit(1);
+  }
+}
+
+bool hit(trace_replay::Sh2CacheModel &cache, std::uint32_t addr) {
+  bool evicted = false;
+  return cache.access(addr, evicted);
+}
+
+// Five lines competing for set 0: the LRU way is replaced, as on the SH7604.
+void test_lru_replacement() {
+  trace_replay::Sh2CacheModel cache;
+  const std::uint32_t a = 0x06000000U;
+  const std::uint32_t b = a + 0x400U;
+  const std::uint32_t c = a + 0x800U;
+  const std::uint32_t d = a + 0xC00U;
+  const std::uint32_t e = a + 0x1000U;
+  bool evicted = true;
+  check(!cache.access(a, evicted) && !evicted, "cold miss fills an empty way");
+  check(!hit(cache, b) && !hit(cache, c) && !hit(cache, d), "four ways fill");
+  check(hit(cache, a + 12U), "same 16-byte line hits");
+  check(!hit(cache, a + 0x10U), "next line is another set");
+  check(!cache.access(e, evicted) && evicted, "fifth tag evicts");
+  check(!hit(cache, b), "least recently used line (b) was replaced");
+  check(hit(cache, a) && hit(cache, e) && hit(cache, b), "recent lines stay");
+  check(!hit(cache, c), "then c, the next oldest");
+  check(hit(cache, 0x06000010U), "other sets are untouched");
+}
+
+TraceRecord make_record(Master master, AccessKind kind, std::uint32_t addr, std::uint32_t service_cycles) {
+  TraceRecord record{};
+  record.master = master;
+  record.kind = kind;
+  record.rw = kind == AccessKind::Write ? Rw::W : Rw::R;
+  record.addr = addr;
+  record.size = 4;
+  record.region = trace_replay::region_of(addr);
+  record.service_cycles = service_cycles;
+  return record;
+}
+
+CachePrediction feed(trace_replay::CacheSimulator &sim, const TraceRecord &record) {
+  return sim.consume(record, trace_replay::classify_cache_bucket(record.region, record.service_cycles));
+}
+
+void test_simulator() {
+  trace_replay::CacheSimulator sim;
+  check(feed(sim, make_record(Master::MSH2, AccessKind::Ifetch, 0x06004000U, 8)) == CachePrediction::Miss, "cold fetch misses");
+  check(feed(sim, make_record(Master::MSH2, AccessKind::Read, 0x06004004U, 1)) == CachePrediction::Hit, "read of the fetched line hits");
+  check(feed(sim, make_record(Master::MSH2, AccessKind::Read, 0x06004008U, 8)) == CachePrediction::Hit, "hit predicted, miss observed");
+  check(feed(sim, make_record(Master::SSH2, AccessKind::Read, 0x06004000U, 4)) == CachePrediction::Miss, "each CPU has its own cache");
+  check(feed(sim, make_record(Master::MSH2, AccessKind::Read, 0x26004000U, 2)) == CachePrediction::Uncached, "cache-through area");
+  check(feed(sim, make_record(Master::MSH2, AccessKind::Write, 0x06008000U, 2)) == CachePrediction::NotSimulated, "writes do not allocate");
+  check(feed(sim, make_record(Master::DMA, AccessKind::Read, 0x06008000U, 2)) == CachePrediction::NotSimulated, "DMA bypasses the caches");
+  check(feed(sim, make_record(Master::MSH2, AccessKind::Read, 0x06008000U, 8)) == CachePrediction::Miss, "write left the line uncached");
+
+  const auto &msh2 = sim.master_stats(Master::MSH2);
+  check(msh2.accesses == 5U && msh2.hits == 2U && msh2.misses == 2U && msh2.uncached == 1U, "MSH2 counters");
+  check(sim.master_stats(Master::SSH2).misses == 1U, "SSH2 counters");
+  // 0x26004000 is outside High WRAM, so there is no observed bucket for it.
+  check(sim.compared() == 5U && sim.agreement_count() == 4U, "agreement with observed buckets");
+  check(sim.confusion(CachePrediction::Hit, CacheBucket::CacheMissFull) == 1U, "confusion cell");
+
+  const auto top = sim.miss_lines().top(10);
+  check(sim.miss_lines().size() == 3U && top.size() == 3U, "one entry per CPU and line");
+  check(top[0].master == Master::MSH2 && top[0].line_addr == 0x06004000U && top[1].line_addr == 0x06008000U && top[2].master == Master::SSH2,
+        "ties ordered by CPU, then address");
+}
+
+void test_miss_line_table() {
+  trace_replay::CacheMissLineTable table;
+  for (std::uint32_t line = 0; line < 5000U; ++line) {
+    for (std::uint32_t i = 0; i <= line % 3U; ++i) {
+      table.add(line % 2U == 0U ? Master::MSH2 : Master::SSH2, 0x06000000U + line * 16U + i);
+    }
+  }
+  check(table.size() == 5000U, "table grows past its initial size");
+  const auto top = table.top(3);
+  check(top.size() == 3U && top[0].misses == 3U && top[0].master == Master::MSH2 && top[0].line_addr == 0x06000020U, "top line");
+  check(top[1].master == Master::MSH2 && top[1].line_addr == 0x06000080U && top[2].master == Master::MSH2, "top order");
+}
+
+} // namespace
+
+int main() {
+  test_lru_replacement();
+  test_simulator();
+  test_miss_line_table();
+  std::cout << "cache sim tests passed\n";
+  return 0;
+}
@@ -0,0 +1,123 @@
+#include "busarb/busarb.hpp"
+#include "busarb/ymir_timing.hpp"
+#include "trace_replay/calibrate.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+namespace {
+
+using trace_replay::Master;
+using trace_replay::Rw;
+using trace_replay::TraceRecord;
+
+void check(bool cond, const char *msg) {
+  if (!cond) {
+    std::cerr << "FAIL: " << msg << '\n';
+    std::exit(1);
+  }
+}
+
+constexpr std::uint32_t kAddrs[] = {0x06000000U, 0x06000040U, 0x05E00000U, 0x05C00000U, 0x25A00000U, 0x00000100U};
+
+std::size_t slot_of(std::uint32_t addr, Rw rw) { return busarb::ymir_region_index(addr) * 2U + (rw == Rw::W ? 1U : 0U); }
+
+// Generates a capture whose completions follow the arbiter model exactly
+// under `table`, so calibration starting from the stock table must find it.
+std::vector<TraceRecord> synthesize(const trace_replay::TimingTable &table, std::size_t count) {
+  const busarb::ArbiterConfig config{};
+  std::vector<TraceRecord> records;
+  std::uint64_t state = 11;
+  std::uint64_t tick = 0;
+  std::uint64_t bus_free = 0;
+  std::uint32_t previous_addr = 0;
+  for (std::size_t i = 0; i < count; ++i) {
+    state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+    // Attempts start once the bus is free so observed elapsed is pure service
+    // time and the per-record total delta stays at its one-tick floor.
+    tick = bus_free + (state >> 61U);
+    TraceRecord record{};
+    record.seq = i;
+    record.tick_first_attempt = tick;
+    record.master = static_cast<Master>((state >> 40U) % 2U);
+    record.addr = kAddrs[(state >> 20U) % std::size(kAddrs)];
+    record.rw = ((state >> 30U) & 1U) != 0U ? Rw::W : Rw::R;
+    record.size = 4;
+    record.region = trace_replay::region_of(record.addr);
+    const std::uint32_t contention = i != 0U && record.addr == previous_addr ? config.same_address_contention : 0U;
+    const std::uint64_t start = std::max(tick, bus_free);
+    bus_free = start + table[slot_of(record.addr, record.rw)] + contention;
+    record.tick_complete = bus_free - 1U;
+    record.service_cycles = static_cast<std::uint32_t>(bus_free - start);
+    previous_addr = record.addr;
+    records.push_back(record);
+  }
+  return records;
+}
+
+void test_recovers_perturbed_table() {
+  trace_replay::TimingTable truth = trace_replay::ymir_timing_table();
+  const std::size_t vdp2_read = slot_of(0x05E00000U, Rw::R);
+  const std::size_t wram_write = slot_of(0x06000000U, Rw::W);
+  const std::size_t vdp1_read = slot_of(0x05C00000U, Rw::R);
+  truth[vdp2_read] = 16U;
+  truth[wram_write] = 3U;
+  truth[vdp1_read] = 25U;
+
+  const auto records = synthesize(truth, 4000);
+  const auto result = trace_replay::calibrate_timing(records);
+  check(result.initial == trace_replay::ymir_timing_table(), "search starts from the stock table");
+  check(result.before.abs_cumulative_drift > 0U, "stock table disagrees with the capture");
+  check(result.after.abs_cumulative_drift == 0U, "perturbed capture is fitted exactly");
+  check(result.after.abs_total_delta == records.size(), "total delta keeps the exclusive-elapsed tick");
+  check(result.after.agreement_count == records.size(), "every record agrees after calibration");
+  check(result.suggested[vdp2_read] == 16U && result.suggested[wram_write] == 3U && result.suggested[vdp1_read] == 25U,
+        "perturbed slots are recovered");
+  check(result.slot_records[vdp2_read] > 0U && result.slot_records[slot_of(0x05FE0000U, Rw::R)] == 0U, "records counted per slot");
+  for (std::size_t slot = 0; slot < result.suggested.size(); ++slot) {
+    if (result.slot_records[slot] == 0U) {
+      check(result.suggested[slot] == result.initial[slot], "slots without records keep their cycles");
+    }
+  }
+}
+
+// An unperturbed capture is already optimal; the search should leave it alone
+// and its incremental scoring must not touch every record per evaluation.
+void test_stock_table_is_a_fixed_point() {
+  const auto records = synthesize(trace_replay::ymir_timing_table(), 4000);
+  const auto result = trace_replay::calibrate_timing(records);
+  check(result.before.abs_cumulative_drift == 0U && result.after.abs_total_delta == result.before.abs_total_delta, "stock capture has no drift");
+  check(result.suggested == result.initial, "fixed point keeps the table");
+  check(result.passes == 1U, "one pass suffices when nothing improves");
+  check(result.records_touched < result.evaluations * records.size(), "incremental evaluation touches fewer records than full replays");
+}
+
+void test_never_worse_on_noisy_capture() {
+  auto records = synthesize(trace_replay::ymir_timing_table(), 3000);
+  std::uint64_t state = 5;
+  for (auto &record : records) {
+    state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+    record.tick_complete += (state >> 62U);
+  }
+  records.push_back(records.front());
+  records.back().master = static_cast<Master>(7);
+  const auto result = trace_replay::calibrate_timing(records);
+  check(result.before.records == records.size() - 1U, "invalid masters are skipped");
+  check(result.after.abs_cumulative_drift <= result.before.abs_cumulative_drift, "calibration never increases the drift");
+  for (const std::uint32_t cycles : result.suggested) {
+    check(cycles >= 1U && cycles <= trace_replay::kMaxCalibrationCycles, "suggested cycles stay in range");
+  }
+}
+
+} // namespace
+
+int main() {
+  test_recovers_perturbed_table();
+  test_stock_table_is_a_fixed_point();
+  test_never_worse_on_noisy_capture();
+  std::cout << "calibrate tests passed\n";
+  return 0;
+}
@@ -0,0 +1,59 @@
+#include "trace_replay/dense_table.hpp"
+
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+
+using trace_replay::DenseTable;
+
+void check(bool cond, const char *msg) {
+  if (!cond) {
+    std::cerr << "FAIL: " << msg << '\n';
+    std::exit(1);
+  }
+}
+
+void test_presence_matches_map_semantics() {
+  DenseTable<std::size_t> table(4);
+  table[1] += 3;
+  table[2] += 0; // touched without counting, like map[key] += 0
+  check(!table.contains(0) && table.contains(1) && table.contains(2), "only touched slots are present");
+  const auto folded = table.to_map([](std::size_t id) {
+    std::string key = "k";
+    key += std::to_string(id);
+    return key;
+  });
+  check(folded.size() == 2U && folded.at("k1") == 3U && folded.at("k2") == 0U, "folded keys and values");
+}
+
+void test_growth_and_label_collisions() {
+  DenseTable<std::size_t> table(2);
+  table[0] += 1;
+  table[40] += 2; // interned id past the preallocated range
+  check(table.slot_count() == 41U && table.contains(40), "table grows on demand");
+  const auto folded = table.to_map([](std::size_t) { return std::string("same"); });
+  check(folded.size() == 1U && folded.at("same") == 3U, "colliding labels are merged");
+}
+
+void test_move_fold() {
+  DenseTable<std::vector<int>> table;
+  table[3].push_back(7);
+  table[5].push_back(9);
+  auto append = [](std::vector<int> &into, const std::vector<int> &values) { into.insert(into.end(), values.begin(), values.end()); };
+  const auto folded = std::move(table).to_map([](std::size_t id) { return id < 4U ? std::string("a") : std::string("b"); }, append);
+  check(folded.at("a") == std::vector<int>{7} && folded.at("b") == std::vector<int>{9}, "vectors fold by label");
+}
+
+} // namespace
+
+int main() {
+  test_presence_matches_map_semantics();
+  test_growth_and_label_collisions();
+  test_move_fold();
+  std::cout << "dense table tests passed\n";
+  return 0;
+}
@@ -0,0 +1,122 @@
+#include "trace_replay/jsonl_scanner.hpp"
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+
+void check(bool cond, const char *msg) {
+  if (!cond) {
+    std::cerr << "FAIL: " << msg << '\n';
+    std::exit(1);
+  }
+}
+
+bool same_spans(const trace_replay::Phase1FieldSpans &a, const trace_replay::Phase1FieldSpans &b) {
+  return a.seq == b.seq && a.master == b.master && a.tick_first_attempt == b.tick_first_attempt && a.tick_complete == b.tick_complete &&
+         a.addr == b.addr && a.size == b.size && a.rw == b.rw && a.kind == b.kind && a.service_cycles == b.service_cycles &&
+         a.retries == b.retries;
+}
+
+const std::vector<std::string> &sample_lines() {
+  static const std::vector<std::string> lines = {
+      R"({"seq":1,"master":"MSH2","tick_first_attempt":10,"tick_complete":12,"addr":"0x02000000","size":4,"rw":"R","kind":"ifetch","service_cycles":2,"retries":0})",
+      R"({"seq": 7, "master": "DMA", "tick_first_attempt": 22, "tick_complete": 26, "addr": "0x05E00100", "size": 4, "rw": "R", "kind": "mmio_read", "service_cycles": 20, "retries": 1})",
+      R"({"kind":"write","rw":"W","retries":0,"service_cycles":2,"size":1,"addr":"0x01000010","tick_complete":29,"tick_first_attempt":27,"master":"SSH2","seq":8,"extra":"a:b,c"})",
+      R"({"seq":9,"master":"DMA","tick_first_attempt":30,"tick_complete":32,"addr":"0x07000000","size":4,"rw":"W","kind":"write","service_cycles":2,"retries":0,"seq":99})",
+      R"({"seq":3,"master":"DMA"})",
+      R"({"seq":"3","master":"DMA","tick_first_attempt":1,"tick_complete":2,"addr":"0x0","size":4,"rw":"R","kind":"read","service_cycles":2})",
+      R"({"seq":4"x","master":"MSH2","tick_first_attempt":1,"tick_complete":2,"addr":"0x0","size":4,"rw":"R","kind":"read","service_cycles":2,"retries":0})",
+      R"({"seq":5,"master":"MSH2","tick_first_attempt":1,"tick_complete":2,"addr":"0x0","size":4,"rw":"R","kind":"read","service_cycles":2,"retries":0,})",
+      R"(prefix {"seq":6,"master":"MSH2","tick_first_attempt":1,"tick_complete":2,"addr":"0x0","size":4,"rw":"R","kind":"read","service_cycles":2,"retries":0} suffix)",
+      R"({"seq":6,"master":"MSH2","tick_first_attempt":1,"tick_complete":2,"addr":"0x0","size":4,"rw":"R","kind":"read","service_cycles":2,"retries":)",
+      R"({"seq":6,"master":"MSH2)",
+      "MALFORMED-LINE",
+      "",
+      "}",
+      R"(")",
+  };
+  return lines;
+}
+
+void test_full_record_fields_extracted() {
+  trace_replay::Phase1FieldSpans spans;
+  check(trace_replay::scan_phase1_fields_fast(sample_lines()[0], spans), "fast scan should accept a flat Phase 1 record");
+  check(spans.complete(), "fast scan should find all Phase 1 keys");
+  check(*spans.seq == "1" && *spans.master == "MSH2" && *spans.addr == "0x02000000" && *spans.kind == "ifetch",
+        "fast scan should return unquoted string values and raw numeric values");
+  check(*spans.tick_first_attempt == "10" && *spans.tick_complete == "12" && *spans.retries == "0", "fast scan numeric spans mismatch");
+}
+
+void test_duplicate_key_keeps_first_occurrence() {
+  trace_replay::Phase1FieldSpans spans;
+  trace_replay::scan_phase1_fields(sample_lines()[3], spans);
+  check(spans.seq.has_value() && *spans.seq == "9", "duplicate key should resolve to its first occurrence like the legacy search");
+}
+
+void test_all_backends_match_legacy_search() {
+  for (const auto &line : sample_lines()) {
+    trace_replay::Phase1FieldSpans legacy;
+    trace_replay::scan_phase1_fields_legacy(line, legacy);
+
+    trace_replay::Phase1FieldSpans combined;
+    trace_replay::scan_phase1_fields(line, combined);
+    check(same_spans(legacy, combined), "combined scan must match the legacy per-key search");
+
+    for (const auto backend : {trace_replay::ScanBackend::Scalar, trace_replay::ScanBackend::Sse2, trace_replay::ScanBackend::Avx2}) {
+      trace_replay::Phase1FieldSpans fast;
+      if (trace_replay::scan_phase1_fields_fast(line, fast, backend) && fast.complete()) {
+        check(same_spans(legacy, fast), "fast scan accepted a line but disagreed with the legacy search");
+      }
+    }
+  }
+}
+
+// Intended difference from the legacy search: a key name inside a string
+// value is not a key.
+void test_key_name_in_string_value_is_not_a_key() {
+  const std::string line =
+      R"({"note":"addr","x":1,"seq":1,"master":"MSH2","tick_first_attempt":10,"tick_complete":12,"addr":"0x02000000","size":4,"rw":"R","kind":"read","service_cycles":2,"retries":0})";
+  trace_replay::Phase1FieldSpans legacy;
+  trace_replay::scan_phase1_fields_legacy(line, legacy);
+  check(legacy.addr.has_value() && *legacy.addr == "1", "legacy search matches the key name in the string value");
+
+  trace_replay::Phase1FieldSpans spans;
+  trace_replay::scan_phase1_fields(line, spans);
+  check(spans.addr.has_value() && *spans.addr == "0x02000000", "combined scan reads the addr key itself");
+  for (const auto backend : {trace_replay::ScanBackend::Scalar, trace_replay::ScanBackend::Sse2, trace_replay::ScanBackend::Avx2}) {
+    trace_replay::Phase1FieldSpans fast;
+    check(trace_replay::scan_phase1_fields_fast(line, fast, backend) && fast.addr.has_value() && *fast.addr == "0x02000000",
+          "fast scan reads the addr key itself");
+  }
+}
+
+void test_block_boundaries() {
+  // Slide the record across every offset of a 64-byte block so structural
+  // characters land on each lane and in the zero-padded tail block.
+  const std::string base = sample_lines()[0];
+  for (std::size_t pad = 0; pad < 80; ++pad) {
+    const std::string line = std::string(pad, ' ') + base;
+    trace_replay::Phase1FieldSpans legacy;
+    trace_replay::scan_phase1_fields_legacy(line, legacy);
+    for (const auto backend : {trace_replay::ScanBackend::Scalar, trace_replay::ScanBackend::Sse2, trace_replay::ScanBackend::Avx2}) {
+      trace_replay::Phase1FieldSpans fast;
+      check(trace_replay::scan_phase1_fields_fast(line, fast, backend), "fast scan should accept padded record");
+      check(same_spans(legacy, fast), "fast scan should match legacy search at every block offset");
+    }
+  }
+}
+
+} // namespace
+
+int main() {
+  test_full_record_fields_extracted();
+  test_duplicate_key_keeps_first_occurrence();
+  test_all_backends_match_legacy_search();
+  test_key_name_in_string_value_is_not_a_key();
+  test_block_boundaries();
+  std::cout << "jsonl scanner tests passed\n";
+  return 0;
+}
@@ -0,0 +1,126 @@
+#include "trace_replay/quantile_sketch.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+namespace {
+
+using trace_replay::QuantileSketch;
+
+void check(bool cond, const char *msg) {
+  if (!cond) {
+    std::cerr << "FAIL: " << msg << '\n';
+    std::exit(1);
+  }
+}
+
+// The sort-and-interpolate definition trace_replay used before the sketch.
+double sorted_percentile(std::vector<std::int64_t> values, double pct) {
+  if (values.empty()) {
+    return 0.0;
+  }
+  std::sort(values.begin(), values.end());
+  const double index = pct * static_cast<double>(values.size() - 1U);
+  const auto lo = static_cast<std::size_t>(std::floor(index));
+  const auto hi = static_cast<std::size_t>(std::ceil(index));
+  if (lo == hi) {
+    return static_cast<double>(values[lo]);
+  }
+  const double frac = index - static_cast<double>(lo);
+  return static_cast<double>(values[lo]) + (static_cast<double>(values[hi]) - static_cast<double>(values[lo])) * frac;
+}
+
+std::uint64_t next(std::uint64_t &state) {
+  state ^= state << 13U;
+  state ^= state >> 7U;
+  state ^= state << 17U;
+  return state;
+}
+
+constexpr double kPcts[] = {0.0, 0.01, 0.1, 0.25, 0.5, 0.75, 0.9, 0.95, 0.99, 1.0};
+
+void test_empty() {
+  const QuantileSketch sketch;
+  check(sketch.empty() && sketch.count() == 0U && sketch.quantile(0.5) == 0.0, "empty sketch reports zero");
+}
+
+void test_exact_matches_sorted_percentile() {
+  std::uint64_t state = 0x9e3779b97f4a7c15ULL;
+  std::vector<std::int64_t> values;
+  QuantileSketch sketch;
+  for (int i = 0; i < 5000; ++i) {
+    std::int64_t v = static_cast<std::int64_t>(next(state) % 2048U) - 1024;
+    if (i % 97 == 0) {
+      v = static_cast<std::int64_t>(next(state) % 1000000U) - 500000; // sparse tail values
+    }
+    values.push_back(v);
+    sketch.add(v);
+  }
+  check(sketch.exact(), "few distinct tail values stay exact");
+  check(sketch.count() == values.size(), "count");
+  std::int64_t sum = 0;
+  for (const auto v : values) {
+    sum += v;
+  }
+  check(sketch.sum() == sum, "sum");
+  for (const double pct : kPcts) {
+    check(sketch.quantile(pct) == sorted_percentile(values, pct), "exact quantile matches sorted percentile");
+  }
+}
+
+void test_merge_matches_single_sketch() {
+  QuantileSketch whole;
+  QuantileSketch a;
+  QuantileSketch b;
+  std::vector<std::int64_t> values;
+  for (std::int64_t v = -3000; v < 3000; v += 7) {
+    whole.add(v);
+    (v % 2 == 0 ? a : b).add(v);
+    values.push_back(v);
+  }
+  a += b;
+  check(a.count() == whole.count() && a.sum() == whole.sum(), "merged count and sum");
+  for (const double pct : kPcts) {
+    check(a.quantile(pct) == whole.quantile(pct), "merged quantiles match");
+    check(a.quantile(pct) == sorted_percentile(values, pct), "merged quantiles are exact");
+  }
+}
+
+void test_wide_tail_is_bounded_and_close() {
+  std::uint64_t state = 0x2545f4914f6cdd1dULL;
+  std::vector<std::int64_t> values;
+  QuantileSketch sketch;
+  for (int i = 0; i < 20000; ++i) {
+    const auto magnitude = static_cast<std::int64_t>(next(state) % 100000000U) + 2000;
+    const std::int64_t v = (i % 3 == 0) ? -magnitude : magnitude;
+    values.push_back(v);
+    sketch.add(v);
+  }
+  check(!sketch.exact(), "many distinct tail values switch to log buckets");
+  for (const double pct : kPcts) {
+    const double expected = sorted_percentile(values, pct);
+    const double got = sketch.quantile(pct);
+    check(std::fabs(got - expected) <= std::fabs(expected) * 0.01, "approximate quantile within 1%");
+  }
+
+  // Merging an exact sketch into a collapsed one keeps the collapsed form.
+  QuantileSketch small;
+  small.add(5000);
+  small += sketch;
+  check(!small.exact() && small.count() == sketch.count() + 1U, "merge into exact sketch collapses");
+}
+
+} // namespace
+
+int main() {
+  test_empty();
+  test_exact_matches_sorted_percentile();
+  test_merge_matches_single_sketch();
+  test_wide_tail_is_bounded_and_close();
+  std::cout << "quantile sketch tests passed\n";
+  return 0;
+}
@@ -0,0 +1,179 @@
+#include "trace_replay/dense_table.hpp"
+#include "trace_replay/quantile_sketch.hpp"
+#include "trace_replay/replay_cache.hpp"
+#include "trace_replay/seq_tracker.hpp"
+#include "trace_replay/state_codec.hpp"
+#include "trace_replay/top_k.hpp"
+
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+
+using trace_replay::InputStats;
+using trace_replay::ReplayCache;
+using trace_replay::StateReader;
+using trace_replay::StateWriter;
+using trace_replay::TraceRecord;
+
+void check(bool cond, const char *msg) {
+  if (!cond) {
+    std::cerr << "FAIL: " << msg << '\n';
+    std::exit(1);
+  }
+}
+
+std::filesystem::path temp_path(const char *name) { return std::filesystem::temp_directory_path() / name; }
+
+StateReader reader_for(const StateWriter &writer) {
+  return StateReader(std::span(reinterpret_cast<const std::uint8_t *>(writer.bytes().data()), writer.bytes().size()));
+}
+
+void test_state_round_trip() {
+  trace_replay::QuantileSketch sketch;
+  for (std::int64_t v = -3000; v < 3000; v += 7) {
+    sketch.add(v * v * (v % 3 == 0 ? -1 : 1));
+  }
+  trace_replay::DenseTable<std::size_t> counts(4);
+  counts[2] += 5;
+  counts[9] += 1;
+  trace_replay::DenseTable<trace_replay::QuantileSketch> sketches(2);
+  sketches[1].add(42);
+  trace_replay::TopK<std::uint32_t> top(3);
+  for (std::uint32_t i = 0; i < 10U; ++i) {
+    top.offer(i % 4U, i);
+  }
+  trace_replay::SeqTracker tracker;
+  for (std::uint64_t seq : {1U, 2U, 3U, 10U, 5U, 5U}) {
+    static_cast<void>(tracker.observe(seq));
+  }
+
+  StateWriter writer;
+  sketch.save(writer);
+  counts.save(writer);
+  sketches.save(writer);
+  top.save(writer);
+  tracker.save(writer);
+
+  StateReader reader = reader_for(writer);
+  trace_replay::QuantileSketch sketch_copy;
+  trace_replay::DenseTable<std::size_t> counts_copy(4);
+  trace_replay::DenseTable<trace_replay::QuantileSketch> sketches_copy(2);
+  trace_replay::TopK<std::uint32_t> top_copy(3);
+  trace_replay::SeqTracker tracker_copy;
+  check(sketch_copy.load(reader) && counts_copy.load(reader) && sketches_copy.load(reader) && top_copy.load(reader) && tracker_copy.load(reader),
+        "state loads back");
+  check(reader.at_end(), "every byte consumed");
+  check(sketch_copy.count() == sketch.count() && sketch_copy.sum() == sketch.sum() && sketch_copy.exact() == sketch.exact(), "sketch totals");
+  for (double pct : {0.0, 0.25, 0.5, 0.9, 0.99, 1.0}) {
+    check(sketch_copy.quantile(pct) == sketch.quantile(pct), "sketch quantiles");
+  }
+  check(counts_copy.contains(9) && !counts_copy.contains(3) && counts_copy[2] == 5U, "dense table slots and presence");
+  check(sketches_copy.contains(1) && sketches_copy[1].quantile(0.5) == 42.0, "dense table of sketches");
+  top.offer(9, 100);
+  top_copy.offer(9, 100);
+  check(top_copy.sorted() == top.sorted(), "top-k keeps offer order across a save");
+  check(tracker_copy.observe(10).duplicate && !tracker_copy.observe(11).duplicate, "seq tracker keeps seen values");
+
+  StateReader short_reader(std::span(reinterpret_cast<const std::uint8_t *>(writer.bytes().data()), 12U));
+  trace_replay::QuantileSketch truncated;
+  check(!truncated.load(short_reader) && !short_reader.ok(), "truncated state is rejected");
+}
+
+std::string jsonl_line(std::uint64_t seq, std::uint64_t tick) {
+  return "{\"seq\":" + std::to_string(seq) + ",\"master\":\"MSH2\",\"tick_first_attempt\":" + std::to_string(tick) +
+         ",\"tick_complete\":" + std::to_string(tick + 2U) +
+         ",\"addr\":\"0x06004000\",\"size\":4,\"rw\":\"R\",\"kind\":\"read\",\"service_cycles\":2,\"retries\":0}\n";
+}
+
+// `count` records with ticks rising by 3, except that every 50th record
+// completes a little early so block boundaries cut through local disorder.
+std::string jsonl_trace(std::uint64_t first, std::uint64_t count) {
+  std::string text;
+  for (std::uint64_t i = first; i < first + count; ++i) {
+    text += jsonl_line(i + 1U, i % 50U == 7U ? i * 3U - 20U : i * 3U + 30U);
+  }
+  return text;
+}
+
+void write_file(const std::filesystem::path &path, const std::string &text) {
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  out << text;
+}
+
+struct CachedRead {
+  std::vector<TraceRecord> records;
+  InputStats stats;
+  bool resumed = false;
+  std::size_t checkpoint = 0;
+};
+
+CachedRead cached_read(const std::filesystem::path &input, const std::filesystem::path &cache_path, std::uint64_t fingerprint) {
+  ReplayCache cache(cache_path.string(), fingerprint);
+  CachedRead out;
+  check(cache.read_input(input.string(), 2, out.stats, out.records), "cached read succeeds");
+  out.resumed = cache.resume_state() != nullptr;
+  check(!out.resumed || *cache.resume_state() == "session", "saved session comes back");
+  const auto checkpoint = cache.plan_checkpoint(out.records);
+  out.checkpoint = checkpoint.value_or(0U);
+  if (checkpoint.has_value()) {
+    check(cache.write("session"), "cache written");
+  }
+  return out;
+}
+
+// Growing a capture resumes from the cache: every record comes back exactly
+// once across the runs, and stats continue from the checkpoint.
+void test_append_resume() {
+  const auto input = temp_path("replay_cache_test.jsonl");
+  const auto cache_path = temp_path("replay_cache_test.trrc");
+  std::filesystem::remove(cache_path);
+  const std::string head = jsonl_trace(0, 20000);
+  const std::string grown = head + jsonl_trace(20000, 5000);
+  check(head.size() > 2U * trace_replay::kReplayCacheJsonlBlockBytes, "fixture spans several blocks");
+
+  write_file(input, head);
+  const CachedRead first = cached_read(input, cache_path, 7);
+  check(!first.resumed && first.records.size() == 20000U, "first run reads everything");
+  check(first.checkpoint > 0U && first.checkpoint < first.records.size(), "checkpoint at a block boundary");
+
+  write_file(input, grown);
+  const CachedRead second = cached_read(input, cache_path, 7);
+  check(second.resumed, "grown capture resumes");
+  check(second.stats.total_events == 25000U, "stats continue from the checkpoint");
+  check(second.records.size() == 25000U - first.checkpoint, "only unconsumed and appended records are read");
+  check(second.records.back().seq == 25000U, "appended records delivered");
+
+  const CachedRead other_options = cached_read(input, cache_path, 8);
+  check(!other_options.resumed && other_options.records.size() == 25000U, "fingerprint mismatch replays in full");
+
+  // Appended records that would replay before already consumed ones.
+  write_file(input, head);
+  static_cast<void>(cached_read(input, cache_path, 7));
+  write_file(input, head + jsonl_line(20001, 0));
+  const CachedRead reordered = cached_read(input, cache_path, 7);
+  check(!reordered.resumed && reordered.records.size() == 20001U, "out-of-order append replays in full");
+
+  std::string edited = grown;
+  edited[7] = '9';
+  write_file(input, edited);
+  const CachedRead changed = cached_read(input, cache_path, 7);
+  check(!changed.resumed && changed.records.size() == 25000U, "edited prefix replays in full");
+
+  std::filesystem::remove(input);
+  std::filesystem::remove(cache_path);
+}
+
+} // namespace
+
+int main() {
+  test_state_round_trip();
+  test_append_resume();
+  std::cout << "replay cache tests passed\n";
+  return 0;
+}
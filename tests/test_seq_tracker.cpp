@@ -0,0 +1,92 @@
+#include "trace_replay/seq_tracker.hpp"
+
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+#include <optional>
+#include <set>
+#include <vector>
+
+namespace {
+
+void check(bool cond, const char *msg) {
+  if (!cond) {
+    std::cerr << "FAIL: " << msg << '\n';
+    std::exit(1);
+  }
+}
+
+// Reference implementation the loaders used before SeqTracker.
+void check_matches_set(const std::vector<std::uint64_t> &seqs, const char *msg) {
+  trace_replay::SeqTracker tracker;
+  std::set<std::uint64_t> seen;
+  std::optional<std::uint64_t> previous;
+  for (const auto seq : seqs) {
+    const bool duplicate = seen.count(seq) != 0U;
+    const bool non_monotonic = previous.has_value() && seq <= *previous;
+    seen.insert(seq);
+    previous = seq;
+    const auto result = tracker.observe(seq);
+    check(result.duplicate == duplicate, msg);
+    check(result.non_monotonic == non_monotonic, msg);
+  }
+}
+
+void test_increasing_stream_uses_one_run() {
+  trace_replay::SeqTracker tracker;
+  for (std::uint64_t seq = 1; seq <= 100000; ++seq) {
+    const auto result = tracker.observe(seq);
+    check(!result.duplicate && !result.non_monotonic, "increasing seq is clean");
+  }
+  check(tracker.run_count() == 1U, "contiguous seq coalesces into one run");
+  check(tracker.pending_count() == 0U, "increasing seq never touches pending buffer");
+}
+
+void test_small_patterns() {
+  check_matches_set({1, 2, 2, 3, 1, 5, 4, 4, 6}, "small duplicate/non-monotonic pattern");
+  check_matches_set({10, 8, 9, 7, 11, 8, 12}, "back-fill below the maximum");
+  check_matches_set({0, std::numeric_limits<std::uint64_t>::max(), 0, std::numeric_limits<std::uint64_t>::max()}, "extreme values");
+  check_matches_set({}, "empty input");
+}
+
+void test_random_against_set() {
+  std::uint64_t state = 0x243F6A8885A308D3ULL;
+  auto next = [&state]() {
+    state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+    return state >> 33;
+  };
+
+  // Mostly increasing with local shuffles and occasional repeats, long enough
+  // to force several pending-buffer merges.
+  std::vector<std::uint64_t> seqs;
+  std::uint64_t seq = 1000;
+  for (int i = 0; i < 50000; ++i) {
+    const auto r = next();
+    if (r % 10U == 0U) {
+      seqs.push_back(seq - (r >> 8) % 64U);
+    } else if (r % 10U == 1U) {
+      seqs.push_back(seq - (r >> 8) % 20000U);
+    } else {
+      seq += 1U + (r % 7U == 0U ? (r >> 4) % 5U : 0U);
+      seqs.push_back(seq);
+    }
+  }
+  check_matches_set(seqs, "mostly increasing stream");
+
+  std::vector<std::uint64_t> shuffled;
+  for (int i = 0; i < 20000; ++i) {
+    shuffled.push_back(next() % 15000U);
+  }
+  check_matches_set(shuffled, "unordered stream");
+}
+
+} // namespace
+
+int main() {
+  test_increasing_stream_uses_one_run();
+  test_small_patterns();
+  test_random_against_set();
+  std::cout << "seq tracker tests passed\n";
+  return 0;
+}
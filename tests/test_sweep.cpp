@@ -0,0 +1,113 @@
+#include "busarb/busarb.hpp"
+#include "busarb/ymir_timing.hpp"
+#include "trace_replay/sweep.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+namespace {
+
+using trace_replay::Master;
+using trace_replay::Region;
+using trace_replay::Rw;
+using trace_replay::TraceRecord;
+
+void check(bool cond, const char *msg) {
+  if (!cond) {
+    std::cerr << "FAIL: " << msg << '\n';
+    std::exit(1);
+  }
+}
+
+void test_grid_parsing() {
+  const auto grid = trace_replay::parse_sweep_spec("same_address_contention=0..2;tie_turnaround=1,3");
+  check(grid.has_value() && grid->size() == 6U, "cartesian product size");
+  check((*grid)[0].config.same_address_contention == 0U && (*grid)[0].config.tie_turnaround == 1U, "first variant");
+  check((*grid)[1].config.same_address_contention == 0U && (*grid)[1].config.tie_turnaround == 3U, "last axis varies fastest");
+  check((*grid)[5].config.same_address_contention == 2U && (*grid)[5].config.tie_turnaround == 3U, "last variant");
+  check((*grid)[5].settings.size() == 2U && (*grid)[5].settings[0].first == "same_address_contention", "settings keep spec order");
+
+  const auto timing = trace_replay::parse_sweep_spec("read:VDP2=18,20;write:High WRAM=3");
+  const std::size_t vdp2_read = static_cast<std::size_t>(Region::Vdp2) * 2U;
+  const std::size_t wram_write = static_cast<std::size_t>(Region::HighWram) * 2U + 1U;
+  check(timing.has_value() && timing->size() == 2U, "timing grid size");
+  check((*timing)[1].cycles[vdp2_read] == 20U && (*timing)[1].cycles[wram_write] == 3U, "timing overrides land in their slots");
+  check((*timing)[1].config.same_address_contention == busarb::ArbiterConfig{}.same_address_contention, "unswept axes keep defaults");
+
+  check(!trace_replay::parse_sweep_spec("").has_value(), "empty grid rejected");
+  check(!trace_replay::parse_sweep_spec("bogus=1").has_value(), "unknown axis rejected");
+  check(!trace_replay::parse_sweep_spec("read:Nowhere=2").has_value(), "unknown region rejected");
+  check(!trace_replay::parse_sweep_spec("read:VDP2=0").has_value(), "zero cycle override rejected");
+  check(!trace_replay::parse_sweep_spec("tie_turnaround=3..1").has_value(), "reversed range rejected");
+  check(!trace_replay::parse_sweep_spec("tie_turnaround=1;tie_turnaround=2").has_value(), "duplicate axis rejected");
+  check(!trace_replay::parse_sweep_spec("same_address_contention=0..99;tie_turnaround=0..99").has_value(), "oversized grid rejected");
+}
+
+TraceRecord make_record(std::uint64_t tick, Master master, std::uint32_t addr, std::uint32_t elapsed) {
+  TraceRecord record{};
+  record.tick_first_attempt = tick;
+  record.tick_complete = tick + elapsed;
+  record.master = master;
+  record.addr = addr;
+  record.rw = Rw::R;
+  record.size = 4;
+  record.region = trace_replay::region_of(addr);
+  record.service_cycles = 2;
+  return record;
+}
+
+// A sweep variant must reproduce what a real busarb::Arbiter predicts.
+void test_variant_matches_arbiter() {
+  std::vector<TraceRecord> records;
+  std::uint64_t state = 7;
+  std::uint64_t tick = 0;
+  const std::uint32_t addrs[] = {0x06000000U, 0x06000004U, 0x05E00000U, 0x25E00000U};
+  for (int i = 0; i < 500; ++i) {
+    state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+    tick += (state >> 60U) % 3U;
+    const auto master = static_cast<Master>((state >> 40U) % 3U);
+    records.push_back(make_record(tick, master, addrs[(state >> 20U) % 4U], static_cast<std::uint32_t>((state >> 10U) % 5U)));
+  }
+
+  auto grid = trace_replay::parse_sweep_spec("same_address_contention=0,2;tie_turnaround=1");
+  check(grid.has_value(), "grid parses");
+  trace_replay::SweepReplay sweep(*grid);
+  for (const auto &record : records) {
+    sweep.consume(record, static_cast<std::uint32_t>(record.tick_complete - record.tick_first_attempt));
+  }
+  const auto ranked = sweep.ranked();
+  check(ranked.size() == 2U, "one result per variant");
+
+  for (std::size_t v = 0; v < grid->size(); ++v) {
+    busarb::Arbiter arbiter(busarb::TimingCallbacks{busarb::ymir_access_cycles, nullptr}, (*grid)[v].config);
+    std::size_t agreement = 0;
+    std::size_t mismatch = 0;
+    std::int64_t final_drift = 0;
+    for (const auto &record : records) {
+      const std::uint64_t before = arbiter.bus_free_tick();
+      arbiter.commit_grant({static_cast<busarb::BusMasterId>(record.master), record.addr, false, record.size, record.tick_first_attempt},
+                           record.tick_first_attempt);
+      const auto drift_wait = static_cast<std::int64_t>(std::max(before, record.tick_first_attempt) - record.tick_first_attempt);
+      final_drift = static_cast<std::int64_t>(arbiter.bus_free_tick()) - static_cast<std::int64_t>(record.tick_complete + 1U);
+      (drift_wait == 0 && final_drift == 0 ? agreement : mismatch) += 1;
+    }
+    const auto it = std::find_if(ranked.begin(), ranked.end(), [v](const trace_replay::SweepResult &r) { return r.variant == v; });
+    check(it != ranked.end(), "variant present in ranking");
+    check(it->agreement_count == agreement && it->mismatch_count == mismatch, "agreement/mismatch match the arbiter");
+    check(it->final_cumulative_drift_total == final_drift, "final drift matches the arbiter");
+    check(it->normalized_agreement_count + it->normalized_mismatch_count == records.size(), "normalized counts cover every record");
+  }
+  check(ranked[0].agreement_count >= ranked[1].agreement_count, "ranking puts most agreements first");
+}
+
+} // namespace
+
+int main() {
+  test_grid_parsing();
+  test_variant_matches_arbiter();
+  std::cout << "sweep tests passed\n";
+  return 0;
+}
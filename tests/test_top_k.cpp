@@ -0,0 +1,85 @@
+#include "trace_replay/top_k.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+namespace {
+
+using trace_replay::TopK;
+
+void check(bool cond, const char *msg) {
+  if (!cond) {
+    std::cerr << "FAIL: " << msg << '\n';
+    std::exit(1);
+  }
+}
+
+struct Item {
+  std::uint64_t score = 0;
+  std::size_t id = 0;
+};
+
+// Reference ranking: stable_sort every candidate by descending score.
+std::vector<std::size_t> stable_sorted_ids(std::vector<Item> items, std::size_t k) {
+  std::stable_sort(items.begin(), items.end(), [](const Item &a, const Item &b) { return a.score > b.score; });
+  std::vector<std::size_t> ids;
+  for (std::size_t i = 0; i < std::min(k, items.size()); ++i) {
+    ids.push_back(items[i].id);
+  }
+  return ids;
+}
+
+std::vector<std::size_t> top_k_ids(const std::vector<Item> &items, std::size_t k) {
+  TopK<Item> top(k);
+  for (const auto &item : items) {
+    top.offer(item.score, item);
+  }
+  std::vector<std::size_t> ids;
+  for (const auto &item : top.sorted()) {
+    ids.push_back(item.id);
+  }
+  return ids;
+}
+
+void test_matches_stable_sort_with_ties() {
+  std::uint64_t state = 12345;
+  std::vector<Item> items;
+  for (std::size_t i = 0; i < 3000; ++i) {
+    state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+    items.push_back(Item{(state >> 33U) % 16U, i}); // few distinct scores: many ties
+  }
+  for (const std::size_t k : {std::size_t{0}, std::size_t{1}, std::size_t{7}, std::size_t{20}, std::size_t{500}, std::size_t{5000}}) {
+    check(top_k_ids(items, k) == stable_sorted_ids(items, k), "bounded top-k matches stable_sort order");
+  }
+}
+
+void test_all_equal_keeps_offer_order() {
+  std::vector<Item> items;
+  for (std::size_t i = 0; i < 10; ++i) {
+    items.push_back(Item{4, i});
+  }
+  check(top_k_ids(items, 3) == std::vector<std::size_t>{0, 1, 2}, "ties keep the earliest offers");
+}
+
+void test_size_is_bounded() {
+  TopK<Item> top(4);
+  for (std::size_t i = 0; i < 1000; ++i) {
+    top.offer(i, Item{i, i});
+  }
+  check(top.size() == 4U, "heap never exceeds k");
+  check(top_k_ids({Item{1, 0}, Item{9, 1}, Item{5, 2}}, 2) == std::vector<std::size_t>{1, 2}, "highest scores first");
+}
+
+} // namespace
+
+int main() {
+  test_matches_stable_sort_with_ties();
+  test_all_equal_keeps_offer_order();
+  test_size_is_bounded();
+  std::cout << "top-k tests passed\n";
+  return 0;
+}
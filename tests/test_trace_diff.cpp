@@ -0,0 +1,142 @@
+#include "trace_replay/record_diff.hpp"
+#include "trace_replay/trace_input.hpp"
+
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <utility>
+#include <vector>
+
+namespace {
+
+using trace_replay::DiffKind;
+using trace_replay::Master;
+using trace_replay::RecordDiff;
+using trace_replay::Region;
+using trace_replay::TraceRecord;
+
+void check(bool cond, const char *msg) {
+  if (!cond) {
+    std::cerr << "FAIL: " << msg << '\n';
+    std::exit(1);
+  }
+}
+
+TraceRecord make_record(std::uint64_t seq, std::uint32_t addr, std::uint64_t elapsed, std::uint32_t service) {
+  TraceRecord record{};
+  record.seq = seq;
+  record.tick_first_attempt = seq * 10U;
+  record.tick_complete = seq * 10U + elapsed;
+  record.addr = addr;
+  record.region = trace_replay::region_of(addr);
+  record.service_cycles = service;
+  return record;
+}
+
+std::vector<RecordDiff> join(const std::vector<TraceRecord> &a, const std::vector<TraceRecord> &b, trace_replay::TraceDiffer &differ) {
+  std::size_t ia = 0;
+  std::size_t ib = 0;
+  std::vector<RecordDiff> diffs;
+  trace_replay::merge_join([&] { return ia < a.size() ? &a[ia++] : nullptr; }, [&] { return ib < b.size() ? &b[ib++] : nullptr; }, differ,
+                           [&](const RecordDiff &diff) { diffs.push_back(diff); });
+  return diffs;
+}
+
+void test_merge_join() {
+  const std::uint32_t wram = 0x06000000U;
+  const std::uint32_t vdp2 = 0x05E00000U;
+  std::vector<TraceRecord> a = {make_record(1, wram, 2, 2), make_record(2, vdp2, 20, 20), make_record(3, wram, 2, 2), make_record(5, wram, 2, 2)};
+  std::vector<TraceRecord> b = {make_record(1, wram, 2, 2), make_record(2, vdp2, 24, 20), make_record(4, wram, 2, 2), make_record(5, vdp2, 20, 20)};
+  b.push_back(make_record(4, wram, 2, 2)); // duplicate seq: cannot be aligned
+
+  trace_replay::TraceDiffer differ;
+  const auto diffs = join(a, b, differ);
+  check(diffs.size() == 5U, "one diff per distinct seq");
+  check(diffs[0].kind == DiffKind::Identical, "identical pair");
+  check(diffs[1].kind == DiffKind::TimingChanged && diffs[1].elapsed_delta == 4 && diffs[1].wait_delta == 4, "deltas are B minus A");
+  check(diffs[1].side_a.classification == trace_replay::Classification::WaitZero && diffs[1].classification_changed(),
+        "wait appearing changes the classification");
+  check(diffs[2].kind == DiffKind::OnlyInA && diffs[2].seq == 3U, "seq missing from B");
+  check(diffs[3].kind == DiffKind::OnlyInB && diffs[3].seq == 4U, "seq missing from A");
+  check(diffs[4].kind == DiffKind::AccessMismatch, "same seq, different address");
+
+  check(differ.identical() == 1U && differ.access_mismatches() == 1U, "kind counters");
+  check(differ.totals().matched == 3U && differ.totals().differing == 2U, "matched/differing totals");
+  check(differ.totals().only_in_a == 1U && differ.totals().only_in_b == 1U, "only-in totals");
+  check(differ.unaligned_a() == 0U && differ.unaligned_b() == 1U, "backwards seq counted as unaligned");
+  check(differ.first_divergence().has_value() && differ.first_divergence()->seq == 2U, "first divergence is the earliest non-identical seq");
+  const auto &vdp2_bucket = differ.by_region()[static_cast<std::size_t>(Region::Vdp2)];
+  check(vdp2_bucket.matched == 1U && vdp2_bucket.differing == 1U && vdp2_bucket.elapsed_delta_sum == 4, "region bucket uses A's region");
+  check(differ.by_master().contains(static_cast<std::size_t>(Master::MSH2)), "master bucket present");
+  check(differ.elapsed_deltas().count() == 3U, "percentiles cover matched pairs only");
+
+  trace_replay::TraceDiffer same;
+  join(a, a, same);
+  check(same.identical() == a.size() && !same.first_divergence().has_value(), "a capture matches itself");
+}
+
+void test_reorder_window() {
+  std::vector<TraceRecord> ordered;
+  for (std::uint64_t seq = 1; seq <= 64U; ++seq) {
+    ordered.push_back(make_record(seq, 0x06000000U, 2, 2));
+  }
+  std::vector<TraceRecord> shuffled = ordered;
+  for (std::size_t i = 0; i + 3U < shuffled.size(); i += 4U) {
+    std::swap(shuffled[i], shuffled[i + 3U]);
+  }
+
+  auto run = [&](std::size_t window, trace_replay::TraceDiffer &differ) {
+    std::size_t ia = 0;
+    std::size_t ib = 0;
+    trace_replay::merge_join([&] { return ia < ordered.size() ? &ordered[ia++] : nullptr; },
+                             [&] { return ib < shuffled.size() ? &shuffled[ib++] : nullptr; }, differ, [](const RecordDiff &) {}, window);
+  };
+  trace_replay::TraceDiffer windowed;
+  run(4, windowed);
+  check(windowed.identical() == ordered.size() && windowed.unaligned_b() == 0U, "local disorder inside the window still joins");
+  trace_replay::TraceDiffer strict;
+  run(0, strict);
+  check(strict.unaligned_b() > 0U && strict.totals().only_in_a == strict.unaligned_b(), "window 0 drops records that go backwards");
+}
+
+// The puller must hand records over in order across batch boundaries, and
+// tearing it down early must not deadlock the parked reader.
+void test_record_puller() {
+  const std::size_t count = trace_replay::RecordPuller::kBatchRecords * 3U + 17U;
+  auto reader = [count](const trace_replay::RecordPuller::Sink &sink) {
+    for (std::size_t i = 0; i < count; ++i) {
+      sink(make_record(i, 0x06000000U, 2, 2));
+    }
+    return true;
+  };
+  {
+    trace_replay::RecordPuller puller(reader);
+    std::size_t seen = 0;
+    bool ordered = true;
+    while (const TraceRecord *record = puller.next()) {
+      ordered = ordered && record->seq == seen;
+      ++seen;
+    }
+    check(seen == count && ordered, "every record arrives once, in order");
+    check(puller.ok() && puller.next() == nullptr, "exhausted puller stays exhausted");
+  }
+  {
+    trace_replay::RecordPuller puller(reader);
+    check(puller.next() != nullptr, "first record available");
+  }
+  {
+    trace_replay::RecordPuller unused(reader);
+  }
+  trace_replay::RecordPuller failing([](const trace_replay::RecordPuller::Sink &) { return false; });
+  check(failing.next() == nullptr && !failing.ok(), "reader failure is reported");
+}
+
+} // namespace
+
+int main() {
+  test_merge_join();
+  test_reorder_window();
+  test_record_puller();
+  std::cout << "trace diff tests passed\n";
+  return 0;
+}
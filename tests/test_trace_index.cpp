@@ -0,0 +1,209 @@
+#include "trace_replay/trace_index.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+using trace_replay::IndexedFormat;
+using trace_replay::IndexUse;
+using trace_replay::InputStats;
+using trace_replay::RecordWindow;
+using trace_replay::TraceRecord;
+using trace_replay::U64Range;
+
+void check(bool cond, const char *msg) {
+  if (!cond) {
+    std::cerr << "FAIL: " << msg << '\n';
+    std::exit(1);
+  }
+}
+
+std::filesystem::path temp_path(const char *name) { return std::filesystem::temp_directory_path() / name; }
+
+// Mostly increasing seq/ticks with periodic stragglers and one malformed line.
+std::string jsonl_trace(std::size_t count) {
+  std::string text;
+  for (std::size_t i = 0; i < count; ++i) {
+    const std::size_t seq = (i % 997U == 5U) ? i / 2U : i + 1U;
+    const std::size_t tick = 10U + i * 3U;
+    if (i == 1234U) {
+      text += "MALFORMED\n";
+    }
+    text += "{\"seq\":" + std::to_string(seq) + ",\"master\":\"MSH2\",\"tick_first_attempt\":" + std::to_string(tick) +
+            ",\"tick_complete\":" + std::to_string(tick + 2U) +
+            ",\"addr\":\"0x06004000\",\"size\":4,\"rw\":\"R\",\"kind\":\"read\",\"service_cycles\":2,\"retries\":0}\n";
+  }
+  return text;
+}
+
+void write_file(const std::filesystem::path &path, const std::string &data) {
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  out.write(data.data(), static_cast<std::streamsize>(data.size()));
+}
+
+std::vector<TraceRecord> read_window(const std::string &path, const RecordWindow &window, IndexUse use, InputStats &stats) {
+  std::vector<TraceRecord> out;
+  check(trace_replay::read_trace_window(path, window, use, 2, stats, [&out](TraceRecord &&rec) { out.push_back(rec); }), "window read");
+  return out;
+}
+
+void test_parse_range() {
+  const auto both = trace_replay::parse_u64_range("10:20");
+  check(both && both->lo == 10U && both->hi == 20U, "A:B");
+  const auto open_hi = trace_replay::parse_u64_range("16:");
+  check(open_hi && open_hi->lo == 16U && open_hi->hi == UINT64_MAX, "A:");
+  const auto open_lo = trace_replay::parse_u64_range(":7");
+  check(open_lo && open_lo->lo == 0U && open_lo->hi == 7U, ":B");
+  check(!trace_replay::parse_u64_range("20:10"), "reversed range rejected");
+  check(!trace_replay::parse_u64_range("5"), "missing colon rejected");
+  check(!trace_replay::parse_u64_range("1:2:3"), "extra colon rejected");
+  check(!trace_replay::parse_u64_range("x:2"), "bad bound rejected");
+}
+
+void test_jsonl_window_matches_full_scan() {
+  const auto path = temp_path("saturnis_trace_index_test.jsonl");
+  const std::string sidecar = trace_replay::trace_index_path(path.string());
+  std::filesystem::remove(sidecar);
+  write_file(path, jsonl_trace(8000));
+
+  trace_replay::MappedFile file;
+  check(file.open(path.string()), "fixture opens");
+  const auto index = trace_replay::build_trace_index(file, IndexedFormat::Jsonl, 3);
+  check(index.has_value() && index->entries.size() > 2U, "index has several spans");
+  check(index->entries.front().first_item == 0U && index->entries.front().offset == 0U, "first span starts at line 0");
+  check(trace_replay::write_trace_index(sidecar, *index), "sidecar written");
+  const auto loaded = trace_replay::load_trace_index(sidecar, file, IndexedFormat::Jsonl);
+  check(loaded.has_value() && loaded->entries.size() == index->entries.size(), "sidecar loads");
+  check(!trace_replay::load_trace_index(sidecar, file, IndexedFormat::Btr1), "format mismatch rejected");
+
+  RecordWindow window{};
+  window.seq = U64Range{3000, 3100};
+  InputStats indexed_stats{};
+  InputStats full_stats{};
+  const auto indexed = read_window(path.string(), window, IndexUse::Auto, indexed_stats);
+  const auto full = read_window(path.string(), window, IndexUse::None, full_stats);
+  check(indexed.size() == full.size() && !indexed.empty(), "same record count with and without index");
+  for (std::size_t i = 0; i < indexed.size(); ++i) {
+    check(indexed[i].seq == full[i].seq && indexed[i].source_line == full[i].source_line, "same records and line numbers");
+    check(window.contains(indexed[i]), "records inside window");
+  }
+  check(indexed_stats.total_events == indexed.size() && full_stats.total_events == full.size(), "stats count window records only");
+  check(indexed_stats.non_monotonic_seq_count == full_stats.non_monotonic_seq_count, "seq checks agree");
+  check(full_stats.malformed_lines == 0U, "malformed lines are not attributed to a window");
+
+  // Line numbers past the malformed line account for it.
+  RecordWindow tail{};
+  tail.tick = U64Range{10U + 7000U * 3U + 2U, 10U + 7000U * 3U + 2U};
+  InputStats tail_stats{};
+  const auto one = read_window(path.string(), tail, IndexUse::Auto, tail_stats);
+  check(one.size() == 1U && one[0].source_line == 7002U, "tick window finds line 7002");
+
+  write_file(path, jsonl_trace(8001));
+  trace_replay::MappedFile changed;
+  check(changed.open(path.string()), "changed fixture opens");
+  check(!trace_replay::load_trace_index(sidecar, changed, IndexedFormat::Jsonl), "stale sidecar rejected");
+  std::filesystem::remove(path);
+  std::filesystem::remove(sidecar);
+}
+
+// Swapping two equal-length lines in the middle keeps the size, the
+// fingerprinted ends and (restored here) the mtime; the span hashes must still
+// catch it.
+void test_same_size_edit_rebuilds_sidecar() {
+  const auto path = temp_path("saturnis_trace_index_edit_test.jsonl");
+  const std::string sidecar = trace_replay::trace_index_path(path.string());
+  std::filesystem::remove(sidecar);
+  std::string text = jsonl_trace(8000);
+  write_file(path, text);
+
+  RecordWindow window{};
+  window.seq = U64Range{6001, 6001};
+  InputStats stats{};
+  check(read_window(path.string(), window, IndexUse::Build, stats).size() == 1U, "record found before the edit");
+  const auto stamp = std::filesystem::last_write_time(path);
+
+  const auto line_at = [&text](const std::string &key) {
+    const std::size_t begin = text.find(key);
+    return std::pair{begin, text.find('\n', begin) - begin};
+  };
+  const auto [early, early_size] = line_at("{\"seq\":4001,");
+  const auto [late, late_size] = line_at("{\"seq\":6001,");
+  check(early_size == late_size, "swapped lines have the same length");
+  const std::string early_line = text.substr(early, early_size);
+  text.replace(early, early_size, text.substr(late, late_size));
+  text.replace(late, late_size, early_line);
+  write_file(path, text);
+  std::filesystem::last_write_time(path, stamp);
+
+  trace_replay::MappedFile file;
+  check(file.open(path.string()), "edited fixture opens");
+  const auto loaded = trace_replay::load_trace_index(sidecar, file, IndexedFormat::Jsonl);
+  check(loaded.has_value(), "header checks miss the edit");
+  check(!trace_replay::trace_index_spans_match(*loaded, file, window), "span hash catches the edit");
+
+  InputStats indexed_stats{};
+  InputStats full_stats{};
+  const auto indexed = read_window(path.string(), window, IndexUse::Auto, indexed_stats);
+  const auto full = read_window(path.string(), window, IndexUse::None, full_stats);
+  check(indexed.size() == 1U && full.size() == 1U && indexed[0].source_line == full[0].source_line, "stale sidecar is rebuilt");
+
+  std::filesystem::last_write_time(path, stamp + std::chrono::seconds(1));
+  trace_replay::MappedFile touched;
+  check(touched.open(path.string()), "touched fixture opens");
+  check(!trace_replay::load_trace_index(sidecar, touched, IndexedFormat::Jsonl), "mtime change rejected");
+  std::filesystem::remove(path);
+  std::filesystem::remove(sidecar);
+}
+
+void test_btr1_window() {
+  const auto path = temp_path("saturnis_trace_index_test.bin");
+  const std::string sidecar = trace_replay::trace_index_path(path.string());
+  std::filesystem::remove(sidecar);
+  std::string data = "BTR1";
+  data += std::string("\x01\x00\x30\x00", 4);
+  for (std::uint64_t i = 0; i < 20000U; ++i) {
+    trace_replay::BinaryTraceRecordV1 raw{};
+    raw.seq = i;
+    raw.tick_first_attempt = i * 2U;
+    raw.tick_complete = i * 2U + 1U;
+    raw.service_cycles = 1;
+    raw.addr = 0x06004000U;
+    raw.size = 4;
+    raw.master = static_cast<std::uint8_t>(i % 4U); // master 3 is malformed
+    data.append(reinterpret_cast<const char *>(&raw), sizeof(raw));
+  }
+  write_file(path, data);
+
+  RecordWindow window{};
+  window.seq = U64Range{12000, 12099};
+  InputStats indexed_stats{};
+  InputStats full_stats{};
+  const auto indexed = read_window(path.string(), window, IndexUse::Build, indexed_stats);
+  const auto full = read_window(path.string(), window, IndexUse::None, full_stats);
+  check(std::filesystem::exists(sidecar), "sidecar built");
+  check(indexed.size() == 75U && full.size() == 75U, "well-formed records in window");
+  for (std::size_t i = 0; i < indexed.size(); ++i) {
+    check(indexed[i].seq == full[i].seq && indexed[i].source_line == indexed[i].seq + 1U, "same BTR1 records");
+  }
+  std::filesystem::remove(path);
+  std::filesystem::remove(sidecar);
+}
+
+} // namespace
+
+int main() {
+  test_parse_range();
+  test_jsonl_window_matches_full_scan();
+  test_same_size_edit_rebuilds_sidecar();
+  test_btr1_window();
+  std::cout << "trace index tests passed\n";
+  return 0;
+}
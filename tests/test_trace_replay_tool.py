@@ -49,7 +49,7 @@ def _write_binary_fixture_from_jsonl(src: pathlib.Path, dst: pathlib.Path) -> No
 
 def main() -> int:
     root = pathlib.Path(__file__).resolve().parents[1]
-    build_dir = root / "build"
+    build_dir = pathlib.Path(sys.argv[1]).resolve() if len(sys.argv) > 1 else root / "build"
     trace_replay = build_dir / "trace_replay"
     fixture = root / "tests" / "fixtures" / "trace_replay" / "sample_trace.jsonl"
     annotated = build_dir / "trace_replay_tool_annotated.jsonl"
@@ -231,6 +231,251 @@ def main() -> int:
             print(f"missing model annotated field: {model_field}")
             return 1
 
+    # --annotated-format bin: fixed 104-byte rows behind a BTA1 header, holding
+    # the same values as the JSONL rows.
+    binary_annotated = build_dir / "trace_replay_tool_annotated_model.bta"
+    proc_binary_annotated = subprocess.run(
+        [
+            str(trace_replay),
+            str(fixture),
+            "--annotated-output",
+            str(binary_annotated),
+            "--annotated-format",
+            "bin",
+            "--include-model-comparison",
+            "--top-k",
+            "5",
+        ],
+        check=False,
+        text=True,
+        capture_output=True,
+    )
+    if proc_binary_annotated.returncode != 0:
+        print(proc_binary_annotated.stdout)
+        print(proc_binary_annotated.stderr)
+        return 1
+    binary_bytes = binary_annotated.read_bytes()
+    if binary_bytes[:8] != b"BTA1" + struct.pack("<HH", 1, 104):
+        print(f"unexpected binary annotated header: {binary_bytes[:8]!r}")
+        return 1
+    model_rows = [json.loads(ln) for ln in model_annotated.read_text().splitlines() if ln.strip()]
+    if len(binary_bytes) != 8 + 104 * len(model_rows):
+        print(f"unexpected binary annotated size: {len(binary_bytes)}")
+        return 1
+    for index, row in enumerate(model_rows):
+        fields = struct.unpack_from("<3Q4q8I3H7B3x", binary_bytes, 8 + 104 * index)
+        expected = (
+            row["seq"],
+            row["tick_first_attempt"],
+            row["tick_complete"],
+            row["model_vs_trace_wait_delta"],
+            row["model_vs_trace_total_delta"],
+            row["cumulative_drift_wait"],
+            row["cumulative_drift_total"],
+            int(row["addr"], 16),
+            row["service_cycles"],
+            row["retries"],
+            row["observed_elapsed"],
+            row["observed_wait"],
+            row["model_predicted_wait"],
+            row["model_predicted_service"],
+            row["model_predicted_total"],
+        )
+        if fields[:15] != expected or fields[18] != row["size"] or fields[-1] != 1:
+            print(f"binary annotated row {index} does not match JSONL: {fields}")
+            return 1
+
+    streaming_annotated = build_dir / "trace_replay_tool_annotated_streaming.jsonl"
+    streaming_summary = build_dir / "trace_replay_tool_summary_streaming.json"
+    proc_streaming = subprocess.run(
+        [
+            str(trace_replay),
+            str(fixture),
+            "--annotated-output",
+            str(streaming_annotated),
+            "--summary-output",
+            str(streaming_summary),
+            "--streaming",
+            "--stream-window",
+            "16",
+            "--top-k",
+            "5",
+        ],
+        check=False,
+        text=True,
+        capture_output=True,
+    )
+    if proc_streaming.returncode != 0:
+        print(proc_streaming.stdout)
+        print(proc_streaming.stderr)
+        return 1
+    if streaming_summary.read_bytes() != summary.read_bytes():
+        print("expected --streaming summary to match batch summary")
+        return 1
+    if streaming_annotated.read_bytes() != annotated.read_bytes():
+        print("expected --streaming annotated output to match batch output")
+        return 1
+
+    # Large enough to span several newline-aligned ingest chunks; repeating the
+    # fixture keeps its malformed lines and produces duplicate/non-monotonic seqs.
+    chunked_fixture = build_dir / "trace_replay_tool_fixture_chunked.jsonl"
+    chunked_fixture.write_text(fixture.read_text() * 400)
+    chunked_outputs = []
+    for threads in ("1", "4"):
+        chunked_summary = build_dir / f"trace_replay_tool_summary_chunked_{threads}.json"
+        proc_chunked = subprocess.run(
+            [
+                str(trace_replay),
+                str(chunked_fixture),
+                "--summary-output",
+                str(chunked_summary),
+                "--include-model-comparison",
+                "--ingest-threads",
+                threads,
+            ],
+            check=False,
+            text=True,
+            capture_output=True,
+        )
+        if proc_chunked.returncode != 0:
+            print(proc_chunked.stdout)
+            print(proc_chunked.stderr)
+            return 1
+        chunked_outputs.append((chunked_summary.read_bytes(), proc_chunked.stdout, proc_chunked.stderr))
+    if chunked_outputs[0] != chunked_outputs[1]:
+        print("expected --ingest-threads 4 output and diagnostics to match single-threaded ingest")
+        return 1
+
+    # Enough records for several replay segments; drift, rankings, annotated
+    # rows and warnings must all match the serial loop.
+    segmented_fixture = build_dir / "trace_replay_tool_fixture_segmented.jsonl"
+    segmented_fixture.write_text(fixture.read_text() * 2000)
+    segmented_outputs = []
+    for threads in ("1", "4"):
+        segmented_summary = build_dir / f"trace_replay_tool_summary_segmented_{threads}.json"
+        segmented_annotated = build_dir / f"trace_replay_tool_annotated_segmented_{threads}.jsonl"
+        proc_segmented = subprocess.run(
+            [
+                str(trace_replay),
+                str(segmented_fixture),
+                "--summary-output",
+                str(segmented_summary),
+                "--annotated-output",
+                str(segmented_annotated),
+                "--include-model-comparison",
+                "--replay-threads",
+                threads,
+            ],
+            check=False,
+            text=True,
+            capture_output=True,
+        )
+        if proc_segmented.returncode != 0:
+            print(proc_segmented.stdout)
+            print(proc_segmented.stderr)
+            return 1
+        segmented_outputs.append(
+            (segmented_summary.read_bytes(), segmented_annotated.read_bytes(), proc_segmented.stdout, proc_segmented.stderr)
+        )
+    if segmented_outputs[0] != segmented_outputs[1]:
+        print("expected --replay-threads 4 output to match the serial replay")
+        return 1
+
+    # The default-config sweep variant must reproduce the single-config counters.
+    sweep_summary = build_dir / "trace_replay_tool_summary_sweep.json"
+    proc_sweep = subprocess.run(
+        [
+            str(trace_replay),
+            str(fixture),
+            "--summary-output",
+            str(sweep_summary),
+            "--include-model-comparison",
+            "--sweep",
+            "same_address_contention=0..2;tie_turnaround=1;read:High WRAM=2,3",
+        ],
+        check=False,
+        text=True,
+        capture_output=True,
+    )
+    if proc_sweep.returncode != 0:
+        print(proc_sweep.stdout)
+        print(proc_sweep.stderr)
+        return 1
+    sweep_data = json.loads(sweep_summary.read_text())
+    ranking = sweep_data["sweep"]["ranking"]
+    if sweep_data["sweep"]["variant_count"] != 6 or len(ranking) != 6 or "sweep_ranking:" not in proc_sweep.stdout:
+        print("expected a ranked sweep over 6 variants")
+        return 1
+    default_variant = [
+        r for r in ranking if r["settings"] == {"same_address_contention": 2, "tie_turnaround": 1, "read:High WRAM": 2}
+    ]
+    if len(default_variant) != 1:
+        print(f"missing default sweep variant: {ranking}")
+        return 1
+    for key in ("agreement_count", "mismatch_count", "known_gap_count", "normalized_agreement_count", "normalized_mismatch_count"):
+        if default_variant[0][key] != sweep_data[key]:
+            print(f"sweep {key} {default_variant[0][key]} != single-config {sweep_data[key]}")
+            return 1
+
+    # --cache-sim: batch and --streaming replays see the same access stream.
+    cache_sim_outputs = []
+    for extra in ([], ["--streaming"]):
+        cache_sim_summary = build_dir / f"trace_replay_tool_summary_cache_sim{'_streaming' if extra else ''}.json"
+        proc_cache_sim = subprocess.run(
+            [str(trace_replay), str(segmented_fixture), "--summary-output", str(cache_sim_summary), "--cache-sim", *extra],
+            check=False,
+            text=True,
+            capture_output=True,
+        )
+        if proc_cache_sim.returncode != 0 or "cache_sim_top_miss_lines:" not in proc_cache_sim.stdout:
+            print(proc_cache_sim.stdout)
+            print(proc_cache_sim.stderr)
+            return 1
+        cache_sim_outputs.append(json.loads(cache_sim_summary.read_text())["cache_sim"])
+    if cache_sim_outputs[0] != cache_sim_outputs[1]:
+        print("expected --streaming --cache-sim to match the batch replay")
+        return 1
+    cache_sim = cache_sim_outputs[0]
+    for master, stats in cache_sim["by_master"].items():
+        if stats["hits"] + stats["misses"] + stats["uncached"] != stats["accesses"]:
+            print(f"inconsistent cache_sim counters for {master}: {stats}")
+            return 1
+    agreement = cache_sim["observed_bucket_agreement"]
+    if sum(cache_sim["prediction_vs_observed_bucket"].values()) != agreement["compared"]:
+        print(f"cache_sim confusion does not add up: {cache_sim}")
+        return 1
+
+    # Calibration must never leave more drift than the stock table.
+    calibrate_summary = build_dir / "trace_replay_tool_summary_calibrate.json"
+    proc_calibrate = subprocess.run(
+        [str(trace_replay), str(fixture), "--calibrate", "--summary-output", str(calibrate_summary)],
+        check=False,
+        text=True,
+        capture_output=True,
+    )
+    if proc_calibrate.returncode != 0 or "suggested_timing_table:" not in proc_calibrate.stdout:
+        print(proc_calibrate.stdout)
+        print(proc_calibrate.stderr)
+        return 1
+    calibration = json.loads(calibrate_summary.read_text())["calibration"]
+    if calibration["residuals_after"]["abs_cumulative_drift"] > calibration["residuals_before"]["abs_cumulative_drift"]:
+        print(f"calibration increased drift: {calibration}")
+        return 1
+    if calibration["suggested_timing_table"][-1]["region"] != "unmapped":
+        print("expected the unmapped row last in the suggested table")
+        return 1
+    for conflicting in (["--streaming"], ["--sweep", "same_address_contention=0..2"], ["--cache-sim"], ["--annotated-output", str(annotated)]):
+        proc_conflict = subprocess.run(
+            [str(trace_replay), str(fixture), "--calibrate", *conflicting],
+            check=False,
+            text=True,
+            capture_output=True,
+        )
+        if proc_conflict.returncode == 0 or "--calibrate" not in proc_conflict.stderr or proc_conflict.stdout:
+            print(f"expected --calibrate with {conflicting[0]} to be rejected up front")
+            print(proc_conflict.stdout)
+            print(proc_conflict.stderr)
+            return 1
 
     binary_fixture = build_dir / "trace_replay_tool_fixture.bin"
     binary_summary = build_dir / "trace_replay_tool_summary_bin.json"
@@ -263,6 +508,287 @@ def main() -> int:
         print(f"unexpected binary malformed_lines_skipped: {bin_data['malformed_lines_skipped']}")
         return 1
 
+    trace_pack = build_dir / "trace_pack"
+    packed = build_dir / "trace_replay_tool_fixture.btr2"
+    proc_pack = subprocess.run(
+        [str(trace_pack), str(binary_fixture), "--output", str(packed), "--block-records", "4"],
+        check=False,
+        text=True,
+        capture_output=True,
+    )
+    if proc_pack.returncode != 0 or "verified" not in proc_pack.stdout:
+        print(proc_pack.stdout)
+        print(proc_pack.stderr)
+        return 1
+
+    def replay_summary(path: pathlib.Path, name: str) -> bytes | None:
+        out = build_dir / name
+        proc_replay = subprocess.run(
+            [str(trace_replay), str(path), "--summary-output", str(out), "--summary-only", "--top-k", "5"],
+            check=False,
+            text=True,
+            capture_output=True,
+        )
+        if proc_replay.returncode != 0:
+            print(proc_replay.stdout)
+            print(proc_replay.stderr)
+            return None
+        return out.read_bytes()
+
+    if replay_summary(packed, "trace_replay_tool_summary_btr2.json") != binary_summary.read_bytes():
+        print("expected BTR2 replay summary to match BTR1 replay summary")
+        return 1
+
+    split_base = build_dir / "trace_replay_tool_split.btr2"
+    proc_split = subprocess.run(
+        [str(trace_pack), str(packed), "--output", str(split_base), "--split-records", "4", "--block-records", "3"],
+        check=False,
+        text=True,
+        capture_output=True,
+    )
+    parts = [build_dir / f"trace_replay_tool_split.{i:03d}.btr2" for i in range(3)]
+    if proc_split.returncode != 0 or not all(part.exists() for part in parts):
+        print(proc_split.stdout)
+        print(proc_split.stderr)
+        return 1
+    joined = build_dir / "trace_replay_tool_joined.btr2"
+    proc_join = subprocess.run(
+        [str(trace_pack), *[str(part) for part in parts], "--output", str(joined)],
+        check=False,
+        text=True,
+        capture_output=True,
+    )
+    if proc_join.returncode != 0:
+        print(proc_join.stdout)
+        print(proc_join.stderr)
+        return 1
+    if replay_summary(joined, "trace_replay_tool_summary_joined.json") != binary_summary.read_bytes():
+        print("expected split + concatenated BTR2 replay summary to match BTR1 replay summary")
+        return 1
+
+    # The JSONL fixture deliberately contains malformed lines.
+    proc_strict = subprocess.run(
+        [str(trace_pack), str(fixture), "--output", str(build_dir / "trace_replay_tool_strict.btr2"), "--strict"],
+        check=False,
+        text=True,
+        capture_output=True,
+    )
+    if proc_strict.returncode != 2:
+        print(f"expected --strict to exit 2 on malformed JSONL, got {proc_strict.returncode}")
+        return 1
+
+    # A spelling BTR2 cannot reproduce fails the pack unless dropping is opted into.
+    lossy_input = build_dir / "trace_replay_tool_lossy.jsonl"
+    lossy_input.write_text(fixture.read_text().replace('"addr":"0x05FE0020"', '"addr":"0x05fe0020"'))
+    lossy_packed = build_dir / "trace_replay_tool_lossy.btr2"
+    proc_lossy = subprocess.run(
+        [str(trace_pack), str(lossy_input), "--output", str(lossy_packed)],
+        check=False,
+        text=True,
+        capture_output=True,
+    )
+    if proc_lossy.returncode != 1 or "--skip-unencodable" not in proc_lossy.stderr:
+        print(f"expected an unencodable addr spelling to fail trace_pack, got {proc_lossy.returncode}")
+        print(proc_lossy.stderr)
+        return 1
+    proc_skip = subprocess.run(
+        [str(trace_pack), str(lossy_input), "--output", str(lossy_packed), "--skip-unencodable"],
+        check=False,
+        text=True,
+        capture_output=True,
+    )
+    if proc_skip.returncode != 0 or "packed_records: 9" not in proc_skip.stdout:
+        print(proc_skip.stdout)
+        print(proc_skip.stderr)
+        return 1
+
+    # trace_diff joins JSONL against its BTR2 repack record for record, and
+    # pinpoints a single changed completion tick.
+    trace_diff = build_dir / "trace_diff"
+    diff_summary = build_dir / "trace_diff_summary.json"
+    proc_diff_same = subprocess.run(
+        [str(trace_diff), str(fixture), str(packed), "--summary-output", str(diff_summary)],
+        check=False,
+        text=True,
+        capture_output=True,
+    )
+    if proc_diff_same.returncode != 0:
+        print(proc_diff_same.stdout)
+        print(proc_diff_same.stderr)
+        return 1
+    diff_same = json.loads(diff_summary.read_text())
+    if diff_same["identical"] != 10 or diff_same["unaligned_a"] != 0 or diff_same["first_divergence"] is not None:
+        print(f"expected the fixture to match its BTR2 repack: {diff_same}")
+        return 1
+
+    shifted_fixture = build_dir / "trace_diff_fixture_shifted.jsonl"
+    shifted_fixture.write_text(fixture.read_text().replace('"tick_complete":26', '"tick_complete":29'))
+    diff_records = build_dir / "trace_diff_records.jsonl"
+    proc_diff = subprocess.run(
+        [str(trace_diff), str(fixture), str(shifted_fixture), "--records-output", str(diff_records), "--summary-output", str(diff_summary)],
+        check=False,
+        text=True,
+        capture_output=True,
+    )
+    if proc_diff.returncode != 0 or "first_divergence: seq=7 kind=timing_changed" not in proc_diff.stdout:
+        print(proc_diff.stdout)
+        print(proc_diff.stderr)
+        return 1
+    diff_lines = [json.loads(ln) for ln in diff_records.read_text().splitlines()]
+    if len(diff_lines) != 1 or diff_lines[0]["elapsed_delta"] != 3 or diff_lines[0]["wait_delta"] != 0:
+        print(f"unexpected trace_diff records: {diff_lines}")
+        return 1
+    vdp2 = [r for r in json.loads(diff_summary.read_text())["by_region"] if r["name"] == "VDP2"]
+    if len(vdp2) != 1 or vdp2[0]["differing"] != 1 or vdp2[0]["elapsed_delta_sum"] != 3:
+        print(f"unexpected trace_diff VDP2 bucket: {vdp2}")
+        return 1
+
+    # --replay-cache: replaying a capture, growing it and replaying again from the
+    # cache matches one replay of the grown capture.
+    masters = ["MSH2", "SSH2", "DMA"]
+    addrs = ["0x06004000", "0x05E00000", "0x00200000", "0x25C00000"]
+    cache_lines = []
+    tick = 0
+    for seq in range(1, 14001):
+        tick += 1 + seq % 5
+        complete = tick + (seq % 7) * 2 - (3 if seq % 97 == 0 else 0)
+        cache_lines.append(
+            f'{{"seq":{seq},"master":"{masters[seq % 3]}","tick_first_attempt":{tick},"tick_complete":{complete},'
+            f'"addr":"{addrs[seq % 4]}","size":{2 if seq % 11 == 0 else 4},"rw":"{"W" if seq % 3 == 0 else "R"}",'
+            f'"kind":"{"write" if seq % 3 == 0 else "read"}","service_cycles":{2 + seq % 4},"retries":{seq % 2}}}\n'
+        )
+    grown_capture = build_dir / "trace_replay_tool_cache_capture.jsonl"
+    replay_cache = build_dir / "trace_replay_tool_cache.trrc"
+    replay_cache.unlink(missing_ok=True)
+
+    def cached_replay(cache_args: list[str], name: str) -> tuple[str, bytes] | None:
+        out = build_dir / name
+        proc_cached = subprocess.run(
+            [str(trace_replay), str(grown_capture), "--include-model-comparison", "--summary-output", str(out), *cache_args],
+            check=False,
+            text=True,
+            capture_output=True,
+        )
+        if proc_cached.returncode != 0:
+            print(proc_cached.stdout)
+            print(proc_cached.stderr)
+            return None
+        return proc_cached.stdout, out.read_bytes()
+
+    grown_capture.write_text("".join(cache_lines[:9000]))
+    if cached_replay(["--replay-cache", str(replay_cache)], "trace_replay_tool_cache_head.json") is None:
+        return 1
+    grown_capture.write_text("".join(cache_lines))
+    resumed = cached_replay(["--replay-cache", str(replay_cache)], "trace_replay_tool_cache_resumed.json")
+    uncached = cached_replay([], "trace_replay_tool_cache_full.json")
+    if resumed is None or uncached is None or resumed != uncached:
+        print("expected a replay resumed from --replay-cache to match a full replay")
+        return 1
+
+    # Live ingestion: stdin replays match a --streaming replay of the same file.
+    file_stream_summary = build_dir / "trace_replay_tool_summary_file_stream.json"
+    stdin_summary = build_dir / "trace_replay_tool_summary_stdin.json"
+    proc_file_stream = subprocess.run(
+        [str(trace_replay), str(fixture), "--streaming", "--include-model-comparison", "--summary-output", str(file_stream_summary)],
+        check=False,
+        text=True,
+        capture_output=True,
+    )
+    proc_stdin = subprocess.run(
+        [
+            str(trace_replay),
+            "-",
+            "--include-model-comparison",
+            "--rolling-interval",
+            "4",
+            "--summary-output",
+            str(stdin_summary),
+        ],
+        input=fixture.read_text(),
+        check=False,
+        text=True,
+        capture_output=True,
+    )
+    if proc_file_stream.returncode != 0 or proc_stdin.returncode != 0:
+        print(proc_file_stream.stderr)
+        print(proc_stdin.stderr)
+        return 1
+    if stdin_summary.read_bytes() != file_stream_summary.read_bytes():
+        print("expected stdin replay summary to match --streaming file replay summary")
+        return 1
+    rolling = [ln for ln in proc_stdin.stdout.splitlines() if ln.startswith("rolling: ")]
+    if len(rolling) != 2 or "records=4 " not in rolling[0] or "records=8 " not in rolling[1]:
+        print(f"unexpected rolling summaries: {rolling}")
+        return 1
+    if [ln for ln in proc_stdin.stdout.splitlines() if not ln.startswith("rolling: ")] != proc_file_stream.stdout.splitlines():
+        print("expected stdin stdout (minus rolling lines) to match file replay stdout")
+        return 1
+    if proc_stdin.stderr != proc_file_stream.stderr:
+        print("expected stdin diagnostics to match file replay diagnostics")
+        return 1
+
+    # Range replays: the sidecar index must not change what is selected.
+    ranged_input = build_dir / "trace_replay_tool_ranged.jsonl"
+    ranged_input.write_bytes(fixture.read_bytes())
+    sidecar = build_dir / "trace_replay_tool_ranged.jsonl.tridx"
+    if sidecar.exists():
+        sidecar.unlink()
+    ranged = {}
+    for label, extra in [("indexed", []), ("reused", []), ("scan", ["--no-index"])]:
+        out = build_dir / f"trace_replay_tool_summary_range_{label}.json"
+        proc_range = subprocess.run(
+            [str(trace_replay), str(ranged_input), "--seq-range", "3:7", "--summary-output", str(out), "--summary-only", *extra],
+            check=False,
+            text=True,
+            capture_output=True,
+        )
+        if proc_range.returncode != 0:
+            print(proc_range.stdout)
+            print(proc_range.stderr)
+            return 1
+        ranged[label] = out.read_bytes()
+    if not sidecar.exists():
+        print("expected --seq-range to write a .tridx sidecar")
+        return 1
+    if not (ranged["indexed"] == ranged["reused"] == ranged["scan"]):
+        print("expected indexed and full-scan range replays to match")
+        return 1
+    range_data = json.loads(ranged["indexed"])
+    if range_data["records_processed"] == 0 or range_data["malformed_lines_skipped"] != 0:
+        print(f"unexpected range replay counts: {range_data['records_processed']} {range_data['malformed_lines_skipped']}")
+        return 1
+
+    # Address spellings: verbatim up to the table cap, canonical hex after it.
+    spelled_count = 0xFFFF + 3
+    spelled_input = build_dir / "trace_replay_tool_spelled.jsonl"
+    spelled_input.write_text(
+        "".join(
+            f'{{"seq":{i + 1},"master":"MSH2","tick_first_attempt":{i * 4},"tick_complete":{i * 4 + 2},'
+            f'"addr":"0x{0x06000000 + i * 4:x}","size":4,"rw":"R","kind":"read","service_cycles":2,"retries":0}}\n'
+            for i in range(spelled_count)
+        )
+    )
+    spelled_annotated = build_dir / "trace_replay_tool_spelled_annotated.jsonl"
+    proc_spelled = subprocess.run(
+        [str(trace_replay), str(spelled_input), "--annotated-output", str(spelled_annotated)],
+        check=False,
+        text=True,
+        capture_output=True,
+    )
+    if proc_spelled.returncode != 0:
+        print(proc_spelled.stdout)
+        print(proc_spelled.stderr)
+        return 1
+    if proc_spelled.stderr.count("address spellings") != 1:
+        print(f"expected one address spelling cap warning, got: {proc_spelled.stderr}")
+        return 1
+    spelled_addrs = [json.loads(line)["addr"] for line in spelled_annotated.read_text().splitlines()]
+    expected_addrs = [f"0x{0x06000000 + i * 4:x}" for i in range(0xFFFF)]
+    expected_addrs += [f"0x{0x06000000 + i * 4:08X}" for i in range(0xFFFF, spelled_count)]
+    if spelled_addrs != expected_addrs:
+        print("expected address spellings past the cap to render as canonical hex")
+        return 1
+
     return 0
 
 
@@ -1,6 +1,7 @@
 #include "busarb/ymir_timing.hpp"
 
 #include <array>
+#include <cstddef>
 #include <cstdint>
 #include <cstdlib>
 #include <iostream>
@@ -21,6 +22,24 @@ void check(bool cond, const char *msg) {
   }
 }
 
+// The page table must answer exactly what a first-to-last scan of the rows
+// does.
+void check_lookup(std::uint32_t addr) {
+  const auto table = busarb::ymir_region_timings();
+  std::size_t region = table.size();
+  for (std::size_t i = 0; i < table.size(); ++i) {
+    if (addr >= table[i].start && addr <= table[i].end) {
+      region = i;
+      break;
+    }
+  }
+  const std::uint32_t read = region == table.size() ? busarb::kYmirUnmappedReadCycles : table[region].read_cycles;
+  const std::uint32_t write = region == table.size() ? busarb::kYmirUnmappedWriteCycles : table[region].write_cycles;
+  const busarb::YmirRegionPage page = busarb::ymir_region_lookup(addr);
+  check(page.region == region && page.read_cycles == read && page.write_cycles == write, "page table disagrees with row scan");
+  check(busarb::ymir_region_index(addr) == region, "region index disagrees with row scan");
+}
+
 } // namespace
 
 int main() {
@@ -50,9 +69,31 @@ int main() {
     check(busarb::ymir_access_cycles(nullptr, row.end, true, 4U) == row.write_cycles, "write end mismatch");
   }
 
+  const auto table = busarb::ymir_region_timings();
+  check(table.size() == rows.size(), "exported table size mismatch");
+  for (std::size_t i = 0; i < rows.size(); ++i) {
+    check(table[i].start == rows[i].start && table[i].end == rows[i].end, "exported table range mismatch");
+    check(table[i].read_cycles == rows[i].read_cycles && table[i].write_cycles == rows[i].write_cycles, "exported table cycles mismatch");
+    check(busarb::ymir_region_index(rows[i].end) == i, "region index mismatch");
+  }
+  check(busarb::ymir_region_index(0x08000000U) == table.size(), "unmapped region index mismatch");
+
   check(busarb::ymir_access_cycles(nullptr, 0x08000000U, false, 4U) == 4U, "unmapped read fallback mismatch");
   check(busarb::ymir_access_cycles(nullptr, 0x08000000U, true, 4U) == 2U, "unmapped write fallback mismatch");
 
+  check(table.size() == busarb::kYmirRegionCount, "region count constant mismatch");
+  for (const auto &row : table) {
+    for (std::uint32_t edge : {row.start, row.end}) {
+      check_lookup(edge - 1U);
+      check_lookup(edge);
+      check_lookup(edge + 1U);
+    }
+  }
+  for (std::uint64_t addr = 0; addr <= 0xFFFFFFFFULL; addr += 0x1FFFU) {
+    check_lookup(static_cast<std::uint32_t>(addr));
+  }
+  check_lookup(0xFFFFFDFFU);
+
   std::cout << "ymir timing tests passed\n";
   return 0;
 }
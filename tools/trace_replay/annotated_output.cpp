@@ -0,0 +1,38 @@
+#include "trace_replay/annotated_output.hpp"
+
+#include <ios>
+
+namespace trace_replay {
+
+bool AnnotatedFile::open(const std::string &path, AnnotatedFormat format) {
+  out_.open(path, std::ios::binary | std::ios::trunc);
+  if (!out_.is_open()) {
+    return false;
+  }
+  buffer_.clear();
+  if (format == AnnotatedFormat::Binary) {
+    buffer_.append("BTA1");
+    buffer_.append(static_cast<char>(kAnnotatedBinaryVersion & 0xFFU));
+    buffer_.append(static_cast<char>(kAnnotatedBinaryVersion >> 8U));
+    buffer_.append(static_cast<char>(sizeof(BinaryAnnotatedRecordV1) & 0xFFU));
+    buffer_.append(static_cast<char>(sizeof(BinaryAnnotatedRecordV1) >> 8U));
+  }
+  return true;
+}
+
+void AnnotatedFile::flush() {
+  const std::string_view pending = buffer_.view();
+  out_.write(pending.data(), static_cast<std::streamsize>(pending.size()));
+  buffer_.clear();
+}
+
+bool AnnotatedFile::close() {
+  if (!out_.is_open()) {
+    return true;
+  }
+  flush();
+  out_.close();
+  return !out_.fail();
+}
+
+} // namespace trace_replay
@@ -0,0 +1,120 @@
+#pragma once
+
+#include "trace_replay/trace_record.hpp"
+
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+namespace trace_replay {
+
+// Output side of trace_replay --annotated-output. Rows are formatted into an
+// in-memory buffer with std::to_chars (no locale or stream state per field)
+// and reach the file in large blocks.
+
+enum class AnnotatedFormat : std::uint8_t { Jsonl, Binary };
+
+// Fixed-size annotated record for --annotated-format bin, after an 8-byte
+// header ("BTA1", uint16 version, uint16 record size) like BTR1's. Fields are
+// little-endian and naturally aligned, so the file maps straight onto a numpy
+// structured dtype (see docs/trace_format.md). Model fields are zero unless
+// flags has kAnnotatedHasModel.
+struct BinaryAnnotatedRecordV1 {
+  std::uint64_t seq;
+  std::uint64_t tick_first_attempt;
+  std::uint64_t tick_complete;
+  std::int64_t model_vs_trace_wait_delta;
+  std::int64_t model_vs_trace_total_delta;
+  std::int64_t cumulative_drift_wait;
+  std::int64_t cumulative_drift_total;
+  std::uint32_t addr;
+  std::uint32_t service_cycles;
+  std::uint32_t retries;
+  std::uint32_t observed_elapsed;
+  std::uint32_t observed_wait;
+  std::uint32_t model_predicted_wait;
+  std::uint32_t model_predicted_service;
+  std::uint32_t model_predicted_total;
+  std::uint16_t master; // label ids as in TraceRecord; canonical ids match BTR1
+  std::uint16_t rw;
+  std::uint16_t kind;
+  std::uint8_t size;
+  std::uint8_t region;
+  std::uint8_t observed_wait_metric_kind;
+  std::uint8_t cache_bucket;
+  std::uint8_t classification;
+  std::uint8_t known_gap_reason;
+  std::uint8_t flags;
+  std::uint8_t reserved[3];
+};
+static_assert(sizeof(BinaryAnnotatedRecordV1) == 104, "BinaryAnnotatedRecordV1 must be 104 bytes");
+
+inline constexpr std::uint16_t kAnnotatedBinaryVersion = 1;
+inline constexpr std::uint8_t kAnnotatedHasModel = 0x01U;
+
+// Append-only byte buffer for formatted output. Integers go through
+// std::to_chars, so output never depends on the global locale.
+class OutputBuffer {
+public:
+  void append(std::string_view text) { bytes_.append(text); }
+  void append(char c) { bytes_.push_back(c); }
+
+  template <typename T>
+  void append_int(T value) {
+    static_assert(std::is_integral_v<T>, "append_int needs an integer");
+    char digits[24];
+    const auto result = std::to_chars(digits, digits + sizeof(digits), value);
+    bytes_.append(digits, static_cast<std::size_t>(result.ptr - digits));
+  }
+
+  // Appends `text` as a JSON string body; see append_json_escaped().
+  void append_escaped(std::string_view text) { append_json_escaped(bytes_, text); }
+
+  template <typename T>
+  void append_raw(const T &value) {
+    static_assert(std::is_trivially_copyable_v<T>, "append_raw needs a trivially copyable type");
+    const std::size_t at = bytes_.size();
+    bytes_.resize(at + sizeof(T));
+    std::memcpy(bytes_.data() + at, &value, sizeof(T));
+  }
+
+  [[nodiscard]] std::string_view view() const { return bytes_; }
+  [[nodiscard]] std::size_t size() const { return bytes_.size(); }
+  void clear() { bytes_.clear(); }
+
+private:
+  std::string bytes_;
+};
+
+// The annotated output file. Rows accumulate in buffer() and are written out
+// whenever commit() finds at least kFlushBytes pending.
+class AnnotatedFile {
+public:
+  static constexpr std::size_t kFlushBytes = std::size_t{1} << 20U;
+
+  // Creates the file; binary output starts with its header.
+  bool open(const std::string &path, AnnotatedFormat format);
+  [[nodiscard]] bool is_open() const { return out_.is_open(); }
+
+  [[nodiscard]] OutputBuffer &buffer() { return buffer_; }
+  void commit() {
+    if (buffer_.size() >= kFlushBytes) {
+      flush();
+    }
+  }
+  // Writes what is left and closes the file; false on a write error.
+  bool close();
+
+private:
+  void flush();
+
+  std::ofstream out_;
+  OutputBuffer buffer_;
+};
+
+} // namespace trace_replay
@@ -0,0 +1,545 @@
+#include "trace_replay/btr2.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <iostream>
+#include <limits>
+#include <utility>
+
+namespace trace_replay {
+namespace {
+
+constexpr std::array<std::uint8_t, 4> kBtr2Magic = {'B', 'T', 'R', '2'};
+constexpr std::array<std::uint8_t, 4> kBtr2IndexMagic = {'B', '2', 'I', 'X'};
+constexpr std::size_t kBlockHeaderSize = 5;
+constexpr std::size_t kColumnDirectoryEntrySize = 5;
+
+void put_u16(std::vector<std::uint8_t> &out, std::uint16_t value) {
+  out.push_back(static_cast<std::uint8_t>(value));
+  out.push_back(static_cast<std::uint8_t>(value >> 8U));
+}
+
+void put_u32(std::vector<std::uint8_t> &out, std::uint32_t value) {
+  for (unsigned shift = 0; shift < 32U; shift += 8U) {
+    out.push_back(static_cast<std::uint8_t>(value >> shift));
+  }
+}
+
+void put_u64(std::vector<std::uint8_t> &out, std::uint64_t value) {
+  for (unsigned shift = 0; shift < 64U; shift += 8U) {
+    out.push_back(static_cast<std::uint8_t>(value >> shift));
+  }
+}
+
+void put_varint(std::vector<std::uint8_t> &out, std::uint64_t value) {
+  while (value >= 0x80U) {
+    out.push_back(static_cast<std::uint8_t>(value | 0x80U));
+    value >>= 7U;
+  }
+  out.push_back(static_cast<std::uint8_t>(value));
+}
+
+std::uint16_t get_u16(const std::uint8_t *p) { return static_cast<std::uint16_t>(p[0] | (p[1] << 8U)); }
+
+std::uint32_t get_u32(const std::uint8_t *p) {
+  std::uint32_t value = 0;
+  for (unsigned i = 0; i < 4U; ++i) {
+    value |= static_cast<std::uint32_t>(p[i]) << (8U * i);
+  }
+  return value;
+}
+
+std::uint64_t get_u64(const std::uint8_t *p) {
+  std::uint64_t value = 0;
+  for (unsigned i = 0; i < 8U; ++i) {
+    value |= static_cast<std::uint64_t>(p[i]) << (8U * i);
+  }
+  return value;
+}
+
+// Deltas are taken modulo 2^64 and zigzag-coded so small steps in either
+// direction stay one byte.
+std::uint64_t zigzag_delta(std::uint64_t value, std::uint64_t base) {
+  const auto delta = static_cast<std::int64_t>(value - base);
+  return (static_cast<std::uint64_t>(delta) << 1U) ^ static_cast<std::uint64_t>(delta >> 63);
+}
+
+std::uint64_t apply_zigzag_delta(std::uint64_t base, std::uint64_t coded) {
+  const std::uint64_t delta = (coded >> 1U) ^ (~(coded & 1U) + 1U);
+  return base + delta;
+}
+
+class ByteReader {
+public:
+  explicit ByteReader(std::span<const std::uint8_t> bytes) : pos_(bytes.data()), end_(bytes.data() + bytes.size()) {}
+
+  std::uint64_t varint() {
+    std::uint64_t value = 0;
+    for (unsigned shift = 0; shift < 64U; shift += 7U) {
+      if (pos_ == end_) {
+        ok_ = false;
+        return 0;
+      }
+      const std::uint8_t byte = *pos_++;
+      value |= static_cast<std::uint64_t>(byte & 0x7FU) << shift;
+      if ((byte & 0x80U) == 0U) {
+        return value;
+      }
+    }
+    ok_ = false;
+    return 0;
+  }
+
+  std::uint8_t byte() {
+    if (pos_ == end_) {
+      ok_ = false;
+      return 0;
+    }
+    return *pos_++;
+  }
+
+  std::span<const std::uint8_t> take(std::size_t count) {
+    if (static_cast<std::size_t>(end_ - pos_) < count) {
+      ok_ = false;
+      return {};
+    }
+    const std::span<const std::uint8_t> out(pos_, count);
+    pos_ += count;
+    return out;
+  }
+
+  [[nodiscard]] bool ok() const { return ok_; }
+
+private:
+  const std::uint8_t *pos_;
+  const std::uint8_t *end_;
+  bool ok_ = true;
+};
+
+// Attribute byte: bits 0-1 master, bit 2 rw, bits 3-5 kind, bits 6-7 size
+// code (0 = 1 byte, 1 = 2 bytes, 2 = 4 bytes).
+std::optional<std::uint8_t> pack_attrs(const TraceRecord &record) {
+  const auto master = static_cast<std::uint16_t>(record.master);
+  const auto rw = static_cast<std::uint16_t>(record.rw);
+  const auto kind = static_cast<std::uint16_t>(record.kind);
+  if (master > 2U || rw > 1U || kind > 4U) {
+    return std::nullopt;
+  }
+  std::uint8_t size_code = 0;
+  if (record.size == 1U) {
+    size_code = 0;
+  } else if (record.size == 2U) {
+    size_code = 1;
+  } else if (record.size == 4U) {
+    size_code = 2;
+  } else {
+    return std::nullopt;
+  }
+  return static_cast<std::uint8_t>(master | (rw << 2U) | (kind << 3U) | (size_code << 6U));
+}
+
+bool unpack_attrs(std::uint8_t attrs, TraceRecord &record) {
+  const auto master = static_cast<std::uint16_t>(attrs & 0x3U);
+  const auto kind = static_cast<std::uint16_t>((attrs >> 3U) & 0x7U);
+  const auto size_code = static_cast<unsigned>(attrs >> 6U);
+  if (master > 2U || kind > 4U || size_code > 2U) {
+    return false;
+  }
+  record.master = static_cast<Master>(master);
+  record.rw = static_cast<Rw>((attrs >> 2U) & 0x1U);
+  record.kind = static_cast<AccessKind>(kind);
+  record.size = static_cast<std::uint8_t>(1U << size_code);
+  return true;
+}
+
+void encode_column(Btr2Column column, std::span<const TraceRecord> records, std::vector<std::uint8_t> &out) {
+  switch (column) {
+  case Btr2Column::Seq: {
+    std::uint64_t previous = 0;
+    for (const auto &record : records) {
+      put_varint(out, zigzag_delta(record.seq, previous));
+      previous = record.seq;
+    }
+    break;
+  }
+  case Btr2Column::TickComplete: {
+    std::uint64_t previous = 0;
+    for (const auto &record : records) {
+      put_varint(out, zigzag_delta(record.tick_complete, previous));
+      previous = record.tick_complete;
+    }
+    break;
+  }
+  case Btr2Column::TickFirstAttempt:
+    // Stored relative to tick_complete of the same record.
+    for (const auto &record : records) {
+      put_varint(out, zigzag_delta(record.tick_complete, record.tick_first_attempt));
+    }
+    break;
+  case Btr2Column::Addr: {
+    // Sorted dictionary (delta varints) followed by bit-packed indices.
+    std::vector<std::uint32_t> dictionary;
+    dictionary.reserve(records.size());
+    for (const auto &record : records) {
+      dictionary.push_back(record.addr);
+    }
+    std::sort(dictionary.begin(), dictionary.end());
+    dictionary.erase(std::unique(dictionary.begin(), dictionary.end()), dictionary.end());
+    put_varint(out, dictionary.size());
+    std::uint32_t previous = 0;
+    for (const auto addr : dictionary) {
+      put_varint(out, addr - previous);
+      previous = addr;
+    }
+    const auto width = dictionary.size() <= 1U ? 0U : static_cast<unsigned>(std::bit_width(dictionary.size() - 1U));
+    out.push_back(static_cast<std::uint8_t>(width));
+    std::uint64_t acc = 0;
+    unsigned bits = 0;
+    for (const auto &record : records) {
+      const auto index = static_cast<std::uint64_t>(std::lower_bound(dictionary.begin(), dictionary.end(), record.addr) - dictionary.begin());
+      acc |= index << bits;
+      bits += width;
+      while (bits >= 8U) {
+        out.push_back(static_cast<std::uint8_t>(acc));
+        acc >>= 8U;
+        bits -= 8U;
+      }
+    }
+    if (bits != 0U) {
+      out.push_back(static_cast<std::uint8_t>(acc));
+    }
+    break;
+  }
+  case Btr2Column::Attrs:
+    for (const auto &record : records) {
+      out.push_back(*pack_attrs(record));
+    }
+    break;
+  case Btr2Column::ServiceCycles:
+    for (const auto &record : records) {
+      put_varint(out, record.service_cycles);
+    }
+    break;
+  case Btr2Column::Retries:
+    for (const auto &record : records) {
+      put_varint(out, record.retries);
+    }
+    break;
+  }
+}
+
+bool decode_column(Btr2Column column, std::span<const std::uint8_t> payload, std::vector<TraceRecord> &out,
+                   std::vector<std::uint32_t> &malformed) {
+  ByteReader reader(payload);
+  switch (column) {
+  case Btr2Column::Seq: {
+    std::uint64_t previous = 0;
+    for (auto &record : out) {
+      record.seq = apply_zigzag_delta(previous, reader.varint());
+      previous = record.seq;
+    }
+    break;
+  }
+  case Btr2Column::TickComplete: {
+    std::uint64_t previous = 0;
+    for (auto &record : out) {
+      record.tick_complete = apply_zigzag_delta(previous, reader.varint());
+      previous = record.tick_complete;
+    }
+    break;
+  }
+  case Btr2Column::TickFirstAttempt:
+    for (auto &record : out) {
+      // Inverse of zigzag_delta(tick_complete, tick_first_attempt).
+      const std::uint64_t elapsed = apply_zigzag_delta(0U, reader.varint());
+      record.tick_first_attempt = record.tick_complete - elapsed;
+    }
+    break;
+  case Btr2Column::Addr: {
+    const std::uint64_t dictionary_size = reader.varint();
+    if (!reader.ok() || dictionary_size > payload.size()) {
+      return false;
+    }
+    std::vector<std::uint32_t> dictionary;
+    dictionary.reserve(static_cast<std::size_t>(dictionary_size));
+    std::uint64_t addr = 0;
+    for (std::uint64_t i = 0; i < dictionary_size; ++i) {
+      addr += reader.varint();
+      dictionary.push_back(static_cast<std::uint32_t>(addr));
+    }
+    const unsigned width = reader.byte();
+    if (width > 32U || (!out.empty() && dictionary.empty())) {
+      return false;
+    }
+    const auto packed = reader.take((out.size() * width + 7U) / 8U);
+    std::uint64_t acc = 0;
+    unsigned bits = 0;
+    std::size_t byte = 0;
+    for (auto &record : out) {
+      while (bits < width) {
+        acc |= static_cast<std::uint64_t>(byte < packed.size() ? packed[byte] : 0U) << bits;
+        ++byte;
+        bits += 8U;
+      }
+      const std::uint64_t index = width == 0U ? 0U : (acc & ((std::uint64_t{1} << width) - 1U));
+      acc >>= width;
+      bits -= width;
+      if (index >= dictionary.size()) {
+        return false;
+      }
+      record.addr = dictionary[static_cast<std::size_t>(index)];
+      record.addr_text_id = kAddrTextUpperHex;
+      record.region = region_of(record.addr);
+    }
+    break;
+  }
+  case Btr2Column::Attrs:
+    for (std::size_t i = 0; i < out.size(); ++i) {
+      if (!unpack_attrs(reader.byte(), out[i])) {
+        malformed.push_back(static_cast<std::uint32_t>(i));
+      }
+    }
+    break;
+  case Btr2Column::ServiceCycles:
+    for (auto &record : out) {
+      record.service_cycles = static_cast<std::uint32_t>(reader.varint());
+    }
+    break;
+  case Btr2Column::Retries:
+    for (auto &record : out) {
+      record.retries = static_cast<std::uint32_t>(reader.varint());
+    }
+    break;
+  }
+  return reader.ok();
+}
+
+} // namespace
+
+bool has_btr2_magic(std::span<const std::uint8_t> bytes) {
+  return bytes.size() >= kBtr2Magic.size() && std::equal(kBtr2Magic.begin(), kBtr2Magic.end(), bytes.begin());
+}
+
+std::optional<Btr2FileView> open_btr2_view(std::span<const std::uint8_t> bytes) {
+  if (bytes.size() < kBtr2HeaderSize + kBtr2TrailerSize || !has_btr2_magic(bytes)) {
+    std::cerr << "error: truncated or invalid BTR2 header\n";
+    return std::nullopt;
+  }
+  const std::uint16_t version = get_u16(bytes.data() + 4);
+  if (version != kBtr2Version) {
+    std::cerr << "error: unsupported BTR2 version " << version << " (expected " << kBtr2Version << ")\n";
+    return std::nullopt;
+  }
+  const std::uint16_t header_size = get_u16(bytes.data() + 6);
+  if (header_size != kBtr2HeaderSize) {
+    std::cerr << "error: unsupported BTR2 header size " << header_size << '\n';
+    return std::nullopt;
+  }
+
+  const std::uint8_t *trailer = bytes.data() + bytes.size() - kBtr2TrailerSize;
+  if (!std::equal(kBtr2IndexMagic.begin(), kBtr2IndexMagic.end(), trailer + 12)) {
+    std::cerr << "error: missing BTR2 block index (truncated capture?)\n";
+    return std::nullopt;
+  }
+  const std::uint64_t index_offset = get_u64(trailer);
+  const std::uint32_t block_count = get_u32(trailer + 8);
+  const std::uint64_t index_end = bytes.size() - kBtr2TrailerSize;
+  if (index_offset < kBtr2HeaderSize || index_offset > index_end ||
+      (index_end - index_offset) != static_cast<std::uint64_t>(block_count) * kBtr2IndexEntrySize) {
+    std::cerr << "error: corrupt BTR2 block index\n";
+    return std::nullopt;
+  }
+
+  Btr2FileView view{};
+  view.bytes = bytes;
+  view.block_records = get_u32(bytes.data() + 8);
+  view.blocks.reserve(block_count);
+  for (std::uint32_t i = 0; i < block_count; ++i) {
+    const std::uint8_t *entry = bytes.data() + index_offset + static_cast<std::uint64_t>(i) * kBtr2IndexEntrySize;
+    Btr2BlockInfo info{};
+    info.offset = get_u64(entry);
+    info.byte_size = get_u32(entry + 8);
+    info.record_count = get_u32(entry + 12);
+    info.first_seq = get_u64(entry + 16);
+    info.first_tick_complete = get_u64(entry + 24);
+    info.min_seq = get_u64(entry + 32);
+    info.max_seq = get_u64(entry + 40);
+    info.min_tick_complete = get_u64(entry + 48);
+    info.max_tick_complete = get_u64(entry + 56);
+    if (info.offset < kBtr2HeaderSize || info.offset > index_offset || info.byte_size > index_offset - info.offset) {
+      std::cerr << "error: BTR2 block " << i << " lies outside the data section\n";
+      return std::nullopt;
+    }
+    // Every record takes at least its attrs byte, so a larger count is corrupt
+    // and would otherwise size the decode buffers.
+    if (info.record_count > info.byte_size || view.record_count > std::numeric_limits<std::uint64_t>::max() - info.record_count) {
+      std::cerr << "error: BTR2 block " << i << " record count " << info.record_count << " does not fit its " << info.byte_size << " bytes\n";
+      return std::nullopt;
+    }
+    view.record_count += info.record_count;
+    view.blocks.push_back(info);
+  }
+  return view;
+}
+
+bool decode_btr2_block(const Btr2FileView &file, std::size_t block, Btr2ColumnMask columns, std::uint64_t first_index,
+                       std::vector<TraceRecord> &out, std::vector<std::uint32_t> &malformed) {
+  const Btr2BlockInfo &info = file.blocks[block];
+  const std::span<const std::uint8_t> bytes = file.bytes.subspan(static_cast<std::size_t>(info.offset), info.byte_size);
+  if (bytes.size() < kBlockHeaderSize || get_u32(bytes.data()) != info.record_count) {
+    std::cerr << "error: corrupt BTR2 block " << block << " header\n";
+    return false;
+  }
+  const std::size_t column_count = bytes[4];
+  const std::size_t directory_end = kBlockHeaderSize + column_count * kColumnDirectoryEntrySize;
+  if (directory_end > bytes.size()) {
+    std::cerr << "error: corrupt BTR2 block " << block << " column directory\n";
+    return false;
+  }
+
+  std::array<std::optional<std::span<const std::uint8_t>>, kBtr2ColumnCount> payloads{};
+  std::size_t payload_offset = directory_end;
+  for (std::size_t i = 0; i < column_count; ++i) {
+    const std::uint8_t *entry = bytes.data() + kBlockHeaderSize + i * kColumnDirectoryEntrySize;
+    const std::uint32_t length = get_u32(entry + 1);
+    if (length > bytes.size() - payload_offset) {
+      std::cerr << "error: corrupt BTR2 block " << block << " column length\n";
+      return false;
+    }
+    // Unknown column ids are skipped so newer writers stay readable.
+    if (entry[0] < kBtr2ColumnCount) {
+      payloads[entry[0]] = bytes.subspan(payload_offset, length);
+    }
+    payload_offset += length;
+  }
+
+  if ((columns & btr2_column_bit(Btr2Column::TickFirstAttempt)) != 0U) {
+    columns |= btr2_column_bit(Btr2Column::TickComplete);
+  }
+  out.assign(info.record_count, TraceRecord{});
+  for (std::size_t i = 0; i < out.size(); ++i) {
+    out[i].source_line = first_index + i + 1U;
+  }
+  // Column order matters only for TickFirstAttempt, which follows TickComplete.
+  for (std::size_t id = 0; id < kBtr2ColumnCount; ++id) {
+    const auto column = static_cast<Btr2Column>(id);
+    if ((columns & btr2_column_bit(column)) == 0U) {
+      continue;
+    }
+    if (!payloads[id].has_value() || !decode_column(column, *payloads[id], out, malformed)) {
+      std::cerr << "error: corrupt BTR2 block " << block << " column " << id << '\n';
+      return false;
+    }
+  }
+  return true;
+}
+
+bool btr2_can_encode(const TraceRecord &record) { return pack_attrs(record).has_value(); }
+
+Btr2EncodedBlock encode_btr2_block(std::span<const TraceRecord> records) {
+  std::array<std::vector<std::uint8_t>, kBtr2ColumnCount> columns{};
+  for (std::size_t id = 0; id < kBtr2ColumnCount; ++id) {
+    encode_column(static_cast<Btr2Column>(id), records, columns[id]);
+  }
+
+  Btr2EncodedBlock block{};
+  auto &bytes = block.bytes;
+  put_u32(bytes, static_cast<std::uint32_t>(records.size()));
+  bytes.push_back(static_cast<std::uint8_t>(kBtr2ColumnCount));
+  for (std::size_t id = 0; id < kBtr2ColumnCount; ++id) {
+    bytes.push_back(static_cast<std::uint8_t>(id));
+    put_u32(bytes, static_cast<std::uint32_t>(columns[id].size()));
+  }
+  for (const auto &column : columns) {
+    bytes.insert(bytes.end(), column.begin(), column.end());
+  }
+
+  Btr2BlockInfo &info = block.info;
+  info.byte_size = static_cast<std::uint32_t>(bytes.size());
+  info.record_count = static_cast<std::uint32_t>(records.size());
+  info.first_seq = records.front().seq;
+  info.first_tick_complete = records.front().tick_complete;
+  info.min_seq = info.max_seq = info.first_seq;
+  info.min_tick_complete = info.max_tick_complete = info.first_tick_complete;
+  for (const auto &record : records) {
+    info.min_seq = std::min(info.min_seq, record.seq);
+    info.max_seq = std::max(info.max_seq, record.seq);
+    info.min_tick_complete = std::min(info.min_tick_complete, record.tick_complete);
+    info.max_tick_complete = std::max(info.max_tick_complete, record.tick_complete);
+  }
+  return block;
+}
+
+Btr2Writer::Btr2Writer(std::ostream &out, std::uint32_t block_records)
+    : out_(out), block_records_(block_records == 0U ? kBtr2DefaultBlockRecords : block_records) {
+  std::vector<std::uint8_t> header(kBtr2Magic.begin(), kBtr2Magic.end());
+  put_u16(header, kBtr2Version);
+  put_u16(header, static_cast<std::uint16_t>(kBtr2HeaderSize));
+  put_u32(header, block_records_);
+  put_u32(header, 0U);
+  out_.write(reinterpret_cast<const char *>(header.data()), static_cast<std::streamsize>(header.size()));
+  offset_ = header.size();
+  pending_.reserve(block_records_);
+}
+
+bool Btr2Writer::append(const TraceRecord &record) {
+  if (finished_ || !btr2_can_encode(record)) {
+    return false;
+  }
+  pending_.push_back(record);
+  if (pending_.size() >= block_records_) {
+    flush_block();
+  }
+  return true;
+}
+
+void Btr2Writer::append_block(Btr2EncodedBlock &&block) {
+  flush_block();
+  write_block(std::move(block));
+}
+
+void Btr2Writer::flush_block() {
+  if (pending_.empty()) {
+    return;
+  }
+  write_block(encode_btr2_block(pending_));
+  pending_.clear();
+}
+
+void Btr2Writer::write_block(Btr2EncodedBlock &&block) {
+  block.info.offset = offset_;
+  out_.write(reinterpret_cast<const char *>(block.bytes.data()), static_cast<std::streamsize>(block.bytes.size()));
+  offset_ += block.bytes.size();
+  records_written_ += block.info.record_count;
+  index_.push_back(block.info);
+}
+
+bool Btr2Writer::finish() {
+  if (finished_) {
+    return static_cast<bool>(out_);
+  }
+  flush_block();
+  std::vector<std::uint8_t> footer;
+  footer.reserve(index_.size() * kBtr2IndexEntrySize + kBtr2TrailerSize);
+  for (const auto &info : index_) {
+    put_u64(footer, info.offset);
+    put_u32(footer, info.byte_size);
+    put_u32(footer, info.record_count);
+    put_u64(footer, info.first_seq);
+    put_u64(footer, info.first_tick_complete);
+    put_u64(footer, info.min_seq);
+    put_u64(footer, info.max_seq);
+    put_u64(footer, info.min_tick_complete);
+    put_u64(footer, info.max_tick_complete);
+  }
+  put_u64(footer, offset_);
+  put_u32(footer, static_cast<std::uint32_t>(index_.size()));
+  footer.insert(footer.end(), kBtr2IndexMagic.begin(), kBtr2IndexMagic.end());
+  out_.write(reinterpret_cast<const char *>(footer.data()), static_cast<std::streamsize>(footer.size()));
+  out_.flush();
+  finished_ = true;
+  return static_cast<bool>(out_);
+}
+
+} // namespace trace_replay
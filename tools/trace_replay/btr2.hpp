@@ -0,0 +1,112 @@
+#pragma once
+
+#include "trace_replay/trace_record.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <ostream>
+#include <span>
+#include <vector>
+
+namespace trace_replay {
+
+// BTR2: columnar, block-indexed trace container (see docs/trace_format.md).
+inline constexpr std::uint16_t kBtr2Version = 1;
+inline constexpr std::size_t kBtr2HeaderSize = 16;
+inline constexpr std::size_t kBtr2TrailerSize = 16;
+inline constexpr std::size_t kBtr2IndexEntrySize = 64;
+inline constexpr std::uint32_t kBtr2DefaultBlockRecords = 65536;
+
+enum class Btr2Column : std::uint8_t {
+  Seq = 0,
+  TickComplete = 1,
+  TickFirstAttempt = 2,
+  Addr = 3,
+  Attrs = 4,
+  ServiceCycles = 5,
+  Retries = 6,
+};
+inline constexpr std::size_t kBtr2ColumnCount = 7;
+
+// Bit set of Btr2Column values to decode; other columns are skipped unread.
+using Btr2ColumnMask = std::uint32_t;
+[[nodiscard]] constexpr Btr2ColumnMask btr2_column_bit(Btr2Column column) { return Btr2ColumnMask{1} << static_cast<unsigned>(column); }
+inline constexpr Btr2ColumnMask kBtr2AllColumns = (Btr2ColumnMask{1} << kBtr2ColumnCount) - 1U;
+
+struct Btr2BlockInfo {
+  std::uint64_t offset = 0;
+  std::uint32_t byte_size = 0;
+  std::uint32_t record_count = 0;
+  std::uint64_t first_seq = 0;
+  std::uint64_t first_tick_complete = 0;
+  std::uint64_t min_seq = 0;
+  std::uint64_t max_seq = 0;
+  std::uint64_t min_tick_complete = 0;
+  std::uint64_t max_tick_complete = 0;
+};
+
+struct Btr2FileView {
+  std::span<const std::uint8_t> bytes;
+  std::uint32_t block_records = 0;
+  std::vector<Btr2BlockInfo> blocks;
+  std::uint64_t record_count = 0;
+};
+
+[[nodiscard]] bool has_btr2_magic(std::span<const std::uint8_t> bytes);
+
+// Validates header, trailer and block index; prints an error and returns
+// nullopt on structural problems.
+[[nodiscard]] std::optional<Btr2FileView> open_btr2_view(std::span<const std::uint8_t> bytes);
+
+// Decodes the requested columns of one block into `out` (resized to the
+// block's record count). Records whose packed attributes are out of range are
+// still emitted; their block-relative indices are appended to `malformed`.
+// `first_index` is the file-wide index of the block's first record and sets
+// source_line (index + 1, as for BTR1). Returns false on a corrupt block.
+bool decode_btr2_block(const Btr2FileView &file, std::size_t block, Btr2ColumnMask columns, std::uint64_t first_index,
+                       std::vector<TraceRecord> &out, std::vector<std::uint32_t> &malformed);
+
+// True if the record fits BTR2 (canonical master/rw/kind, size 1/2/4).
+[[nodiscard]] bool btr2_can_encode(const TraceRecord &record);
+
+// One encoded block; `info.offset` is filled in when the block is written.
+struct Btr2EncodedBlock {
+  std::vector<std::uint8_t> bytes;
+  Btr2BlockInfo info;
+};
+
+// Encodes `records` (all btr2_can_encode, at least one) as a single block.
+// Independent of any writer, so blocks can be encoded on worker threads.
+[[nodiscard]] Btr2EncodedBlock encode_btr2_block(std::span<const TraceRecord> records);
+
+// Streaming encoder. Records are buffered into blocks of `block_records` and
+// the index is written by finish().
+class Btr2Writer {
+public:
+  explicit Btr2Writer(std::ostream &out, std::uint32_t block_records = kBtr2DefaultBlockRecords);
+
+  // Returns false if the record has no BTR2 encoding (non-canonical master,
+  // rw or kind, or a size other than 1/2/4).
+  bool append(const TraceRecord &record);
+  // Writes a pre-encoded block after flushing any buffered records.
+  void append_block(Btr2EncodedBlock &&block);
+  bool finish();
+
+  [[nodiscard]] std::uint64_t records_written() const { return records_written_; }
+  [[nodiscard]] std::size_t blocks_written() const { return index_.size(); }
+
+private:
+  void flush_block();
+  void write_block(Btr2EncodedBlock &&block);
+
+  std::ostream &out_;
+  std::uint32_t block_records_ = kBtr2DefaultBlockRecords;
+  std::uint64_t offset_ = 0;
+  std::uint64_t records_written_ = 0;
+  std::vector<TraceRecord> pending_;
+  std::vector<Btr2BlockInfo> index_;
+  bool finished_ = false;
+};
+
+} // namespace trace_replay
@@ -0,0 +1,183 @@
+#include "trace_replay/cache_sim.hpp"
+
+#include <algorithm>
+
+namespace trace_replay {
+namespace {
+
+constexpr std::uint32_t kValid = 0x80000000U;
+constexpr std::uint32_t kCacheAreaMask = 0x1FFFFFFFU; // A28:A0; A31:A29 == 0 is the cached area
+constexpr std::uint64_t kEmptySlot = ~std::uint64_t{0};
+constexpr std::uint32_t kCountMax = 0xFFFFFFFFU;
+
+// LRU bits per the SH7604 manual: bit 5 = way 0 vs 1, 4 = 0 vs 2, 3 = 0 vs 3,
+// 2 = 1 vs 2, 1 = 1 vs 3, 0 = 2 vs 3; a clear bit means the lower way was
+// used more recently. An access rewrites the three bits that involve its way.
+struct LruUpdate {
+  std::uint8_t keep;
+  std::uint8_t set;
+};
+constexpr std::array<LruUpdate, kSh2CacheWays> kLruUpdate{{{0x07U, 0x00U}, {0x19U, 0x20U}, {0x2AU, 0x14U}, {0x34U, 0x0BU}}};
+
+constexpr std::array<std::uint8_t, 64> make_replace_way() {
+  std::array<std::uint8_t, 64> table{};
+  for (std::size_t lru = 0; lru < table.size(); ++lru) {
+    if ((lru & 0x38U) == 0x38U) {
+      table[lru] = 0;
+    } else if ((lru & 0x26U) == 0x06U) {
+      table[lru] = 1;
+    } else if ((lru & 0x15U) == 0x01U) {
+      table[lru] = 2;
+    } else {
+      table[lru] = 3; // (lru & 0x0B) == 0; other patterns are unreachable
+    }
+  }
+  return table;
+}
+constexpr std::array<std::uint8_t, 64> kReplaceWay = make_replace_way();
+
+bool is_cache_bucket(CacheBucket bucket) { return bucket != CacheBucket::NotApplicable && bucket != CacheBucket::Anomaly; }
+
+bool prediction_matches(CachePrediction prediction, CacheBucket observed) {
+  switch (prediction) {
+  case CachePrediction::Hit:
+    return observed == CacheBucket::CacheHit;
+  case CachePrediction::Miss:
+    return observed == CacheBucket::CacheMissHalf || observed == CacheBucket::CacheMissFull;
+  case CachePrediction::Uncached:
+    return observed == CacheBucket::UncachedOrThrough;
+  case CachePrediction::NotSimulated:
+    break;
+  }
+  return false;
+}
+
+std::size_t slot_hash(std::uint64_t key) { return static_cast<std::size_t>((key * 0x9E3779B97F4A7C15ULL) >> 32U); }
+
+} // namespace
+
+const char *cache_prediction_name(CachePrediction prediction) {
+  switch (prediction) {
+  case CachePrediction::NotSimulated:
+    return "not_simulated";
+  case CachePrediction::Uncached:
+    return "uncached";
+  case CachePrediction::Hit:
+    return "hit";
+  case CachePrediction::Miss:
+    return "miss";
+  }
+  return "unknown";
+}
+
+bool Sh2CacheModel::access(std::uint32_t addr, bool &evicted) {
+  const std::uint32_t set = (addr >> 4U) & (kSh2CacheSets - 1U);
+  const std::uint32_t tag = ((addr & kCacheAreaMask) >> 10U) | kValid;
+  std::uint32_t *ways = &tags_[set * kSh2CacheWays];
+  std::uint8_t &lru = lru_[set];
+  for (std::uint32_t way = 0; way < kSh2CacheWays; ++way) {
+    if (ways[way] == tag) {
+      lru = static_cast<std::uint8_t>((lru & kLruUpdate[way].keep) | kLruUpdate[way].set);
+      evicted = false;
+      return true;
+    }
+  }
+  const std::uint8_t way = kReplaceWay[lru];
+  evicted = ways[way] != 0U;
+  ways[way] = tag;
+  lru = static_cast<std::uint8_t>((lru & kLruUpdate[way].keep) | kLruUpdate[way].set);
+  return false;
+}
+
+void CacheMissLineTable::add(Master master, std::uint32_t addr) {
+  if ((used_ + 1U) * 2U > slots_.size()) {
+    grow();
+  }
+  const std::uint64_t key = (std::uint64_t{static_cast<std::uint16_t>(master)} << 25U) | ((addr & kCacheAreaMask) >> 4U);
+  const std::size_t mask = slots_.size() - 1U;
+  for (std::size_t i = slot_hash(key) & mask;; i = (i + 1U) & mask) {
+    std::uint64_t &slot = slots_[i];
+    if (slot == kEmptySlot) {
+      slot = (key << 32U) | 1U;
+      ++used_;
+      return;
+    }
+    if ((slot >> 32U) == key) {
+      if ((slot & kCountMax) != kCountMax) {
+        ++slot;
+      }
+      return;
+    }
+  }
+}
+
+void CacheMissLineTable::grow() {
+  std::vector<std::uint64_t> old = std::move(slots_);
+  slots_.assign(old.empty() ? 1024U : old.size() * 2U, kEmptySlot);
+  const std::size_t mask = slots_.size() - 1U;
+  for (const std::uint64_t slot : old) {
+    if (slot == kEmptySlot) {
+      continue;
+    }
+    std::size_t i = slot_hash(slot >> 32U) & mask;
+    while (slots_[i] != kEmptySlot) {
+      i = (i + 1U) & mask;
+    }
+    slots_[i] = slot;
+  }
+}
+
+std::vector<CacheMissLine> CacheMissLineTable::top(std::size_t k) const {
+  std::vector<CacheMissLine> lines;
+  lines.reserve(used_);
+  for (const std::uint64_t slot : slots_) {
+    if (slot == kEmptySlot) {
+      continue;
+    }
+    const std::uint64_t key = slot >> 32U;
+    lines.push_back(CacheMissLine{static_cast<Master>(key >> 25U), static_cast<std::uint32_t>((key & 0x1FFFFFFU) << 4U),
+                                  static_cast<std::uint32_t>(slot & kCountMax)});
+  }
+  const auto more_misses = [](const CacheMissLine &a, const CacheMissLine &b) {
+    if (a.misses != b.misses) return a.misses > b.misses;
+    if (a.master != b.master) return a.master < b.master;
+    return a.line_addr < b.line_addr;
+  };
+  const std::size_t emit = std::min(k, lines.size());
+  std::partial_sort(lines.begin(), lines.begin() + static_cast<std::ptrdiff_t>(emit), lines.end(), more_misses);
+  lines.resize(emit);
+  return lines;
+}
+
+CachePrediction CacheSimulator::consume(const TraceRecord &record, CacheBucket observed) {
+  if ((record.master != Master::MSH2 && record.master != Master::SSH2) ||
+      (record.kind != AccessKind::Ifetch && record.kind != AccessKind::Read)) {
+    return CachePrediction::NotSimulated;
+  }
+  const std::size_t cpu = static_cast<std::size_t>(record.master);
+  CacheSimMasterStats &stats = stats_[cpu];
+  ++stats.accesses;
+  CachePrediction prediction = CachePrediction::Uncached;
+  if ((record.addr & ~kCacheAreaMask) != 0U) {
+    ++stats.uncached;
+  } else {
+    bool evicted = false;
+    if (caches_[cpu].access(record.addr, evicted)) {
+      prediction = CachePrediction::Hit;
+      ++stats.hits;
+    } else {
+      prediction = CachePrediction::Miss;
+      ++stats.misses;
+      stats.evictions += evicted ? 1U : 0U;
+      miss_lines_.add(record.master, record.addr);
+    }
+  }
+  if (is_cache_bucket(observed)) {
+    ++compared_;
+    ++confusion_[static_cast<std::size_t>(prediction) * kCacheBucketCount + static_cast<std::size_t>(observed)];
+    agreement_count_ += prediction_matches(prediction, observed) ? 1U : 0U;
+  }
+  return prediction;
+}
+
+} // namespace trace_replay
@@ -0,0 +1,102 @@
+#pragma once
+
+#include "trace_replay/trace_record.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace trace_replay {
+
+// SH-2 cache simulation (--cache-sim): replays each CPU's ifetch/read stream
+// through a model of the SH7604 on-chip cache (4 KB, 4 ways x 64 sets of
+// 16-byte lines, 6-bit pairwise LRU per set) and compares the predicted
+// outcome with the bucket classify_cache_bucket() infers from service cycles.
+
+inline constexpr std::uint32_t kSh2CacheLineBytes = 16;
+inline constexpr std::uint32_t kSh2CacheSets = 64;
+inline constexpr std::uint32_t kSh2CacheWays = 4;
+
+enum class CachePrediction : std::uint8_t {
+  NotSimulated, // DMA, writes, MMIO
+  Uncached,     // cache-through area (0x2xxxxxxx) or outside the cache area
+  Hit,
+  Miss,
+};
+inline constexpr std::size_t kCachePredictionCount = static_cast<std::size_t>(CachePrediction::Miss) + 1U;
+
+[[nodiscard]] const char *cache_prediction_name(CachePrediction prediction);
+
+// One SH-2 cache. State is 1 KB of tags plus 64 LRU bytes; an access is a
+// set lookup and four tag compares. Writes are write-through without
+// allocation on the SH-2, so only reads and fetches go through access().
+class Sh2CacheModel {
+public:
+  // Looks `addr` up, filling the LRU way on a miss. `evicted` is set when the
+  // fill replaced a valid line.
+  bool access(std::uint32_t addr, bool &evicted);
+
+private:
+  std::array<std::uint32_t, kSh2CacheSets * kSh2CacheWays> tags_{}; // tag | kValid, 0 = invalid
+  std::array<std::uint8_t, kSh2CacheSets> lru_{};
+};
+
+struct CacheSimMasterStats {
+  std::size_t accesses = 0;
+  std::size_t hits = 0;
+  std::size_t misses = 0;
+  std::size_t evictions = 0;
+  std::size_t uncached = 0;
+};
+
+struct CacheMissLine {
+  Master master = Master::MSH2;
+  std::uint32_t line_addr = 0;
+  std::uint32_t misses = 0;
+};
+
+// Miss counts per (CPU, 16-byte line), open addressing over packed 64-bit
+// slots (key << 32 | count), so the table stays a flat array however many
+// lines the capture touches. Only misses probe it.
+class CacheMissLineTable {
+public:
+  void add(Master master, std::uint32_t addr);
+  [[nodiscard]] std::size_t size() const { return used_; }
+  // Most misses first, then CPU and address.
+  [[nodiscard]] std::vector<CacheMissLine> top(std::size_t k) const;
+
+private:
+  void grow();
+
+  std::vector<std::uint64_t> slots_;
+  std::size_t used_ = 0;
+};
+
+class CacheSimulator {
+public:
+  // Valid-master records in replay order; `observed` is the record's
+  // classify_cache_bucket() result.
+  CachePrediction consume(const TraceRecord &record, CacheBucket observed);
+
+  [[nodiscard]] const CacheSimMasterStats &master_stats(Master master) const { return stats_[static_cast<std::size_t>(master)]; }
+  // Simulated records whose observed bucket is a cache bucket (High WRAM).
+  [[nodiscard]] std::size_t compared() const { return compared_; }
+  [[nodiscard]] std::size_t agreement_count() const { return agreement_count_; }
+  // [prediction][observed bucket] over the compared records.
+  [[nodiscard]] std::size_t confusion(CachePrediction prediction, CacheBucket observed) const {
+    return confusion_[static_cast<std::size_t>(prediction) * kCacheBucketCount + static_cast<std::size_t>(observed)];
+  }
+  [[nodiscard]] const CacheMissLineTable &miss_lines() const { return miss_lines_; }
+
+private:
+  std::array<Sh2CacheModel, 2> caches_{}; // MSH2, SSH2
+  std::array<CacheSimMasterStats, 2> stats_{};
+  std::array<std::size_t, kCachePredictionCount * kCacheBucketCount> confusion_{};
+  std::size_t compared_ = 0;
+  std::size_t agreement_count_ = 0;
+  CacheMissLineTable miss_lines_;
+};
+
+} // namespace trace_replay
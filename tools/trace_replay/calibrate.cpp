@@ -0,0 +1,224 @@
+#include "trace_replay/calibrate.hpp"
+
+#include "busarb/ymir_timing.hpp"
+
+#include <algorithm>
+#include <optional>
+#include <utility>
+
+namespace trace_replay {
+namespace {
+
+std::uint64_t magnitude(std::int64_t value) {
+  return value < 0 ? std::uint64_t{0} - static_cast<std::uint64_t>(value) : static_cast<std::uint64_t>(value);
+}
+
+class Calibrator {
+public:
+  Calibrator(std::span<const TraceRecord> records, const busarb::ArbiterConfig &config, TimingTable table) : table_(std::move(table)) {
+    slot_records_.resize(table_.size());
+    std::optional<TraceRecord> previous;
+    for (const auto &record : records) {
+      if (!is_valid_master(record.master)) {
+        continue;
+      }
+      const bool is_write = record.rw == Rw::W;
+      const std::size_t slot = busarb::ymir_region_index(record.addr) * 2U + (is_write ? 1U : 0U);
+      const LocalModelTerms terms = local_model_terms(record, previous);
+      const std::uint32_t contention = terms.contention(config.same_address_contention);
+      const std::uint32_t predicted_wait = terms.predicted_wait(config);
+      const ObservedTiming observed = observed_timing(record);
+
+      slot_records_[slot].push_back(slot_.size());
+      slot_.push_back(static_cast<std::uint32_t>(slot));
+      attempt_.push_back(record.tick_first_attempt);
+      end_exclusive_.push_back(static_cast<std::int64_t>(record.tick_complete + 1U));
+      contention_.push_back(contention);
+      local_base_.push_back(static_cast<std::int64_t>(predicted_wait) - static_cast<std::int64_t>(observed.elapsed));
+      known_gap_.push_back(record.size == 1U && record.retries == 0U && predicted_wait > observed.wait ? 1U : 0U);
+      previous = record;
+    }
+    bus_free_tick_.assign(slot_.size(), 0U);
+  }
+
+  // Replays every record with the current table and refreshes the cache.
+  CalibrationResiduals evaluate_full() {
+    CalibrationResiduals residuals{};
+    residuals.records = slot_.size();
+    std::uint64_t bus_free = 0;
+    for (std::size_t i = 0; i < slot_.size(); ++i) {
+      const std::uint32_t cycles = table_[slot_[i]];
+      const std::uint64_t start = std::max(attempt_[i], bus_free);
+      bus_free = start + cycles + contention_[i];
+      bus_free_tick_[i] = bus_free;
+      const std::int64_t drift = static_cast<std::int64_t>(bus_free) - end_exclusive_[i];
+      residuals.abs_total_delta += magnitude(local_base_[i] + static_cast<std::int64_t>(cycles));
+      residuals.abs_cumulative_drift += magnitude(drift);
+      residuals.final_cumulative_drift_total = drift;
+      if (known_gap_[i] == 0U && start == attempt_[i] && drift == 0) {
+        ++residuals.agreement_count;
+      }
+    }
+    return residuals;
+  }
+
+  // Coordinate descent over the slots until a full pass changes nothing.
+  void run(CalibrationResult &result) {
+    while (result.passes < kMaxCalibrationPasses) {
+      ++result.passes;
+      bool improved = false;
+      for (std::size_t slot = 0; slot < table_.size(); ++slot) {
+        if (slot_records_[slot].empty()) {
+          continue;
+        }
+        const std::uint32_t current = table_[slot];
+        std::uint32_t best = current;
+        Score best_change{};
+        auto score = [&](std::uint32_t cycles) {
+          ++result.evaluations;
+          return Score{drift_change(slot, cycles, false, result.records_touched), local_change(slot, cycles)};
+        };
+        // Walk downhill from `from` one cycle at a time in each direction.
+        auto climb = [&](std::uint32_t from) {
+          for (const int step : {-1, 1}) {
+            std::int64_t value = static_cast<std::int64_t>(from) + step;
+            while (value >= 1 && value <= static_cast<std::int64_t>(kMaxCalibrationCycles)) {
+              const Score change = score(static_cast<std::uint32_t>(value));
+              if (!(change < best_change)) {
+                break;
+              }
+              best_change = change;
+              best = static_cast<std::uint32_t>(value);
+              value += step;
+            }
+          }
+        };
+        climb(current);
+        // The median observed service minimizes the per-record term on its own.
+        const std::uint32_t seed = local_median(slot);
+        if (seed != current && seed != best) {
+          const Score change = score(seed);
+          if (change < best_change) {
+            best_change = change;
+            best = seed;
+            climb(seed);
+          }
+        }
+        if (best != current) {
+          drift_change(slot, best, true, result.records_touched);
+          table_[slot] = best;
+          improved = true;
+        }
+      }
+      if (!improved) {
+        break;
+      }
+    }
+  }
+
+  [[nodiscard]] const TimingTable &table() const { return table_; }
+  [[nodiscard]] std::size_t slot_record_count(std::size_t slot) const { return slot_records_[slot].size(); }
+
+private:
+  // Change in (sum |drift|, sum |total delta|), compared lexicographically.
+  using Score = std::pair<std::int64_t, std::int64_t>;
+
+  std::int64_t local_change(std::size_t slot, std::uint32_t cycles) const {
+    std::int64_t change = 0;
+    for (const std::size_t i : slot_records_[slot]) {
+      change += static_cast<std::int64_t>(magnitude(local_base_[i] + static_cast<std::int64_t>(cycles))) -
+                static_cast<std::int64_t>(magnitude(local_base_[i] + static_cast<std::int64_t>(table_[slot])));
+    }
+    return change;
+  }
+
+  std::uint32_t local_median(std::size_t slot) const {
+    std::vector<std::int64_t> wanted;
+    wanted.reserve(slot_records_[slot].size());
+    for (const std::size_t i : slot_records_[slot]) {
+      wanted.push_back(-local_base_[i]);
+    }
+    auto mid = wanted.begin() + static_cast<std::ptrdiff_t>(wanted.size() / 2U);
+    std::nth_element(wanted.begin(), mid, wanted.end());
+    return static_cast<std::uint32_t>(std::clamp<std::int64_t>(*mid, 1, kMaxCalibrationCycles));
+  }
+
+  // Change in sum |drift| if `slot` used `cycles`. Re-simulates from the
+  // slot's first record; once a record's bus-free tick matches the cached one
+  // the chain is unchanged up to the slot's next record, so it jumps there.
+  std::int64_t drift_change(std::size_t slot, std::uint32_t cycles, bool commit, std::uint64_t &touched) {
+    const auto &indices = slot_records_[slot];
+    std::int64_t change = 0;
+    std::size_t next = 0;
+    std::size_t i = indices.front();
+    std::uint64_t bus_free = i == 0U ? 0U : bus_free_tick_[i - 1U];
+    while (true) {
+      ++touched;
+      const std::uint32_t service = slot_[i] == slot ? cycles : table_[slot_[i]];
+      const std::uint64_t updated = std::max(attempt_[i], bus_free) + service + contention_[i];
+      const std::uint64_t cached = bus_free_tick_[i];
+      bus_free = updated;
+      if (updated == cached) {
+        while (next < indices.size() && indices[next] <= i) {
+          ++next;
+        }
+        if (next == indices.size()) {
+          break;
+        }
+        i = indices[next];
+        bus_free = bus_free_tick_[i - 1U];
+        continue;
+      }
+      change += static_cast<std::int64_t>(magnitude(static_cast<std::int64_t>(updated) - end_exclusive_[i])) -
+                static_cast<std::int64_t>(magnitude(static_cast<std::int64_t>(cached) - end_exclusive_[i]));
+      if (commit) {
+        bus_free_tick_[i] = updated;
+      }
+      if (++i == slot_.size()) {
+        break;
+      }
+    }
+    return change;
+  }
+
+  TimingTable table_;
+  std::vector<std::vector<std::size_t>> slot_records_;
+  // Per-record inputs, struct-of-arrays over valid-master records.
+  std::vector<std::uint32_t> slot_;
+  std::vector<std::uint64_t> attempt_;
+  std::vector<std::int64_t> end_exclusive_;
+  std::vector<std::uint32_t> contention_;
+  std::vector<std::int64_t> local_base_; // model total delta = local_base + service cycles
+  std::vector<std::uint8_t> known_gap_;
+  // Cached bus-free tick after each record under table_.
+  std::vector<std::uint64_t> bus_free_tick_;
+};
+
+} // namespace
+
+TimingTable ymir_timing_table() {
+  TimingTable table;
+  for (const auto &row : busarb::ymir_region_timings()) {
+    table.push_back(row.read_cycles);
+    table.push_back(row.write_cycles);
+  }
+  table.push_back(busarb::kYmirUnmappedReadCycles);
+  table.push_back(busarb::kYmirUnmappedWriteCycles);
+  return table;
+}
+
+CalibrationResult calibrate_timing(std::span<const TraceRecord> records, const busarb::ArbiterConfig &config) {
+  CalibrationResult result{};
+  result.initial = ymir_timing_table();
+  Calibrator calibrator(records, config, result.initial);
+  result.before = calibrator.evaluate_full();
+  calibrator.run(result);
+  result.after = calibrator.evaluate_full();
+  result.suggested = calibrator.table();
+  for (std::size_t slot = 0; slot < result.suggested.size(); ++slot) {
+    result.slot_records.push_back(calibrator.slot_record_count(slot));
+  }
+  return result;
+}
+
+} // namespace trace_replay
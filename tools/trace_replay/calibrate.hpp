@@ -0,0 +1,55 @@
+#pragma once
+
+#include "busarb/busarb.hpp"
+#include "trace_replay/trace_record.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace trace_replay {
+
+// Timing-table calibration (--calibrate): a coordinate search over the
+// per-region read/write cycles of busarb's Ymir table that minimizes the
+// model's cumulative drift against one capture, breaking ties on the summed
+// per-record total delta.
+
+inline constexpr std::uint32_t kMaxCalibrationCycles = 255;
+inline constexpr std::size_t kMaxCalibrationPasses = 8;
+
+// Service cycles per table slot, indexed [row * 2 + is_write] over the rows of
+// busarb::ymir_region_timings() plus one trailing row for unmapped addresses.
+using TimingTable = std::vector<std::uint32_t>;
+
+[[nodiscard]] TimingTable ymir_timing_table();
+
+// Table-dependent model error over the valid-master records of a capture.
+struct CalibrationResiduals {
+  std::size_t records = 0;
+  std::uint64_t abs_total_delta = 0;      // sum of |model_vs_trace_total_delta|
+  std::uint64_t abs_cumulative_drift = 0; // sum of |cumulative_drift_total|
+  std::int64_t final_cumulative_drift_total = 0;
+  std::size_t agreement_count = 0;
+};
+
+struct CalibrationResult {
+  TimingTable initial;
+  TimingTable suggested;
+  std::vector<std::size_t> slot_records; // records per table slot
+  CalibrationResiduals before;
+  CalibrationResiduals after;
+  std::size_t passes = 0;
+  std::size_t evaluations = 0;
+  // Records re-simulated by incremental evaluations, against evaluations *
+  // records for full replays.
+  std::uint64_t records_touched = 0;
+};
+
+// `records` must be in replay order; invalid masters are skipped. Each
+// candidate value for a slot is scored incrementally: only that slot's
+// records and the drift stretches downstream of them, up to the point where
+// the bus-free tick rejoins the cached chain, are re-simulated.
+[[nodiscard]] CalibrationResult calibrate_timing(std::span<const TraceRecord> records, const busarb::ArbiterConfig &config = {});
+
+} // namespace trace_replay
@@ -0,0 +1,126 @@
+#pragma once
+
+#include "trace_replay/state_codec.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace trace_replay {
+
+// Values indexed by a small integer id built from enum/label ids, for
+// per-record counters whose key space is tiny and static. Replaces
+// string-keyed maps on the hot path: labels are only produced when the table
+// is folded into a map for the summary.
+//
+// A slot counts as present once it has been accessed (even if the value was
+// left unchanged), matching std::map::operator[] semantics, so the folded map
+// has exactly the keys the string-keyed map would have had.
+template <typename T>
+class DenseTable {
+public:
+  DenseTable() = default;
+  explicit DenseTable(std::size_t initial_slots) : slots_(initial_slots), present_(initial_slots, 0U) {}
+
+  // Ids past the current size (interned non-canonical labels) grow the table.
+  T &operator[](std::size_t id) {
+    if (id >= slots_.size()) {
+      slots_.resize(id + 1U);
+      present_.resize(id + 1U, 0U);
+    }
+    present_[id] = 1U;
+    return slots_[id];
+  }
+
+  // Adds `other` slot by slot; slots present in either table stay present.
+  DenseTable &operator+=(const DenseTable &other) {
+    other.for_each([this](std::size_t id, const T &value) { (*this)[id] += value; });
+    return *this;
+  }
+
+  [[nodiscard]] bool contains(std::size_t id) const { return id < present_.size() && present_[id] != 0U; }
+  [[nodiscard]] std::size_t slot_count() const { return slots_.size(); }
+
+  template <typename Fn>
+  void for_each(Fn &&fn) const {
+    for (std::size_t id = 0; id < slots_.size(); ++id) {
+      if (present_[id] != 0U) {
+        fn(id, slots_[id]);
+      }
+    }
+  }
+
+  // Folds present slots into a label-keyed map. Slots that render to the same
+  // label are combined with `merge(existing, value)`. The rvalue overload
+  // moves the values out instead of copying them.
+  template <typename LabelFn, typename MergeFn>
+  [[nodiscard]] std::map<std::string, T> to_map(LabelFn &&label, MergeFn &&merge) const & {
+    std::map<std::string, T> out;
+    for_each([&](std::size_t id, const T &value) { fold(out, label(id), value, merge); });
+    return out;
+  }
+
+  template <typename LabelFn, typename MergeFn>
+  [[nodiscard]] std::map<std::string, T> to_map(LabelFn &&label, MergeFn &&merge) && {
+    std::map<std::string, T> out;
+    for (std::size_t id = 0; id < slots_.size(); ++id) {
+      if (present_[id] != 0U) {
+        fold(out, label(id), std::move(slots_[id]), merge);
+      }
+    }
+    return out;
+  }
+
+  template <typename LabelFn>
+  [[nodiscard]] std::map<std::string, T> to_map(LabelFn &&label) const & {
+    return to_map(label, [](T &into, const T &value) { into += value; });
+  }
+
+  // Replay cache state (see state_codec.hpp). Non-trivial values provide
+  // their own save/load.
+  void save(StateWriter &out) const {
+    out.put_vector(present_);
+    if constexpr (std::is_trivially_copyable_v<T>) {
+      out.put_vector(slots_);
+    } else {
+      for (const T &slot : slots_) {
+        slot.save(out);
+      }
+    }
+  }
+
+  bool load(StateReader &in) {
+    if (!in.get_vector(present_)) {
+      return false;
+    }
+    if constexpr (std::is_trivially_copyable_v<T>) {
+      return in.get_vector(slots_) && slots_.size() == present_.size();
+    } else {
+      slots_.assign(present_.size(), T{});
+      for (T &slot : slots_) {
+        if (!slot.load(in)) {
+          return false;
+        }
+      }
+      return true;
+    }
+  }
+
+private:
+  template <typename Value, typename MergeFn>
+  static void fold(std::map<std::string, T> &out, std::string key, Value &&value, MergeFn &merge) {
+    auto [it, inserted] = out.try_emplace(std::move(key), std::forward<Value>(value));
+    if (!inserted) {
+      merge(it->second, value);
+    }
+  }
+
+  std::vector<T> slots_;
+  std::vector<std::uint8_t> present_;
+};
+
+} // namespace trace_replay
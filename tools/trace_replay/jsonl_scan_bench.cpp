@@ -0,0 +1,111 @@
+#include "trace_replay/jsonl_scanner.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Measures JSONL field extraction throughput (records/sec) for the legacy
+// per-key search and each compiled single-pass scanner backend.
+//
+// Usage: trace_scan_bench [input.jsonl] [--records N] [--rounds N]
+
+namespace {
+
+std::vector<std::string> synthetic_lines(std::size_t count) {
+  static constexpr const char *kMasters[] = {"MSH2", "SSH2", "DMA"};
+  static constexpr const char *kKinds[] = {"ifetch", "read", "write", "mmio_read", "mmio_write"};
+  static constexpr std::uint32_t kAddrs[] = {0x06004000U, 0x02000000U, 0x05C00100U, 0x05FE0020U, 0x00001000U};
+  std::vector<std::string> lines;
+  lines.reserve(count);
+  std::uint64_t state = 0x9E3779B97F4A7C15ULL;
+  std::uint64_t tick = 0;
+  char buffer[256];
+  for (std::size_t i = 0; i < count; ++i) {
+    state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+    const auto r = static_cast<std::uint32_t>(state >> 33);
+    tick += r % 4U;
+    const char *kind = kKinds[r % 5U];
+    const bool write = (r % 5U) == 2U || (r % 5U) == 4U;
+    std::snprintf(buffer, sizeof(buffer),
+                  "{\"seq\":%zu,\"master\":\"%s\",\"tick_first_attempt\":%llu,\"tick_complete\":%llu,\"addr\":\"0x%08X\",\"size\":%u,"
+                  "\"rw\":\"%s\",\"kind\":\"%s\",\"service_cycles\":%u,\"retries\":%u}",
+                  i + 1U, kMasters[(r >> 3) % 3U], static_cast<unsigned long long>(tick), static_cast<unsigned long long>(tick + (r >> 7) % 9U),
+                  kAddrs[(r >> 11) % 5U] + ((r >> 13) % 64U) * 4U, 1U << ((r >> 17) % 3U), write ? "W" : "R", kind, 2U + (r >> 19) % 20U,
+                  (r >> 23) % 3U);
+    lines.emplace_back(buffer);
+  }
+  return lines;
+}
+
+template <typename Fn>
+void run(const char *label, const std::vector<std::string> &lines, std::size_t rounds, Fn &&fn) {
+  std::size_t checksum = 0;
+  const auto start = std::chrono::steady_clock::now();
+  for (std::size_t round = 0; round < rounds; ++round) {
+    for (const auto &line : lines) {
+      trace_replay::Phase1FieldSpans spans;
+      fn(line, spans);
+      checksum += spans.addr.has_value() ? spans.addr->size() : 0U;
+    }
+  }
+  const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  const double records = static_cast<double>(lines.size() * rounds);
+  std::cout << label << ": " << static_cast<std::uint64_t>(records / elapsed.count()) << " records/sec"
+            << " (" << elapsed.count() << " s, checksum " << checksum << ")\n";
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  std::string input_path;
+  std::size_t record_count = 1000000;
+  std::size_t rounds = 3;
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    if (arg == "--records" && i + 1 < argc) {
+      record_count = static_cast<std::size_t>(std::strtoull(argv[++i], nullptr, 10));
+    } else if (arg == "--rounds" && i + 1 < argc) {
+      rounds = static_cast<std::size_t>(std::strtoull(argv[++i], nullptr, 10));
+    } else {
+      input_path = arg;
+    }
+  }
+
+  std::vector<std::string> lines;
+  if (!input_path.empty()) {
+    std::ifstream input(input_path);
+    if (!input.is_open()) {
+      std::cerr << "Failed to open input file: " << input_path << '\n';
+      return 1;
+    }
+    std::string line;
+    while (std::getline(input, line)) {
+      if (!line.empty()) {
+        lines.push_back(line);
+      }
+    }
+  } else {
+    lines = synthetic_lines(record_count);
+  }
+  std::cout << "lines: " << lines.size() << ", rounds: " << rounds << '\n';
+
+  run("legacy_per_key_find", lines, rounds, [](std::string_view line, trace_replay::Phase1FieldSpans &spans) {
+    trace_replay::scan_phase1_fields_legacy(line, spans);
+  });
+  for (const auto backend : {trace_replay::ScanBackend::Scalar, trace_replay::ScanBackend::Sse2, trace_replay::ScanBackend::Avx2}) {
+    if (static_cast<int>(backend) > static_cast<int>(trace_replay::widest_scan_backend())) {
+      continue; // not compiled into this build
+    }
+    const std::string label = std::string("single_pass_") + trace_replay::scan_backend_name(backend);
+    run(label.c_str(), lines, rounds, [backend](std::string_view line, trace_replay::Phase1FieldSpans &spans) {
+      trace_replay::scan_phase1_fields_fast(line, spans, backend);
+    });
+  }
+  std::cout << "default_backend: " << trace_replay::scan_backend_name(trace_replay::default_scan_backend()) << '\n';
+  return 0;
+}
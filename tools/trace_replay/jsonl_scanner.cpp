@@ -0,0 +1,309 @@
+#include "trace_replay/jsonl_scanner.hpp"
+
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define SATURNIS_SCAN_HAS_AVX2 1
+#else
+#define SATURNIS_SCAN_HAS_AVX2 0
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SATURNIS_SCAN_HAS_SSE2 1
+#else
+#define SATURNIS_SCAN_HAS_SSE2 0
+#endif
+
+namespace trace_replay {
+namespace {
+
+constexpr std::size_t kNpos = std::string_view::npos;
+
+constexpr bool is_structural(char c) { return c == '"' || c == ':' || c == ',' || c == '}'; }
+
+struct ScalarBlocks {
+  static constexpr std::size_t kWidth = 64;
+  static std::uint64_t mask(const char *p) {
+    std::uint64_t m = 0;
+    for (std::size_t i = 0; i < kWidth; ++i) {
+      m |= static_cast<std::uint64_t>(is_structural(p[i])) << i;
+    }
+    return m;
+  }
+};
+
+#if SATURNIS_SCAN_HAS_SSE2
+struct Sse2Blocks {
+  static constexpr std::size_t kWidth = 16;
+  static std::uint64_t mask(const char *p) {
+    const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+    const __m128i quote_or_colon = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('"')), _mm_cmpeq_epi8(v, _mm_set1_epi8(':')));
+    const __m128i comma_or_brace = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(',')), _mm_cmpeq_epi8(v, _mm_set1_epi8('}')));
+    return static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_or_si128(quote_or_colon, comma_or_brace)));
+  }
+};
+#endif
+
+#if SATURNIS_SCAN_HAS_AVX2
+struct Avx2Blocks {
+  static constexpr std::size_t kWidth = 32;
+  static std::uint64_t mask(const char *p) {
+    const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+    const __m256i quote_or_colon = _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('"')), _mm256_cmpeq_epi8(v, _mm256_set1_epi8(':')));
+    const __m256i comma_or_brace = _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(',')), _mm256_cmpeq_epi8(v, _mm256_set1_epi8('}')));
+    return static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_or_si256(quote_or_colon, comma_or_brace)));
+  }
+};
+#endif
+
+// Yields offsets of structural characters in increasing order, computing one
+// block mask at a time. The final partial block is copied into a zero-padded
+// buffer so loads never run past the line.
+template <typename Blocks>
+class StructuralCursor {
+public:
+  explicit StructuralCursor(std::string_view line) : line_(line) { load(0U); }
+
+  std::size_t next() {
+    while (mask_ == 0U) {
+      if (base_ + Blocks::kWidth >= line_.size()) {
+        return kNpos;
+      }
+      load(base_ + Blocks::kWidth);
+    }
+    const auto bit = static_cast<std::size_t>(std::countr_zero(mask_));
+    mask_ &= mask_ - 1U;
+    return base_ + bit;
+  }
+
+  // Next structural character that is a quote; used to close strings, which
+  // may legally contain ':' or ','.
+  std::size_t next_quote() {
+    std::size_t pos = next();
+    while (pos != kNpos && line_[pos] != '"') {
+      pos = next();
+    }
+    return pos;
+  }
+
+private:
+  void load(std::size_t base) {
+    base_ = base;
+    const std::size_t remaining = line_.size() - base;
+    if (remaining >= Blocks::kWidth) {
+      mask_ = Blocks::mask(line_.data() + base);
+      return;
+    }
+    std::array<char, Blocks::kWidth> padded{};
+    if (remaining != 0U) {
+      std::memcpy(padded.data(), line_.data() + base, remaining);
+    }
+    mask_ = Blocks::mask(padded.data());
+  }
+
+  std::string_view line_;
+  std::size_t base_ = 0U;
+  std::uint64_t mask_ = 0U;
+};
+
+std::optional<std::string_view> *field_slot(std::string_view key, Phase1FieldSpans &out) {
+  switch (key.size()) {
+  case 2:
+    return key == "rw" ? &out.rw : nullptr;
+  case 3:
+    return key == "seq" ? &out.seq : nullptr;
+  case 4:
+    if (key == "addr") return &out.addr;
+    if (key == "size") return &out.size;
+    if (key == "kind") return &out.kind;
+    return nullptr;
+  case 6:
+    return key == "master" ? &out.master : nullptr;
+  case 7:
+    return key == "retries" ? &out.retries : nullptr;
+  case 13:
+    return key == "tick_complete" ? &out.tick_complete : nullptr;
+  case 14:
+    return key == "service_cycles" ? &out.service_cycles : nullptr;
+  case 18:
+    return key == "tick_first_attempt" ? &out.tick_first_attempt : nullptr;
+  default:
+    return nullptr;
+  }
+}
+
+template <typename Blocks>
+bool scan_flat_object(std::string_view line, Phase1FieldSpans &out) {
+  StructuralCursor<Blocks> cursor(line);
+  std::size_t pos = cursor.next();
+  while (true) {
+    if (pos == kNpos || line[pos] != '"') {
+      return false;
+    }
+    const std::size_t key_end = cursor.next_quote();
+    if (key_end == kNpos) {
+      return false;
+    }
+    const std::string_view key = line.substr(pos + 1U, key_end - pos - 1U);
+    const std::size_t colon = cursor.next();
+    if (colon == kNpos || line[colon] != ':') {
+      return false;
+    }
+    std::size_t start = colon + 1U;
+    while (start < line.size() && (line[start] == ' ' || line[start] == '\t')) {
+      ++start;
+    }
+    if (start >= line.size()) {
+      return false;
+    }
+
+    std::string_view value;
+    std::size_t terminator = cursor.next();
+    if (line[start] == '"') {
+      const std::size_t end = cursor.next_quote();
+      if (terminator != start || end == kNpos) {
+        return false;
+      }
+      value = line.substr(start + 1U, end - start - 1U);
+      terminator = cursor.next();
+    } else if (terminator != kNpos) {
+      value = line.substr(start, terminator - start);
+    }
+    if (terminator == kNpos || (line[terminator] != ',' && line[terminator] != '}')) {
+      return false;
+    }
+
+    if (auto *slot = field_slot(key, out); slot != nullptr && !slot->has_value()) {
+      *slot = value;
+    }
+    if (line[terminator] == '}') {
+      return true;
+    }
+    pos = cursor.next();
+  }
+}
+
+} // namespace
+
+ScanBackend widest_scan_backend() {
+#if SATURNIS_SCAN_HAS_AVX2
+  return ScanBackend::Avx2;
+#elif SATURNIS_SCAN_HAS_SSE2
+  return ScanBackend::Sse2;
+#else
+  return ScanBackend::Scalar;
+#endif
+}
+
+ScanBackend default_scan_backend() {
+  // The AVX2 sweep measured slower than SSE2 in trace_scan_bench, so a -mavx2
+  // build still defaults to SSE2 unless configured with
+  // -DSATURNIS_TRACE_SCAN_AVX2=ON.
+#if SATURNIS_SCAN_HAS_AVX2 && defined(SATURNIS_TRACE_SCAN_AVX2)
+  return ScanBackend::Avx2;
+#elif SATURNIS_SCAN_HAS_SSE2
+  return ScanBackend::Sse2;
+#else
+  return ScanBackend::Scalar;
+#endif
+}
+
+const char *scan_backend_name(ScanBackend backend) {
+  switch (backend) {
+  case ScanBackend::Scalar:
+    return "scalar";
+  case ScanBackend::Sse2:
+    return "sse2";
+  case ScanBackend::Avx2:
+    return "avx2";
+  }
+  return "unknown";
+}
+
+bool scan_phase1_fields_fast(std::string_view line, Phase1FieldSpans &out, ScanBackend backend) {
+  // Backends not compiled into this build degrade to the next narrower one.
+  switch (backend) {
+  case ScanBackend::Avx2:
+#if SATURNIS_SCAN_HAS_AVX2
+    return scan_flat_object<Avx2Blocks>(line, out);
+#endif
+    [[fallthrough]];
+  case ScanBackend::Sse2:
+#if SATURNIS_SCAN_HAS_SSE2
+    return scan_flat_object<Sse2Blocks>(line, out);
+#endif
+    [[fallthrough]];
+  case ScanBackend::Scalar:
+    break;
+  }
+  return scan_flat_object<ScalarBlocks>(line, out);
+}
+
+std::optional<std::string_view> find_value_span(std::string_view line, std::string_view key) {
+  std::string needle;
+  needle.reserve(key.size() + 2U);
+  needle.push_back('"');
+  needle.append(key);
+  needle.push_back('"');
+  const auto key_pos = line.find(needle);
+  if (key_pos == std::string_view::npos) {
+    return std::nullopt;
+  }
+  const auto colon = line.find(':', key_pos + needle.size());
+  if (colon == std::string_view::npos) {
+    return std::nullopt;
+  }
+  std::size_t start = colon + 1;
+  while (start < line.size() && (line[start] == ' ' || line[start] == '\t')) {
+    ++start;
+  }
+  if (start >= line.size()) {
+    return std::nullopt;
+  }
+  if (line[start] == '"') {
+    std::size_t end = start + 1;
+    while (end < line.size() && line[end] != '"') {
+      ++end;
+    }
+    if (end >= line.size()) {
+      return std::nullopt;
+    }
+    return line.substr(start + 1, end - start - 1);
+  }
+
+  std::size_t end = start;
+  while (end < line.size() && line[end] != ',' && line[end] != '}') {
+    ++end;
+  }
+  return line.substr(start, end - start);
+}
+
+void scan_phase1_fields_legacy(std::string_view line, Phase1FieldSpans &out) {
+  out.seq = find_value_span(line, "seq");
+  out.master = find_value_span(line, "master");
+  out.tick_first_attempt = find_value_span(line, "tick_first_attempt");
+  out.tick_complete = find_value_span(line, "tick_complete");
+  out.addr = find_value_span(line, "addr");
+  out.size = find_value_span(line, "size");
+  out.rw = find_value_span(line, "rw");
+  out.kind = find_value_span(line, "kind");
+  out.service_cycles = find_value_span(line, "service_cycles");
+  out.retries = find_value_span(line, "retries");
+}
+
+void scan_phase1_fields(std::string_view line, Phase1FieldSpans &out) {
+  out = Phase1FieldSpans{};
+  if (scan_phase1_fields_fast(line, out) && out.complete()) {
+    return;
+  }
+  scan_phase1_fields_legacy(line, out);
+}
+
+} // namespace trace_replay
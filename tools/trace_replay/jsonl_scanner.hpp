@@ -0,0 +1,57 @@
+#pragma once
+
+#include <optional>
+#include <string_view>
+
+namespace trace_replay {
+
+// Raw value spans for the Phase 1 JSONL keys (see docs/trace_format.md).
+// String values are returned without their quotes.
+struct Phase1FieldSpans {
+  std::optional<std::string_view> seq;
+  std::optional<std::string_view> master;
+  std::optional<std::string_view> tick_first_attempt;
+  std::optional<std::string_view> tick_complete;
+  std::optional<std::string_view> addr;
+  std::optional<std::string_view> size;
+  std::optional<std::string_view> rw;
+  std::optional<std::string_view> kind;
+  std::optional<std::string_view> service_cycles;
+  std::optional<std::string_view> retries;
+
+  [[nodiscard]] bool complete() const {
+    return seq && master && tick_first_attempt && tick_complete && addr && size && rw && kind && service_cycles && retries;
+  }
+};
+
+enum class ScanBackend {
+  Scalar,
+  Sse2,
+  Avx2,
+};
+
+// Widest structural-character backend compiled into this build.
+[[nodiscard]] ScanBackend widest_scan_backend();
+// Backend used when none is given: SSE2 where available; AVX2 only with the
+// SATURNIS_TRACE_SCAN_AVX2 build option.
+[[nodiscard]] ScanBackend default_scan_backend();
+[[nodiscard]] const char *scan_backend_name(ScanBackend backend);
+
+// Single left-to-right sweep over `line` that locates quotes, colons, commas and
+// the closing brace a block at a time and fills every known key it meets.
+// Returns false if the line does not follow the flat {"key":value,...} shape;
+// callers then fall back to scan_phase1_fields_legacy.
+bool scan_phase1_fields_fast(std::string_view line, Phase1FieldSpans &out, ScanBackend backend = default_scan_backend());
+
+// Original per-key search: one substring scan of the whole line per key.
+std::optional<std::string_view> find_value_span(std::string_view line, std::string_view key);
+void scan_phase1_fields_legacy(std::string_view line, Phase1FieldSpans &out);
+
+// Fast sweep with legacy fallback. The sweep only matches keys in key
+// position. find_value_span also matches a key name that appears as a string
+// value, e.g. "note":"addr". On such lines the sweep returns the real key's
+// value where the per-key search would return the value after the next colon.
+// Every other line gets the same spans as the per-key search.
+void scan_phase1_fields(std::string_view line, Phase1FieldSpans &out);
+
+} // namespace trace_replay
@@ -0,0 +1,166 @@
+#include "trace_replay/quantile_sketch.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <limits>
+
+namespace trace_replay {
+namespace {
+
+constexpr unsigned kLogSubBits = 7;
+constexpr std::uint64_t kLogSubBuckets = std::uint64_t{1} << kLogSubBits;
+
+std::uint64_t magnitude(std::int64_t value) {
+  return value < 0 ? std::uint64_t{0} - static_cast<std::uint64_t>(value) : static_cast<std::uint64_t>(value);
+}
+
+// Keys sort in value order: negative values use the negated magnitude key, so
+// larger magnitudes sort first.
+std::int64_t log_key(std::int64_t value) {
+  const std::uint64_t m = magnitude(value);
+  const auto exponent = static_cast<unsigned>(std::bit_width(m) - 1U);
+  const std::uint64_t sub = (m >> (exponent - kLogSubBits)) & (kLogSubBuckets - 1U);
+  const auto key = static_cast<std::int64_t>(exponent * kLogSubBuckets + sub);
+  return value < 0 ? -key : key;
+}
+
+// Midpoint of the bucket, clamped to the int64 range.
+std::int64_t log_key_value(std::int64_t key) {
+  const std::uint64_t unsigned_key = key < 0 ? static_cast<std::uint64_t>(-key) : static_cast<std::uint64_t>(key);
+  const auto exponent = static_cast<unsigned>(unsigned_key / kLogSubBuckets);
+  const std::uint64_t sub = unsigned_key % kLogSubBuckets;
+  const unsigned shift = exponent - kLogSubBits;
+  const std::uint64_t mid = ((kLogSubBuckets + sub) << shift) + ((std::uint64_t{1} << shift) >> 1U);
+  constexpr auto kMax = static_cast<std::uint64_t>(std::numeric_limits<std::int64_t>::max());
+  if (key >= 0) {
+    return static_cast<std::int64_t>(std::min(mid, kMax));
+  }
+  return mid > kMax ? std::numeric_limits<std::int64_t>::min() : -static_cast<std::int64_t>(mid);
+}
+
+} // namespace
+
+void QuantileSketch::add(std::int64_t value) {
+  ++count_;
+  sum_ += static_cast<std::uint64_t>(value);
+  if (value >= 0 && value < kDenseLimit) {
+    const auto index = static_cast<std::size_t>(value);
+    if (index >= non_negative_.size()) {
+      non_negative_.resize(index + 1U);
+    }
+    ++non_negative_[index];
+  } else if (value < 0 && value >= -kDenseLimit) {
+    const auto index = static_cast<std::size_t>(-1 - value);
+    if (index >= negative_.size()) {
+      negative_.resize(index + 1U);
+    }
+    ++negative_[index];
+  } else {
+    add_tail(value, 1U);
+  }
+}
+
+void QuantileSketch::merge(const QuantileSketch &other) {
+  count_ += other.count_;
+  sum_ += other.sum_;
+  if (other.non_negative_.size() > non_negative_.size()) {
+    non_negative_.resize(other.non_negative_.size());
+  }
+  for (std::size_t i = 0; i < other.non_negative_.size(); ++i) {
+    non_negative_[i] += other.non_negative_[i];
+  }
+  if (other.negative_.size() > negative_.size()) {
+    negative_.resize(other.negative_.size());
+  }
+  for (std::size_t i = 0; i < other.negative_.size(); ++i) {
+    negative_[i] += other.negative_[i];
+  }
+  if (!other.log_tail_.empty()) {
+    collapse_tail();
+    for (const auto &[key, count] : other.log_tail_) {
+      log_tail_[key] += count;
+    }
+  }
+  for (const auto &[value, count] : other.tail_) {
+    add_tail(value, count);
+  }
+}
+
+void QuantileSketch::add_tail(std::int64_t value, std::uint64_t count) {
+  if (!log_tail_.empty()) {
+    add_log_tail(value, count);
+    return;
+  }
+  tail_[value] += count;
+  if (tail_.size() > kMaxTailValues) {
+    collapse_tail();
+  }
+}
+
+void QuantileSketch::add_log_tail(std::int64_t value, std::uint64_t count) { log_tail_[log_key(value)] += count; }
+
+void QuantileSketch::collapse_tail() {
+  for (const auto &[value, count] : tail_) {
+    add_log_tail(value, count);
+  }
+  tail_.clear();
+}
+
+std::int64_t QuantileSketch::value_at_rank(std::uint64_t rank) const {
+  // Out-of-range values live in exactly one of tail_/log_tail_.
+  const bool exact_tail = log_tail_.empty();
+  const auto &tail = exact_tail ? tail_ : log_tail_;
+  auto tail_value = [exact_tail](std::int64_t key) { return exact_tail ? key : log_key_value(key); };
+
+  auto it = tail.begin();
+  for (; it != tail.end() && it->first < 0; ++it) {
+    if (rank < it->second) return tail_value(it->first);
+    rank -= it->second;
+  }
+  for (std::size_t i = negative_.size(); i-- > 0U;) {
+    if (rank < negative_[i]) return -1 - static_cast<std::int64_t>(i);
+    rank -= negative_[i];
+  }
+  for (std::size_t i = 0; i < non_negative_.size(); ++i) {
+    if (rank < non_negative_[i]) return static_cast<std::int64_t>(i);
+    rank -= non_negative_[i];
+  }
+  for (; it != tail.end(); ++it) {
+    if (rank < it->second) return tail_value(it->first);
+    rank -= it->second;
+  }
+  return 0;
+}
+
+double QuantileSketch::quantile(double pct) const {
+  if (count_ == 0U) {
+    return 0.0;
+  }
+  const double index = pct * static_cast<double>(count_ - 1U);
+  const auto lo = static_cast<std::uint64_t>(std::floor(index));
+  const auto hi = static_cast<std::uint64_t>(std::ceil(index));
+  const std::int64_t lo_value = value_at_rank(lo);
+  if (lo == hi) {
+    return static_cast<double>(lo_value);
+  }
+  const std::int64_t hi_value = value_at_rank(hi);
+  const double frac = index - static_cast<double>(lo);
+  return static_cast<double>(lo_value) + (static_cast<double>(hi_value) - static_cast<double>(lo_value)) * frac;
+}
+
+void QuantileSketch::save(StateWriter &out) const {
+  out.put_vector(non_negative_);
+  out.put_vector(negative_);
+  out.put_map(tail_);
+  out.put_map(log_tail_);
+  out.put(count_);
+  out.put(sum_);
+}
+
+bool QuantileSketch::load(StateReader &in) {
+  return in.get_vector(non_negative_) && in.get_vector(negative_) && in.get_map(tail_) && in.get_map(log_tail_) && in.get(count_) &&
+         in.get(sum_);
+}
+
+} // namespace trace_replay
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "trace_replay/state_codec.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <vector>
+
+namespace trace_replay {
+
+// One-pass quantiles over int64 samples without keeping the samples.
+//
+// Values in [-kDenseLimit, kDenseLimit) (cycle counts and wait deltas in
+// practice) are counted exactly in dense arrays that grow to the largest value
+// seen. Rarer values outside that range are counted exactly per distinct value
+// until kMaxTailValues distinct values have been seen; after that the tail
+// switches to HDR-style log buckets (7 significant bits, < 0.4% relative error)
+// and exact() turns false. Memory per sketch is therefore bounded no matter how
+// many samples are added.
+class QuantileSketch {
+public:
+  static constexpr std::int64_t kDenseLimit = 1024;
+  static constexpr std::size_t kMaxTailValues = 1024;
+
+  void add(std::int64_t value);
+  void merge(const QuantileSketch &other);
+  QuantileSketch &operator+=(const QuantileSketch &other) {
+    merge(other);
+    return *this;
+  }
+
+  [[nodiscard]] std::uint64_t count() const { return count_; }
+  [[nodiscard]] bool empty() const { return count_ == 0U; }
+  // Sum of all samples, wrapping modulo 2^64 like an int64 accumulator.
+  [[nodiscard]] std::int64_t sum() const { return static_cast<std::int64_t>(sum_); }
+  [[nodiscard]] bool exact() const { return log_tail_.empty(); }
+
+  // Same definition as sorting every sample and interpolating linearly
+  // between the ranks floor/ceil(pct * (count - 1)); 0.0 when empty.
+  [[nodiscard]] double quantile(double pct) const;
+
+  // Replay cache state (see state_codec.hpp).
+  void save(StateWriter &out) const;
+  bool load(StateReader &in);
+
+private:
+  [[nodiscard]] std::int64_t value_at_rank(std::uint64_t rank) const;
+  void add_tail(std::int64_t value, std::uint64_t count);
+  void add_log_tail(std::int64_t value, std::uint64_t count);
+  void collapse_tail();
+
+  std::vector<std::uint64_t> non_negative_; // value v at [v]
+  std::vector<std::uint64_t> negative_;     // value -1 - i at [i]
+  std::map<std::int64_t, std::uint64_t> tail_;
+  // Signed log-bucket key (see quantile_sketch.cpp) -> count.
+  std::map<std::int64_t, std::uint64_t> log_tail_;
+  std::uint64_t count_ = 0;
+  std::uint64_t sum_ = 0;
+};
+
+} // namespace trace_replay
@@ -0,0 +1,122 @@
+#include "trace_replay/record_diff.hpp"
+
+#include <utility>
+
+namespace trace_replay {
+namespace {
+
+std::uint64_t magnitude(std::int64_t value) {
+  return value < 0 ? std::uint64_t{0} - static_cast<std::uint64_t>(value) : static_cast<std::uint64_t>(value);
+}
+
+DiffSide observe(const TraceRecord &record) {
+  DiffSide side{};
+  side.timing = observed_timing(record);
+  side.classification = side.timing.wait > 0U ? Classification::WaitNonzero : Classification::WaitZero;
+  return side;
+}
+
+bool same_access(const TraceRecord &a, const TraceRecord &b) {
+  return a.master == b.master && a.addr == b.addr && a.rw == b.rw && a.size == b.size && a.kind == b.kind;
+}
+
+void add_to(DiffBucket &bucket, const RecordDiff &diff) {
+  switch (diff.kind) {
+  case DiffKind::OnlyInA:
+    ++bucket.only_in_a;
+    return;
+  case DiffKind::OnlyInB:
+    ++bucket.only_in_b;
+    return;
+  case DiffKind::Identical:
+    ++bucket.matched;
+    return;
+  case DiffKind::TimingChanged:
+  case DiffKind::AccessMismatch:
+    break;
+  }
+  ++bucket.matched;
+  ++bucket.differing;
+  bucket.classification_changes += diff.classification_changed() ? 1U : 0U;
+  bucket.wait_delta_sum += diff.wait_delta;
+  bucket.elapsed_delta_sum += diff.elapsed_delta;
+  bucket.abs_wait_delta_sum += magnitude(diff.wait_delta);
+  bucket.abs_elapsed_delta_sum += magnitude(diff.elapsed_delta);
+}
+
+} // namespace
+
+const char *diff_kind_name(DiffKind kind) {
+  switch (kind) {
+  case DiffKind::Identical:
+    return "identical";
+  case DiffKind::TimingChanged:
+    return "timing_changed";
+  case DiffKind::AccessMismatch:
+    return "access_mismatch";
+  case DiffKind::OnlyInA:
+    return "only_in_a";
+  case DiffKind::OnlyInB:
+    return "only_in_b";
+  }
+  return "unknown";
+}
+
+RecordDiff TraceDiffer::compare(const TraceRecord &a, const TraceRecord &b) {
+  RecordDiff diff{};
+  diff.seq = a.seq;
+  diff.region = a.region;
+  diff.master = a.master;
+  diff.a = a;
+  diff.b = b;
+  diff.side_a = observe(a);
+  diff.side_b = observe(b);
+  diff.wait_delta = static_cast<std::int64_t>(diff.side_b.timing.wait) - static_cast<std::int64_t>(diff.side_a.timing.wait);
+  diff.elapsed_delta = static_cast<std::int64_t>(diff.side_b.timing.elapsed) - static_cast<std::int64_t>(diff.side_a.timing.elapsed);
+  diff.tick_shift = static_cast<std::int64_t>(b.tick_first_attempt) - static_cast<std::int64_t>(a.tick_first_attempt);
+  if (!same_access(a, b)) {
+    diff.kind = DiffKind::AccessMismatch;
+  } else if (diff.wait_delta != 0 || diff.elapsed_delta != 0 || a.service_cycles != b.service_cycles || a.retries != b.retries ||
+             diff.side_a.timing.kind != diff.side_b.timing.kind) {
+    diff.kind = DiffKind::TimingChanged;
+  }
+  wait_deltas_.add(diff.wait_delta);
+  elapsed_deltas_.add(diff.elapsed_delta);
+  return record(std::move(diff));
+}
+
+RecordDiff TraceDiffer::only_in_a(const TraceRecord &a) {
+  RecordDiff diff{};
+  diff.seq = a.seq;
+  diff.kind = DiffKind::OnlyInA;
+  diff.region = a.region;
+  diff.master = a.master;
+  diff.a = a;
+  diff.side_a = observe(a);
+  return record(std::move(diff));
+}
+
+RecordDiff TraceDiffer::only_in_b(const TraceRecord &b) {
+  RecordDiff diff{};
+  diff.seq = b.seq;
+  diff.kind = DiffKind::OnlyInB;
+  diff.region = b.region;
+  diff.master = b.master;
+  diff.b = b;
+  diff.side_b = observe(b);
+  return record(std::move(diff));
+}
+
+RecordDiff TraceDiffer::record(RecordDiff diff) {
+  add_to(totals_, diff);
+  add_to(by_region_[static_cast<std::size_t>(diff.region)], diff);
+  add_to(by_master_[static_cast<std::size_t>(diff.master)], diff);
+  identical_ += diff.kind == DiffKind::Identical ? 1U : 0U;
+  access_mismatches_ += diff.kind == DiffKind::AccessMismatch ? 1U : 0U;
+  if (diff.kind != DiffKind::Identical && !first_divergence_.has_value()) {
+    first_divergence_ = diff;
+  }
+  return diff;
+}
+
+} // namespace trace_replay
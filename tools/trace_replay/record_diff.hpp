@@ -0,0 +1,184 @@
+#pragma once
+
+#include "trace_replay/dense_table.hpp"
+#include "trace_replay/quantile_sketch.hpp"
+#include "trace_replay/trace_record.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <utility>
+#include <vector>
+
+namespace trace_replay {
+
+// Record-aligned comparison of two captures of the same workload (trace_diff).
+// Records are joined on seq; deltas are B minus A.
+
+enum class DiffKind : std::uint8_t {
+  Identical,
+  TimingChanged,  // same access, different wait/elapsed/service/retries
+  AccessMismatch, // same seq but a different master/addr/rw/size/kind
+  OnlyInA,
+  OnlyInB,
+};
+
+[[nodiscard]] const char *diff_kind_name(DiffKind kind);
+
+// Observed timing of one side, with the same wait-based classification
+// trace_replay reports when the model comparison is off.
+struct DiffSide {
+  ObservedTiming timing{};
+  Classification classification = Classification::WaitZero;
+};
+
+struct RecordDiff {
+  std::uint64_t seq = 0;
+  DiffKind kind = DiffKind::Identical;
+  // Region/master the delta is attributed to: A's, or B's for OnlyInB.
+  Region region = Region::Unmapped;
+  Master master = Master::MSH2;
+  std::optional<TraceRecord> a;
+  std::optional<TraceRecord> b;
+  DiffSide side_a{};
+  DiffSide side_b{};
+  std::int64_t wait_delta = 0;
+  std::int64_t elapsed_delta = 0;
+  std::int64_t tick_shift = 0; // tick_first_attempt, informational only
+
+  [[nodiscard]] bool classification_changed() const {
+    return a.has_value() && b.has_value() && side_a.classification != side_b.classification;
+  }
+};
+
+struct DiffBucket {
+  std::uint64_t matched = 0;
+  std::uint64_t differing = 0; // TimingChanged + AccessMismatch among matched
+  std::uint64_t only_in_a = 0;
+  std::uint64_t only_in_b = 0;
+  std::uint64_t classification_changes = 0;
+  std::int64_t wait_delta_sum = 0;
+  std::int64_t elapsed_delta_sum = 0;
+  std::uint64_t abs_wait_delta_sum = 0;
+  std::uint64_t abs_elapsed_delta_sum = 0;
+};
+
+// Accumulates per-record diffs. Holds no records beyond the first divergence,
+// so memory does not grow with capture length.
+class TraceDiffer {
+public:
+  RecordDiff compare(const TraceRecord &a, const TraceRecord &b);
+  RecordDiff only_in_a(const TraceRecord &a);
+  RecordDiff only_in_b(const TraceRecord &b);
+  // Records a streaming join cannot place (see SeqOrderedCursor); they are
+  // counted and left out.
+  void note_unaligned(bool side_b) { ++(side_b ? unaligned_b_ : unaligned_a_); }
+
+  [[nodiscard]] const DiffBucket &totals() const { return totals_; }
+  [[nodiscard]] std::uint64_t identical() const { return identical_; }
+  [[nodiscard]] std::uint64_t access_mismatches() const { return access_mismatches_; }
+  [[nodiscard]] std::uint64_t unaligned_a() const { return unaligned_a_; }
+  [[nodiscard]] std::uint64_t unaligned_b() const { return unaligned_b_; }
+  [[nodiscard]] const std::optional<RecordDiff> &first_divergence() const { return first_divergence_; }
+  [[nodiscard]] const std::array<DiffBucket, kRegionCount> &by_region() const { return by_region_; }
+  [[nodiscard]] const DenseTable<DiffBucket> &by_master() const { return by_master_; }
+  [[nodiscard]] const QuantileSketch &wait_deltas() const { return wait_deltas_; }
+  [[nodiscard]] const QuantileSketch &elapsed_deltas() const { return elapsed_deltas_; }
+
+private:
+  RecordDiff record(RecordDiff diff);
+
+  DiffBucket totals_{};
+  std::uint64_t identical_ = 0;
+  std::uint64_t access_mismatches_ = 0;
+  std::uint64_t unaligned_a_ = 0;
+  std::uint64_t unaligned_b_ = 0;
+  std::optional<RecordDiff> first_divergence_;
+  std::array<DiffBucket, kRegionCount> by_region_{};
+  DenseTable<DiffBucket> by_master_;
+  // Matched pairs only.
+  QuantileSketch wait_deltas_;
+  QuantileSketch elapsed_deltas_;
+};
+
+inline constexpr std::size_t kDefaultDiffReorderWindow = 1024;
+
+// Re-sequences one side of a diff by seq through a bounded min-heap, so local
+// seq disorder in a capture still joins. A record whose seq is not above the
+// last one released (late beyond the window, or a duplicate) is counted as
+// unaligned and dropped.
+template <typename Next>
+class SeqOrderedCursor {
+public:
+  SeqOrderedCursor(Next next, std::size_t window, TraceDiffer &differ, bool side_b)
+      : next_(std::move(next)), window_(window), differ_(differ), side_b_(side_b) {}
+
+  const TraceRecord *next() {
+    while (true) {
+      while (!exhausted_ && heap_.size() <= window_) {
+        const TraceRecord *record = next_();
+        if (record == nullptr) {
+          exhausted_ = true;
+        } else if (released_ && record->seq <= current_.seq) {
+          differ_.note_unaligned(side_b_);
+        } else {
+          heap_.push_back(*record);
+          std::push_heap(heap_.begin(), heap_.end(), later_seq);
+        }
+      }
+      if (heap_.empty()) {
+        return nullptr;
+      }
+      std::pop_heap(heap_.begin(), heap_.end(), later_seq);
+      const bool duplicate = released_ && heap_.back().seq <= current_.seq;
+      current_ = heap_.back();
+      heap_.pop_back();
+      released_ = true;
+      if (!duplicate) {
+        return &current_;
+      }
+      differ_.note_unaligned(side_b_);
+    }
+  }
+
+private:
+  static bool later_seq(const TraceRecord &lhs, const TraceRecord &rhs) { return lhs.seq > rhs.seq; }
+
+  Next next_;
+  std::size_t window_;
+  TraceDiffer &differ_;
+  bool side_b_;
+  std::vector<TraceRecord> heap_;
+  TraceRecord current_{};
+  bool released_ = false;
+  bool exhausted_ = false;
+};
+
+// Merge-joins two inputs on seq. `next_a`/`next_b` return the next record of
+// their side in input order or nullptr at the end; each side is re-sequenced
+// through a `reorder_window`-record buffer first. `on_diff` sees every
+// RecordDiff, identical pairs included, in seq order.
+template <typename NextA, typename NextB, typename OnDiff>
+void merge_join(NextA next_a, NextB next_b, TraceDiffer &differ, OnDiff &&on_diff, std::size_t reorder_window = kDefaultDiffReorderWindow) {
+  SeqOrderedCursor<NextA> side_a(std::move(next_a), reorder_window, differ, false);
+  SeqOrderedCursor<NextB> side_b(std::move(next_b), reorder_window, differ, true);
+  const TraceRecord *a = side_a.next();
+  const TraceRecord *b = side_b.next();
+  while (a != nullptr || b != nullptr) {
+    if (b == nullptr || (a != nullptr && a->seq < b->seq)) {
+      on_diff(differ.only_in_a(*a));
+      a = side_a.next();
+    } else if (a == nullptr || b->seq < a->seq) {
+      on_diff(differ.only_in_b(*b));
+      b = side_b.next();
+    } else {
+      on_diff(differ.compare(*a, *b));
+      a = side_a.next();
+      b = side_b.next();
+    }
+  }
+}
+
+} // namespace trace_replay
@@ -0,0 +1,348 @@
+#include "trace_replay/replay_cache.hpp"
+
+#include "trace_replay/state_codec.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string_view>
+#include <utility>
+
+namespace trace_replay {
+namespace {
+
+constexpr std::array<char, 4> kReplayCacheMagic = {'T', 'R', 'R', 'C'};
+
+ReplayOrderKey order_key(const TraceRecord &record) { return ReplayOrderKey{record.tick_complete, record.seq}; }
+
+// Block size parameter of `format`; a cache written with another one has
+// different block boundaries and is ignored.
+std::uint64_t block_unit(IndexedFormat format) {
+  return format == IndexedFormat::Jsonl ? kReplayCacheJsonlBlockBytes : kReplayCacheBtr1BlockRecords;
+}
+
+void put_labels(StateWriter &out, const std::vector<std::string> &labels) {
+  out.put<std::uint64_t>(labels.size());
+  for (const auto &label : labels) {
+    out.put_string(label);
+  }
+}
+
+bool get_labels(StateReader &in, std::vector<std::string> &labels) {
+  std::uint64_t count = 0;
+  if (!in.get(count)) {
+    return false;
+  }
+  labels.clear();
+  for (std::uint64_t i = 0; i < count; ++i) {
+    if (!in.get_string(labels.emplace_back())) {
+      return false;
+    }
+  }
+  return true;
+}
+
+std::span<const std::uint8_t> as_bytes(std::string_view text) { return {reinterpret_cast<const std::uint8_t *>(text.data()), text.size()}; }
+
+} // namespace
+
+std::uint64_t block_hash(std::span<const std::uint8_t> bytes) {
+  constexpr std::uint64_t kPrime = 0x100000001b3ULL;
+  std::uint64_t hash = 0xcbf29ce484222325ULL ^ static_cast<std::uint64_t>(bytes.size());
+  std::size_t i = 0;
+  for (; i + 8U <= bytes.size(); i += 8U) {
+    std::uint64_t word = 0;
+    std::memcpy(&word, bytes.data() + i, sizeof(word));
+    hash = (hash ^ word) * kPrime;
+    hash ^= hash >> 32U;
+  }
+  for (; i < bytes.size(); ++i) {
+    hash = (hash ^ bytes[i]) * kPrime;
+  }
+  return hash ^ (hash >> 29U);
+}
+
+bool ReplayCache::read_input(const std::string &input_path, std::size_t ingest_threads, InputStats &stats, std::vector<TraceRecord> &records) {
+  MappedFile file;
+  if (!file.open(input_path)) {
+    std::cerr << "Failed to open input file: " << input_path << '\n';
+    return false;
+  }
+  if (is_binary_input(input_path)) {
+    if (has_btr2_magic(file.bytes())) {
+      std::cerr << "error: --replay-cache needs a JSONL or BTR1 input\n";
+      return false;
+    }
+    format_ = IndexedFormat::Btr1;
+  }
+
+  loaded_ = load(format_);
+  if (loaded_.has_value()) {
+    if (!matches_input(*loaded_, file.bytes())) {
+      std::cerr << "note: replay cache " << path_ << " does not match the start of " << input_path << "; replaying in full\n";
+    } else if (!restore_interned_labels(loaded_->labels)) {
+      std::cerr << "note: replay cache " << path_ << " label ids cannot be restored; replaying in full\n";
+    } else {
+      resumed_ = true;
+    }
+  }
+
+  const std::size_t threads = resolve_ingest_threads(ingest_threads);
+  auto read = [&] {
+    stats = resumed_ ? loaded_->stats : InputStats{};
+    records = resumed_ ? loaded_->pending : std::vector<TraceRecord>{};
+    blocks_read_.clear();
+    last_mark_.reset();
+    if (format_ == IndexedFormat::Btr1) {
+      return read_btr1_blocks(file, stats, records);
+    }
+    read_jsonl_blocks(file.bytes(), threads, stats, records);
+    return true;
+  };
+  if (!read()) {
+    return false;
+  }
+  if (resumed_ && loaded_->max_key.has_value()) {
+    const ReplayOrderKey seam = *loaded_->max_key;
+    const auto tail = records.begin() + static_cast<std::ptrdiff_t>(loaded_->pending.size());
+    if (std::any_of(tail, records.end(), [&seam](const TraceRecord &record) { return order_key(record) < seam; })) {
+      std::cerr << "note: appended records replay before the replay cache checkpoint; replaying in full\n";
+      resumed_ = false;
+      if (!read()) {
+        return false;
+      }
+    }
+  }
+  if (resumed_) {
+    std::cerr << "note: replay cache: resuming after " << loaded_->records << " records (" << loaded_->offset() << " of " << file.size()
+              << " bytes cached, " << loaded_->pending.size() << " records pending)\n";
+  }
+  return true;
+}
+
+void ReplayCache::read_jsonl_blocks(std::span<const std::uint8_t> input, std::size_t threads, InputStats &stats, std::vector<TraceRecord> &records) {
+  const std::size_t offset = resumed_ ? static_cast<std::size_t>(loaded_->offset()) : 0U;
+  const std::string_view text(reinterpret_cast<const char *>(input.data()) + offset, input.size() - offset);
+  // Chunk boundaries depend only on the bytes before them, so every chunk but
+  // the last is a stable block whatever gets appended later.
+  const std::vector<std::string_view> chunks = split_jsonl_chunks(text, kReplayCacheJsonlBlockBytes);
+  JsonlChunkMerger merger = resumed_ ? JsonlChunkMerger(stats, loaded_->seq_tracker, static_cast<std::size_t>(loaded_->item_base))
+                                     : JsonlChunkMerger(stats);
+  auto sink = [&records](TraceRecord &&rec) { records.push_back(std::move(rec)); };
+
+  threads = std::min(threads, std::max<std::size_t>(chunks.size(), 1U));
+  std::vector<JsonlChunkResult> wave(threads);
+  std::vector<std::uint64_t> hashes(threads);
+  std::uint64_t end_offset = offset;
+  for (std::size_t first = 0; first < chunks.size(); first += threads) {
+    const std::size_t count = std::min(threads, chunks.size() - first);
+    for (std::size_t i = 0; i < count; ++i) {
+      wave[i] = JsonlChunkResult{};
+    }
+    run_parallel(count, [&](std::size_t i) {
+      parse_jsonl_chunk(chunks[first + i], wave[i]);
+      hashes[i] = block_hash(as_bytes(chunks[first + i]));
+    });
+    for (std::size_t i = 0; i < count; ++i) {
+      merger.merge(wave[i], sink);
+      end_offset += chunks[first + i].size();
+      if (first + i + 1U < chunks.size()) {
+        blocks_read_.push_back(ReplayCacheBlock{end_offset, hashes[i]});
+      }
+      if (first + i + 2U == chunks.size()) {
+        last_mark_ = BlockMark{merger.line_base(), records.size(), stats, merger.seq_tracker()};
+      }
+    }
+  }
+}
+
+bool ReplayCache::read_btr1_blocks(const MappedFile &file, InputStats &stats, std::vector<TraceRecord> &records) {
+  const auto view = open_binary_view_v1(file);
+  if (!view.has_value()) {
+    return false;
+  }
+  SeqTracker seq_tracker = resumed_ ? loaded_->seq_tracker : SeqTracker{};
+  std::uint64_t block_start = resumed_ ? loaded_->offset() : 0U;
+  const std::size_t complete = view->records.size() - view->records.size() % kReplayCacheBtr1BlockRecords;
+  for (std::size_t index = resumed_ ? static_cast<std::size_t>(loaded_->item_base) : 0U; index < view->records.size(); ++index) {
+    ++stats.total_events;
+    auto decoded = decode_binary_record(view->records[index], index + 1);
+    if (!decoded.has_value()) {
+      ++stats.malformed_lines;
+      std::cerr << "warning: malformed binary record at index " << index << " skipped\n";
+    } else {
+      note_binary_seq(seq_tracker, stats, decoded->seq, index);
+      records.push_back(std::move(*decoded));
+    }
+    // The first block also covers the header.
+    if ((index + 1U) % kReplayCacheBtr1BlockRecords == 0U) {
+      const std::uint64_t end = kBinaryHeaderSize + (index + 1U) * sizeof(BinaryTraceRecordV1);
+      const std::uint64_t hash = block_hash(file.bytes().subspan(static_cast<std::size_t>(block_start), static_cast<std::size_t>(end - block_start)));
+      blocks_read_.push_back(ReplayCacheBlock{end, hash});
+      if (index + 1U == complete) {
+        last_mark_ = BlockMark{index + 1U, records.size(), stats, seq_tracker};
+      }
+      block_start = end;
+    }
+  }
+  if (view->trailing_bytes != 0U) {
+    std::cerr << "error: truncated binary record at index " << view->records.size() << "\n";
+    return false;
+  }
+  return true;
+}
+
+std::optional<std::size_t> ReplayCache::plan_checkpoint(const std::vector<TraceRecord> &records) {
+  planned_ = false;
+  planned_pending_.clear();
+  if (!last_mark_.has_value()) {
+    return std::nullopt;
+  }
+  const std::size_t before = last_mark_->records;
+  std::optional<ReplayOrderKey> suffix_min;
+  for (std::size_t r = before; r < records.size(); ++r) {
+    if (!suffix_min.has_value() || order_key(records[r]) < *suffix_min) {
+      suffix_min = order_key(records[r]);
+    }
+  }
+
+  // Records before the checkpoint that sort no later than everything after
+  // it come first in replay order whatever is appended behind them (equal
+  // keys keep input order); the rest stay pending until a later run.
+  std::optional<ReplayOrderKey> max_key = resumed_ ? loaded_->max_key : std::nullopt;
+  std::size_t consumed = 0;
+  for (std::size_t r = 0; r < before; ++r) {
+    const ReplayOrderKey key = order_key(records[r]);
+    if (suffix_min.has_value() && *suffix_min < key) {
+      planned_pending_.push_back(records[r]);
+      continue;
+    }
+    ++consumed;
+    if (!max_key.has_value() || *max_key < key) {
+      max_key = key;
+    }
+  }
+  planned_ = true;
+  planned_consumed_ = consumed;
+  planned_max_key_ = max_key;
+  return consumed;
+}
+
+bool ReplayCache::write(std::string session_state) {
+  if (!planned_) {
+    return true;
+  }
+  const BlockMark &mark = *last_mark_;
+  ReplayCheckpoint checkpoint;
+  if (resumed_) {
+    checkpoint.blocks = loaded_->blocks;
+  }
+  checkpoint.blocks.insert(checkpoint.blocks.end(), blocks_read_.begin(), blocks_read_.end());
+  checkpoint.item_base = mark.item_base;
+  checkpoint.records = (resumed_ ? loaded_->records : 0U) + planned_consumed_;
+  checkpoint.stats = mark.stats;
+  checkpoint.seq_tracker = mark.seq_tracker;
+  checkpoint.max_key = planned_max_key_;
+  checkpoint.pending = std::move(planned_pending_);
+  checkpoint.labels = interned_labels();
+  checkpoint.session_state = std::move(session_state);
+
+  StateWriter out;
+  out.put(kReplayCacheMagic);
+  out.put(kReplayCacheVersion);
+  out.put(fingerprint_);
+  out.put(format_);
+  out.put(block_unit(format_));
+  out.put_vector(checkpoint.blocks);
+  out.put(checkpoint.item_base);
+  out.put(checkpoint.records);
+  out.put(checkpoint.stats);
+  checkpoint.seq_tracker.save(out);
+  out.put(checkpoint.max_key);
+  out.put_vector(checkpoint.pending);
+  put_labels(out, checkpoint.labels.masters);
+  put_labels(out, checkpoint.labels.rws);
+  put_labels(out, checkpoint.labels.kinds);
+  put_labels(out, checkpoint.labels.addr_texts);
+  out.put_string(checkpoint.session_state);
+  out.put(block_hash(as_bytes(out.bytes())));
+
+  const std::string temp_path = path_ + ".tmp";
+  {
+    std::ofstream file(temp_path, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+      std::cerr << "Failed to open replay cache path: " << temp_path << '\n';
+      return false;
+    }
+    file.write(out.bytes().data(), static_cast<std::streamsize>(out.bytes().size()));
+    if (!file) {
+      std::cerr << "error: failed to write replay cache " << temp_path << '\n';
+      return false;
+    }
+  }
+  if (std::rename(temp_path.c_str(), path_.c_str()) != 0) {
+    std::cerr << "error: failed to replace replay cache " << path_ << '\n';
+    return false;
+  }
+  return true;
+}
+
+std::optional<ReplayCheckpoint> ReplayCache::load(IndexedFormat format) const {
+  std::ifstream input(path_, std::ios::binary);
+  if (!input.is_open()) {
+    return std::nullopt;
+  }
+  const std::vector<std::uint8_t> bytes{std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>()};
+  std::uint64_t checksum = 0;
+  if (bytes.size() >= sizeof(checksum)) {
+    std::memcpy(&checksum, bytes.data() + bytes.size() - sizeof(checksum), sizeof(checksum));
+  }
+  const std::span<const std::uint8_t> payload(bytes.data(), bytes.size() - std::min(bytes.size(), sizeof(checksum)));
+  if (bytes.size() < sizeof(checksum) || block_hash(payload) != checksum) {
+    std::cerr << "note: ignoring unreadable replay cache " << path_ << '\n';
+    return std::nullopt;
+  }
+
+  StateReader in(payload);
+  std::array<char, 4> magic{};
+  std::uint32_t version = 0;
+  std::uint64_t fingerprint = 0;
+  IndexedFormat cached_format = IndexedFormat::Jsonl;
+  std::uint64_t unit = 0;
+  if (!in.get(magic) || magic != kReplayCacheMagic || !in.get(version) || version != kReplayCacheVersion || !in.get(fingerprint) ||
+      fingerprint != fingerprint_ || !in.get(cached_format) || cached_format != format || !in.get(unit) || unit != block_unit(format)) {
+    std::cerr << "note: ignoring replay cache " << path_ << " written by another build, option set or input format\n";
+    return std::nullopt;
+  }
+  ReplayCheckpoint checkpoint;
+  const bool ok = in.get_vector(checkpoint.blocks) && in.get(checkpoint.item_base) && in.get(checkpoint.records) && in.get(checkpoint.stats) &&
+                  checkpoint.seq_tracker.load(in) && in.get(checkpoint.max_key) && in.get_vector(checkpoint.pending) && get_labels(in, checkpoint.labels.masters) &&
+                  get_labels(in, checkpoint.labels.rws) && get_labels(in, checkpoint.labels.kinds) &&
+                  get_labels(in, checkpoint.labels.addr_texts) && in.get_string(checkpoint.session_state) && in.at_end();
+  if (!ok) {
+    std::cerr << "note: ignoring unreadable replay cache " << path_ << '\n';
+    return std::nullopt;
+  }
+  return checkpoint;
+}
+
+bool ReplayCache::matches_input(const ReplayCheckpoint &checkpoint, std::span<const std::uint8_t> input) const {
+  if (format_ == IndexedFormat::Btr1 && checkpoint.offset() != kBinaryHeaderSize + checkpoint.item_base * sizeof(BinaryTraceRecordV1)) {
+    return false;
+  }
+  std::uint64_t start = 0;
+  for (const auto &block : checkpoint.blocks) {
+    if (block.end_offset <= start || block.end_offset > input.size() ||
+        block_hash(input.subspan(static_cast<std::size_t>(start), static_cast<std::size_t>(block.end_offset - start))) != block.hash) {
+      return false;
+    }
+    start = block.end_offset;
+  }
+  return true;
+}
+
+} // namespace trace_replay
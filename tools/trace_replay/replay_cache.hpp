@@ -0,0 +1,124 @@
+#pragma once
+
+#include "trace_replay/seq_tracker.hpp"
+#include "trace_replay/trace_index.hpp"
+#include "trace_replay/trace_input.hpp"
+#include "trace_replay/trace_record.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace trace_replay {
+
+// Incremental batch replay (--replay-cache). The input is cut into blocks
+// whose boundaries depend only on the bytes before them: 1 MiB newline-aligned
+// chunks for JSONL, fixed record counts for BTR1. The cache file keeps the
+// content hash of every block up to a checkpoint at the last complete block,
+// the loader state there, and the serialized replay session after every
+// record before the checkpoint that no later record replays ahead of. The
+// remaining records before it (local tick disorder near the boundary) are
+// stored as they are. A rerun on a capture that has only grown at the tail
+// verifies the hashes, restores the session and parses and replays just the
+// stored records and the blocks after the checkpoint. See
+// docs/trace_format.md.
+
+inline constexpr std::uint32_t kReplayCacheVersion = 2;
+inline constexpr std::size_t kReplayCacheJsonlBlockBytes = std::size_t{1} << 20U;
+inline constexpr std::size_t kReplayCacheBtr1BlockRecords = 16384;
+
+// Fast non-cryptographic hash of a byte span (FNV-1a over 64-bit words with a
+// folding step so every input bit reaches every output bit). Detects edits,
+// not deliberate collisions.
+[[nodiscard]] std::uint64_t block_hash(std::span<const std::uint8_t> bytes);
+
+// Replay order key (tick_complete, seq); ties keep input order.
+struct ReplayOrderKey {
+  std::uint64_t tick_complete = 0;
+  std::uint64_t seq = 0;
+
+  friend bool operator<(const ReplayOrderKey &a, const ReplayOrderKey &b) {
+    return a.tick_complete != b.tick_complete ? a.tick_complete < b.tick_complete : a.seq < b.seq;
+  }
+};
+
+struct ReplayCacheBlock {
+  std::uint64_t end_offset = 0;
+  std::uint64_t hash = 0;
+};
+
+// Input and session state at a block boundary.
+struct ReplayCheckpoint {
+  std::vector<ReplayCacheBlock> blocks; // every block before the checkpoint, in file order
+  std::uint64_t item_base = 0;          // lines (JSONL) or record indices (BTR1) before it
+  std::uint64_t records = 0;            // records the session has consumed
+  InputStats stats;
+  SeqTracker seq_tracker;
+  std::optional<ReplayOrderKey> max_key; // largest replay key the session has consumed
+  std::vector<TraceRecord> pending;      // records before it the session has not consumed, file order
+  InternedLabels labels;
+  std::string session_state;
+
+  [[nodiscard]] std::uint64_t offset() const { return blocks.empty() ? 0U : blocks.back().end_offset; }
+};
+
+class ReplayCache {
+public:
+  // `fingerprint` covers everything besides the input that the saved session
+  // depends on (options, timing tables, build); a cache written under a
+  // different fingerprint is ignored.
+  ReplayCache(std::string path, std::uint64_t fingerprint) : path_(std::move(path)), fingerprint_(fingerprint) {}
+
+  // Reads a JSONL or BTR1 input file. If the cache matches the fingerprint
+  // and the input's leading blocks, only the cached pending records and the
+  // records after the checkpoint are returned and `stats` continues from the
+  // checkpoint; otherwise (or if an appended record would replay ahead of the
+  // cached session) the whole input is read. `records` come back in file
+  // order.
+  bool read_input(const std::string &input_path, std::size_t ingest_threads, InputStats &stats, std::vector<TraceRecord> &records);
+
+  // Serialized session to restore before replaying the records read; null
+  // when they are the whole input.
+  [[nodiscard]] const std::string *resume_state() const { return resumed_ ? &loaded_->session_state : nullptr; }
+
+  // Plans a checkpoint at the last complete block read this run, given
+  // `records` as returned by read_input (before sorting). Returns how many
+  // records in replay order the session must consume before it is saved;
+  // nullopt if no block was completed this run.
+  [[nodiscard]] std::optional<std::size_t> plan_checkpoint(const std::vector<TraceRecord> &records);
+
+  // Writes the planned checkpoint with the session state after consuming
+  // that many records. Replaces the cache file atomically.
+  bool write(std::string session_state);
+
+private:
+  // Loader state after the last complete block read this run.
+  struct BlockMark {
+    std::uint64_t item_base = 0;
+    std::size_t records = 0;
+    InputStats stats;
+    SeqTracker seq_tracker;
+  };
+
+  [[nodiscard]] std::optional<ReplayCheckpoint> load(IndexedFormat format) const;
+  [[nodiscard]] bool matches_input(const ReplayCheckpoint &checkpoint, std::span<const std::uint8_t> input) const;
+  void read_jsonl_blocks(std::span<const std::uint8_t> input, std::size_t threads, InputStats &stats, std::vector<TraceRecord> &records);
+  bool read_btr1_blocks(const MappedFile &file, InputStats &stats, std::vector<TraceRecord> &records);
+
+  std::string path_;
+  std::uint64_t fingerprint_ = 0;
+  IndexedFormat format_ = IndexedFormat::Jsonl;
+  std::optional<ReplayCheckpoint> loaded_;
+  bool resumed_ = false;
+  std::vector<ReplayCacheBlock> blocks_read_; // complete blocks read this run
+  std::optional<BlockMark> last_mark_;
+  bool planned_ = false;
+  std::size_t planned_consumed_ = 0;
+  std::optional<ReplayOrderKey> planned_max_key_;
+  std::vector<TraceRecord> planned_pending_;
+};
+
+} // namespace trace_replay
@@ -0,0 +1,80 @@
+#include "trace_replay/seq_tracker.hpp"
+
+#include <algorithm>
+#include <utility>
+
+namespace trace_replay {
+
+SeqCheck SeqTracker::observe(std::uint64_t seq) {
+  SeqCheck check{};
+  check.duplicate = !insert(seq);
+  check.non_monotonic = previous_.has_value() && seq <= *previous_;
+  previous_ = seq;
+  return check;
+}
+
+// Returns false if `seq` was already present.
+bool SeqTracker::insert(std::uint64_t seq) {
+  if (runs_.empty() || seq > runs_.back().hi) {
+    // Pending values are always below the last run, so a new maximum cannot
+    // be a duplicate.
+    if (!runs_.empty() && seq == runs_.back().hi + 1U) {
+      runs_.back().hi = seq;
+    } else {
+      runs_.push_back(Run{seq, seq});
+    }
+    return true;
+  }
+  if (in_runs(seq)) {
+    return false;
+  }
+  const auto it = std::lower_bound(pending_.begin(), pending_.end(), seq);
+  if (it != pending_.end() && *it == seq) {
+    return false;
+  }
+  pending_.insert(it, seq);
+  if (pending_.size() >= kMaxPending) {
+    merge_pending();
+  }
+  return true;
+}
+
+bool SeqTracker::in_runs(std::uint64_t seq) const {
+  // First run whose upper bound reaches seq.
+  const auto it = std::lower_bound(runs_.begin(), runs_.end(), seq, [](const Run &run, std::uint64_t value) { return run.hi < value; });
+  return it != runs_.end() && it->lo <= seq;
+}
+
+void SeqTracker::merge_pending() {
+  std::vector<Run> merged;
+  merged.reserve(runs_.size() + pending_.size());
+  auto append = [&merged](Run run) {
+    if (!merged.empty() && run.lo <= merged.back().hi + 1U) {
+      merged.back().hi = std::max(merged.back().hi, run.hi);
+    } else {
+      merged.push_back(run);
+    }
+  };
+  auto run = runs_.begin();
+  auto value = pending_.begin();
+  while (run != runs_.end() || value != pending_.end()) {
+    if (value == pending_.end() || (run != runs_.end() && run->lo < *value)) {
+      append(*run++);
+    } else {
+      append(Run{*value, *value});
+      ++value;
+    }
+  }
+  runs_ = std::move(merged);
+  pending_.clear();
+}
+
+void SeqTracker::save(StateWriter &out) const {
+  out.put_vector(runs_);
+  out.put_vector(pending_);
+  out.put(previous_);
+}
+
+bool SeqTracker::load(StateReader &in) { return in.get_vector(runs_) && in.get_vector(pending_) && in.get(previous_); }
+
+} // namespace trace_replay
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "trace_replay/state_codec.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+namespace trace_replay {
+
+struct SeqCheck {
+  bool duplicate = false;
+  bool non_monotonic = false;
+};
+
+// Tracks every `seq` seen so far for the loader diagnostics. Captures are
+// expected to be (nearly) increasing, so seen values are kept as sorted,
+// coalesced [lo, hi] runs: an increasing stream costs O(1) per record and
+// one run per gap. Out-of-order values go to a small sorted side buffer that
+// is merged into the runs once it fills.
+class SeqTracker {
+public:
+  // Records `seq` and reports whether it repeats an earlier value and whether
+  // it fails to increase over the previous call.
+  SeqCheck observe(std::uint64_t seq);
+
+  [[nodiscard]] std::size_t run_count() const { return runs_.size(); }
+  [[nodiscard]] std::size_t pending_count() const { return pending_.size(); }
+
+  // Replay cache state (see state_codec.hpp).
+  void save(StateWriter &out) const;
+  bool load(StateReader &in);
+
+private:
+  struct Run {
+    std::uint64_t lo = 0;
+    std::uint64_t hi = 0;
+  };
+
+  static constexpr std::size_t kMaxPending = 4096;
+
+  bool insert(std::uint64_t seq);
+  [[nodiscard]] bool in_runs(std::uint64_t seq) const;
+  void merge_pending();
+
+  std::vector<Run> runs_;
+  std::vector<std::uint64_t> pending_;
+  std::optional<std::uint64_t> previous_;
+};
+
+} // namespace trace_replay
@@ -0,0 +1,161 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <span>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+namespace trace_replay {
+
+// Byte encoding for saved replay state (--replay-cache). Fields are written in
+// native layout: a cache is only ever read back by a build whose fingerprint
+// matches the one that wrote it (see replay_cache.hpp), so nothing here needs
+// to be portable.
+class StateWriter {
+public:
+  template <typename T>
+  void put(const T &value) {
+    static_assert(std::is_trivially_copyable_v<T>, "StateWriter::put needs a trivially copyable type");
+    const auto *bytes = reinterpret_cast<const char *>(&value);
+    bytes_.append(bytes, sizeof(T));
+  }
+
+  template <typename T>
+  void put_vector(const std::vector<T> &values) {
+    static_assert(std::is_trivially_copyable_v<T>, "StateWriter::put_vector needs a trivially copyable type");
+    put<std::uint64_t>(values.size());
+    bytes_.append(reinterpret_cast<const char *>(values.data()), values.size() * sizeof(T));
+  }
+
+  void put_string(std::string_view text) {
+    put<std::uint64_t>(text.size());
+    bytes_.append(text.data(), text.size());
+  }
+
+  template <typename V>
+  void put_map(const std::map<std::int64_t, V> &values) {
+    put<std::uint64_t>(values.size());
+    for (const auto &[key, value] : values) {
+      put(key);
+      put(value);
+    }
+  }
+
+  template <typename V>
+  void put_map(const std::map<std::string, V> &values) {
+    put<std::uint64_t>(values.size());
+    for (const auto &[key, value] : values) {
+      put_string(key);
+      put(value);
+    }
+  }
+
+  [[nodiscard]] const std::string &bytes() const { return bytes_; }
+
+private:
+  std::string bytes_;
+};
+
+// Reads what StateWriter wrote. Every getter returns false (and leaves the
+// reader failed) on a short or inconsistent buffer instead of reading past it.
+class StateReader {
+public:
+  explicit StateReader(std::span<const std::uint8_t> bytes) : bytes_(bytes) {}
+
+  template <typename T>
+  bool get(T &value) {
+    static_assert(std::is_trivially_copyable_v<T>, "StateReader::get needs a trivially copyable type");
+    if (!take(sizeof(T))) {
+      return false;
+    }
+    std::memcpy(&value, bytes_.data() + position_ - sizeof(T), sizeof(T));
+    return true;
+  }
+
+  template <typename T>
+  bool get_vector(std::vector<T> &values) {
+    static_assert(std::is_trivially_copyable_v<T>, "StateReader::get_vector needs a trivially copyable type");
+    std::uint64_t count = 0;
+    if (!get(count) || count > remaining() / sizeof(T) || !take(static_cast<std::size_t>(count) * sizeof(T))) {
+      return fail();
+    }
+    values.resize(static_cast<std::size_t>(count));
+    std::memcpy(values.data(), bytes_.data() + position_ - values.size() * sizeof(T), values.size() * sizeof(T));
+    return true;
+  }
+
+  bool get_string(std::string &text) {
+    std::uint64_t size = 0;
+    if (!get(size) || size > remaining() || !take(static_cast<std::size_t>(size))) {
+      return fail();
+    }
+    text.assign(reinterpret_cast<const char *>(bytes_.data()) + position_ - size, static_cast<std::size_t>(size));
+    return true;
+  }
+
+  template <typename V>
+  bool get_map(std::map<std::int64_t, V> &values) {
+    values.clear();
+    std::uint64_t count = 0;
+    if (!get(count)) {
+      return false;
+    }
+    for (std::uint64_t i = 0; i < count; ++i) {
+      std::int64_t key = 0;
+      V value{};
+      if (!get(key) || !get(value)) {
+        return false;
+      }
+      values.emplace_hint(values.end(), key, value);
+    }
+    return true;
+  }
+
+  template <typename V>
+  bool get_map(std::map<std::string, V> &values) {
+    values.clear();
+    std::uint64_t count = 0;
+    if (!get(count)) {
+      return false;
+    }
+    for (std::uint64_t i = 0; i < count; ++i) {
+      std::string key;
+      V value{};
+      if (!get_string(key) || !get(value)) {
+        return false;
+      }
+      values.emplace_hint(values.end(), std::move(key), value);
+    }
+    return true;
+  }
+
+  [[nodiscard]] bool ok() const { return ok_; }
+  [[nodiscard]] bool at_end() const { return ok_ && position_ == bytes_.size(); }
+
+private:
+  [[nodiscard]] std::size_t remaining() const { return bytes_.size() - position_; }
+
+  bool take(std::size_t size) {
+    if (!ok_ || size > remaining()) {
+      return fail();
+    }
+    position_ += size;
+    return true;
+  }
+
+  bool fail() {
+    ok_ = false;
+    return false;
+  }
+
+  std::span<const std::uint8_t> bytes_;
+  std::size_t position_ = 0;
+  bool ok_ = true;
+};
+
+} // namespace trace_replay
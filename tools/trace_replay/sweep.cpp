@@ -0,0 +1,231 @@
+#include "trace_replay/sweep.hpp"
+
+#include "busarb/ymir_timing.hpp"
+
+#include <algorithm>
+#include <iostream>
+#include <limits>
+
+namespace trace_replay {
+namespace {
+
+enum class SweepAxisKind : std::uint8_t { SameAddressContention, TieTurnaround, Cycles };
+
+struct SweepAxis {
+  std::string key;
+  SweepAxisKind kind = SweepAxisKind::Cycles;
+  std::size_t cycles_slot = 0;
+  std::vector<std::uint32_t> values;
+};
+
+std::optional<std::uint32_t> parse_u32(std::string_view text) {
+  const auto parsed = parse_u64(text);
+  if (!parsed.has_value() || *parsed > std::numeric_limits<std::uint32_t>::max()) {
+    return std::nullopt;
+  }
+  return static_cast<std::uint32_t>(*parsed);
+}
+
+bool parse_axis_key(std::string_view key, SweepAxis &axis) {
+  if (key == "same_address_contention") {
+    axis.kind = SweepAxisKind::SameAddressContention;
+    return true;
+  }
+  if (key == "tie_turnaround") {
+    axis.kind = SweepAxisKind::TieTurnaround;
+    return true;
+  }
+  std::size_t is_write = 0;
+  if (key.starts_with("read:")) {
+    key.remove_prefix(5);
+  } else if (key.starts_with("write:")) {
+    key.remove_prefix(6);
+    is_write = 1;
+  } else {
+    return false;
+  }
+  for (std::size_t region = 0; region < kRegionCount; ++region) {
+    if (region_name(static_cast<Region>(region)) == key) {
+      axis.kind = SweepAxisKind::Cycles;
+      axis.cycles_slot = region * 2U + is_write;
+      return true;
+    }
+  }
+  return false;
+}
+
+bool parse_axis_values(std::string_view text, SweepAxis &axis) {
+  while (!text.empty()) {
+    const std::size_t comma = text.find(',');
+    const std::string_view item = text.substr(0, comma);
+    text = comma == std::string_view::npos ? std::string_view{} : text.substr(comma + 1U);
+
+    const std::size_t dots = item.find("..");
+    const auto lo = parse_u32(item.substr(0, dots));
+    const auto hi = dots == std::string_view::npos ? lo : parse_u32(item.substr(dots + 2U));
+    if (!lo.has_value() || !hi.has_value() || *lo > *hi || *hi - *lo >= kMaxSweepVariants) {
+      return false;
+    }
+    for (std::uint64_t value = *lo; value <= *hi; ++value) {
+      axis.values.push_back(static_cast<std::uint32_t>(value));
+    }
+  }
+  if (axis.values.empty()) {
+    return false;
+  }
+  if (axis.kind == SweepAxisKind::Cycles && std::find(axis.values.begin(), axis.values.end(), 0U) != axis.values.end()) {
+    return false;
+  }
+  return true;
+}
+
+} // namespace
+
+std::optional<std::vector<SweepVariant>> parse_sweep_spec(std::string_view spec) {
+  std::vector<SweepAxis> axes;
+  std::size_t variant_count = 1;
+  while (!spec.empty()) {
+    const std::size_t semicolon = spec.find(';');
+    const std::string_view item = spec.substr(0, semicolon);
+    spec = semicolon == std::string_view::npos ? std::string_view{} : spec.substr(semicolon + 1U);
+    if (item.empty()) {
+      continue;
+    }
+
+    SweepAxis axis;
+    const std::size_t eq = item.find('=');
+    axis.key = std::string(item.substr(0, eq));
+    if (eq == std::string_view::npos || !parse_axis_key(axis.key, axis) || !parse_axis_values(item.substr(eq + 1U), axis)) {
+      std::cerr << "error: invalid --sweep axis '" << item << "'\n";
+      return std::nullopt;
+    }
+    for (const auto &existing : axes) {
+      if (existing.key == axis.key) {
+        std::cerr << "error: --sweep axis '" << axis.key << "' given twice\n";
+        return std::nullopt;
+      }
+    }
+    variant_count *= axis.values.size();
+    if (variant_count > kMaxSweepVariants) {
+      std::cerr << "error: --sweep grid exceeds " << kMaxSweepVariants << " variants\n";
+      return std::nullopt;
+    }
+    axes.push_back(std::move(axis));
+  }
+  if (axes.empty()) {
+    std::cerr << "error: --sweep needs at least one axis\n";
+    return std::nullopt;
+  }
+
+  // Cartesian product; the first axis varies slowest.
+  std::vector<SweepVariant> variants;
+  variants.reserve(variant_count);
+  std::vector<std::size_t> digits(axes.size(), 0U);
+  for (std::size_t n = 0; n < variant_count; ++n) {
+    SweepVariant variant;
+    for (std::size_t a = 0; a < axes.size(); ++a) {
+      const SweepAxis &axis = axes[a];
+      const std::uint32_t value = axis.values[digits[a]];
+      switch (axis.kind) {
+      case SweepAxisKind::SameAddressContention:
+        variant.config.same_address_contention = value;
+        break;
+      case SweepAxisKind::TieTurnaround:
+        variant.config.tie_turnaround = value;
+        break;
+      case SweepAxisKind::Cycles:
+        variant.cycles[axis.cycles_slot] = value;
+        break;
+      }
+      variant.settings.emplace_back(axis.key, value);
+    }
+    variants.push_back(std::move(variant));
+    for (std::size_t a = axes.size(); a-- > 0U;) {
+      if (++digits[a] < axes[a].values.size()) {
+        break;
+      }
+      digits[a] = 0U;
+    }
+  }
+  return variants;
+}
+
+SweepReplay::SweepReplay(std::vector<SweepVariant> variants) : variants_(std::move(variants)) {
+  const std::size_t count = variants_.size();
+  same_address_contention_.reserve(count);
+  tie_turnaround_.reserve(count);
+  cycles_.reserve(count * kRegionCount * 2U);
+  for (const auto &variant : variants_) {
+    same_address_contention_.push_back(variant.config.same_address_contention);
+    tie_turnaround_.push_back(variant.config.tie_turnaround);
+    cycles_.insert(cycles_.end(), variant.cycles.begin(), variant.cycles.end());
+  }
+  bus_free_tick_.assign(count, 0U);
+  final_cumulative_drift_total_.assign(count, 0);
+  agreement_count_.assign(count, 0U);
+  mismatch_count_.assign(count, 0U);
+  known_gap_count_.assign(count, 0U);
+  normalized_agreement_count_.assign(count, 0U);
+  normalized_mismatch_count_.assign(count, 0U);
+}
+
+void SweepReplay::consume(const TraceRecord &record, std::uint32_t observed_wait) {
+  // Everything that does not depend on the variant is computed once; this
+  // mirrors busarb::BasicArbiter::commit_grant and local_model_terms().
+  const bool is_write = record.rw == Rw::W;
+  const std::uint32_t base_service = std::max(1U, busarb::YmirTiming{}.access_cycles(record.addr, is_write, record.size));
+  const LocalModelTerms terms = local_model_terms(record, previous_);
+  const std::size_t cycles_slot = static_cast<std::size_t>(record.region) * 2U + (is_write ? 1U : 0U);
+  const std::uint64_t attempt = record.tick_first_attempt;
+  const auto end_exclusive = static_cast<std::int64_t>(record.tick_complete + 1U);
+  const bool byte_without_retry = record.size == 1U && record.retries == 0U;
+
+  for (std::size_t v = 0; v < variants_.size(); ++v) {
+    const std::uint32_t override_cycles = cycles_[v * kRegionCount * 2U + cycles_slot];
+    const std::uint32_t service = override_cycles != 0U ? override_cycles : base_service;
+    const std::uint32_t contention = terms.contention(same_address_contention_[v]);
+    const std::uint32_t predicted_wait = terms.predicted_wait(same_address_contention_[v], tie_turnaround_[v]);
+    const std::int64_t wait_delta = static_cast<std::int64_t>(predicted_wait) - static_cast<std::int64_t>(observed_wait);
+
+    const std::uint64_t start = std::max(attempt, bus_free_tick_[v]);
+    bus_free_tick_[v] = start + service + contention;
+    const std::int64_t drift_wait = static_cast<std::int64_t>(start) - static_cast<std::int64_t>(attempt);
+    const std::int64_t drift_total = static_cast<std::int64_t>(bus_free_tick_[v]) - end_exclusive;
+    final_cumulative_drift_total_[v] = drift_total;
+
+    if (byte_without_retry && wait_delta > 0) {
+      ++known_gap_count_[v];
+    } else if (drift_wait == 0 && drift_total == 0) {
+      ++agreement_count_[v];
+    } else {
+      ++mismatch_count_[v];
+    }
+    if (wait_delta == 0) {
+      ++normalized_agreement_count_[v];
+    } else {
+      ++normalized_mismatch_count_[v];
+    }
+  }
+  previous_ = record;
+}
+
+std::vector<SweepResult> SweepReplay::ranked() const {
+  std::vector<SweepResult> results;
+  results.reserve(variants_.size());
+  for (std::size_t v = 0; v < variants_.size(); ++v) {
+    results.push_back(SweepResult{v, agreement_count_[v], mismatch_count_[v], known_gap_count_[v], normalized_agreement_count_[v],
+                                  normalized_mismatch_count_[v], final_cumulative_drift_total_[v]});
+  }
+  auto drift_magnitude = [](std::int64_t drift) { return drift < 0 ? std::uint64_t{0} - static_cast<std::uint64_t>(drift) : static_cast<std::uint64_t>(drift); };
+  std::sort(results.begin(), results.end(), [&](const SweepResult &a, const SweepResult &b) {
+    if (a.agreement_count != b.agreement_count) return a.agreement_count > b.agreement_count;
+    if (a.normalized_agreement_count != b.normalized_agreement_count) return a.normalized_agreement_count > b.normalized_agreement_count;
+    const std::uint64_t a_drift = drift_magnitude(a.final_cumulative_drift_total);
+    const std::uint64_t b_drift = drift_magnitude(b.final_cumulative_drift_total);
+    if (a_drift != b_drift) return a_drift < b_drift;
+    return a.variant < b.variant;
+  });
+  return results;
+}
+
+} // namespace trace_replay
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "busarb/busarb.hpp"
+#include "trace_replay/trace_record.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace trace_replay {
+
+// Multi-configuration model replay (--sweep): one pass over the records drives
+// every ArbiterConfig / timing-table variant of a grid, so calibrating the
+// model costs one ingest instead of one per candidate.
+
+inline constexpr std::size_t kMaxSweepVariants = 4096;
+
+struct SweepVariant {
+  busarb::ArbiterConfig config{};
+  // Service cycles indexed [region * 2 + is_write]; 0 keeps ymir_access_cycles.
+  std::array<std::uint32_t, kRegionCount * 2U> cycles{};
+  // The swept axes and their values, in spec order, for reporting.
+  std::vector<std::pair<std::string, std::uint32_t>> settings;
+};
+
+// Parses "axis=values[;axis=values...]" into the cartesian product of the
+// axes. Axes are same_address_contention, tie_turnaround, read:<region> and
+// write:<region> (region names as in the summary, e.g. "read:VDP2"); values
+// are comma-separated decimals or inclusive "A..B" ranges. Cycle overrides
+// must be >= 1. Prints the problem and returns nullopt on a bad spec.
+[[nodiscard]] std::optional<std::vector<SweepVariant>> parse_sweep_spec(std::string_view spec);
+
+struct SweepResult {
+  std::size_t variant = 0;
+  std::size_t agreement_count = 0;
+  std::size_t mismatch_count = 0;
+  std::size_t known_gap_count = 0;
+  std::size_t normalized_agreement_count = 0;
+  std::size_t normalized_mismatch_count = 0;
+  std::int64_t final_cumulative_drift_total = 0;
+};
+
+// Replays every variant side by side. Per-variant state is kept as parallel
+// arrays (struct of arrays): the only arbiter state that differs between
+// variants is the bus-free tick, since the last granted address is the
+// previous record's for all of them. Classification matches the
+// --include-model-comparison counters of a single-config replay.
+class SweepReplay {
+public:
+  explicit SweepReplay(std::vector<SweepVariant> variants);
+
+  // Valid-master records only, in replay order; `observed_wait` is the
+  // record's ymir_wait.
+  void consume(const TraceRecord &record, std::uint32_t observed_wait);
+
+  [[nodiscard]] std::size_t variant_count() const { return variants_.size(); }
+  [[nodiscard]] const SweepVariant &variant(std::size_t index) const { return variants_[index]; }
+
+  // Most agreements first, then most normalized agreements, then smallest
+  // |final drift|, then grid order.
+  [[nodiscard]] std::vector<SweepResult> ranked() const;
+
+private:
+  std::vector<SweepVariant> variants_;
+  std::vector<std::uint32_t> same_address_contention_;
+  std::vector<std::uint32_t> tie_turnaround_;
+  std::vector<std::uint32_t> cycles_; // [variant][region][is_write]
+  std::vector<std::uint64_t> bus_free_tick_;
+  std::vector<std::int64_t> final_cumulative_drift_total_;
+  std::vector<std::size_t> agreement_count_;
+  std::vector<std::size_t> mismatch_count_;
+  std::vector<std::size_t> known_gap_count_;
+  std::vector<std::size_t> normalized_agreement_count_;
+  std::vector<std::size_t> normalized_mismatch_count_;
+  std::optional<TraceRecord> previous_;
+};
+
+} // namespace trace_replay
@@ -0,0 +1,98 @@
+#pragma once
+
+#include "trace_replay/state_codec.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace trace_replay {
+
+// Keeps the k highest-scoring values offered so far in a bounded heap, so a
+// ranking costs O(n log k) time and O(k) memory instead of retaining and
+// sorting every candidate. Equal scores keep offer order (earlier first),
+// which is the order a stable_sort by descending score over all candidates
+// would produce.
+template <typename T>
+class TopK {
+public:
+  explicit TopK(std::size_t k) : k_(k) {}
+
+  void offer(std::uint64_t score, const T &value) {
+    const std::uint64_t order = next_order_++;
+    if (k_ == 0U) {
+      return;
+    }
+    if (heap_.size() < k_) {
+      heap_.push_back(Entry{score, order, value});
+      std::push_heap(heap_.begin(), heap_.end(), better);
+      return;
+    }
+    // A later offer only displaces the current worst entry with a strictly
+    // higher score; on a tie the earlier offer ranks first.
+    if (score <= heap_.front().score) {
+      return;
+    }
+    std::pop_heap(heap_.begin(), heap_.end(), better);
+    heap_.back() = Entry{score, order, value};
+    std::push_heap(heap_.begin(), heap_.end(), better);
+  }
+
+  // Offers everything `later` kept, as if its values had been offered after
+  // all of ours; the result equals one TopK fed both sequences in order.
+  void merge(const TopK &later) {
+    std::vector<Entry> entries = later.heap_;
+    std::sort_heap(entries.begin(), entries.end(), better);
+    for (const auto &entry : entries) {
+      offer(entry.score, entry.value);
+    }
+  }
+
+  [[nodiscard]] std::size_t size() const { return heap_.size(); }
+
+  // Best first.
+  [[nodiscard]] std::vector<T> sorted() const {
+    std::vector<Entry> entries = heap_;
+    std::sort_heap(entries.begin(), entries.end(), better);
+    std::vector<T> out;
+    out.reserve(entries.size());
+    for (auto &entry : entries) {
+      out.push_back(std::move(entry.value));
+    }
+    return out;
+  }
+
+  // Replay cache state (see state_codec.hpp); T must be trivially copyable.
+  // k is fixed by the constructor and checked rather than restored.
+  void save(StateWriter &out) const {
+    out.put(k_);
+    out.put(next_order_);
+    out.put_vector(heap_);
+  }
+
+  bool load(StateReader &in) {
+    std::size_t k = 0;
+    return in.get(k) && k == k_ && in.get(next_order_) && in.get_vector(heap_) && heap_.size() <= k_;
+  }
+
+private:
+  struct Entry {
+    std::uint64_t score = 0;
+    std::uint64_t order = 0;
+    T value{};
+  };
+
+  // Heap comparator: the heap front is the entry every other entry beats.
+  static bool better(const Entry &a, const Entry &b) {
+    if (a.score != b.score) return a.score > b.score;
+    return a.order < b.order;
+  }
+
+  std::size_t k_ = 0;
+  std::uint64_t next_order_ = 0;
+  std::vector<Entry> heap_;
+};
+
+} // namespace trace_replay
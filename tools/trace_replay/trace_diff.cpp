@@ -0,0 +1,289 @@
+#include "trace_replay/quantile_sketch.hpp"
+#include "trace_replay/record_diff.hpp"
+#include "trace_replay/trace_input.hpp"
+#include "trace_replay/trace_record.hpp"
+
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <optional>
+#include <string>
+
+// Compares two captures of the same workload record by record. Both inputs
+// are streamed and merge-joined on seq, so memory stays bounded by a reader
+// batch and a reorder window per side no matter how long the captures are.
+
+namespace {
+
+using trace_replay::DiffBucket;
+using trace_replay::DiffKind;
+using trace_replay::RecordDiff;
+using trace_replay::TraceRecord;
+using trace_replay::json_escape;
+
+struct Options {
+  std::string input_a;
+  std::string input_b;
+  std::optional<std::string> records_output_path;
+  std::optional<std::string> summary_output_path;
+  std::size_t records_limit = std::numeric_limits<std::size_t>::max();
+  std::size_t reorder_window = trace_replay::kDefaultDiffReorderWindow;
+  std::size_t threads = 0; // 0 = hardware concurrency
+};
+
+void print_help() {
+  std::cout << "Usage: trace_diff <a.{jsonl|bin|btr2}|-> <b.{jsonl|bin|btr2}|-> [options]\n"
+            << "  --records-output <path>     Write one JSONL line per differing record ('-' = stdout)\n"
+            << "  --records-limit <N>         Stop writing differing records after N lines (counters still cover all)\n"
+            << "  --summary-output <path>     Write machine-readable summary JSON\n"
+            << "  --reorder-window <N>        Records buffered per input to re-sequence local seq disorder (default 1024)\n"
+            << "  --threads <N>               JSONL parse threads per input (default: hardware concurrency)\n"
+            << "  --help                      Show this help\n"
+            << "Records are joined on seq; deltas are B minus A. Both inputs are streamed, never loaded whole.\n"
+            << "Classification is the wait-based one trace_replay reports without --include-model-comparison.\n";
+}
+
+bool parse_options(int argc, char **argv, Options &opts) {
+  std::size_t positional = 0;
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    if (arg == "--help" || arg == "-h") {
+      print_help();
+      std::exit(0);
+    }
+    if (arg == "--records-output") {
+      if (i + 1 >= argc) return false;
+      opts.records_output_path = argv[++i];
+      continue;
+    }
+    if (arg == "--summary-output") {
+      if (i + 1 >= argc) return false;
+      opts.summary_output_path = argv[++i];
+      continue;
+    }
+    if (arg == "--records-limit") {
+      if (i + 1 >= argc) return false;
+      const auto parsed = trace_replay::parse_u64(argv[++i]);
+      if (!parsed) return false;
+      opts.records_limit = static_cast<std::size_t>(*parsed);
+      continue;
+    }
+    if (arg == "--reorder-window") {
+      if (i + 1 >= argc) return false;
+      const auto parsed = trace_replay::parse_u64(argv[++i]);
+      if (!parsed) return false;
+      opts.reorder_window = static_cast<std::size_t>(*parsed);
+      continue;
+    }
+    if (arg == "--threads") {
+      if (i + 1 >= argc) return false;
+      const auto parsed = trace_replay::parse_u64(argv[++i]);
+      if (!parsed) return false;
+      opts.threads = static_cast<std::size_t>(*parsed);
+      continue;
+    }
+    if (arg == "-" || (!arg.empty() && arg[0] != '-')) {
+      (positional++ == 0 ? opts.input_a : opts.input_b) = arg;
+      continue;
+    }
+    return false;
+  }
+  return positional == 2U && !(opts.input_a == "-" && opts.input_b == "-");
+}
+
+void write_side(std::ostream &out, const std::optional<TraceRecord> &record, const trace_replay::DiffSide &side) {
+  if (!record.has_value()) {
+    out << "null";
+    return;
+  }
+  out << "{\"master\":\"" << json_escape(trace_replay::master_label(record->master)) << "\",\"addr\":\"" << trace_replay::to_hex32(record->addr)
+      << "\",\"rw\":\"" << json_escape(trace_replay::rw_label(record->rw)) << "\",\"size\":" << static_cast<unsigned>(record->size)
+      << ",\"tick_first_attempt\":" << record->tick_first_attempt << ",\"tick_complete\":" << record->tick_complete
+      << ",\"service_cycles\":" << record->service_cycles << ",\"retries\":" << record->retries << ",\"elapsed\":" << side.timing.elapsed
+      << ",\"wait\":" << side.timing.wait << ",\"classification\":\"" << trace_replay::classification_name(side.classification) << "\"}";
+}
+
+void write_record_diff(std::ostream &out, const RecordDiff &diff) {
+  out << "{\"seq\":" << diff.seq << ",\"diff\":\"" << trace_replay::diff_kind_name(diff.kind) << "\",\"region\":\""
+      << json_escape(trace_replay::region_name(diff.region)) << "\",\"a\":";
+  write_side(out, diff.a, diff.side_a);
+  out << ",\"b\":";
+  write_side(out, diff.b, diff.side_b);
+  if (diff.a.has_value() && diff.b.has_value()) {
+    out << ",\"wait_delta\":" << diff.wait_delta << ",\"elapsed_delta\":" << diff.elapsed_delta << ",\"tick_shift\":" << diff.tick_shift
+        << ",\"classification_changed\":" << (diff.classification_changed() ? "true" : "false");
+  }
+  out << "}";
+}
+
+void print_bucket(std::ostream &out, const std::string &label, const DiffBucket &bucket) {
+  out << "  " << label << ": matched=" << bucket.matched << " differing=" << bucket.differing << " only_in_a=" << bucket.only_in_a
+      << " only_in_b=" << bucket.only_in_b << " classification_changes=" << bucket.classification_changes
+      << " wait_delta_sum=" << bucket.wait_delta_sum << " elapsed_delta_sum=" << bucket.elapsed_delta_sum << '\n';
+}
+
+void write_bucket(std::ostream &out, const std::string &label, const DiffBucket &bucket) {
+  out << "{\"name\": \"" << json_escape(label) << "\", \"matched\": " << bucket.matched << ", \"differing\": " << bucket.differing
+      << ", \"only_in_a\": " << bucket.only_in_a << ", \"only_in_b\": " << bucket.only_in_b
+      << ", \"classification_changes\": " << bucket.classification_changes << ", \"wait_delta_sum\": " << bucket.wait_delta_sum
+      << ", \"elapsed_delta_sum\": " << bucket.elapsed_delta_sum << ", \"abs_wait_delta_sum\": " << bucket.abs_wait_delta_sum
+      << ", \"abs_elapsed_delta_sum\": " << bucket.abs_elapsed_delta_sum << "}";
+}
+
+bool touched(const DiffBucket &bucket) { return bucket.matched + bucket.only_in_a + bucket.only_in_b != 0U; }
+
+// Calls fn(label, bucket) for every region, then every master, that saw a record.
+template <typename RegionFn, typename MasterFn>
+void for_each_bucket(const trace_replay::TraceDiffer &differ, RegionFn &&region_fn, MasterFn &&master_fn) {
+  for (std::size_t region = 0; region < trace_replay::kRegionCount; ++region) {
+    if (touched(differ.by_region()[region])) {
+      region_fn(trace_replay::region_name(static_cast<trace_replay::Region>(region)), differ.by_region()[region]);
+    }
+  }
+  differ.by_master().for_each([&](std::size_t id, const DiffBucket &bucket) {
+    master_fn(trace_replay::master_label(static_cast<trace_replay::Master>(id)), bucket);
+  });
+}
+
+void print_summary(std::ostream &out, const trace_replay::TraceDiffer &differ, const trace_replay::InputStats &stats_a,
+                   const trace_replay::InputStats &stats_b) {
+  const DiffBucket &totals = differ.totals();
+  out << "total_events_a: " << stats_a.total_events << '\n';
+  out << "total_events_b: " << stats_b.total_events << '\n';
+  out << "matched: " << totals.matched << '\n';
+  out << "identical: " << differ.identical() << '\n';
+  out << "differing: " << totals.differing << '\n';
+  out << "access_mismatch: " << differ.access_mismatches() << '\n';
+  out << "only_in_a: " << totals.only_in_a << '\n';
+  out << "only_in_b: " << totals.only_in_b << '\n';
+  out << "unaligned_a: " << differ.unaligned_a() << '\n';
+  out << "unaligned_b: " << differ.unaligned_b() << '\n';
+  out << "classification_changes: " << totals.classification_changes << '\n';
+  out << "wait_delta_sum: " << totals.wait_delta_sum << '\n';
+  out << "elapsed_delta_sum: " << totals.elapsed_delta_sum << '\n';
+  out << "elapsed_delta_p50/p90/p99: " << differ.elapsed_deltas().quantile(0.50) << '/' << differ.elapsed_deltas().quantile(0.90) << '/'
+            << differ.elapsed_deltas().quantile(0.99) << '\n';
+  if (const auto &first = differ.first_divergence(); first.has_value()) {
+    out << "first_divergence: seq=" << first->seq << " kind=" << trace_replay::diff_kind_name(first->kind)
+              << " region=" << trace_replay::region_name(first->region) << " wait_delta=" << first->wait_delta
+              << " elapsed_delta=" << first->elapsed_delta << '\n';
+  } else {
+    out << "first_divergence: none\n";
+  }
+  auto print = [&out](const std::string &label, const DiffBucket &bucket) { print_bucket(out, label, bucket); };
+  auto skip = [](const std::string &, const DiffBucket &) {};
+  out << "region_deltas:\n";
+  for_each_bucket(differ, print, skip);
+  out << "master_deltas:\n";
+  for_each_bucket(differ, skip, print);
+}
+
+bool write_summary_json(const std::string &path, const trace_replay::TraceDiffer &differ, const trace_replay::InputStats &stats_a,
+                        const trace_replay::InputStats &stats_b) {
+  std::ofstream out(path);
+  if (!out.is_open()) {
+    std::cerr << "Failed to open summary output path: " << path << '\n';
+    return false;
+  }
+  const DiffBucket &totals = differ.totals();
+  out << "{\n";
+  out << "  \"total_events_a\": " << stats_a.total_events << ",\n";
+  out << "  \"total_events_b\": " << stats_b.total_events << ",\n";
+  out << "  \"malformed_lines_a\": " << stats_a.malformed_lines << ",\n";
+  out << "  \"malformed_lines_b\": " << stats_b.malformed_lines << ",\n";
+  out << "  \"identical\": " << differ.identical() << ",\n";
+  out << "  \"access_mismatch\": " << differ.access_mismatches() << ",\n";
+  out << "  \"unaligned_a\": " << differ.unaligned_a() << ",\n";
+  out << "  \"unaligned_b\": " << differ.unaligned_b() << ",\n";
+  out << "  \"totals\": ";
+  write_bucket(out, "all", totals);
+  out << ",\n";
+  out << "  \"wait_delta_percentiles\": {\"p50\": " << differ.wait_deltas().quantile(0.50) << ", \"p90\": " << differ.wait_deltas().quantile(0.90)
+      << ", \"p99\": " << differ.wait_deltas().quantile(0.99) << "},\n";
+  out << "  \"elapsed_delta_percentiles\": {\"p50\": " << differ.elapsed_deltas().quantile(0.50)
+      << ", \"p90\": " << differ.elapsed_deltas().quantile(0.90) << ", \"p99\": " << differ.elapsed_deltas().quantile(0.99) << "},\n";
+  out << "  \"first_divergence\": ";
+  if (const auto &first = differ.first_divergence(); first.has_value()) {
+    write_record_diff(out, *first);
+  } else {
+    out << "null";
+  }
+  out << ",\n";
+  bool first_entry = true;
+  auto entry = [&](const std::string &label, const DiffBucket &bucket) {
+    out << (first_entry ? "\n    " : ",\n    ");
+    write_bucket(out, label, bucket);
+    first_entry = false;
+  };
+  auto skip = [](const std::string &, const DiffBucket &) {};
+  out << "  \"by_region\": [";
+  for_each_bucket(differ, entry, skip);
+  out << "\n  ],\n";
+  first_entry = true;
+  out << "  \"by_master\": [";
+  for_each_bucket(differ, skip, entry);
+  out << "\n  ]\n";
+  out << "}\n";
+  return true;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  Options options;
+  if (!parse_options(argc, argv, options)) {
+    print_help();
+    return 1;
+  }
+
+  std::ofstream records_file;
+  std::ostream *records_out = nullptr;
+  if (options.records_output_path.has_value()) {
+    if (*options.records_output_path == "-") {
+      records_out = &std::cout;
+    } else {
+      records_file.open(*options.records_output_path);
+      if (!records_file.is_open()) {
+        std::cerr << "Failed to open records output path: " << *options.records_output_path << '\n';
+        return 1;
+      }
+      records_out = &records_file;
+    }
+  }
+
+  trace_replay::InputStats stats_a;
+  trace_replay::InputStats stats_b;
+  auto reader = [&options](const std::string &path, trace_replay::InputStats &stats) {
+    return [&options, &path, &stats](const trace_replay::RecordPuller::Sink &sink) {
+      return trace_replay::read_trace_records(path, options.threads, stats, sink);
+    };
+  };
+  trace_replay::TraceDiffer differ;
+  {
+    trace_replay::RecordPuller side_a(reader(options.input_a, stats_a));
+    trace_replay::RecordPuller side_b(reader(options.input_b, stats_b));
+    std::size_t written = 0;
+    trace_replay::merge_join(
+        [&side_a] { return side_a.next(); }, [&side_b] { return side_b.next(); }, differ,
+        [&](const RecordDiff &diff) {
+          if (records_out != nullptr && diff.kind != DiffKind::Identical && written < options.records_limit) {
+            write_record_diff(*records_out, diff);
+            *records_out << '\n';
+            ++written;
+          }
+        },
+        options.reorder_window);
+    if (!side_a.ok() || !side_b.ok()) {
+      return 1;
+    }
+  }
+
+  // Keep stdout pure JSONL when the differing records go there.
+  print_summary(records_out == &std::cout ? std::cerr : std::cout, differ, stats_a, stats_b);
+  if (options.summary_output_path.has_value() && !write_summary_json(*options.summary_output_path, differ, stats_a, stats_b)) {
+    return 1;
+  }
+  return 0;
+}
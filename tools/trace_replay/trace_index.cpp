@@ -0,0 +1,322 @@
+#include "trace_replay/trace_index.hpp"
+
+#include "trace_replay/replay_cache.hpp"
+
+#include <algorithm>
+#include <array>
+#include <fstream>
+#include <iterator>
+
+namespace trace_replay {
+namespace {
+
+constexpr std::array<std::uint8_t, 4> kTraceIndexMagic = {'T', 'R', 'I', 'X'};
+constexpr std::size_t kFingerprintEdgeBytes = std::size_t{64} << 10U;
+
+void put_u64(std::vector<std::uint8_t> &out, std::uint64_t value) {
+  for (unsigned shift = 0; shift < 64U; shift += 8U) {
+    out.push_back(static_cast<std::uint8_t>(value >> shift));
+  }
+}
+
+std::uint64_t get_u64(const std::uint8_t *p) {
+  std::uint64_t value = 0;
+  for (unsigned i = 0; i < 8U; ++i) {
+    value |= static_cast<std::uint64_t>(p[i]) << (8U * i);
+  }
+  return value;
+}
+
+std::uint32_t get_u32(const std::uint8_t *p) {
+  std::uint32_t value = 0;
+  for (unsigned i = 0; i < 4U; ++i) {
+    value |= static_cast<std::uint32_t>(p[i]) << (8U * i);
+  }
+  return value;
+}
+
+std::span<const std::uint8_t> as_span(std::string_view text) { return {reinterpret_cast<const std::uint8_t *>(text.data()), text.size()}; }
+
+TraceIndexEntry open_entry(std::uint64_t offset, std::uint64_t byte_size, std::uint64_t first_item) {
+  TraceIndexEntry entry{};
+  entry.offset = offset;
+  entry.byte_size = byte_size;
+  entry.first_item = first_item;
+  // Count unknown: any non-zero value keeps the span selectable.
+  entry.record_count = std::numeric_limits<std::uint64_t>::max();
+  entry.max_seq = std::numeric_limits<std::uint64_t>::max();
+  entry.max_tick_complete = std::numeric_limits<std::uint64_t>::max();
+  return entry;
+}
+
+void note_bounds(TraceIndexEntry &entry, const TraceRecord &record) {
+  if (entry.record_count == 0U) {
+    entry.min_seq = entry.max_seq = record.seq;
+    entry.min_tick_complete = entry.max_tick_complete = record.tick_complete;
+  } else {
+    entry.min_seq = std::min(entry.min_seq, record.seq);
+    entry.max_seq = std::max(entry.max_seq, record.seq);
+    entry.min_tick_complete = std::min(entry.min_tick_complete, record.tick_complete);
+    entry.max_tick_complete = std::max(entry.max_tick_complete, record.tick_complete);
+  }
+  ++entry.record_count;
+}
+
+std::optional<TraceIndex> build_jsonl_index(const MappedFile &file, std::size_t ingest_threads) {
+  const std::string_view text(reinterpret_cast<const char *>(file.data()), file.size());
+  const std::vector<std::string_view> chunks = split_jsonl_chunks(text, kTraceIndexSpanBytes);
+  const std::size_t workers = std::min(resolve_ingest_threads(ingest_threads), std::max<std::size_t>(chunks.size(), 1U));
+
+  TraceIndex index{};
+  index.format = IndexedFormat::Jsonl;
+  index.entries.reserve(chunks.size());
+  std::uint64_t line_base = 0;
+  std::vector<JsonlChunkResult> wave(workers);
+  for (std::size_t first = 0; first < chunks.size(); first += workers) {
+    const std::size_t count = std::min(workers, chunks.size() - first);
+    for (std::size_t i = 0; i < count; ++i) {
+      wave[i] = JsonlChunkResult{};
+    }
+    run_parallel(count, [&](std::size_t i) { parse_jsonl_chunk(chunks[first + i], wave[i]); });
+    for (std::size_t i = 0; i < count; ++i) {
+      TraceIndexEntry entry{};
+      entry.offset = static_cast<std::uint64_t>(chunks[first + i].data() - text.data());
+      entry.byte_size = chunks[first + i].size();
+      entry.first_item = line_base;
+      entry.content_hash = block_hash(as_span(chunks[first + i]));
+      for (const auto &rec : wave[i].records) {
+        note_bounds(entry, rec);
+      }
+      index.entries.push_back(entry);
+      line_base += wave[i].line_count;
+    }
+  }
+  return index;
+}
+
+std::optional<TraceIndex> build_btr1_index(const MappedFile &file) {
+  const auto view = open_binary_view_v1(file);
+  if (!view.has_value()) {
+    return std::nullopt;
+  }
+  constexpr std::size_t kRecordsPerEntry = kTraceIndexSpanBytes / sizeof(BinaryTraceRecordV1);
+  TraceIndex index{};
+  index.format = IndexedFormat::Btr1;
+  for (std::size_t begin = 0; begin < view->records.size(); begin += kRecordsPerEntry) {
+    const std::size_t end = std::min(view->records.size(), begin + kRecordsPerEntry);
+    TraceIndexEntry entry{};
+    entry.offset = kBinaryHeaderSize + begin * sizeof(BinaryTraceRecordV1);
+    entry.byte_size = (end - begin) * sizeof(BinaryTraceRecordV1);
+    entry.first_item = begin;
+    entry.content_hash = block_hash(file.bytes().subspan(static_cast<std::size_t>(entry.offset), static_cast<std::size_t>(entry.byte_size)));
+    for (std::size_t i = begin; i < end; ++i) {
+      if (const auto decoded = decode_binary_record(view->records[i], i + 1U)) {
+        note_bounds(entry, *decoded);
+      }
+    }
+    index.entries.push_back(entry);
+  }
+  return index;
+}
+
+} // namespace
+
+std::optional<U64Range> parse_u64_range(std::string_view text) {
+  const std::size_t colon = text.find(':');
+  if (colon == std::string_view::npos || text.find(':', colon + 1U) != std::string_view::npos) {
+    return std::nullopt;
+  }
+  U64Range range{};
+  const std::string_view lo = text.substr(0, colon);
+  const std::string_view hi = text.substr(colon + 1U);
+  if (!lo.empty()) {
+    const auto parsed = parse_u64(lo);
+    if (!parsed) return std::nullopt;
+    range.lo = *parsed;
+  }
+  if (!hi.empty()) {
+    const auto parsed = parse_u64(hi);
+    if (!parsed) return std::nullopt;
+    range.hi = *parsed;
+  }
+  if (range.lo > range.hi) {
+    return std::nullopt;
+  }
+  return range;
+}
+
+std::string trace_index_path(const std::string &input_path) { return input_path + ".tridx"; }
+
+std::uint64_t trace_fingerprint(std::span<const std::uint8_t> bytes) {
+  std::uint64_t hash = 0xcbf29ce484222325ULL;
+  auto mix = [&hash](std::uint8_t byte) {
+    hash ^= byte;
+    hash *= 0x100000001b3ULL;
+  };
+  for (unsigned shift = 0; shift < 64U; shift += 8U) {
+    mix(static_cast<std::uint8_t>(static_cast<std::uint64_t>(bytes.size()) >> shift));
+  }
+  const std::size_t head = std::min(bytes.size(), kFingerprintEdgeBytes);
+  for (std::size_t i = 0; i < head; ++i) {
+    mix(bytes[i]);
+  }
+  for (std::size_t i = std::max(head, bytes.size() - std::min(bytes.size(), kFingerprintEdgeBytes)); i < bytes.size(); ++i) {
+    mix(bytes[i]);
+  }
+  return hash;
+}
+
+std::optional<TraceIndex> build_trace_index(const MappedFile &file, IndexedFormat format, std::size_t ingest_threads) {
+  auto index = format == IndexedFormat::Btr1 ? build_btr1_index(file) : build_jsonl_index(file, ingest_threads);
+  if (index.has_value()) {
+    index->source_size = file.size();
+    index->source_fingerprint = trace_fingerprint(file.bytes());
+    index->source_mtime = file.mtime();
+  }
+  return index;
+}
+
+bool write_trace_index(const std::string &path, const TraceIndex &index) {
+  std::vector<std::uint8_t> bytes;
+  bytes.reserve(kTraceIndexHeaderSize + index.entries.size() * kTraceIndexEntrySize);
+  bytes.insert(bytes.end(), kTraceIndexMagic.begin(), kTraceIndexMagic.end());
+  bytes.push_back(static_cast<std::uint8_t>(kTraceIndexVersion));
+  bytes.push_back(static_cast<std::uint8_t>(kTraceIndexVersion >> 8U));
+  bytes.push_back(static_cast<std::uint8_t>(kTraceIndexHeaderSize));
+  bytes.push_back(0);
+  bytes.push_back(static_cast<std::uint8_t>(index.format));
+  bytes.insert(bytes.end(), 3U, 0);
+  const auto entry_count = static_cast<std::uint32_t>(index.entries.size());
+  for (unsigned shift = 0; shift < 32U; shift += 8U) {
+    bytes.push_back(static_cast<std::uint8_t>(entry_count >> shift));
+  }
+  put_u64(bytes, index.source_size);
+  put_u64(bytes, index.source_fingerprint);
+  put_u64(bytes, index.source_mtime);
+  for (const auto &entry : index.entries) {
+    put_u64(bytes, entry.offset);
+    put_u64(bytes, entry.byte_size);
+    put_u64(bytes, entry.first_item);
+    put_u64(bytes, entry.record_count);
+    put_u64(bytes, entry.min_seq);
+    put_u64(bytes, entry.max_seq);
+    put_u64(bytes, entry.min_tick_complete);
+    put_u64(bytes, entry.max_tick_complete);
+    put_u64(bytes, entry.content_hash);
+  }
+
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  if (!out.is_open()) {
+    return false;
+  }
+  out.write(reinterpret_cast<const char *>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+  return static_cast<bool>(out);
+}
+
+std::optional<TraceIndex> load_trace_index(const std::string &path, const MappedFile &file, IndexedFormat format) {
+  std::ifstream input(path, std::ios::binary);
+  if (!input.is_open()) {
+    return std::nullopt;
+  }
+  const std::vector<std::uint8_t> bytes{std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>()};
+  if (bytes.size() < kTraceIndexHeaderSize || !std::equal(kTraceIndexMagic.begin(), kTraceIndexMagic.end(), bytes.begin())) {
+    return std::nullopt;
+  }
+  const auto version = static_cast<std::uint16_t>(bytes[4] | (bytes[5] << 8U));
+  const auto header_size = static_cast<std::uint16_t>(bytes[6] | (bytes[7] << 8U));
+  if (version != kTraceIndexVersion || header_size != kTraceIndexHeaderSize || bytes[8] != static_cast<std::uint8_t>(format)) {
+    return std::nullopt;
+  }
+  const std::uint32_t entry_count = get_u32(bytes.data() + 12);
+  if (bytes.size() != kTraceIndexHeaderSize + std::size_t{entry_count} * kTraceIndexEntrySize) {
+    return std::nullopt;
+  }
+
+  TraceIndex index{};
+  index.format = format;
+  index.source_size = get_u64(bytes.data() + 16);
+  index.source_fingerprint = get_u64(bytes.data() + 24);
+  index.source_mtime = get_u64(bytes.data() + 32);
+  if (index.source_size != file.size() || index.source_mtime != file.mtime() || index.source_fingerprint != trace_fingerprint(file.bytes())) {
+    return std::nullopt;
+  }
+  index.entries.resize(entry_count);
+  const std::uint8_t *p = bytes.data() + kTraceIndexHeaderSize;
+  for (auto &entry : index.entries) {
+    entry.offset = get_u64(p);
+    entry.byte_size = get_u64(p + 8);
+    entry.first_item = get_u64(p + 16);
+    entry.record_count = get_u64(p + 24);
+    entry.min_seq = get_u64(p + 32);
+    entry.max_seq = get_u64(p + 40);
+    entry.min_tick_complete = get_u64(p + 48);
+    entry.max_tick_complete = get_u64(p + 56);
+    entry.content_hash = get_u64(p + 64);
+    if (entry.offset > file.size() || entry.byte_size > file.size() - entry.offset) {
+      return std::nullopt;
+    }
+    p += kTraceIndexEntrySize;
+  }
+  return index;
+}
+
+bool trace_index_spans_match(const TraceIndex &index, const MappedFile &file, const RecordWindow &window) {
+  for (const auto &entry : index.entries) {
+    if (window_selects(window, entry) &&
+        block_hash(file.bytes().subspan(static_cast<std::size_t>(entry.offset), static_cast<std::size_t>(entry.byte_size))) != entry.content_hash) {
+      return false;
+    }
+  }
+  return true;
+}
+
+TraceIndex whole_file_index(const MappedFile &file, IndexedFormat format) {
+  TraceIndex index{};
+  index.format = format;
+  index.source_size = file.size();
+  if (format == IndexedFormat::Btr1) {
+    if (file.size() > kBinaryHeaderSize) {
+      index.entries.push_back(open_entry(kBinaryHeaderSize, file.size() - kBinaryHeaderSize, 0));
+    }
+    return index;
+  }
+  // Same spans as a built index, so parsing stays parallel and bounded.
+  const std::string_view text(reinterpret_cast<const char *>(file.data()), file.size());
+  std::uint64_t line_base = 0;
+  for (const std::string_view chunk : split_jsonl_chunks(text, kTraceIndexSpanBytes)) {
+    index.entries.push_back(open_entry(static_cast<std::uint64_t>(chunk.data() - text.data()), chunk.size(), line_base));
+    line_base += static_cast<std::uint64_t>(std::count(chunk.begin(), chunk.end(), '\n'));
+    if (chunk.back() != '\n') {
+      ++line_base;
+    }
+  }
+  return index;
+}
+
+std::optional<TraceIndex> resolve_trace_index(const std::string &path, const MappedFile &file, IndexedFormat format,
+                                              const RecordWindow &window, IndexUse use, std::size_t ingest_threads) {
+  if (use == IndexUse::None) {
+    return whole_file_index(file, format);
+  }
+  const std::string sidecar = trace_index_path(path);
+  if (use == IndexUse::Auto) {
+    if (auto loaded = load_trace_index(sidecar, file, format)) {
+      if (trace_index_spans_match(*loaded, file, window)) {
+        return loaded;
+      }
+      std::cerr << "note: trace index " << sidecar << " does not match the input; rebuilding\n";
+    }
+  }
+  auto built = build_trace_index(file, format, ingest_threads);
+  if (!built.has_value()) {
+    return std::nullopt;
+  }
+  if (write_trace_index(sidecar, *built)) {
+    std::cerr << "note: wrote trace index " << sidecar << '\n';
+  } else {
+    std::cerr << "warning: could not write trace index " << sidecar << '\n';
+  }
+  return built;
+}
+
+} // namespace trace_replay
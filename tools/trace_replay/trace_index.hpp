@@ -0,0 +1,267 @@
+#pragma once
+
+#include "trace_replay/btr2.hpp"
+#include "trace_replay/seq_tracker.hpp"
+#include "trace_replay/trace_input.hpp"
+#include "trace_replay/trace_record.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <limits>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace trace_replay {
+
+// Seq/tick windows over a capture, and the sidecar index (<input>.tridx) that
+// lets JSONL and BTR1 window reads seek past spans that cannot match. BTR2
+// files use their own block index instead. See docs/trace_format.md.
+
+// Inclusive [lo, hi] range of u64 values.
+struct U64Range {
+  std::uint64_t lo = 0;
+  std::uint64_t hi = std::numeric_limits<std::uint64_t>::max();
+
+  [[nodiscard]] bool contains(std::uint64_t value) const { return lo <= value && value <= hi; }
+  [[nodiscard]] bool overlaps(std::uint64_t min, std::uint64_t max) const { return min <= hi && lo <= max; }
+};
+
+// Parses "A:B", "A:" or ":B" (inclusive; a missing bound is open).
+[[nodiscard]] std::optional<U64Range> parse_u64_range(std::string_view text);
+
+// Records selected by --seq-range / --tick-range. Ticks are tick_complete,
+// the replay order key.
+struct RecordWindow {
+  std::optional<U64Range> seq;
+  std::optional<U64Range> tick;
+
+  [[nodiscard]] bool active() const { return seq.has_value() || tick.has_value(); }
+  [[nodiscard]] bool contains(const TraceRecord &record) const {
+    return (!seq || seq->contains(record.seq)) && (!tick || tick->contains(record.tick_complete));
+  }
+  [[nodiscard]] bool overlaps(std::uint64_t min_seq, std::uint64_t max_seq, std::uint64_t min_tick, std::uint64_t max_tick) const {
+    return (!seq || seq->overlaps(min_seq, max_seq)) && (!tick || tick->overlaps(min_tick, max_tick));
+  }
+};
+
+inline constexpr std::uint16_t kTraceIndexVersion = 2;
+inline constexpr std::size_t kTraceIndexHeaderSize = 40;
+inline constexpr std::size_t kTraceIndexEntrySize = 72;
+// Target bytes of input covered by one index entry.
+inline constexpr std::size_t kTraceIndexSpanBytes = std::size_t{256} << 10U;
+
+enum class IndexedFormat : std::uint8_t { Jsonl = 0, Btr1 = 1 };
+
+// One contiguous span of the input. For JSONL the span starts at a line
+// boundary and `first_item` is the number of lines before it; for BTR1 it is
+// the index of the span's first record. Bounds cover well-formed records only;
+// an entry with record_count 0 never matches a window. `content_hash` is the
+// block_hash() of the span's bytes, checked before its bounds are trusted.
+struct TraceIndexEntry {
+  std::uint64_t offset = 0;
+  std::uint64_t byte_size = 0;
+  std::uint64_t first_item = 0;
+  std::uint64_t record_count = 0;
+  std::uint64_t min_seq = 0;
+  std::uint64_t max_seq = 0;
+  std::uint64_t min_tick_complete = 0;
+  std::uint64_t max_tick_complete = 0;
+  std::uint64_t content_hash = 0;
+};
+
+[[nodiscard]] inline bool window_selects(const RecordWindow &window, const TraceIndexEntry &entry) {
+  return entry.record_count != 0U && window.overlaps(entry.min_seq, entry.max_seq, entry.min_tick_complete, entry.max_tick_complete);
+}
+
+struct TraceIndex {
+  IndexedFormat format = IndexedFormat::Jsonl;
+  std::uint64_t source_size = 0;
+  std::uint64_t source_fingerprint = 0;
+  std::uint64_t source_mtime = 0;
+  std::vector<TraceIndexEntry> entries;
+};
+
+[[nodiscard]] std::string trace_index_path(const std::string &input_path);
+
+// Cheap staleness check: FNV-1a over the size and the first and last 64 KiB.
+[[nodiscard]] std::uint64_t trace_fingerprint(std::span<const std::uint8_t> bytes);
+
+// Scans the whole input once (JSONL in parallel waves) and records per-span
+// seq/tick bounds. Returns nullopt on a structural error (already reported).
+[[nodiscard]] std::optional<TraceIndex> build_trace_index(const MappedFile &file, IndexedFormat format, std::size_t ingest_threads);
+
+bool write_trace_index(const std::string &path, const TraceIndex &index);
+
+// Returns nullopt if the sidecar is missing, unreadable, malformed or does not
+// match `file` (size, fingerprint or mtime changed).
+[[nodiscard]] std::optional<TraceIndex> load_trace_index(const std::string &path, const MappedFile &file, IndexedFormat format);
+
+// True when every span `window` selects still has its stored content hash.
+// The header checks miss same-size edits that keep the mtime (a copy with
+// preserved timestamps, say) away from the file's ends.
+[[nodiscard]] bool trace_index_spans_match(const TraceIndex &index, const MappedFile &file, const RecordWindow &window);
+
+// A single entry covering the whole input with open bounds, used when window
+// reads run without a sidecar.
+[[nodiscard]] TraceIndex whole_file_index(const MappedFile &file, IndexedFormat format);
+
+enum class IndexUse : std::uint8_t {
+  Auto,  // use a matching sidecar; otherwise build one and try to save it
+  Build, // always rebuild and save the sidecar
+  None,  // scan the whole file, never touch the sidecar
+};
+
+// Resolves the index for a window read of `path` according to `use`. A
+// sidecar whose spans selected by `window` fail trace_index_spans_match() is
+// rebuilt.
+[[nodiscard]] std::optional<TraceIndex> resolve_trace_index(const std::string &path, const MappedFile &file, IndexedFormat format,
+                                                            const RecordWindow &window, IndexUse use, std::size_t ingest_threads);
+
+// Windowed reads only see records inside the window: InputStats and the seq
+// checks cover those records alone, and malformed lines are not attributed
+// to any window (they are neither counted nor reported). Results therefore do
+// not depend on which spans the index let the reader skip.
+template <typename Sink>
+void emit_window_record(const RecordWindow &window, SeqTracker &seq_tracker, InputStats &stats, TraceRecord &&rec, std::uint64_t item,
+                        bool binary, Sink &sink) {
+  if (!window.contains(rec)) {
+    return;
+  }
+  ++stats.total_events;
+  if (binary) {
+    note_binary_seq(seq_tracker, stats, rec.seq, item);
+  } else {
+    const auto seq_check = seq_tracker.observe(rec.seq);
+    if (seq_check.duplicate) {
+      ++stats.duplicate_seq_count;
+      std::cerr << "warning: duplicate seq " << rec.seq << " on line " << item << '\n';
+    }
+    if (seq_check.non_monotonic) {
+      ++stats.non_monotonic_seq_count;
+      std::cerr << "warning: non-monotonic seq " << rec.seq << " on line " << item << '\n';
+    }
+  }
+  sink(std::move(rec));
+}
+
+template <typename Sink>
+bool read_jsonl_window(const MappedFile &file, const TraceIndex &index, const RecordWindow &window, std::size_t ingest_threads,
+                       InputStats &stats, Sink &sink) {
+  std::vector<const TraceIndexEntry *> selected;
+  for (const auto &entry : index.entries) {
+    if (window_selects(window, entry)) {
+      selected.push_back(&entry);
+    }
+  }
+  const std::string_view text(reinterpret_cast<const char *>(file.data()), file.size());
+  const std::size_t workers = std::min(resolve_ingest_threads(ingest_threads), std::max<std::size_t>(selected.size(), 1U));
+  SeqTracker seq_tracker;
+  std::vector<JsonlChunkResult> wave(workers);
+  for (std::size_t first = 0; first < selected.size(); first += workers) {
+    const std::size_t count = std::min(workers, selected.size() - first);
+    for (std::size_t i = 0; i < count; ++i) {
+      wave[i] = JsonlChunkResult{};
+    }
+    run_parallel(count, [&](std::size_t i) {
+      const auto &entry = *selected[first + i];
+      parse_jsonl_chunk(text.substr(static_cast<std::size_t>(entry.offset), static_cast<std::size_t>(entry.byte_size)), wave[i]);
+    });
+    for (std::size_t i = 0; i < count; ++i) {
+      const std::uint64_t line_base = selected[first + i]->first_item;
+      for (auto &rec : wave[i].records) {
+        rec.source_line += line_base;
+        const std::uint64_t line = rec.source_line;
+        emit_window_record(window, seq_tracker, stats, std::move(rec), line, false, sink);
+      }
+    }
+  }
+  return true;
+}
+
+template <typename Sink>
+bool read_btr1_window(const MappedFile &file, const TraceIndex &index, const RecordWindow &window, InputStats &stats, Sink &sink) {
+  const auto view = open_binary_view_v1(file);
+  if (!view.has_value()) {
+    return false;
+  }
+  SeqTracker seq_tracker;
+  for (const auto &entry : index.entries) {
+    if (!window_selects(window, entry)) {
+      continue;
+    }
+    const std::size_t begin = static_cast<std::size_t>(entry.first_item);
+    const std::size_t end = std::min(view->records.size(), begin + static_cast<std::size_t>(entry.byte_size / sizeof(BinaryTraceRecordV1)));
+    for (std::size_t i = begin; i < end; ++i) {
+      auto decoded = decode_binary_record(view->records[i], i + 1U);
+      if (decoded.has_value()) {
+        emit_window_record(window, seq_tracker, stats, std::move(*decoded), i, true, sink);
+      }
+    }
+  }
+  if (view->trailing_bytes != 0U) {
+    std::cerr << "error: truncated binary record at index " << view->records.size() << "\n";
+    return false;
+  }
+  return true;
+}
+
+template <typename Sink>
+bool read_btr2_window(const MappedFile &file, const RecordWindow &window, InputStats &stats, Sink &sink) {
+  const auto view = open_btr2_view(file.bytes());
+  if (!view.has_value()) {
+    return false;
+  }
+  SeqTracker seq_tracker;
+  std::vector<TraceRecord> block_records;
+  std::vector<std::uint32_t> malformed;
+  std::uint64_t first_index = 0;
+  for (std::size_t block = 0; block < view->blocks.size(); ++block) {
+    const auto &info = view->blocks[block];
+    if (window.overlaps(info.min_seq, info.max_seq, info.min_tick_complete, info.max_tick_complete)) {
+      malformed.clear();
+      if (!decode_btr2_block(*view, block, kBtr2AllColumns, first_index, block_records, malformed)) {
+        return false;
+      }
+      auto next_malformed = malformed.begin();
+      for (std::size_t i = 0; i < block_records.size(); ++i) {
+        if (next_malformed != malformed.end() && *next_malformed == i) {
+          ++next_malformed;
+          continue;
+        }
+        emit_window_record(window, seq_tracker, stats, std::move(block_records[i]), first_index + i, true, sink);
+      }
+    }
+    first_index += info.record_count;
+  }
+  return true;
+}
+
+// Streams the records of `path` that fall inside `window`, in file order.
+template <typename Sink>
+bool read_trace_window(const std::string &path, const RecordWindow &window, IndexUse use, std::size_t ingest_threads, InputStats &stats,
+                       Sink &&sink) {
+  MappedFile file;
+  if (!file.open(path)) {
+    std::cerr << "Failed to open input file: " << path << '\n';
+    return false;
+  }
+  if (is_binary_input(path) && has_btr2_magic(file.bytes())) {
+    return read_btr2_window(file, window, stats, sink);
+  }
+  const IndexedFormat format = is_binary_input(path) ? IndexedFormat::Btr1 : IndexedFormat::Jsonl;
+  const auto index = resolve_trace_index(path, file, format, window, use, ingest_threads);
+  if (!index.has_value()) {
+    return false;
+  }
+  if (format == IndexedFormat::Btr1) {
+    return read_btr1_window(file, *index, window, stats, sink);
+  }
+  return read_jsonl_window(file, *index, window, ingest_threads, stats, sink);
+}
+
+} // namespace trace_replay
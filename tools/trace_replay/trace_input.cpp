@@ -0,0 +1,386 @@
+#include "trace_replay/trace_input.hpp"
+
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define SATURNIS_TRACE_REPLAY_HAS_MMAP 1
+#else
+#define SATURNIS_TRACE_REPLAY_HAS_MMAP 0
+#endif
+
+namespace trace_replay {
+namespace {
+
+bool ends_with(const std::string &text, std::string_view suffix) {
+  return text.size() >= suffix.size() && std::string_view(text).substr(text.size() - suffix.size()) == suffix;
+}
+
+} // namespace
+
+MappedFile &MappedFile::operator=(MappedFile &&other) noexcept {
+  if (this != &other) {
+    release();
+    data_ = std::exchange(other.data_, nullptr);
+    size_ = std::exchange(other.size_, 0U);
+    mtime_ = std::exchange(other.mtime_, 0U);
+    mapped_ = std::exchange(other.mapped_, false);
+    fallback_ = std::move(other.fallback_);
+  }
+  return *this;
+}
+
+bool MappedFile::open(const std::string &path) {
+  release();
+  std::error_code ec;
+  const auto stamp = std::filesystem::last_write_time(path, ec);
+  mtime_ = ec ? 0U : static_cast<std::uint64_t>(stamp.time_since_epoch().count());
+#if SATURNIS_TRACE_REPLAY_HAS_MMAP
+  const int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+  struct stat st {};
+  if (::fstat(fd, &st) != 0) {
+    ::close(fd);
+    return false;
+  }
+  size_ = static_cast<std::size_t>(st.st_size);
+  if (size_ > 0U) {
+    void *addr = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (addr == MAP_FAILED) {
+      ::close(fd);
+      size_ = 0U;
+      return false;
+    }
+    ::madvise(addr, size_, MADV_SEQUENTIAL);
+    data_ = static_cast<const std::uint8_t *>(addr);
+    mapped_ = true;
+  }
+  ::close(fd);
+  return true;
+#else
+  std::ifstream input(path, std::ios::binary);
+  if (!input.is_open()) {
+    return false;
+  }
+  fallback_.assign(std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>());
+  data_ = reinterpret_cast<const std::uint8_t *>(fallback_.data());
+  size_ = fallback_.size();
+  return true;
+#endif
+}
+
+void MappedFile::release() {
+#if SATURNIS_TRACE_REPLAY_HAS_MMAP
+  if (mapped_) {
+    ::munmap(const_cast<std::uint8_t *>(data_), size_);
+  }
+#endif
+  data_ = nullptr;
+  size_ = 0U;
+  mtime_ = 0U;
+  mapped_ = false;
+  fallback_.clear();
+}
+
+StreamSource::~StreamSource() {
+#if SATURNIS_TRACE_REPLAY_HAS_MMAP
+  if (owns_fd_) {
+    ::close(fd_);
+  }
+#endif
+}
+
+bool StreamSource::open(const std::string &path) {
+#if SATURNIS_TRACE_REPLAY_HAS_MMAP
+  if (path == "-") {
+    fd_ = STDIN_FILENO;
+    return true;
+  }
+  fd_ = ::open(path.c_str(), O_RDONLY);
+  owns_fd_ = fd_ >= 0;
+  return owns_fd_;
+#else
+  if (path == "-") {
+    stream_ = &std::cin;
+    return true;
+  }
+  owned_stream_ = std::make_unique<std::ifstream>(path, std::ios::binary);
+  stream_ = owned_stream_.get();
+  return static_cast<bool>(*stream_);
+#endif
+}
+
+std::size_t StreamSource::read(std::uint8_t *out, std::size_t capacity) {
+#if SATURNIS_TRACE_REPLAY_HAS_MMAP
+  while (true) {
+    const ::ssize_t n = ::read(fd_, out, capacity);
+    if (n >= 0) {
+      return static_cast<std::size_t>(n);
+    }
+    if (errno != EINTR) {
+      failed_ = true;
+      return 0U;
+    }
+  }
+#else
+  // Without POSIX reads this blocks until `capacity` bytes or end of input.
+  stream_->read(reinterpret_cast<char *>(out), static_cast<std::streamsize>(capacity));
+  if (stream_->bad()) {
+    failed_ = true;
+  }
+  return static_cast<std::size_t>(stream_->gcount());
+#endif
+}
+
+bool is_stream_input(const std::string &path) {
+  if (path == "-") {
+    return true;
+  }
+  std::error_code ec;
+  const auto status = std::filesystem::status(path, ec);
+  return !ec && std::filesystem::exists(status) && !std::filesystem::is_regular_file(status) && !std::filesystem::is_directory(status);
+}
+
+void parse_jsonl_chunk(std::string_view chunk, JsonlChunkResult &out) {
+  std::size_t pos = 0;
+  while (pos < chunk.size()) {
+    std::size_t end = chunk.find('\n', pos);
+    if (end == std::string_view::npos) {
+      end = chunk.size();
+    }
+    ++out.line_count;
+    if (end != pos) {
+      ++out.nonempty_lines;
+      auto rec = trace_replay::parse_record(chunk.substr(pos, end - pos), out.line_count);
+      if (rec.has_value()) {
+        out.records.push_back(*rec);
+      } else {
+        out.malformed_lines.push_back(out.line_count);
+      }
+    }
+    pos = end + 1U;
+  }
+}
+
+std::vector<std::string_view> split_jsonl_chunks(std::string_view text, std::size_t target) {
+  std::vector<std::string_view> chunks;
+  std::size_t start = 0;
+  while (start < text.size()) {
+    std::size_t end = text.size();
+    if (text.size() - start > target) {
+      const std::size_t newline = text.find('\n', start + target - 1U);
+      end = newline == std::string_view::npos ? text.size() : newline + 1U;
+    }
+    chunks.push_back(text.substr(start, end - start));
+    start = end;
+  }
+  return chunks;
+}
+
+std::size_t resolve_ingest_threads(std::size_t requested) {
+  if (requested != 0U) {
+    return requested;
+  }
+  const unsigned hw = std::thread::hardware_concurrency();
+  return hw == 0U ? 1U : static_cast<std::size_t>(hw);
+}
+
+WorkerPool::~WorkerPool() {
+  {
+    const std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  work_ready_.notify_all();
+  for (auto &worker : workers_) {
+    worker.join();
+  }
+}
+
+WorkerPool &WorkerPool::shared() {
+  static WorkerPool pool;
+  return pool;
+}
+
+std::size_t WorkerPool::claim(Job &job) {
+  const std::size_t index = job.next++;
+  if (job.next == job.count) {
+    queue_.erase(std::find(queue_.begin(), queue_.end(), &job));
+  }
+  return index;
+}
+
+void WorkerPool::run(std::size_t count, Task task, void *ctx) {
+  if (count == 0U) {
+    return;
+  }
+  Job job{task, ctx, count, 0, count};
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (workers_.size() + 1U < count) {
+    workers_.emplace_back([this] { worker_loop(); });
+  }
+  queue_.push_back(&job);
+  work_ready_.notify_all();
+  while (job.next < job.count) {
+    const std::size_t index = claim(job);
+    lock.unlock();
+    task(ctx, index);
+    lock.lock();
+    --job.remaining;
+  }
+  job_done_.wait(lock, [&job] { return job.remaining == 0U; });
+}
+
+void WorkerPool::worker_loop() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  for (;;) {
+    work_ready_.wait(lock, [this] { return stopping_ || !queue_.empty(); });
+    if (stopping_) {
+      return;
+    }
+    Job &job = *queue_.front();
+    const std::size_t index = claim(job);
+    lock.unlock();
+    job.task(job.ctx, index);
+    lock.lock();
+    if (--job.remaining == 0U) {
+      job_done_.notify_all();
+    }
+  }
+}
+
+bool check_btr1_header(std::span<const std::uint8_t> header) {
+  if (header.size() < kBinaryHeaderSize) {
+    std::cerr << "error: truncated binary header\n";
+    return false;
+  }
+  if (!(header[0] == 'B' && header[1] == 'T' && header[2] == 'R' && header[3] == '1')) {
+    std::cerr << "error: invalid binary magic (expected BTR1)\n";
+    return false;
+  }
+  const std::uint16_t version = static_cast<std::uint16_t>(header[4] | (header[5] << 8));
+  const std::uint16_t record_size = static_cast<std::uint16_t>(header[6] | (header[7] << 8));
+  if (version != 1) {
+    std::cerr << "error: unsupported binary trace version " << version << " (expected 1)\n";
+    return false;
+  }
+  if (record_size != sizeof(BinaryTraceRecordV1)) {
+    std::cerr << "error: unsupported binary record size " << record_size << " (expected " << sizeof(BinaryTraceRecordV1) << ")\n";
+    return false;
+  }
+  return true;
+}
+
+std::optional<BinaryTraceViewV1> open_binary_view_v1(const MappedFile &file) {
+  if (!check_btr1_header(file.bytes())) {
+    return std::nullopt;
+  }
+
+  // The 8-byte header keeps every record 8-byte aligned relative to the page-aligned mapping.
+  const std::size_t payload = file.size() - kBinaryHeaderSize;
+  BinaryTraceViewV1 view{};
+  view.records = std::span<const BinaryTraceRecordV1>(reinterpret_cast<const BinaryTraceRecordV1 *>(file.data() + kBinaryHeaderSize),
+                                                      payload / sizeof(BinaryTraceRecordV1));
+  view.trailing_bytes = payload % sizeof(BinaryTraceRecordV1);
+  return view;
+}
+
+void note_binary_seq(SeqTracker &seq_tracker, InputStats &stats, std::uint64_t seq, std::uint64_t index) {
+  const auto seq_check = seq_tracker.observe(seq);
+  if (seq_check.duplicate) {
+    ++stats.duplicate_seq_count;
+    std::cerr << "warning: duplicate seq " << seq << " in binary record " << index << '\n';
+  }
+  if (seq_check.non_monotonic) {
+    ++stats.non_monotonic_seq_count;
+    std::cerr << "warning: non-monotonic seq " << seq << " in binary record " << index << '\n';
+  }
+}
+
+bool is_binary_input(const std::string &path) {
+  return ends_with(path, ".bin") || ends_with(path, ".btr2");
+}
+
+RecordPuller::RecordPuller(Reader reader) : reader_(std::move(reader)) {
+  filling_.reserve(kBatchRecords);
+  thread_ = std::thread([this] { produce(); });
+}
+
+RecordPuller::~RecordPuller() {
+  {
+    const std::lock_guard<std::mutex> lock(mutex_);
+    cancelled_ = true;
+  }
+  wake_.notify_all();
+  thread_.join();
+}
+
+const TraceRecord *RecordPuller::next() {
+  if (position_ < current_.size()) {
+    return &current_[position_++];
+  }
+  if (done_) {
+    return nullptr;
+  }
+  std::unique_lock<std::mutex> lock(mutex_);
+  requested_ = true;
+  wake_.notify_all();
+  wake_.wait(lock, [this] { return delivered_; });
+  delivered_ = false;
+  current_.swap(ready_);
+  ready_.clear();
+  position_ = 0;
+  if (finished_) {
+    done_ = true;
+    ok_ = reader_ok_;
+  }
+  lock.unlock();
+  return position_ < current_.size() ? &current_[position_++] : nullptr;
+}
+
+void RecordPuller::produce() {
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    wake_.wait(lock, [this] { return requested_ || cancelled_; });
+    if (cancelled_) {
+      return;
+    }
+  }
+  const bool ok = reader_([this](const TraceRecord &record) {
+    filling_.push_back(record);
+    if (filling_.size() == kBatchRecords) {
+      std::unique_lock<std::mutex> lock(mutex_);
+      hand_off(lock, false);
+    }
+  });
+  std::unique_lock<std::mutex> lock(mutex_);
+  reader_ok_ = ok;
+  hand_off(lock, true);
+}
+
+// Publishes the filled batch to a waiting next() and, unless this was the
+// last one, parks the reader until the consumer asks again. A cancelled
+// puller drops records until its reader returns.
+void RecordPuller::hand_off(std::unique_lock<std::mutex> &lock, bool finished) {
+  if (cancelled_) {
+    filling_.clear();
+    return;
+  }
+  ready_.swap(filling_);
+  requested_ = false;
+  delivered_ = true;
+  finished_ = finished;
+  wake_.notify_all();
+  if (!finished) {
+    wake_.wait(lock, [this] { return requested_ || cancelled_; });
+  }
+}
+
+} // namespace trace_replay
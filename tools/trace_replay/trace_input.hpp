@@ -0,0 +1,525 @@
+#pragma once
+
+#include "trace_replay/btr2.hpp"
+#include "trace_replay/seq_tracker.hpp"
+#include "trace_replay/trace_record.hpp"
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace trace_replay {
+
+// Shared capture loaders for trace_replay and trace_pack. Every reader streams
+// well-formed records to a sink in input order and reports diagnostics the
+// same way regardless of format.
+
+struct InputStats {
+  std::size_t total_events = 0;
+  std::size_t malformed_lines = 0;
+  std::size_t duplicate_seq_count = 0;
+  std::size_t non_monotonic_seq_count = 0;
+};
+
+// Read-only view of a whole input file. Uses mmap where available so large
+// captures are paged in on demand instead of copied through an ifstream.
+class MappedFile {
+public:
+  MappedFile() = default;
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+  MappedFile(MappedFile &&other) noexcept { *this = std::move(other); }
+  MappedFile &operator=(MappedFile &&other) noexcept;
+  ~MappedFile() { release(); }
+
+  bool open(const std::string &path);
+
+  [[nodiscard]] const std::uint8_t *data() const { return data_; }
+  [[nodiscard]] std::size_t size() const { return size_; }
+  [[nodiscard]] std::span<const std::uint8_t> bytes() const { return {data_, size_}; }
+  // Last-write stamp at open(), in filesystem clock ticks; 0 if unknown.
+  [[nodiscard]] std::uint64_t mtime() const { return mtime_; }
+
+private:
+  void release();
+
+  const std::uint8_t *data_ = nullptr;
+  std::size_t size_ = 0U;
+  std::uint64_t mtime_ = 0U;
+  bool mapped_ = false;
+  std::vector<char> fallback_;
+};
+
+// Sequential reader for inputs that cannot be mapped: "-" (stdin), FIFOs and
+// character devices. read() returns as soon as any bytes are available, so a
+// capture that is still being written is processed as it arrives.
+class StreamSource {
+public:
+  StreamSource() = default;
+  StreamSource(const StreamSource &) = delete;
+  StreamSource &operator=(const StreamSource &) = delete;
+  ~StreamSource();
+
+  bool open(const std::string &path);
+  // Returns the number of bytes read, 0 at end of input or on error.
+  std::size_t read(std::uint8_t *out, std::size_t capacity);
+  [[nodiscard]] bool failed() const { return failed_; }
+
+private:
+  int fd_ = -1;
+  bool owns_fd_ = false;
+  bool failed_ = false;
+  std::unique_ptr<std::istream> owned_stream_;
+  std::istream *stream_ = nullptr;
+};
+
+// True for "-" and for paths that exist but are not regular files.
+[[nodiscard]] bool is_stream_input(const std::string &path);
+
+// Bytes requested per read() on stream inputs. Memory stays bounded by this
+// plus the longest line.
+inline constexpr std::size_t kStreamReadBytes = std::size_t{1} << 20U;
+
+// Chunk size bounds for parallel JSONL ingest: small files still spread over
+// every worker, large ones are processed in waves of at most 4 MiB per worker.
+inline constexpr std::size_t kMinJsonlChunkBytes = std::size_t{64} << 10U;
+inline constexpr std::size_t kMaxJsonlChunkBytes = std::size_t{4} << 20U;
+
+// Parse output of one newline-aligned JSONL chunk. Line numbers are relative
+// to the chunk (first line is 1) until the chunk is merged.
+struct JsonlChunkResult {
+  std::vector<TraceRecord> records;
+  std::vector<std::size_t> malformed_lines;
+  std::size_t nonempty_lines = 0;
+  std::size_t line_count = 0;
+};
+
+// Same line splitting as std::getline: '\n' terminates a line, a final line
+// without a newline still counts, and '\r' is left in place.
+void parse_jsonl_chunk(std::string_view chunk, JsonlChunkResult &out);
+
+// Splits [0, text.size()) into spans of roughly `target` bytes that each end
+// just past a newline (or at end of input).
+[[nodiscard]] std::vector<std::string_view> split_jsonl_chunks(std::string_view text, std::size_t target);
+
+// 0 selects std::thread::hardware_concurrency().
+[[nodiscard]] std::size_t resolve_ingest_threads(std::size_t requested);
+
+// Process-wide workers shared by every parallel stage: ingest waves, index
+// builds, replay segments and block encoding. Threads start on first use and
+// live until exit, so a stage that runs thousands of waves does not create
+// and join threads for each one. run() may be called from several threads at
+// once (trace_diff reads both inputs in parallel) and from inside a task; the
+// caller works through its own indices too, so it never waits on a task that
+// no thread has picked up.
+class WorkerPool {
+public:
+  using Task = void (*)(void *ctx, std::size_t index);
+
+  WorkerPool() = default;
+  WorkerPool(const WorkerPool &) = delete;
+  WorkerPool &operator=(const WorkerPool &) = delete;
+  ~WorkerPool();
+
+  [[nodiscard]] static WorkerPool &shared();
+
+  // Runs task(ctx, i) for i in [0, count) on the caller and up to count - 1
+  // workers; returns when all of them have finished.
+  void run(std::size_t count, Task task, void *ctx);
+
+private:
+  struct Job {
+    Task task = nullptr;
+    void *ctx = nullptr;
+    std::size_t count = 0;
+    std::size_t next = 0;      // first index no thread has claimed
+    std::size_t remaining = 0; // indices not yet finished
+  };
+
+  void worker_loop();
+  // Claims the next index of `job` (mutex_ held) and drops the job from the
+  // queue once every index is claimed.
+  std::size_t claim(Job &job);
+
+  std::mutex mutex_;
+  std::condition_variable work_ready_;
+  std::condition_variable job_done_;
+  std::deque<Job *> queue_;
+  std::vector<std::thread> workers_;
+  bool stopping_ = false;
+};
+
+// Runs fn(i) for i in [0, count) on the shared WorkerPool and waits for all
+// of them.
+template <typename Fn>
+void run_parallel(std::size_t count, Fn &&fn) {
+  if (count == 1U) {
+    fn(std::size_t{0});
+    return;
+  }
+  using Callable = std::remove_reference_t<Fn>;
+  WorkerPool::shared().run(
+      count, [](void *ctx, std::size_t index) { (*static_cast<Callable *>(ctx))(index); },
+      const_cast<void *>(static_cast<const void *>(std::addressof(fn))));
+}
+
+// Folds parsed chunks back into file order: rebases line numbers, reports
+// malformed lines and seq problems, and forwards records to the sink.
+class JsonlChunkMerger {
+public:
+  explicit JsonlChunkMerger(InputStats &stats) : stats_(stats) {}
+  // Continues a read that stopped after `line_base` lines (replay cache).
+  JsonlChunkMerger(InputStats &stats, SeqTracker seq_tracker, std::size_t line_base)
+      : stats_(stats), seq_tracker_(std::move(seq_tracker)), line_base_(line_base) {}
+
+  template <typename Sink>
+  void merge(JsonlChunkResult &chunk, Sink &sink) {
+    stats_.total_events += chunk.nonempty_lines;
+    auto malformed = chunk.malformed_lines.begin();
+    auto report_malformed_before = [&](std::size_t local_line) {
+      for (; malformed != chunk.malformed_lines.end() && *malformed < local_line; ++malformed) {
+        ++stats_.malformed_lines;
+        std::cerr << "warning: malformed line " << (line_base_ + *malformed) << " skipped\n";
+      }
+    };
+    for (auto &rec : chunk.records) {
+      report_malformed_before(rec.source_line);
+      rec.source_line += line_base_;
+      const auto seq_check = seq_tracker_.observe(rec.seq);
+      if (seq_check.duplicate) {
+        ++stats_.duplicate_seq_count;
+        std::cerr << "warning: duplicate seq " << rec.seq << " on line " << rec.source_line << '\n';
+      }
+      if (seq_check.non_monotonic) {
+        ++stats_.non_monotonic_seq_count;
+        std::cerr << "warning: non-monotonic seq " << rec.seq << " on line " << rec.source_line << '\n';
+      }
+      sink(std::move(rec));
+    }
+    report_malformed_before(chunk.line_count + 1U);
+    line_base_ += chunk.line_count;
+  }
+
+  [[nodiscard]] const SeqTracker &seq_tracker() const { return seq_tracker_; }
+  [[nodiscard]] std::size_t line_base() const { return line_base_; }
+
+private:
+  InputStats &stats_;
+  SeqTracker seq_tracker_;
+  std::size_t line_base_ = 0;
+};
+
+// Parses `chunks` in waves of up to `workers` chunks on worker threads and
+// merges each wave in chunk order before starting the next.
+template <typename Sink>
+void parse_jsonl_waves(std::span<const std::string_view> chunks, std::size_t workers, JsonlChunkMerger &merger, Sink &sink) {
+  workers = std::min(workers, std::max<std::size_t>(chunks.size(), 1U));
+  std::vector<JsonlChunkResult> wave(workers);
+  for (std::size_t first = 0; first < chunks.size(); first += workers) {
+    const std::size_t count = std::min(workers, chunks.size() - first);
+    for (std::size_t i = 0; i < count; ++i) {
+      wave[i] = JsonlChunkResult{};
+    }
+    run_parallel(count, [&](std::size_t i) { parse_jsonl_chunk(chunks[first + i], wave[i]); });
+    for (std::size_t i = 0; i < count; ++i) {
+      merger.merge(wave[i], sink);
+    }
+  }
+}
+
+// Streams each well-formed JSONL record to `sink` in input order. The file is
+// parsed in waves of newline-aligned chunks, one chunk per worker; each wave is
+// merged back in chunk order before the next starts, so warnings, InputStats
+// and record order match a sequential read while memory stays bounded by the
+// wave size.
+template <typename Sink>
+bool read_jsonl_records(const std::string &path, std::size_t ingest_threads, InputStats &stats, Sink &&sink) {
+  MappedFile file;
+  if (!file.open(path)) {
+    std::cerr << "Failed to open input file: " << path << '\n';
+    return false;
+  }
+  const std::string_view text(reinterpret_cast<const char *>(file.data()), file.size());
+  const std::size_t threads = resolve_ingest_threads(ingest_threads);
+  const std::size_t chunk_bytes = std::clamp(text.size() / threads, kMinJsonlChunkBytes, kMaxJsonlChunkBytes);
+  const std::vector<std::string_view> chunks = split_jsonl_chunks(text, chunk_bytes);
+  JsonlChunkMerger merger(stats);
+  parse_jsonl_waves(chunks, threads, merger, sink);
+  return true;
+}
+
+inline constexpr std::size_t kBinaryHeaderSize = 8U;
+
+// Checks the BTR1 magic, version and record size; prints the error on failure.
+[[nodiscard]] bool check_btr1_header(std::span<const std::uint8_t> header);
+
+// Typed in-place view over a BTR1 file. The header is validated once; records
+// are then read straight out of the mapping without per-record copies.
+struct BinaryTraceViewV1 {
+  std::span<const BinaryTraceRecordV1> records;
+  // Trailing bytes that do not form a whole record (truncated capture).
+  std::size_t trailing_bytes = 0U;
+};
+
+[[nodiscard]] std::optional<BinaryTraceViewV1> open_binary_view_v1(const MappedFile &file);
+
+// Shared duplicate/non-monotonic bookkeeping for binary inputs, which report
+// record indices instead of line numbers.
+void note_binary_seq(SeqTracker &seq_tracker, InputStats &stats, std::uint64_t seq, std::uint64_t index);
+
+// Streams each well-formed BTR1 record to `sink` in file order.
+template <typename Sink>
+bool read_btr1_records(const MappedFile &file, InputStats &stats, Sink &&sink) {
+  const auto view = open_binary_view_v1(file);
+  if (!view.has_value()) {
+    return false;
+  }
+
+  SeqTracker seq_tracker;
+  for (std::size_t index = 0; index < view->records.size(); ++index) {
+    const BinaryTraceRecordV1 &raw = view->records[index];
+    ++stats.total_events;
+
+    auto decoded = decode_binary_record(raw, index + 1);
+    if (!decoded.has_value()) {
+      ++stats.malformed_lines;
+      std::cerr << "warning: malformed binary record at index " << index << " skipped\n";
+      continue;
+    }
+    note_binary_seq(seq_tracker, stats, decoded->seq, index);
+    sink(std::move(*decoded));
+  }
+  if (view->trailing_bytes != 0U) {
+    std::cerr << "error: truncated binary record at index " << view->records.size() << "\n";
+    return false;
+  }
+  return true;
+}
+
+// Streams each well-formed BTR2 record to `sink` in file order, decoding one
+// block at a time.
+template <typename Sink>
+bool read_btr2_records(const MappedFile &file, InputStats &stats, Sink &&sink) {
+  const auto view = open_btr2_view(file.bytes());
+  if (!view.has_value()) {
+    return false;
+  }
+
+  SeqTracker seq_tracker;
+  std::vector<TraceRecord> block_records;
+  std::vector<std::uint32_t> malformed;
+  std::uint64_t first_index = 0;
+  for (std::size_t block = 0; block < view->blocks.size(); ++block) {
+    malformed.clear();
+    if (!decode_btr2_block(*view, block, kBtr2AllColumns, first_index, block_records, malformed)) {
+      return false;
+    }
+    auto next_malformed = malformed.begin();
+    for (std::size_t i = 0; i < block_records.size(); ++i) {
+      const std::uint64_t index = first_index + i;
+      ++stats.total_events;
+      if (next_malformed != malformed.end() && *next_malformed == i) {
+        ++next_malformed;
+        ++stats.malformed_lines;
+        std::cerr << "warning: malformed binary record at index " << index << " skipped\n";
+        continue;
+      }
+      note_binary_seq(seq_tracker, stats, block_records[i].seq, index);
+      sink(std::move(block_records[i]));
+    }
+    first_index += block_records.size();
+  }
+  return true;
+}
+
+// Streams each well-formed BTR1/BTR2 record to `sink`; the version is taken
+// from the file magic.
+template <typename Sink>
+bool read_binary_records(const std::string &path, InputStats &stats, Sink &&sink) {
+  MappedFile file;
+  if (!file.open(path)) {
+    std::cerr << "Failed to open input file: " << path << '\n';
+    return false;
+  }
+  if (has_btr2_magic(file.bytes())) {
+    return read_btr2_records(file, stats, std::forward<Sink>(sink));
+  }
+  return read_btr1_records(file, stats, std::forward<Sink>(sink));
+}
+
+[[nodiscard]] bool is_binary_input(const std::string &path);
+
+// Streams records from a non-seekable input. The format is sniffed from the
+// first bytes: BTR1 by magic, anything else as JSONL. BTR2 is rejected because
+// its block index sits at the end of the file. JSONL diagnostics and record
+// order match read_jsonl_records; BTR1 ones match read_btr1_records.
+template <typename Sink>
+bool read_stream_records(const std::string &path, std::size_t ingest_threads, InputStats &stats, Sink &&sink) {
+  StreamSource source;
+  if (!source.open(path)) {
+    std::cerr << "Failed to open input stream: " << path << '\n';
+    return false;
+  }
+  std::vector<std::uint8_t> buffer(kStreamReadBytes);
+  std::size_t filled = 0;
+  bool eof = false;
+  auto fill = [&] {
+    if (buffer.size() - filled < kStreamReadBytes) {
+      buffer.resize(filled + kStreamReadBytes);
+    }
+    const std::size_t n = source.read(buffer.data() + filled, buffer.size() - filled);
+    filled += n;
+    eof = n == 0U;
+    return !source.failed();
+  };
+  auto consume = [&](std::size_t bytes) {
+    std::memmove(buffer.data(), buffer.data() + bytes, filled - bytes);
+    filled -= bytes;
+  };
+  while (filled < 4U && !eof) {
+    if (!fill()) break;
+  }
+  if (source.failed()) {
+    std::cerr << "error: read failed on input stream: " << path << '\n';
+    return false;
+  }
+  const std::span<const std::uint8_t> head(buffer.data(), filled);
+  if (has_btr2_magic(head)) {
+    std::cerr << "error: BTR2 input needs a seekable file (its block index is at the end)\n";
+    return false;
+  }
+
+  if (filled >= 4U && std::memcmp(buffer.data(), "BTR1", 4U) == 0) {
+    while (filled < kBinaryHeaderSize && !eof) {
+      if (!fill()) break;
+    }
+    if (!check_btr1_header(std::span<const std::uint8_t>(buffer.data(), filled))) {
+      return false;
+    }
+    consume(kBinaryHeaderSize);
+    SeqTracker seq_tracker;
+    std::uint64_t index = 0;
+    while (true) {
+      const std::size_t whole = filled - filled % sizeof(BinaryTraceRecordV1);
+      for (std::size_t offset = 0; offset < whole; offset += sizeof(BinaryTraceRecordV1), ++index) {
+        BinaryTraceRecordV1 raw{};
+        std::memcpy(&raw, buffer.data() + offset, sizeof(raw));
+        ++stats.total_events;
+        auto decoded = decode_binary_record(raw, static_cast<std::size_t>(index) + 1U);
+        if (!decoded.has_value()) {
+          ++stats.malformed_lines;
+          std::cerr << "warning: malformed binary record at index " << index << " skipped\n";
+          continue;
+        }
+        note_binary_seq(seq_tracker, stats, decoded->seq, index);
+        sink(std::move(*decoded));
+      }
+      consume(whole);
+      if (eof || !fill()) break;
+    }
+    if (source.failed()) {
+      std::cerr << "error: read failed on input stream: " << path << '\n';
+      return false;
+    }
+    if (filled != 0U) {
+      std::cerr << "error: truncated binary record at index " << index << "\n";
+      return false;
+    }
+    return true;
+  }
+
+  // JSONL: parse every complete line in the buffer, keep the partial tail.
+  const std::size_t threads = resolve_ingest_threads(ingest_threads);
+  JsonlChunkMerger merger(stats);
+  while (true) {
+    const std::string_view text(reinterpret_cast<const char *>(buffer.data()), filled);
+    const std::size_t last_newline = text.rfind('\n');
+    const std::size_t complete = eof ? filled : (last_newline == std::string_view::npos ? 0U : last_newline + 1U);
+    if (complete != 0U) {
+      const std::size_t chunk_bytes = std::max(kMinJsonlChunkBytes, complete / threads);
+      const std::vector<std::string_view> chunks = split_jsonl_chunks(text.substr(0, complete), chunk_bytes);
+      parse_jsonl_waves(chunks, threads, merger, sink);
+      consume(complete);
+    }
+    if (eof || !fill()) break;
+  }
+  if (source.failed()) {
+    std::cerr << "error: read failed on input stream: " << path << '\n';
+    return false;
+  }
+  return true;
+}
+
+// Format is chosen from the extension (.bin/.btr2 vs JSONL); binary versions
+// from the file magic. Stdin ("-") and FIFOs are read as streams.
+template <typename Sink>
+bool read_trace_records(const std::string &path, std::size_t ingest_threads, InputStats &stats, Sink &&sink) {
+  if (is_stream_input(path)) {
+    return read_stream_records(path, ingest_threads, stats, std::forward<Sink>(sink));
+  }
+  if (is_binary_input(path)) {
+    return read_binary_records(path, stats, std::forward<Sink>(sink));
+  }
+  return read_jsonl_records(path, ingest_threads, stats, std::forward<Sink>(sink));
+}
+
+// Pull-style cursor over one of the push-style readers above, for consumers
+// that interleave two inputs (trace_diff). The reader runs on its own thread
+// but only while the consumer is waiting in next(), so readers never print
+// diagnostics concurrently and at most two batches per input are resident.
+class RecordPuller {
+public:
+  using Sink = std::function<void(const TraceRecord &)>;
+  using Reader = std::function<bool(const Sink &)>;
+
+  static constexpr std::size_t kBatchRecords = 4096;
+
+  explicit RecordPuller(Reader reader);
+  RecordPuller(const RecordPuller &) = delete;
+  RecordPuller &operator=(const RecordPuller &) = delete;
+  ~RecordPuller();
+
+  // Next record in input order, or nullptr once the reader has returned. The
+  // pointer stays valid until the following call.
+  const TraceRecord *next();
+  // The reader's return value; meaningful once next() has returned nullptr.
+  [[nodiscard]] bool ok() const { return ok_; }
+
+private:
+  void produce();
+  void hand_off(std::unique_lock<std::mutex> &lock, bool finished);
+
+  Reader reader_;
+  std::vector<TraceRecord> filling_; // producer side
+  std::vector<TraceRecord> current_; // consumer side
+  std::size_t position_ = 0;
+  bool done_ = false;
+  bool ok_ = true;
+
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  std::vector<TraceRecord> ready_;
+  bool requested_ = false;
+  bool delivered_ = false;
+  bool finished_ = false;
+  bool cancelled_ = false;
+  bool reader_ok_ = true;
+  std::thread thread_;
+};
+
+} // namespace trace_replay
@@ -0,0 +1,403 @@
+#include "trace_replay/btr2.hpp"
+#include "trace_replay/seq_tracker.hpp"
+#include "trace_replay/trace_input.hpp"
+#include "trace_replay/trace_record.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <optional>
+#include <span>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Converts Phase 1 JSONL, BTR1 or BTR2 captures into BTR2, validating them on
+// the way. Several inputs are concatenated in argument order; --split-records
+// spreads the output over numbered parts instead.
+
+namespace {
+
+using trace_replay::TraceRecord;
+
+struct Options {
+  std::vector<std::string> input_paths;
+  std::string output_path;
+  std::uint32_t block_records = trace_replay::kBtr2DefaultBlockRecords;
+  std::uint64_t split_records = 0; // 0 = single output file
+  std::size_t threads = 0;         // 0 = hardware concurrency
+  bool strict = false;
+  bool skip_unencodable = false;
+  bool verify = true;
+};
+
+void print_help() {
+  std::cout << "Usage: trace_pack <input.{jsonl|bin|btr2}>... --output <out.btr2> [options]\n"
+            << "  -o, --output <path>         BTR2 output path (split parts insert .NNN before the extension)\n"
+            << "  --block-records <N>         Records per BTR2 block (default 65536)\n"
+            << "  --split-records <N>         Start a new output part every N records\n"
+            << "  --threads <N>               Parse/encode threads (default: hardware concurrency)\n"
+            << "  --skip-unencodable          Drop records BTR2 cannot hold exactly (labels, size or addr spelling) instead of failing\n"
+            << "  --strict                    Exit 2 if any record is malformed, duplicated, out of order or dropped\n"
+            << "  --no-verify                 Skip re-reading each output part after writing it\n"
+            << "  --help                      Show this help\n"
+            << "Multiple inputs are concatenated in argument order; '-' reads JSONL or BTR1 from stdin.\n";
+}
+
+bool parse_options(int argc, char **argv, Options &opts) {
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    if (arg == "--help" || arg == "-h") {
+      print_help();
+      std::exit(0);
+    }
+    if (arg == "--output" || arg == "-o") {
+      if (i + 1 >= argc) return false;
+      opts.output_path = argv[++i];
+      continue;
+    }
+    if (arg == "--block-records") {
+      if (i + 1 >= argc) return false;
+      const auto parsed = trace_replay::parse_u64(argv[++i]);
+      if (!parsed || *parsed == 0U || *parsed > 0xFFFFFFFFULL) return false;
+      opts.block_records = static_cast<std::uint32_t>(*parsed);
+      continue;
+    }
+    if (arg == "--split-records") {
+      if (i + 1 >= argc) return false;
+      const auto parsed = trace_replay::parse_u64(argv[++i]);
+      if (!parsed || *parsed == 0U) return false;
+      opts.split_records = *parsed;
+      continue;
+    }
+    if (arg == "--threads") {
+      if (i + 1 >= argc) return false;
+      const auto parsed = trace_replay::parse_u64(argv[++i]);
+      if (!parsed) return false;
+      opts.threads = static_cast<std::size_t>(*parsed);
+      continue;
+    }
+    if (arg == "--strict") {
+      opts.strict = true;
+      continue;
+    }
+    if (arg == "--skip-unencodable") {
+      opts.skip_unencodable = true;
+      continue;
+    }
+    if (arg == "--no-verify") {
+      opts.verify = false;
+      continue;
+    }
+    if (arg == "-" || (!arg.empty() && arg[0] != '-')) {
+      opts.input_paths.push_back(arg);
+      continue;
+    }
+    return false;
+  }
+  return !opts.input_paths.empty() && !opts.output_path.empty();
+}
+
+// Why `record` would not survive a BTR2 round trip exactly, or nullptr if it
+// would. BTR2 renders every address as 0x%08X.
+const char *unencodable_reason(const TraceRecord &record) {
+  if (!trace_replay::btr2_can_encode(record)) {
+    return "non-canonical master/rw/kind or size";
+  }
+  if (record.addr_text_id != trace_replay::kAddrTextUpperHex) {
+    return "addr not spelled as 0xXXXXXXXX";
+  }
+  return nullptr;
+}
+
+// FNV-1a over every encoded field, so verification can confirm a part decodes
+// to exactly what was packed.
+inline constexpr std::uint64_t kDigestSeed = 0xCBF29CE484222325ULL;
+
+std::uint64_t digest_record(std::uint64_t digest, const TraceRecord &record) {
+  const std::uint64_t fields[] = {record.seq,
+                                  record.tick_first_attempt,
+                                  record.tick_complete,
+                                  record.addr,
+                                  record.service_cycles,
+                                  record.retries,
+                                  static_cast<std::uint64_t>(record.master),
+                                  static_cast<std::uint64_t>(record.rw),
+                                  static_cast<std::uint64_t>(record.kind),
+                                  record.size};
+  for (const auto field : fields) {
+    for (unsigned shift = 0; shift < 64U; shift += 8U) {
+      digest ^= (field >> shift) & 0xFFU;
+      digest *= 0x100000001B3ULL;
+    }
+  }
+  return digest;
+}
+
+struct OutputPart {
+  std::string path;
+  std::uint64_t records = 0;
+  std::size_t blocks = 0;
+  std::uint64_t digest = kDigestSeed;
+  std::uint64_t bytes = 0;
+};
+
+// Buffers records into waves of threads * block_records, encodes the blocks
+// of a wave in parallel and writes them in order. Blocks never straddle a
+// split boundary.
+class PackOutput {
+public:
+  explicit PackOutput(const Options &options)
+      : options_(options), threads_(trace_replay::resolve_ingest_threads(options.threads)) {
+    pending_.reserve(wave_records());
+  }
+
+  bool add(const TraceRecord &record) {
+    pending_.push_back(record);
+    if (pending_.size() >= wave_records()) {
+      return flush_wave();
+    }
+    return true;
+  }
+
+  bool finish() {
+    if (!flush_wave()) {
+      return false;
+    }
+    if (!writer_.has_value() && !open_next_part()) {
+      return false;
+    }
+    return close_part();
+  }
+
+  [[nodiscard]] const std::vector<OutputPart> &parts() const { return parts_; }
+
+private:
+  struct Slice {
+    std::size_t begin = 0;
+    std::size_t end = 0;
+    bool starts_part = false;
+  };
+
+  [[nodiscard]] std::size_t wave_records() const { return threads_ * options_.block_records; }
+
+  [[nodiscard]] std::string part_path(std::size_t index) const {
+    if (options_.split_records == 0U) {
+      return options_.output_path;
+    }
+    const std::filesystem::path base(options_.output_path);
+    std::string number = std::to_string(index);
+    number.insert(0, number.size() < 3U ? 3U - number.size() : 0U, '0');
+    std::filesystem::path part = base.parent_path() / base.stem();
+    return part.string() + "." + number + base.extension().string();
+  }
+
+  bool flush_wave() {
+    if (pending_.empty()) {
+      return true;
+    }
+    std::vector<Slice> slices;
+    bool need_part = !writer_.has_value();
+    std::size_t pos = 0;
+    while (pos < pending_.size()) {
+      if (options_.split_records != 0U && records_in_part_ == options_.split_records) {
+        need_part = true;
+        records_in_part_ = 0;
+      }
+      std::uint64_t len = std::min<std::uint64_t>(options_.block_records, pending_.size() - pos);
+      if (options_.split_records != 0U) {
+        len = std::min(len, options_.split_records - records_in_part_);
+      }
+      slices.push_back(Slice{pos, pos + static_cast<std::size_t>(len), need_part});
+      need_part = false;
+      records_in_part_ += len;
+      pos += static_cast<std::size_t>(len);
+    }
+
+    std::vector<trace_replay::Btr2EncodedBlock> encoded(slices.size());
+    const std::span<const TraceRecord> records(pending_);
+    for (std::size_t first = 0; first < slices.size(); first += threads_) {
+      const std::size_t count = std::min(threads_, slices.size() - first);
+      trace_replay::run_parallel(count, [&](std::size_t i) {
+        const Slice &slice = slices[first + i];
+        encoded[first + i] = trace_replay::encode_btr2_block(records.subspan(slice.begin, slice.end - slice.begin));
+      });
+    }
+
+    for (std::size_t i = 0; i < slices.size(); ++i) {
+      if (slices[i].starts_part) {
+        if (writer_.has_value() && !close_part()) {
+          return false;
+        }
+        if (!open_next_part()) {
+          return false;
+        }
+      }
+      OutputPart &part = parts_.back();
+      for (std::size_t r = slices[i].begin; r < slices[i].end; ++r) {
+        part.digest = digest_record(part.digest, pending_[r]);
+      }
+      part.records += slices[i].end - slices[i].begin;
+      ++part.blocks;
+      writer_->append_block(std::move(encoded[i]));
+    }
+    pending_.clear();
+    return true;
+  }
+
+  bool open_next_part() {
+    OutputPart part{};
+    part.path = part_path(parts_.size());
+    stream_.emplace(part.path, std::ios::binary | std::ios::trunc);
+    if (!stream_->is_open()) {
+      std::cerr << "Failed to open output path: " << part.path << '\n';
+      return false;
+    }
+    writer_.emplace(*stream_, options_.block_records);
+    parts_.push_back(std::move(part));
+    return true;
+  }
+
+  bool close_part() {
+    OutputPart &part = parts_.back();
+    const bool written = writer_->finish();
+    writer_.reset();
+    stream_->close();
+    const bool closed = !stream_->fail();
+    stream_.reset();
+    if (!written || !closed) {
+      std::cerr << "error: failed writing " << part.path << '\n';
+      return false;
+    }
+    std::error_code ec;
+    part.bytes = std::filesystem::file_size(part.path, ec);
+    return !options_.verify || verify_part(part);
+  }
+
+  static bool verify_part(const OutputPart &part) {
+    trace_replay::MappedFile file;
+    if (!file.open(part.path)) {
+      std::cerr << "error: cannot reopen " << part.path << " for verification\n";
+      return false;
+    }
+    const auto view = trace_replay::open_btr2_view(file.bytes());
+    if (!view.has_value()) {
+      return false;
+    }
+    std::uint64_t digest = kDigestSeed;
+    std::uint64_t first_index = 0;
+    std::vector<TraceRecord> block_records;
+    std::vector<std::uint32_t> malformed;
+    for (std::size_t block = 0; block < view->blocks.size(); ++block) {
+      if (!trace_replay::decode_btr2_block(*view, block, trace_replay::kBtr2AllColumns, first_index, block_records, malformed)) {
+        return false;
+      }
+      for (const auto &record : block_records) {
+        digest = digest_record(digest, record);
+      }
+      first_index += block_records.size();
+    }
+    if (!malformed.empty() || first_index != part.records || view->blocks.size() != part.blocks || digest != part.digest) {
+      std::cerr << "error: verification failed for " << part.path << " (decoded " << first_index << " of " << part.records << " records)\n";
+      return false;
+    }
+    return true;
+  }
+
+  const Options &options_;
+  std::size_t threads_ = 1;
+  std::vector<TraceRecord> pending_;
+  std::uint64_t records_in_part_ = 0;
+  std::optional<std::ofstream> stream_;
+  std::optional<trace_replay::Btr2Writer> writer_;
+  std::vector<OutputPart> parts_;
+};
+
+} // namespace
+
+int main(int argc, char **argv) {
+  Options options{};
+  if (!parse_options(argc, argv, options)) {
+    print_help();
+    return 1;
+  }
+
+  PackOutput output(options);
+  bool output_ok = true;
+  std::size_t issues = 0;
+  std::uint64_t input_bytes = 0;
+  std::uint64_t packed_records = 0;
+  // Seq checks across the concatenated output; per-input checks come from
+  // the loaders themselves.
+  trace_replay::SeqTracker output_seq;
+  std::size_t output_duplicate_seq_count = 0;
+  std::size_t output_non_monotonic_seq_count = 0;
+
+  for (const auto &path : options.input_paths) {
+    trace_replay::InputStats stats{};
+    std::size_t unencodable = 0;
+    std::uint64_t records = 0;
+    const bool read_ok = trace_replay::read_trace_records(path, options.threads, stats, [&](TraceRecord &&record) {
+      if (!output_ok) {
+        return;
+      }
+      if (const char *reason = unencodable_reason(record)) {
+        ++unencodable;
+        if (!options.skip_unencodable) {
+          std::cerr << "error: seq " << record.seq << " (source line " << record.source_line << ") has no exact BTR2 encoding (" << reason
+                    << "); pass --skip-unencodable to drop such records\n";
+          output_ok = false;
+          return;
+        }
+        std::cerr << "warning: seq " << record.seq << " (source line " << record.source_line << ") has no exact BTR2 encoding (" << reason
+                  << "); skipped\n";
+        return;
+      }
+      const auto seq_check = output_seq.observe(record.seq);
+      output_duplicate_seq_count += seq_check.duplicate ? 1U : 0U;
+      output_non_monotonic_seq_count += seq_check.non_monotonic ? 1U : 0U;
+      ++records;
+      output_ok = output.add(record);
+    });
+    if (!read_ok || !output_ok) {
+      return 1;
+    }
+    // Stdin/FIFO inputs have no size; compression_ratio then covers files only.
+    std::error_code ec;
+    const std::uintmax_t size = std::filesystem::file_size(path, ec);
+    input_bytes += ec ? 0U : size;
+    packed_records += records;
+    issues += stats.malformed_lines + stats.duplicate_seq_count + stats.non_monotonic_seq_count + unencodable;
+    std::cout << "input: " << path << " total_events=" << stats.total_events << " packed=" << records
+              << " malformed=" << stats.malformed_lines << " duplicate_seq=" << stats.duplicate_seq_count
+              << " non_monotonic_seq=" << stats.non_monotonic_seq_count << " unencodable=" << unencodable << "\n";
+  }
+
+  if (!output.finish()) {
+    return 1;
+  }
+  std::uint64_t output_bytes = 0;
+  for (const auto &part : output.parts()) {
+    output_bytes += part.bytes;
+    std::cout << "output: " << part.path << " records=" << part.records << " blocks=" << part.blocks << " bytes=" << part.bytes
+              << (options.verify ? " verified" : "") << "\n";
+  }
+  if (options.input_paths.size() > 1U) {
+    issues += output_duplicate_seq_count + output_non_monotonic_seq_count;
+    std::cout << "concatenated_duplicate_seq_count: " << output_duplicate_seq_count << "\n";
+    std::cout << "concatenated_non_monotonic_seq_count: " << output_non_monotonic_seq_count << "\n";
+  }
+  std::cout << "packed_records: " << packed_records << "\n";
+  std::cout << "input_bytes: " << input_bytes << "\n";
+  std::cout << "output_bytes: " << output_bytes << "\n";
+  std::cout << "compression_ratio: " << (output_bytes == 0U ? 0.0 : static_cast<double>(input_bytes) / static_cast<double>(output_bytes)) << "\n";
+
+  if (options.strict && issues != 0U) {
+    std::cerr << "error: " << issues << " validation issue(s) with --strict\n";
+    return 2;
+  }
+  return 0;
+}
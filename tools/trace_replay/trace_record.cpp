@@ -0,0 +1,363 @@
+#include "trace_replay/trace_record.hpp"
+
+#include "trace_replay/jsonl_scanner.hpp"
+
+#include <array>
+#include <charconv>
+#include <iostream>
+#include <mutex>
+
+namespace trace_replay {
+namespace {
+
+constexpr std::uint32_t kMaxShortLabels = 0xFFFFU;
+// Non-canonical address spellings kept verbatim. Past this, addresses render
+// as to_hex32() so memory stays bounded on long or live captures.
+constexpr std::uint32_t kMaxAddrTextLabels = 0xFFFFU;
+
+LabelTable &master_labels() {
+  static LabelTable table({"MSH2", "SSH2", "DMA"}, kMaxShortLabels);
+  return table;
+}
+
+LabelTable &rw_labels() {
+  static LabelTable table({"R", "W"}, kMaxShortLabels);
+  return table;
+}
+
+LabelTable &kind_labels() {
+  static LabelTable table({"ifetch", "read", "write", "mmio_read", "mmio_write"}, kMaxShortLabels);
+  return table;
+}
+
+LabelTable &addr_text_labels() {
+  static LabelTable table({}, kMaxAddrTextLabels);
+  return table;
+}
+
+bool is_hex_digit_in_case(char c, bool upper) {
+  if (c >= '0' && c <= '9') return true;
+  return upper ? (c >= 'A' && c <= 'F') : (c >= 'a' && c <= 'f');
+}
+
+// Picks the cheapest way to reproduce the original address spelling.
+std::uint32_t addr_text_id_for(std::string_view text) {
+  if (text.size() == 10U && text[0] == '0' && text[1] == 'x') {
+    bool upper = true;
+    bool lower = true;
+    for (std::size_t i = 2; i < text.size(); ++i) {
+      upper = upper && is_hex_digit_in_case(text[i], true);
+      lower = lower && is_hex_digit_in_case(text[i], false);
+    }
+    if (upper) return kAddrTextUpperHex;
+    if (lower) return kAddrTextLowerHex;
+  }
+  if (const auto id = addr_text_labels().try_intern(text)) {
+    return kAddrTextInternedBase + *id;
+  }
+  static std::once_flag warned;
+  std::call_once(warned, [] {
+    std::cerr << "warning: more than " << kMaxAddrTextLabels << " distinct non-canonical address spellings; rendering the rest as 0xXXXXXXXX\n";
+  });
+  return kAddrTextUpperHex;
+}
+
+} // namespace
+
+LabelTable::LabelTable(std::initializer_list<std::string_view> canonical, std::uint32_t max_labels)
+    : canonical_(canonical.begin(), canonical.end()), max_labels_(max_labels) {
+  for (const auto &text : canonical_) {
+    ids_.emplace(text, static_cast<std::uint32_t>(labels_.size()));
+    labels_.push_back(text);
+  }
+}
+
+std::uint32_t LabelTable::intern(std::string_view text) {
+  if (const auto id = try_intern(text)) {
+    return *id;
+  }
+  // Pathological input: fold further distinct labels into the last slot.
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::cerr << "warning: label table full; folding \"" << text << "\" into \"" << labels_.back() << "\"\n";
+  return static_cast<std::uint32_t>(labels_.size() - 1U);
+}
+
+std::optional<std::uint32_t> LabelTable::try_intern(std::string_view text) {
+  for (std::size_t id = 0; id < canonical_.size(); ++id) {
+    if (canonical_[id] == text) {
+      return static_cast<std::uint32_t>(id);
+    }
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (const auto it = ids_.find(text); it != ids_.end()) {
+    return it->second;
+  }
+  if (labels_.size() >= max_labels_) {
+    return std::nullopt;
+  }
+  const auto id = static_cast<std::uint32_t>(labels_.size());
+  labels_.emplace_back(text);
+  ids_.emplace(labels_.back(), id);
+  return id;
+}
+
+const std::string &LabelTable::label(std::uint32_t id) const {
+  if (id < canonical_.size()) {
+    return canonical_[id];
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  return labels_[id];
+}
+
+std::vector<std::string> LabelTable::interned() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return {labels_.begin() + static_cast<std::ptrdiff_t>(canonical_.size()), labels_.end()};
+}
+
+bool LabelTable::restore(const std::vector<std::string> &labels) {
+  for (std::size_t i = 0; i < labels.size(); ++i) {
+    if (intern(labels[i]) != canonical_.size() + i) {
+      return false;
+    }
+  }
+  return true;
+}
+
+InternedLabels interned_labels() {
+  return InternedLabels{master_labels().interned(), rw_labels().interned(), kind_labels().interned(), addr_text_labels().interned()};
+}
+
+bool restore_interned_labels(const InternedLabels &labels) {
+  return master_labels().restore(labels.masters) && rw_labels().restore(labels.rws) && kind_labels().restore(labels.kinds) &&
+         addr_text_labels().restore(labels.addr_texts);
+}
+
+bool is_valid_master(Master master) { return static_cast<std::uint16_t>(master) < kCanonicalMasterCount; }
+
+const std::string &master_label(Master master) { return master_labels().label(static_cast<std::uint16_t>(master)); }
+
+const std::string &rw_label(Rw rw) { return rw_labels().label(static_cast<std::uint16_t>(rw)); }
+
+const std::string &kind_label(AccessKind kind) { return kind_labels().label(static_cast<std::uint16_t>(kind)); }
+
+std::string to_hex32(std::uint32_t value) {
+  static constexpr char kDigits[] = "0123456789ABCDEF";
+  std::string out = "0x00000000";
+  for (int i = 0; i < 8; ++i) {
+    out[static_cast<std::size_t>(9 - i)] = kDigits[(value >> (i * 4)) & 0xF];
+  }
+  return out;
+}
+
+void append_json_escaped(std::string &out, std::string_view text) {
+  for (char c : text) {
+    if (c == '"' || c == '\\') {
+      out.push_back('\\');
+    }
+    out.push_back(c);
+  }
+}
+
+std::string json_escape(std::string_view text) {
+  std::string out;
+  out.reserve(text.size());
+  append_json_escaped(out, text);
+  return out;
+}
+
+std::string addr_text(const TraceRecord &record) {
+  if (record.addr_text_id == kAddrTextUpperHex) {
+    return to_hex32(record.addr);
+  }
+  if (record.addr_text_id == kAddrTextLowerHex) {
+    std::string out = to_hex32(record.addr);
+    for (std::size_t i = 2; i < out.size(); ++i) {
+      if (out[i] >= 'A' && out[i] <= 'F') {
+        out[i] = static_cast<char>(out[i] - 'A' + 'a');
+      }
+    }
+    return out;
+  }
+  return addr_text_labels().label(record.addr_text_id - kAddrTextInternedBase);
+}
+
+Region region_of(std::uint32_t addr) { return static_cast<Region>(busarb::ymir_region_lookup(addr).region); }
+
+const std::string &region_name(Region region) {
+  static const std::array<std::string, kRegionCount> kNames = [] {
+    std::array<std::string, kRegionCount> names;
+    const auto rows = busarb::ymir_region_timings();
+    for (std::size_t i = 0; i < rows.size(); ++i) {
+      names[i] = rows[i].name;
+    }
+    names.back() = "Unmapped";
+    return names;
+  }();
+  return kNames[static_cast<std::size_t>(region)];
+}
+
+ObservedTiming observed_timing(const TraceRecord &record) {
+  ObservedTiming timing{};
+  if (record.tick_complete >= record.tick_first_attempt) {
+    timing.elapsed = static_cast<std::uint32_t>(record.tick_complete - record.tick_first_attempt);
+    timing.kind = WaitMetricKind::ExactTickElapsedExclusive;
+  } else {
+    timing.elapsed = static_cast<std::uint32_t>(record.retries * record.service_cycles + record.service_cycles);
+    timing.kind = WaitMetricKind::ProxyRetriesXService;
+  }
+  timing.wait = (timing.elapsed > record.service_cycles) ? (timing.elapsed - record.service_cycles) : 0U;
+  return timing;
+}
+
+LocalModelTerms local_model_terms(const TraceRecord &record, const std::optional<TraceRecord> &previous) {
+  LocalModelTerms terms{};
+  if (!previous.has_value()) {
+    return terms;
+  }
+  terms.same_address = previous->addr == record.addr;
+  terms.sh2_tie = is_valid_master(previous->master) && is_valid_master(record.master) && previous->tick_first_attempt == record.tick_first_attempt &&
+                  previous->master != Master::DMA && record.master != Master::DMA && previous->master != record.master;
+  return terms;
+}
+
+CacheBucket classify_cache_bucket(Region region, std::uint32_t service_cycles) {
+  if (region != Region::HighWram) {
+    return CacheBucket::NotApplicable;
+  }
+  if (service_cycles == 1U) {
+    return CacheBucket::CacheHit;
+  }
+  if (service_cycles == 2U) {
+    return CacheBucket::UncachedOrThrough;
+  }
+  if (service_cycles == 4U) {
+    return CacheBucket::CacheMissHalf;
+  }
+  if (service_cycles == 8U) {
+    return CacheBucket::CacheMissFull;
+  }
+  return CacheBucket::Anomaly;
+}
+
+const char *cache_bucket_name(CacheBucket bucket) {
+  switch (bucket) {
+  case CacheBucket::NotApplicable:
+    return "not_applicable";
+  case CacheBucket::CacheHit:
+    return "cache_hit";
+  case CacheBucket::UncachedOrThrough:
+    return "uncached_or_through";
+  case CacheBucket::CacheMissHalf:
+    return "cache_miss_half";
+  case CacheBucket::CacheMissFull:
+    return "cache_miss_full";
+  case CacheBucket::Anomaly:
+    return "anomaly";
+  }
+  return "anomaly";
+}
+
+const char *classification_name(Classification classification) {
+  switch (classification) {
+  case Classification::Agreement:
+    return "agreement";
+  case Classification::Mismatch:
+    return "mismatch";
+  case Classification::KnownYmirWaitModelGap:
+    return "known_ymir_wait_model_gap";
+  case Classification::WaitNonzero:
+    return "wait_nonzero";
+  case Classification::WaitZero:
+    return "wait_zero";
+  }
+  return "mismatch";
+}
+
+const char *wait_metric_kind_name(WaitMetricKind kind) {
+  return kind == WaitMetricKind::ExactTickElapsedExclusive ? "exact_tick_elapsed_exclusive" : "proxy_retries_x_service";
+}
+
+const char *known_gap_reason_name(KnownGapReason reason) {
+  return reason == KnownGapReason::ByteAccessWaitCheckGap ? "byte_access_wait_check_gap" : "";
+}
+
+std::optional<std::uint64_t> parse_u64(std::string_view text) {
+  std::uint64_t value = 0;
+  auto result = std::from_chars(text.data(), text.data() + text.size(), value, 10);
+  if (result.ec != std::errc{} || result.ptr != text.data() + text.size()) {
+    return std::nullopt;
+  }
+  return value;
+}
+
+std::optional<std::uint32_t> parse_addr(std::string_view text) {
+  std::string_view trimmed = text;
+  if (trimmed.rfind("0x", 0) == 0 || trimmed.rfind("0X", 0) == 0) {
+    trimmed.remove_prefix(2);
+  }
+  std::uint32_t value = 0;
+  auto result = std::from_chars(trimmed.data(), trimmed.data() + trimmed.size(), value, 16);
+  if (result.ec != std::errc{} || result.ptr != trimmed.data() + trimmed.size()) {
+    return std::nullopt;
+  }
+  return value;
+}
+
+std::optional<TraceRecord> parse_record(std::string_view line, std::size_t source_line) {
+  Phase1FieldSpans fields;
+  scan_phase1_fields(line, fields);
+  if (!fields.complete()) {
+    return std::nullopt;
+  }
+
+  const auto parsed_seq = parse_u64(*fields.seq);
+  const auto parsed_tfa = parse_u64(*fields.tick_first_attempt);
+  const auto parsed_tc = parse_u64(*fields.tick_complete);
+  const auto parsed_addr = parse_addr(*fields.addr);
+  const auto parsed_size = parse_u64(*fields.size);
+  const auto parsed_service = parse_u64(*fields.service_cycles);
+  const auto parsed_retries = parse_u64(*fields.retries);
+
+  if (!parsed_seq || !parsed_tfa || !parsed_tc || !parsed_addr || !parsed_size || !parsed_service || !parsed_retries) {
+    return std::nullopt;
+  }
+
+  TraceRecord rec{};
+  rec.seq = *parsed_seq;
+  rec.master = static_cast<Master>(master_labels().intern(*fields.master));
+  rec.tick_first_attempt = *parsed_tfa;
+  rec.tick_complete = *parsed_tc;
+  rec.addr = *parsed_addr;
+  rec.addr_text_id = addr_text_id_for(*fields.addr);
+  rec.size = static_cast<std::uint8_t>(*parsed_size);
+  rec.rw = static_cast<Rw>(rw_labels().intern(*fields.rw));
+  rec.kind = static_cast<AccessKind>(kind_labels().intern(*fields.kind));
+  rec.service_cycles = static_cast<std::uint32_t>(*parsed_service);
+  rec.retries = static_cast<std::uint32_t>(*parsed_retries);
+  rec.source_line = source_line;
+  rec.region = region_of(rec.addr);
+  return rec;
+}
+
+std::optional<TraceRecord> decode_binary_record(const BinaryTraceRecordV1 &raw, std::size_t source_line) {
+  if (raw.master > 2U || raw.rw > 1U || raw.kind > 4U || !(raw.size == 1 || raw.size == 2 || raw.size == 4)) {
+    return std::nullopt;
+  }
+  TraceRecord rec{};
+  rec.seq = raw.seq;
+  rec.master = static_cast<Master>(raw.master);
+  rec.tick_first_attempt = raw.tick_first_attempt;
+  rec.tick_complete = raw.tick_complete;
+  rec.addr = raw.addr;
+  rec.addr_text_id = kAddrTextUpperHex;
+  rec.size = raw.size;
+  rec.rw = static_cast<Rw>(raw.rw);
+  rec.kind = static_cast<AccessKind>(raw.kind);
+  rec.service_cycles = static_cast<std::uint32_t>(raw.service_cycles);
+  rec.retries = static_cast<std::uint32_t>(raw.retries);
+  rec.source_line = source_line;
+  rec.region = region_of(rec.addr);
+  return rec;
+}
+
+} // namespace trace_replay
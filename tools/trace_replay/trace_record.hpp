@@ -0,0 +1,230 @@
+#pragma once
+
+#include "busarb/ymir_timing.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <initializer_list>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace trace_replay {
+
+// Interned label ids. Canonical Phase 1 values have fixed ids that match the
+// BTR1 byte encodings; any other text seen in JSONL input is interned after
+// them so it can still be reported verbatim.
+enum class Master : std::uint16_t {
+  MSH2 = 0,
+  SSH2 = 1,
+  DMA = 2,
+};
+inline constexpr std::uint16_t kCanonicalMasterCount = 3;
+
+enum class Rw : std::uint16_t {
+  R = 0,
+  W = 1,
+};
+
+enum class AccessKind : std::uint16_t {
+  Ifetch = 0,
+  Read = 1,
+  Write = 2,
+  MmioRead = 3,
+  MmioWrite = 4,
+};
+
+// Rows of busarb::ymir_region_timings(), in table order, then Unmapped.
+enum class Region : std::uint8_t {
+  BiosRom,
+  Smpc,
+  BackupRam,
+  LowWram,
+  MinitSinit,
+  ABusCs0Cs1,
+  ABusDummy,
+  CdBlockCs2,
+  Scsp,
+  Vdp1Vram,
+  Vdp1Fb,
+  Vdp1Regs,
+  Vdp2,
+  ScuRegs,
+  HighWram,
+  Sh2OnChipRegs,
+  Unmapped,
+};
+inline constexpr std::size_t kRegionCount = static_cast<std::size_t>(Region::Unmapped) + 1U;
+static_assert(static_cast<std::size_t>(Region::Unmapped) == busarb::kYmirRegionCount, "Region must follow the busarb region table");
+
+enum class CacheBucket : std::uint8_t {
+  NotApplicable,
+  CacheHit,
+  UncachedOrThrough,
+  CacheMissHalf,
+  CacheMissFull,
+  Anomaly,
+};
+inline constexpr std::size_t kCacheBucketCount = static_cast<std::size_t>(CacheBucket::Anomaly) + 1U;
+
+enum class Classification : std::uint8_t {
+  Agreement,
+  Mismatch,
+  KnownYmirWaitModelGap,
+  WaitNonzero,
+  WaitZero,
+};
+inline constexpr std::size_t kClassificationCount = static_cast<std::size_t>(Classification::WaitZero) + 1U;
+
+enum class WaitMetricKind : std::uint8_t {
+  ExactTickElapsedExclusive,
+  ProxyRetriesXService,
+};
+
+enum class KnownGapReason : std::uint8_t {
+  None,
+  ByteAccessWaitCheckGap,
+};
+
+// Address text is rendered at output time. Ids below kAddrTextInternedBase
+// select a canonical rendering of `addr`; larger ids index the interned
+// original spelling. Once the spelling table is full, further spellings fall
+// back to kAddrTextUpperHex.
+inline constexpr std::uint32_t kAddrTextUpperHex = 0;
+inline constexpr std::uint32_t kAddrTextLowerHex = 1;
+inline constexpr std::uint32_t kAddrTextInternedBase = 2;
+
+struct TraceRecord {
+  std::uint64_t seq = 0;
+  std::uint64_t tick_first_attempt = 0;
+  std::uint64_t tick_complete = 0;
+  std::uint64_t source_line = 0;
+  std::uint32_t addr = 0;
+  std::uint32_t service_cycles = 0;
+  std::uint32_t retries = 0;
+  std::uint32_t addr_text_id = kAddrTextUpperHex;
+  Master master = Master::MSH2;
+  Rw rw = Rw::R;
+  AccessKind kind = AccessKind::Read;
+  std::uint8_t size = 4;
+  Region region = Region::Unmapped;
+};
+static_assert(sizeof(TraceRecord) <= 56, "TraceRecord should stay packed");
+
+// Thread-safe append-only string table. Lookups of canonical labels never
+// take the lock.
+class LabelTable {
+public:
+  LabelTable(std::initializer_list<std::string_view> canonical, std::uint32_t max_labels);
+
+  [[nodiscard]] std::uint32_t intern(std::string_view text);
+  // Like intern(), but nullopt instead of folding once the table is full.
+  [[nodiscard]] std::optional<std::uint32_t> try_intern(std::string_view text);
+  [[nodiscard]] const std::string &label(std::uint32_t id) const;
+
+  // Non-canonical labels in id order.
+  [[nodiscard]] std::vector<std::string> interned() const;
+  // Interns `labels` in order; false if any of them does not get the id it
+  // had in the table interned() was taken from.
+  [[nodiscard]] bool restore(const std::vector<std::string> &labels);
+
+private:
+  // Immutable after construction, so canonical lookups need no lock.
+  const std::vector<std::string> canonical_;
+  std::uint32_t max_labels_ = 0;
+  mutable std::mutex mutex_;
+  std::deque<std::string> labels_;
+  std::map<std::string, std::uint32_t, std::less<>> ids_;
+};
+
+// Snapshot of every label table's interned entries. Saved replay state refers
+// to labels by id, so a resumed run restores these before parsing anything.
+struct InternedLabels {
+  std::vector<std::string> masters;
+  std::vector<std::string> rws;
+  std::vector<std::string> kinds;
+  std::vector<std::string> addr_texts;
+};
+
+[[nodiscard]] InternedLabels interned_labels();
+// False if the tables already hold labels that would shift the saved ids.
+[[nodiscard]] bool restore_interned_labels(const InternedLabels &labels);
+
+[[nodiscard]] bool is_valid_master(Master master);
+[[nodiscard]] const std::string &master_label(Master master);
+[[nodiscard]] const std::string &rw_label(Rw rw);
+[[nodiscard]] const std::string &kind_label(AccessKind kind);
+[[nodiscard]] std::string addr_text(const TraceRecord &record);
+[[nodiscard]] std::string to_hex32(std::uint32_t value);
+
+// JSON string bodies in every trace_replay/trace_diff output: '"' and '\\'
+// are escaped, everything else is copied.
+void append_json_escaped(std::string &out, std::string_view text);
+[[nodiscard]] std::string json_escape(std::string_view text);
+
+// One busarb::ymir_region_lookup() page-table load.
+[[nodiscard]] Region region_of(std::uint32_t addr);
+[[nodiscard]] const std::string &region_name(Region region);
+
+// Observed elapsed ticks and wait (elapsed beyond service_cycles) for one
+// record: exact from the tick pair, or retries * service + service when
+// tick_complete precedes tick_first_attempt.
+struct ObservedTiming {
+  std::uint32_t elapsed = 0;
+  std::uint32_t wait = 0;
+  WaitMetricKind kind = WaitMetricKind::ExactTickElapsedExclusive;
+};
+[[nodiscard]] ObservedTiming observed_timing(const TraceRecord &record);
+
+// Model terms for one record that depend only on the previous included record
+// (nullopt at the start): a repeat of its address, which the arbiter charges
+// same_address_contention, and a different SH-2 attempting on the same tick,
+// which costs tie_turnaround. The replay, --sweep and --calibrate all use it.
+struct LocalModelTerms {
+  bool same_address = false;
+  bool sh2_tie = false;
+
+  [[nodiscard]] std::uint32_t contention(std::uint32_t same_address_contention) const { return same_address ? same_address_contention : 0U; }
+  [[nodiscard]] std::uint32_t predicted_wait(std::uint32_t same_address_contention, std::uint32_t tie_turnaround) const {
+    return contention(same_address_contention) + (sh2_tie ? tie_turnaround : 0U);
+  }
+  [[nodiscard]] std::uint32_t predicted_wait(const busarb::ArbiterConfig &config) const {
+    return predicted_wait(config.same_address_contention, config.tie_turnaround);
+  }
+};
+[[nodiscard]] LocalModelTerms local_model_terms(const TraceRecord &record, const std::optional<TraceRecord> &previous);
+
+[[nodiscard]] CacheBucket classify_cache_bucket(Region region, std::uint32_t service_cycles);
+[[nodiscard]] const char *cache_bucket_name(CacheBucket bucket);
+[[nodiscard]] const char *classification_name(Classification classification);
+[[nodiscard]] const char *wait_metric_kind_name(WaitMetricKind kind);
+[[nodiscard]] const char *known_gap_reason_name(KnownGapReason reason);
+
+[[nodiscard]] std::optional<std::uint64_t> parse_u64(std::string_view text);
+[[nodiscard]] std::optional<std::uint32_t> parse_addr(std::string_view text);
+
+// Parses one Phase 1 JSONL line; nullopt means malformed.
+[[nodiscard]] std::optional<TraceRecord> parse_record(std::string_view line, std::size_t source_line);
+
+struct BinaryTraceRecordV1 {
+  std::uint64_t seq;
+  std::uint64_t tick_first_attempt;
+  std::uint64_t tick_complete;
+  std::uint64_t service_cycles;
+  std::uint64_t retries;
+  std::uint32_t addr;
+  std::uint8_t size;
+  std::uint8_t master;
+  std::uint8_t rw;
+  std::uint8_t kind;
+};
+static_assert(sizeof(BinaryTraceRecordV1) == 48, "BinaryTraceRecordV1 must be 48 bytes");
+
+// Decodes one BTR1 record; nullopt means an out-of-range enum or size.
+[[nodiscard]] std::optional<TraceRecord> decode_binary_record(const BinaryTraceRecordV1 &raw, std::size_t source_line);
+
+} // namespace trace_replay
@@ -1,18 +1,29 @@
 #include "busarb/busarb.hpp"
 #include "busarb/ymir_timing.hpp"
+#include "trace_replay/annotated_output.hpp"
+#include "trace_replay/cache_sim.hpp"
+#include "trace_replay/calibrate.hpp"
+#include "trace_replay/dense_table.hpp"
+#include "trace_replay/quantile_sketch.hpp"
+#include "trace_replay/replay_cache.hpp"
+#include "trace_replay/state_codec.hpp"
+#include "trace_replay/sweep.hpp"
+#include "trace_replay/top_k.hpp"
+#include "trace_replay/trace_index.hpp"
+#include "trace_replay/trace_input.hpp"
+#include "trace_replay/trace_record.hpp"
 
 #include <algorithm>
 #include <array>
-#include <charconv>
 #include <cmath>
 #include <cstdint>
 #include <cstdlib>
 #include <fstream>
 #include <iostream>
 #include <map>
-#include <numeric>
+#include <memory>
 #include <optional>
-#include <set>
+#include <sstream>
 #include <string>
 #include <string_view>
 #include <utility>
@@ -21,300 +32,208 @@
 namespace {
 
 inline constexpr std::uint32_t kSummarySchemaVersion = 4;
-
-struct TraceRecord {
-  std::uint64_t seq = 0;
-  std::string master;
-  std::uint64_t tick_first_attempt = 0;
-  std::uint64_t tick_complete = 0;
-  std::uint32_t addr = 0;
-  std::string addr_text;
-  std::uint8_t size = 4;
-  std::string rw;
-  std::string kind;
-  std::uint32_t service_cycles = 0;
-  std::uint32_t retries = 0;
-  std::size_t source_line = 0;
-};
-
+inline constexpr std::uint64_t kDefaultStreamWindowTicks = 65536;
+// Stdin/FIFO inputs report progress every this many replayed records.
+inline constexpr std::size_t kDefaultLiveRollingRecords = 100000;
+// Segment size bounds for segmented batch replay.
+inline constexpr std::size_t kMinReplaySegmentRecords = 4096;
+inline constexpr std::size_t kMaxReplaySegmentRecords = 65536;
+
+using trace_replay::AccessKind;
+using trace_replay::CacheBucket;
+using trace_replay::Classification;
+using trace_replay::InputStats;
+using trace_replay::KnownGapReason;
+using trace_replay::Master;
+using trace_replay::QuantileSketch;
+using trace_replay::TopK;
+using trace_replay::Rw;
+using trace_replay::TraceRecord;
+using trace_replay::WaitMetricKind;
+using trace_replay::addr_text;
+using trace_replay::cache_bucket_name;
+using trace_replay::classification_name;
+using trace_replay::classify_cache_bucket;
+using trace_replay::json_escape;
+using trace_replay::kind_label;
+using trace_replay::known_gap_reason_name;
+using trace_replay::master_label;
+using trace_replay::parse_u64;
+using trace_replay::region_name;
+using trace_replay::rw_label;
+using trace_replay::wait_metric_kind_name;
+
+// Per-record replay outcome. Observed service/retries live in `record`; labels
+// are rendered from the enum ids only when output is written.
 struct ReplayResult {
   TraceRecord record{};
 
-  std::uint32_t ymir_service_cycles = 0;
-  std::uint32_t ymir_retries = 0;
   std::uint32_t ymir_elapsed = 0;
   std::uint32_t ymir_wait = 0;
-  std::string ymir_wait_metric_kind;
-  std::string cache_bucket;
 
   std::uint32_t model_predicted_service = 0;
   std::uint32_t model_predicted_wait = 0;
   std::uint32_t model_predicted_total = 0;
 
-  std::uint32_t base_latency = 0;
-  std::uint32_t contention_stall = 0;
-  std::uint32_t total_predicted = 0;
-
   std::int64_t model_vs_trace_wait_delta = 0;
   std::int64_t model_vs_trace_total_delta = 0;
 
   std::int64_t cumulative_drift_wait = 0;
   std::int64_t cumulative_drift_total = 0;
 
-  std::string classification;
-  std::string known_gap_reason;
+  WaitMetricKind ymir_wait_metric_kind = WaitMetricKind::ExactTickElapsedExclusive;
+  CacheBucket cache_bucket = CacheBucket::NotApplicable;
+  Classification classification = Classification::Agreement;
+  KnownGapReason known_gap_reason = KnownGapReason::None;
 };
 
 struct Options {
   std::string input_path;
   std::optional<std::string> annotated_output_path;
+  trace_replay::AnnotatedFormat annotated_format = trace_replay::AnnotatedFormat::Jsonl;
   std::optional<std::string> summary_output_path;
   std::size_t top_k = 20;
   bool summary_only = false;
   bool include_model_comparison = false;
   std::optional<std::size_t> annotated_limit;
+  bool streaming = false;
+  std::uint64_t stream_window_ticks = kDefaultStreamWindowTicks;
+  std::size_t ingest_threads = 0; // 0 = hardware concurrency
+  std::size_t replay_threads = 0; // 0 = hardware concurrency
+  trace_replay::RecordWindow window;
+  trace_replay::IndexUse index_use = trace_replay::IndexUse::Auto;
+  std::optional<std::size_t> rolling_interval; // unset: default for live inputs, off otherwise
+  std::optional<std::vector<trace_replay::SweepVariant>> sweep;
+  bool calibrate = false;
+  std::optional<std::string> replay_cache_path;
+  bool cache_sim = false;
 };
 
 void print_help() {
-  std::cout << "Usage: trace_replay <input.{jsonl|bin}> [options]\n"
+  std::cout << "Usage: trace_replay <input.{jsonl|bin|btr2}|-> [options]\n"
             << "  --annotated-output <path>   Write annotated JSONL\n"
+            << "  --annotated-format <fmt>    Annotated output format: jsonl (default) or bin (fixed 104-byte records)\n"
             << "  --summary-output <path>     Write machine-readable summary JSON\n"
             << "  --summary-only              Skip annotated output even if path supplied\n"
             << "  --include-model-comparison  Enable arbiter/model-comparison metrics (hypothesis-only)\n"
             << "  --annotated-limit <N>       Emit first N annotated rows\n"
             << "  --top <N>                   Legacy alias for --top-k\n"
             << "  --top-k <N>                 Number of ranked entries to emit\n"
+            << "  --streaming                 Replay incrementally through a bounded reorder window\n"
+            << "  --stream-window <ticks>     Reorder window for --streaming (default 65536)\n"
+            << "  --ingest-threads <N>        JSONL parse threads (default: hardware concurrency)\n"
+            << "  --replay-threads <N>        Batch replay threads (default: hardware concurrency)\n"
+            << "  --sweep <grid>              Also replay every arbiter/timing variant of <grid> and rank them, e.g.\n"
+            << "                              'same_address_contention=0..3;tie_turnaround=0,1;read:VDP2=18,20'\n"
+            << "  --calibrate                 Fit the Ymir region timing table to the capture instead of replaying;\n"
+            << "                              prints a suggested table and residuals (--summary-output: JSON)\n"
+            << "  --cache-sim                 Also simulate each SH-2's 4 KB 4-way cache over its ifetch/read stream; reports\n"
+            << "                              hit rates, miss hotspots by 16-byte line and agreement with observed cache buckets\n"
+            << "  --replay-cache <path>       Keep replay state per input block in <path>; a rerun on a capture that only\n"
+            << "                              grew at the tail replays just the new blocks (JSONL/BTR1 files, summary only)\n"
+            << "  --seq-range <A:B>           Replay only records with A <= seq <= B (either bound may be omitted)\n"
+            << "  --tick-range <A:B>          Replay only records with A <= tick_complete <= B\n"
+            << "  --build-index               (Re)build the <input>.tridx sidecar index\n"
+            << "  --no-index                  Scan the whole input for range replays; never read or write the sidecar\n"
+            << "  --rolling-interval <N>      Print a rolling summary line every N replayed records (0 = off;\n"
+            << "                              default 100000 for stdin/FIFO inputs, off for files)\n"
             << "  --help                      Show this help\n"
-            << "Schema: Phase 1 per-successful-access JSONL records or BTR1 binary v1 records.\n"
+            << "Schema: Phase 1 per-successful-access JSONL records, BTR1 binary v1 records, or BTR2 columnar blocks.\n"
+            << "Input '-' or a FIFO is read live (JSONL or BTR1) and replayed with --streaming.\n"
             << "Comparative replay only: keeps recorded Ymir ticks; does not retime downstream records.\n";
 }
 
-std::optional<std::string_view> find_value_span(std::string_view line, std::string_view key) {
-  const std::string needle = std::string("\"") + std::string(key) + "\"";
-  const auto key_pos = line.find(needle);
-  if (key_pos == std::string_view::npos) {
-    return std::nullopt;
-  }
-  const auto colon = line.find(':', key_pos + needle.size());
-  if (colon == std::string_view::npos) {
-    return std::nullopt;
-  }
-  std::size_t start = colon + 1;
-  while (start < line.size() && (line[start] == ' ' || line[start] == '\t')) {
-    ++start;
-  }
-  if (start >= line.size()) {
-    return std::nullopt;
-  }
-  if (line[start] == '"') {
-    std::size_t end = start + 1;
-    while (end < line.size() && line[end] != '"') {
-      ++end;
-    }
-    if (end >= line.size()) {
-      return std::nullopt;
-    }
-    return line.substr(start + 1, end - start - 1);
-  }
-
-  std::size_t end = start;
-  while (end < line.size() && line[end] != ',' && line[end] != '}') {
-    ++end;
-  }
-  return line.substr(start, end - start);
+std::string size_label(std::uint8_t size) {
+  if (size == 1U) return "B";
+  if (size == 2U) return "W";
+  if (size == 4U) return "L";
+  return std::to_string(size);
 }
 
-std::optional<std::uint64_t> parse_u64(std::string_view text) {
-  std::uint64_t value = 0;
-  auto result = std::from_chars(text.data(), text.data() + text.size(), value, 10);
-  if (result.ec != std::errc{} || result.ptr != text.data() + text.size()) {
-    return std::nullopt;
-  }
-  return value;
-}
+double percentile(const QuantileSketch &values, double pct) { return values.quantile(pct); }
 
-std::optional<std::uint32_t> parse_addr(std::string_view text) {
-  std::string_view trimmed = text;
-  if (trimmed.rfind("0x", 0) == 0 || trimmed.rfind("0X", 0) == 0) {
-    trimmed.remove_prefix(2);
-  }
-  std::uint32_t value = 0;
-  auto result = std::from_chars(trimmed.data(), trimmed.data() + trimmed.size(), value, 16);
-  if (result.ec != std::errc{} || result.ptr != trimmed.data() + trimmed.size()) {
-    return std::nullopt;
-  }
-  return value;
+// Ranking score: |value| without the llabs(INT64_MIN) overflow.
+std::uint64_t magnitude(std::int64_t value) {
+  return value < 0 ? std::uint64_t{0} - static_cast<std::uint64_t>(value) : static_cast<std::uint64_t>(value);
 }
 
-std::optional<TraceRecord> parse_record(const std::string &line, std::size_t source_line) {
-  const auto seq = find_value_span(line, "seq");
-  const auto master = find_value_span(line, "master");
-  const auto tick_first_attempt = find_value_span(line, "tick_first_attempt");
-  const auto tick_complete = find_value_span(line, "tick_complete");
-  const auto addr = find_value_span(line, "addr");
-  const auto size = find_value_span(line, "size");
-  const auto rw = find_value_span(line, "rw");
-  const auto kind = find_value_span(line, "kind");
-  const auto service_cycles = find_value_span(line, "service_cycles");
-  const auto retries = find_value_span(line, "retries");
-
-  if (!seq || !master || !tick_first_attempt || !tick_complete || !addr || !size || !rw || !kind || !service_cycles || !retries) {
-    return std::nullopt;
+struct ObservedBucketStats {
+  std::size_t sample_size = 0;
+  std::size_t observed_wait_nonzero_count = 0;
+  QuantileSketch observed_elapsed_values;
+  QuantileSketch observed_wait_values;
+
+  ObservedBucketStats &operator+=(const ObservedBucketStats &other) {
+    sample_size += other.sample_size;
+    observed_wait_nonzero_count += other.observed_wait_nonzero_count;
+    observed_elapsed_values += other.observed_elapsed_values;
+    observed_wait_values += other.observed_wait_values;
+    return *this;
   }
 
-  const auto parsed_seq = parse_u64(*seq);
-  const auto parsed_tfa = parse_u64(*tick_first_attempt);
-  const auto parsed_tc = parse_u64(*tick_complete);
-  const auto parsed_addr = parse_addr(*addr);
-  const auto parsed_size = parse_u64(*size);
-  const auto parsed_service = parse_u64(*service_cycles);
-  const auto parsed_retries = parse_u64(*retries);
+  void save(trace_replay::StateWriter &out) const {
+    out.put(sample_size);
+    out.put(observed_wait_nonzero_count);
+    observed_elapsed_values.save(out);
+    observed_wait_values.save(out);
+  }
 
-  if (!parsed_seq || !parsed_tfa || !parsed_tc || !parsed_addr || !parsed_size || !parsed_service || !parsed_retries) {
-    return std::nullopt;
+  bool load(trace_replay::StateReader &in) {
+    return in.get(sample_size) && in.get(observed_wait_nonzero_count) && observed_elapsed_values.load(in) && observed_wait_values.load(in);
   }
+};
 
-  TraceRecord rec{};
-  rec.seq = *parsed_seq;
-  rec.master = std::string(*master);
-  rec.tick_first_attempt = *parsed_tfa;
-  rec.tick_complete = *parsed_tc;
-  rec.addr = *parsed_addr;
-  rec.addr_text = std::string(*addr);
-  rec.size = static_cast<std::uint8_t>(*parsed_size);
-  rec.rw = std::string(*rw);
-  rec.kind = std::string(*kind);
-  rec.service_cycles = static_cast<std::uint32_t>(*parsed_service);
-  rec.retries = static_cast<std::uint32_t>(*parsed_retries);
-  rec.source_line = source_line;
-  return rec;
+// Dense ids for the per-record distribution counters. The kind id varies
+// slowest because interned (non-canonical) kinds are the only unbounded
+// dimension and simply extend the tables.
+using trace_replay::DenseTable;
+using trace_replay::Region;
+using trace_replay::kCacheBucketCount;
+using trace_replay::kCanonicalMasterCount;
+using trace_replay::kClassificationCount;
+using trace_replay::kRegionCount;
+
+constexpr std::size_t kCanonicalKindCount = 5;
+constexpr std::size_t kMasterRegionIds = kCanonicalMasterCount * kRegionCount;
+constexpr std::size_t kMasterRegionKindIds = kCanonicalKindCount * kRegionCount * kCanonicalMasterCount;
+
+std::size_t master_region_id(const TraceRecord &record) {
+  return static_cast<std::size_t>(record.master) * kRegionCount + static_cast<std::size_t>(record.region);
 }
 
-std::optional<busarb::BusMasterId> parse_master(const std::string &master) {
-  if (master == "MSH2") return busarb::BusMasterId::SH2_A;
-  if (master == "SSH2") return busarb::BusMasterId::SH2_B;
-  if (master == "DMA") return busarb::BusMasterId::DMA;
-  return std::nullopt;
+std::size_t master_region_kind_id(const TraceRecord &record) {
+  return (static_cast<std::size_t>(record.kind) * kRegionCount + static_cast<std::size_t>(record.region)) * kCanonicalMasterCount +
+         static_cast<std::size_t>(record.master);
 }
 
-std::string region_name(std::uint32_t addr) {
-  if (addr <= 0x00FFFFFFU) return "BIOS ROM";
-  if (addr >= 0x01000000U && addr <= 0x017FFFFFU) return "SMPC";
-  if (addr >= 0x01800000U && addr <= 0x01FFFFFFU) return "Backup RAM";
-  if (addr >= 0x02000000U && addr <= 0x02FFFFFFU) return "Low WRAM";
-  if (addr >= 0x10000000U && addr <= 0x1FFFFFFFU) return "MINIT/SINIT";
-  if (addr >= 0x20000000U && addr <= 0x4FFFFFFFU) return "A-Bus CS0/CS1";
-  if (addr >= 0x05000000U && addr <= 0x057FFFFFU) return "A-Bus dummy";
-  if (addr >= 0x05800000U && addr <= 0x058FFFFFU) return "CD Block CS2";
-  if (addr >= 0x05A00000U && addr <= 0x05BFFFFFU) return "SCSP";
-  if (addr >= 0x05C00000U && addr <= 0x05C7FFFFU) return "VDP1 VRAM";
-  if (addr >= 0x05C80000U && addr <= 0x05CFFFFFU) return "VDP1 FB";
-  if (addr >= 0x05D00000U && addr <= 0x05D7FFFFU) return "VDP1 regs";
-  if (addr >= 0x05E00000U && addr <= 0x05FBFFFFU) return "VDP2";
-  if (addr >= 0x05FE0000U && addr <= 0x05FEFFFFU) return "SCU regs";
-  if (addr >= 0x06000000U && addr <= 0x07FFFFFFU) return "High WRAM";
-  if (addr >= 0xFFFFFE00U && addr <= 0xFFFFFFFFU) return "SH-2 on-chip regs";
-  return "Unmapped";
+std::size_t master_region_kind_bucket_id(const TraceRecord &record, CacheBucket bucket) {
+  return master_region_kind_id(record) * kCacheBucketCount + static_cast<std::size_t>(bucket);
 }
 
-bool is_high_wram(std::uint32_t addr) {
-  return addr >= 0x06000000U && addr <= 0x07FFFFFFU;
+std::size_t region_classification_id(Region region, Classification classification) {
+  return static_cast<std::size_t>(region) * kClassificationCount + static_cast<std::size_t>(classification);
 }
 
-std::string classify_cache_bucket(std::uint32_t addr, std::uint32_t service_cycles) {
-  if (!is_high_wram(addr)) {
-    return "not_applicable";
-  }
-  if (service_cycles == 1U) {
-    return "cache_hit";
-  }
-  if (service_cycles == 2U) {
-    return "uncached_or_through";
-  }
-  if (service_cycles == 4U) {
-    return "cache_miss_half";
-  }
-  if (service_cycles == 8U) {
-    return "cache_miss_full";
-  }
-  return "anomaly";
+std::string master_region_label(std::size_t id) {
+  return master_label(static_cast<Master>(id / kRegionCount)) + " | " + region_name(static_cast<Region>(id % kRegionCount));
 }
 
-std::string json_escape(const std::string &input) {
-  std::string out;
-  out.reserve(input.size());
-  for (char c : input) {
-    if (c == '"' || c == '\\') {
-      out.push_back('\\');
-    }
-    out.push_back(c);
-  }
-  return out;
+std::string master_region_kind_label(std::size_t id) {
+  const auto master = static_cast<Master>(id % kCanonicalMasterCount);
+  const std::size_t kind_region = id / kCanonicalMasterCount;
+  return master_label(master) + " | " + region_name(static_cast<Region>(kind_region % kRegionCount)) + " | " +
+         kind_label(static_cast<AccessKind>(kind_region / kRegionCount));
 }
 
-
-std::uint32_t estimate_local_wait_cycles(const TraceRecord &record,
-                                        const std::optional<TraceRecord> &previous_record,
-                                        const busarb::ArbiterConfig &config) {
-  if (!previous_record.has_value()) {
-    return 0U;
-  }
-
-  std::uint32_t wait = 0U;
-  if (previous_record->addr == record.addr) {
-    wait += config.same_address_contention;
-  }
-
-  const auto prev_master = parse_master(previous_record->master);
-  const auto cur_master = parse_master(record.master);
-  const bool sh2_tie = prev_master.has_value() && cur_master.has_value() &&
-                       previous_record->tick_first_attempt == record.tick_first_attempt &&
-                       *prev_master != busarb::BusMasterId::DMA && *cur_master != busarb::BusMasterId::DMA &&
-                       *prev_master != *cur_master;
-  if (sh2_tie) {
-    wait += config.tie_turnaround;
-  }
-
-  return wait;
-}
-
-std::string size_label(std::uint8_t size) {
-  if (size == 1U) return "B";
-  if (size == 2U) return "W";
-  if (size == 4U) return "L";
-  return std::to_string(size);
+std::string master_region_kind_bucket_label(std::size_t id) {
+  return master_region_kind_label(id / kCacheBucketCount) + " | " + cache_bucket_name(static_cast<CacheBucket>(id % kCacheBucketCount));
 }
 
-double percentile(std::vector<std::int64_t> values, double pct) {
-  if (values.empty()) {
-    return 0.0;
-  }
-  std::sort(values.begin(), values.end());
-  const double index = pct * static_cast<double>(values.size() - 1);
-  const auto lo = static_cast<std::size_t>(std::floor(index));
-  const auto hi = static_cast<std::size_t>(std::ceil(index));
-  if (lo == hi) {
-    return static_cast<double>(values[lo]);
-  }
-  const double frac = index - static_cast<double>(lo);
-  return static_cast<double>(values[lo]) + (static_cast<double>(values[hi]) - static_cast<double>(values[lo])) * frac;
+std::string region_classification_label(std::size_t id) {
+  return region_name(static_cast<Region>(id / kClassificationCount)) + " | " +
+         classification_name(static_cast<Classification>(id % kClassificationCount));
 }
 
-
-struct InputStats {
-  std::size_t total_events = 0;
-  std::size_t malformed_lines = 0;
-  std::size_t duplicate_seq_count = 0;
-  std::size_t non_monotonic_seq_count = 0;
-};
-
-struct ObservedBucketStats {
-  std::size_t sample_size = 0;
-  std::size_t observed_wait_nonzero_count = 0;
-  std::vector<std::int64_t> observed_elapsed_values;
-  std::vector<std::int64_t> observed_wait_values;
-};
-
 struct SymmetryCheckEntry {
   std::string bucket;
   ObservedBucketStats msh2;
@@ -323,179 +242,37 @@ struct SymmetryCheckEntry {
   std::string notes;
 };
 
-struct BinaryTraceRecordV1 {
-  std::uint64_t seq;
-  std::uint64_t tick_first_attempt;
-  std::uint64_t tick_complete;
-  std::uint64_t service_cycles;
-  std::uint64_t retries;
-  std::uint32_t addr;
-  std::uint8_t size;
-  std::uint8_t master;
-  std::uint8_t rw;
-  std::uint8_t kind;
-};
-static_assert(sizeof(BinaryTraceRecordV1) == 48, "BinaryTraceRecordV1 must be 48 bytes");
-
-std::string to_hex32(std::uint32_t value) {
-  static constexpr char kDigits[] = "0123456789ABCDEF";
-  std::string out = "0x00000000";
-  for (int i = 0; i < 8; ++i) {
-    out[9 - i] = kDigits[(value >> (i * 4)) & 0xF];
-  }
-  return out;
-}
-
-std::optional<std::string> decode_master(std::uint8_t value) {
-  if (value == 0) return std::string("MSH2");
-  if (value == 1) return std::string("SSH2");
-  if (value == 2) return std::string("DMA");
-  return std::nullopt;
-}
-
-std::optional<std::string> decode_rw(std::uint8_t value) {
-  if (value == 0) return std::string("R");
-  if (value == 1) return std::string("W");
-  return std::nullopt;
-}
-
-std::optional<std::string> decode_kind(std::uint8_t value) {
-  if (value == 0) return std::string("ifetch");
-  if (value == 1) return std::string("read");
-  if (value == 2) return std::string("write");
-  if (value == 3) return std::string("mmio_read");
-  if (value == 4) return std::string("mmio_write");
-  return std::nullopt;
-}
-
-bool load_jsonl_records(const std::string &path, std::vector<TraceRecord> &records, InputStats &stats) {
-  std::ifstream input(path);
-  if (!input.is_open()) {
-    std::cerr << "Failed to open input file: " << path << '\n';
+// --build-index without a range: refresh the sidecar, then replay as usual.
+bool build_index_sidecar(const Options &options) {
+  trace_replay::MappedFile file;
+  if (!file.open(options.input_path)) {
+    std::cerr << "Failed to open input file: " << options.input_path << '\n';
     return false;
   }
-
-  std::set<std::uint64_t> seen_seq_values;
-  std::optional<std::uint64_t> previous_seq_in_input;
-  std::string line;
-  std::size_t line_number = 0;
-  while (std::getline(input, line)) {
-    ++line_number;
-    if (line.empty()) {
-      continue;
-    }
-    ++stats.total_events;
-    auto rec = parse_record(line, line_number);
-    if (!rec.has_value()) {
-      ++stats.malformed_lines;
-      std::cerr << "warning: malformed line " << line_number << " skipped\n";
-      continue;
-    }
-    if (seen_seq_values.find(rec->seq) != seen_seq_values.end()) {
-      ++stats.duplicate_seq_count;
-      std::cerr << "warning: duplicate seq " << rec->seq << " on line " << line_number << '\n';
-    }
-    seen_seq_values.insert(rec->seq);
-
-    if (previous_seq_in_input.has_value() && rec->seq <= *previous_seq_in_input) {
-      ++stats.non_monotonic_seq_count;
-      std::cerr << "warning: non-monotonic seq " << rec->seq << " on line " << line_number << '\n';
-    }
-    previous_seq_in_input = rec->seq;
-    records.push_back(*rec);
+  if (trace_replay::is_binary_input(options.input_path) && trace_replay::has_btr2_magic(file.bytes())) {
+    std::cerr << "note: BTR2 inputs carry their own block index; no sidecar written\n";
+    return true;
   }
-  return true;
+  const auto format = trace_replay::is_binary_input(options.input_path) ? trace_replay::IndexedFormat::Btr1 : trace_replay::IndexedFormat::Jsonl;
+  return trace_replay::resolve_trace_index(options.input_path, file, format, options.window, trace_replay::IndexUse::Build, options.ingest_threads)
+      .has_value();
 }
 
-bool load_binary_records(const std::string &path, std::vector<TraceRecord> &records, InputStats &stats) {
-  std::ifstream input(path, std::ios::binary);
-  if (!input.is_open()) {
-    std::cerr << "Failed to open input file: " << path << '\n';
-    return false;
-  }
-
-  std::array<char, 8> header{};
-  input.read(header.data(), static_cast<std::streamsize>(header.size()));
-  if (input.gcount() != static_cast<std::streamsize>(header.size())) {
-    std::cerr << "error: truncated binary header\n";
-    return false;
+// Range replays go through the index so only overlapping spans are parsed.
+template <typename Sink>
+bool read_input_records(const Options &options, InputStats &stats, Sink &&sink) {
+  if (options.window.active()) {
+    return trace_replay::read_trace_window(options.input_path, options.window, options.index_use, options.ingest_threads, stats,
+                                           std::forward<Sink>(sink));
   }
-  if (!(header[0] == 'B' && header[1] == 'T' && header[2] == 'R' && header[3] == '1')) {
-    std::cerr << "error: invalid binary magic (expected BTR1)\n";
+  if (options.index_use == trace_replay::IndexUse::Build && !build_index_sidecar(options)) {
     return false;
   }
-  const std::uint16_t version = static_cast<std::uint8_t>(header[4]) | (static_cast<std::uint16_t>(static_cast<std::uint8_t>(header[5])) << 8);
-  const std::uint16_t record_size = static_cast<std::uint8_t>(header[6]) | (static_cast<std::uint16_t>(static_cast<std::uint8_t>(header[7])) << 8);
-  if (version != 1) {
-    std::cerr << "error: unsupported binary trace version " << version << " (expected 1)\n";
-    return false;
-  }
-  if (record_size != sizeof(BinaryTraceRecordV1)) {
-    std::cerr << "error: unsupported binary record size " << record_size << " (expected " << sizeof(BinaryTraceRecordV1) << ")\n";
-    return false;
-  }
-
-  std::set<std::uint64_t> seen_seq_values;
-  std::optional<std::uint64_t> previous_seq;
-  std::size_t index = 0;
-  while (true) {
-    BinaryTraceRecordV1 raw{};
-    input.read(reinterpret_cast<char *>(&raw), sizeof(raw));
-    const auto got = input.gcount();
-    if (got == 0) {
-      break;
-    }
-    if (got != static_cast<std::streamsize>(sizeof(raw))) {
-      std::cerr << "error: truncated binary record at index " << index << "\n";
-      return false;
-    }
-    ++stats.total_events;
-
-    auto master = decode_master(raw.master);
-    auto rw = decode_rw(raw.rw);
-    auto kind = decode_kind(raw.kind);
-    if (!master.has_value() || !rw.has_value() || !kind.has_value() || !(raw.size == 1 || raw.size == 2 || raw.size == 4)) {
-      ++stats.malformed_lines;
-      std::cerr << "warning: malformed binary record at index " << index << " skipped\n";
-      ++index;
-      continue;
-    }
-
-    TraceRecord rec{};
-    rec.seq = raw.seq;
-    rec.master = *master;
-    rec.tick_first_attempt = raw.tick_first_attempt;
-    rec.tick_complete = raw.tick_complete;
-    rec.addr = raw.addr;
-    rec.addr_text = to_hex32(raw.addr);
-    rec.size = raw.size;
-    rec.rw = *rw;
-    rec.kind = *kind;
-    rec.service_cycles = static_cast<std::uint32_t>(raw.service_cycles);
-    rec.retries = static_cast<std::uint32_t>(raw.retries);
-    rec.source_line = index + 1;
-
-    if (seen_seq_values.find(rec.seq) != seen_seq_values.end()) {
-      ++stats.duplicate_seq_count;
-      std::cerr << "warning: duplicate seq " << rec.seq << " in binary record " << index << '\n';
-    }
-    seen_seq_values.insert(rec.seq);
-    if (previous_seq.has_value() && rec.seq <= *previous_seq) {
-      ++stats.non_monotonic_seq_count;
-      std::cerr << "warning: non-monotonic seq " << rec.seq << " in binary record " << index << '\n';
-    }
-    previous_seq = rec.seq;
-    records.push_back(std::move(rec));
-    ++index;
-  }
-  return true;
+  return trace_replay::read_trace_records(options.input_path, options.ingest_threads, stats, std::forward<Sink>(sink));
 }
 
-bool load_input_records(const std::string &path, std::vector<TraceRecord> &records, InputStats &stats) {
-  if (path.size() >= 4 && path.substr(path.size() - 4) == ".bin") {
-    return load_binary_records(path, records, stats);
-  }
-  return load_jsonl_records(path, records, stats);
+bool load_input_records(const Options &options, std::vector<TraceRecord> &records, InputStats &stats) {
+  return read_input_records(options, stats, [&records](TraceRecord &&rec) { records.push_back(std::move(rec)); });
 }
 
 bool parse_options(int argc, char **argv, Options &opts) {
@@ -514,6 +291,18 @@ bool parse_options(int argc, char **argv, Options &opts) {
       opts.annotated_output_path = std::string(argv[++i]);
       continue;
     }
+    if (arg == "--annotated-format") {
+      if (i + 1 >= argc) return false;
+      const std::string format = argv[++i];
+      if (format == "jsonl") {
+        opts.annotated_format = trace_replay::AnnotatedFormat::Jsonl;
+      } else if (format == "bin") {
+        opts.annotated_format = trace_replay::AnnotatedFormat::Binary;
+      } else {
+        return false;
+      }
+      continue;
+    }
     if (arg == "--summary-output") {
       if (i + 1 >= argc) return false;
       opts.summary_output_path = std::string(argv[++i]);
@@ -541,7 +330,73 @@ bool parse_options(int argc, char **argv, Options &opts) {
       opts.top_k = static_cast<std::size_t>(*parsed);
       continue;
     }
-    if (!arg.empty() && arg[0] != '-') {
+    if (arg == "--streaming") {
+      opts.streaming = true;
+      continue;
+    }
+    if (arg == "--stream-window") {
+      if (i + 1 >= argc) return false;
+      const auto parsed = parse_u64(argv[++i]);
+      if (!parsed) return false;
+      opts.stream_window_ticks = *parsed;
+      continue;
+    }
+    if (arg == "--ingest-threads") {
+      if (i + 1 >= argc) return false;
+      const auto parsed = parse_u64(argv[++i]);
+      if (!parsed) return false;
+      opts.ingest_threads = static_cast<std::size_t>(*parsed);
+      continue;
+    }
+    if (arg == "--calibrate") {
+      opts.calibrate = true;
+      continue;
+    }
+    if (arg == "--replay-cache") {
+      if (i + 1 >= argc) return false;
+      opts.replay_cache_path = std::string(argv[++i]);
+      continue;
+    }
+    if (arg == "--cache-sim") {
+      opts.cache_sim = true;
+      continue;
+    }
+    if (arg == "--sweep") {
+      if (i + 1 >= argc) return false;
+      opts.sweep = trace_replay::parse_sweep_spec(argv[++i]);
+      if (!opts.sweep.has_value()) return false;
+      continue;
+    }
+    if (arg == "--replay-threads") {
+      if (i + 1 >= argc) return false;
+      const auto parsed = parse_u64(argv[++i]);
+      if (!parsed) return false;
+      opts.replay_threads = static_cast<std::size_t>(*parsed);
+      continue;
+    }
+    if (arg == "--seq-range" || arg == "--tick-range") {
+      if (i + 1 >= argc) return false;
+      const auto parsed = trace_replay::parse_u64_range(argv[++i]);
+      if (!parsed) return false;
+      (arg == "--seq-range" ? opts.window.seq : opts.window.tick) = *parsed;
+      continue;
+    }
+    if (arg == "--rolling-interval") {
+      if (i + 1 >= argc) return false;
+      const auto parsed = parse_u64(argv[++i]);
+      if (!parsed) return false;
+      opts.rolling_interval = static_cast<std::size_t>(*parsed);
+      continue;
+    }
+    if (arg == "--build-index") {
+      opts.index_use = trace_replay::IndexUse::Build;
+      continue;
+    }
+    if (arg == "--no-index") {
+      opts.index_use = trace_replay::IndexUse::None;
+      continue;
+    }
+    if (arg == "-" || (!arg.empty() && arg[0] != '-')) {
       opts.input_path = arg;
       continue;
     }
@@ -550,639 +405,1423 @@ bool parse_options(int argc, char **argv, Options &opts) {
   return !opts.input_path.empty();
 }
 
-} // namespace
-
-int main(int argc, char **argv) {
-  Options options{};
-  if (!parse_options(argc, argv, options)) {
-    print_help();
-    return 1;
-  }
+// A contiguous slice of the sorted batch records plus the input-derived state
+// the serial loop would carry into it.
+struct ReplaySegment {
+  std::size_t begin = 0;
+  std::size_t end = 0;
+  std::optional<TraceRecord> previous_valid; // last valid-master record before `begin`
+  busarb::BusMasterMask round_robin_last = 0;
+  std::size_t valid_before = 0;
+};
 
-  std::vector<TraceRecord> records;
-  InputStats input_stats{};
-  if (!load_input_records(options.input_path, records, input_stats)) {
-    return 1;
+// Incremental replay state. Records must be fed in replay order
+// (tick_complete, seq, input order); batch and streaming modes differ only
+// in how they establish that order.
+class ReplaySession {
+public:
+  explicit ReplaySession(const Options &options) : options_(options), top_cumulative_(options.top_k), top_normalized_(options.top_k) {
+    if (options_.include_model_comparison) {
+      arbiter_.emplace(busarb::YmirTiming{}, arbiter_config_);
+    }
+    if (options_.sweep.has_value()) {
+      sweep_.emplace(*options_.sweep);
+    }
+    if (options_.cache_sim) {
+      cache_sim_.emplace();
+    }
   }
 
-  const std::size_t malformed_lines = input_stats.malformed_lines;
-  const std::size_t duplicate_seq_count = input_stats.duplicate_seq_count;
-  const std::size_t non_monotonic_seq_count = input_stats.non_monotonic_seq_count;
-  const std::size_t nonempty_lines = input_stats.total_events;
-
-  std::stable_sort(records.begin(), records.end(), [](const TraceRecord &a, const TraceRecord &b) {
-    if (a.tick_complete != b.tick_complete) return a.tick_complete < b.tick_complete;
-    return a.seq < b.seq;
-  });
-
-
-  std::vector<TraceRecord> filtered_records;
-  filtered_records.reserve(records.size());
-  std::map<std::string, std::size_t> included_master_distribution;
-  std::map<std::string, std::size_t> included_region_distribution;
-  std::map<std::string, std::size_t> included_size_distribution;
-  std::map<std::string, std::size_t> included_rw_distribution;
-  std::map<std::string, std::size_t> included_access_kind_distribution;
-  std::map<std::string, std::size_t> included_master_region_distribution;
-  std::map<std::string, std::size_t> included_cache_bucket_distribution;
-  std::map<std::string, std::size_t> included_master_region_access_kind_cache_bucket_distribution;
-  std::map<std::string, std::size_t> excluded_reason_counts;
-  std::map<std::string, std::size_t> known_gap_bucket_counts;
-
-  for (const auto &record : records) {
-    if (!parse_master(record.master).has_value()) {
-      ++excluded_reason_counts["invalid_master"];
-      std::cerr << "warning: invalid master on line " << record.source_line << " skipped\n";
-      continue;
-    }
-    filtered_records.push_back(record);
-    included_master_distribution[record.master] += 1;
-    included_region_distribution[region_name(record.addr)] += 1;
-    included_size_distribution[size_label(record.size)] += 1;
-    included_rw_distribution[record.rw] += 1;
-    included_access_kind_distribution[record.kind] += 1;
-    included_master_region_distribution[record.master + " | " + region_name(record.addr)] += 1;
-    const std::string bucket = classify_cache_bucket(record.addr, record.service_cycles);
-    included_cache_bucket_distribution[bucket] += 1;
-    included_master_region_access_kind_cache_bucket_distribution[record.master + " | " + region_name(record.addr) + " | " + record.kind + " | " + bucket] += 1;
-    if (record.size == 1U) {
-      known_gap_bucket_counts["byte_access_wait_check_gap_candidate"] += 1;
+  bool begin() {
+    if (!options_.summary_only && options_.annotated_output_path.has_value()) {
+      if (!annotated_file_.open(*options_.annotated_output_path, options_.annotated_format)) {
+        std::cerr << "Failed to open annotated output path: " << *options_.annotated_output_path << '\n';
+        return false;
+      }
+      annotated_out_ = &annotated_file_.buffer();
     }
+    return true;
   }
 
-  excluded_reason_counts["malformed_line"] += malformed_lines;
-  const std::size_t total_events = nonempty_lines;
-  const std::size_t included_events = filtered_records.size();
-  const std::size_t excluded_events = total_events >= included_events ? (total_events - included_events) : 0;
+  [[nodiscard]] bool annotating() const { return annotated_out_ != nullptr; }
 
-  const busarb::ArbiterConfig arbiter_config{};
-  std::optional<busarb::Arbiter> arbiter;
-  if (options.include_model_comparison) {
-    arbiter.emplace(busarb::TimingCallbacks{busarb::ymir_access_cycles, nullptr}, arbiter_config);
+  // Starts this session as one segment of a segmented batch replay. Annotated
+  // rows and warnings are buffered until the segment is absorbed.
+  void begin_segment(const ReplaySegment &segment, const busarb::ArbiterState &arbiter_state, bool annotate) {
+    diagnostics_ = &segment_diagnostics_;
+    if (annotate) {
+      annotated_out_ = &segment_annotated_;
+    }
+    annotated_rows_ = segment.valid_before;
+    if (arbiter_.has_value()) {
+      arbiter_->restore(arbiter_state);
+      previous_record_for_normalized_ = segment.previous_valid;
+    }
   }
-  std::optional<TraceRecord> previous_record_for_normalized;
 
-  std::vector<ReplayResult> results;
-  results.reserve(records.size());
+  [[nodiscard]] const busarb::ArbiterConfig &arbiter_config() const { return arbiter_config_; }
 
-  std::size_t known_gap_count = 0;
-  std::size_t known_gap_byte_access_count = 0;
-  std::size_t cumulative_agreement_count = 0;
-  std::size_t cumulative_mismatch_count = 0;
-  std::size_t normalized_agreement_count = 0;
-  std::size_t normalized_mismatch_count = 0;
-
-  std::map<std::string, std::size_t> histogram;
-  std::map<std::string, std::size_t> normalized_by_master;
-  std::map<std::string, std::size_t> normalized_by_region;
-  std::map<std::string, std::size_t> normalized_by_size;
-  std::map<std::string, std::size_t> normalized_mismatch_by_master_region_access_kind;
-  std::map<std::string, std::size_t> sample_size_by_master_region_access_kind;
-  std::map<std::string, std::vector<std::int64_t>> normalized_delta_by_access_kind;
-  std::map<std::string, ObservedBucketStats> observed_bucket_stats_by_master_region_access_kind_cache_bucket;
+  // Folds in the next segment, in replay order.
+  void absorb(ReplaySession &segment) {
+    if (annotated_out_ != nullptr) {
+      annotated_out_->append(segment.segment_annotated_.view());
+      annotated_file_.commit();
+    }
+    const std::string_view warnings = segment.segment_diagnostics_.view();
+    diagnostics_->write(warnings.data(), static_cast<std::streamsize>(warnings.size()));
+    annotated_rows_ = segment.annotated_rows_;
+
+    included_events_ += segment.included_events_;
+    records_processed_ += segment.records_processed_;
+    observed_wait_nonzero_count_ += segment.observed_wait_nonzero_count_;
+    included_master_distribution_ += segment.included_master_distribution_;
+    included_region_distribution_ += segment.included_region_distribution_;
+    included_size_distribution_ += segment.included_size_distribution_;
+    included_rw_distribution_ += segment.included_rw_distribution_;
+    included_access_kind_distribution_ += segment.included_access_kind_distribution_;
+    included_master_region_distribution_ += segment.included_master_region_distribution_;
+    included_cache_bucket_distribution_ += segment.included_cache_bucket_distribution_;
+    included_master_region_access_kind_cache_bucket_distribution_ += segment.included_master_region_access_kind_cache_bucket_distribution_;
+    for (const auto &[reason, count] : segment.excluded_reason_counts_) {
+      excluded_reason_counts_[reason] += count;
+    }
+    byte_access_gap_candidates_ += segment.byte_access_gap_candidates_;
+
+    known_gap_count_ += segment.known_gap_count_;
+    known_gap_byte_access_count_ += segment.known_gap_byte_access_count_;
+    cumulative_agreement_count_ += segment.cumulative_agreement_count_;
+    cumulative_mismatch_count_ += segment.cumulative_mismatch_count_;
+    normalized_agreement_count_ += segment.normalized_agreement_count_;
+    normalized_mismatch_count_ += segment.normalized_mismatch_count_;
+    sum_base_latency_ += segment.sum_base_latency_;
+    sum_contention_stall_ += segment.sum_contention_stall_;
+    sum_total_predicted_ += segment.sum_total_predicted_;
+    if (segment.records_processed_ != 0U) {
+      final_cumulative_drift_wait_ = segment.final_cumulative_drift_wait_;
+      final_cumulative_drift_total_ = segment.final_cumulative_drift_total_;
+      last_tick_complete_ = segment.last_tick_complete_;
+      if (arbiter_.has_value()) {
+        arbiter_->restore(segment.arbiter_->state());
+        previous_record_for_normalized_ = segment.previous_record_for_normalized_;
+      }
+    }
 
-  std::vector<std::int64_t> normalized_wait_deltas;
-  normalized_wait_deltas.reserve(records.size());
+    histogram_ += segment.histogram_;
+    normalized_by_master_ += segment.normalized_by_master_;
+    normalized_by_region_ += segment.normalized_by_region_;
+    normalized_by_size_ += segment.normalized_by_size_;
+    normalized_mismatch_by_master_region_access_kind_ += segment.normalized_mismatch_by_master_region_access_kind_;
+    sample_size_by_master_region_access_kind_ += segment.sample_size_by_master_region_access_kind_;
+    normalized_delta_by_access_kind_ += segment.normalized_delta_by_access_kind_;
+    observed_bucket_stats_by_master_region_access_kind_cache_bucket_ += segment.observed_bucket_stats_by_master_region_access_kind_cache_bucket_;
+    normalized_wait_deltas_ += segment.normalized_wait_deltas_;
+    top_cumulative_.merge(segment.top_cumulative_);
+    top_normalized_.merge(segment.top_normalized_);
+  }
 
-  for (const auto &record : filtered_records) {
-    const auto master = parse_master(record.master);
+  void consume(const TraceRecord &record) {
+    if (!trace_replay::is_valid_master(record.master)) {
+      ++excluded_reason_counts_["invalid_master"];
+      *diagnostics_ << "warning: invalid master on line " << record.source_line << " skipped\n";
+      return;
+    }
+    ++included_events_;
+    const CacheBucket bucket = classify_cache_bucket(record.region, record.service_cycles);
+    const std::size_t mrk_id = master_region_kind_id(record);
+    const std::size_t mrkb_id = master_region_kind_bucket_id(record, bucket);
+    included_master_distribution_[static_cast<std::size_t>(record.master)] += 1;
+    included_region_distribution_[static_cast<std::size_t>(record.region)] += 1;
+    included_size_distribution_[record.size] += 1;
+    included_rw_distribution_[static_cast<std::size_t>(record.rw)] += 1;
+    included_access_kind_distribution_[static_cast<std::size_t>(record.kind)] += 1;
+    included_master_region_distribution_[master_region_id(record)] += 1;
+    included_cache_bucket_distribution_[static_cast<std::size_t>(bucket)] += 1;
+    included_master_region_access_kind_cache_bucket_distribution_[mrkb_id] += 1;
+    if (record.size == 1U) {
+      ++byte_access_gap_candidates_;
+    }
 
     ReplayResult r{};
     r.record = record;
-    r.observed_service_cycles = record.service_cycles;
-    r.observed_retries = record.retries;
 
-    if (record.tick_complete >= record.tick_first_attempt) {
-      r.ymir_elapsed = static_cast<std::uint32_t>(record.tick_complete - record.tick_first_attempt);
-      r.ymir_wait_metric_kind = "exact_tick_elapsed_exclusive";
-    } else {
-      r.ymir_elapsed = static_cast<std::uint32_t>(r.ymir_retries * r.ymir_service_cycles + r.ymir_service_cycles);
-      r.ymir_wait_metric_kind = "proxy_retries_x_service";
-    }
-    r.ymir_wait = (r.ymir_elapsed > r.ymir_service_cycles) ? (r.ymir_elapsed - r.ymir_service_cycles) : 0U;
-    r.cache_bucket = classify_cache_bucket(record.addr, r.ymir_service_cycles);
+    const trace_replay::ObservedTiming observed = trace_replay::observed_timing(record);
+    r.ymir_elapsed = observed.elapsed;
+    r.ymir_wait = observed.wait;
+    r.ymir_wait_metric_kind = observed.kind;
+    r.cache_bucket = bucket;
+    observed_wait_nonzero_count_ += (r.ymir_wait > 0U ? 1U : 0U);
 
-    const std::string observed_bucket_key = record.master + " | " + region_name(record.addr) + " | " + record.kind + " | " + r.cache_bucket;
-    auto &observed_bucket_stats = observed_bucket_stats_by_master_region_access_kind_cache_bucket[observed_bucket_key];
+    auto &observed_bucket_stats = observed_bucket_stats_by_master_region_access_kind_cache_bucket_[mrkb_id];
     observed_bucket_stats.sample_size += 1;
     observed_bucket_stats.observed_wait_nonzero_count += (r.ymir_wait > 0U ? 1U : 0U);
-    observed_bucket_stats.observed_elapsed_values.push_back(static_cast<std::int64_t>(r.ymir_elapsed));
-    observed_bucket_stats.observed_wait_values.push_back(static_cast<std::int64_t>(r.ymir_wait));
+    observed_bucket_stats.observed_elapsed_values.add(static_cast<std::int64_t>(r.ymir_elapsed));
+    observed_bucket_stats.observed_wait_values.add(static_cast<std::int64_t>(r.ymir_wait));
+    if (sweep_.has_value()) {
+      sweep_->consume(record, r.ymir_wait);
+    }
+    if (cache_sim_.has_value()) {
+      static_cast<void>(cache_sim_->consume(record, bucket));
+    }
 
-    if (options.include_model_comparison) {
-      const busarb::BusRequest req{*master, record.addr, record.rw == "W", record.size, record.tick_first_attempt};
-      const std::uint64_t bus_before_commit = arbiter->bus_free_tick();
-      arbiter->commit_grant(req, record.tick_first_attempt);
-      const std::uint64_t bus_after_commit = arbiter->bus_free_tick();
+    if (options_.include_model_comparison) {
+      const bool is_write = record.rw == Rw::W;
+      // Canonical Master ids share their numbering with busarb::BusMasterId.
+      const busarb::BusRequest req{static_cast<busarb::BusMasterId>(record.master), record.addr, is_write, record.size, record.tick_first_attempt};
+      const std::uint64_t arbiter_start = arbiter_->reserve(req);
+      const std::uint64_t bus_after_commit = arbiter_->bus_free_tick();
 
-      r.arbiter_predicted_wait = estimate_local_wait_cycles(record, previous_record_for_normalized, arbiter_config);
-      r.arbiter_predicted_service = std::max(1U, busarb::ymir_access_cycles(nullptr, record.addr, record.rw == "W", record.size));
-      r.arbiter_predicted_total = r.arbiter_predicted_wait + r.arbiter_predicted_service;
-      r.base_latency = r.arbiter_predicted_service;
-      r.contention_stall = r.arbiter_predicted_wait;
-      r.total_predicted = r.arbiter_predicted_total;
+      r.model_predicted_wait = trace_replay::local_model_terms(record, previous_record_for_normalized_).predicted_wait(arbiter_config_);
+      r.model_predicted_service = std::max(1U, arbiter_->timing().access_cycles(record.addr, is_write, record.size));
+      r.model_predicted_total = r.model_predicted_wait + r.model_predicted_service;
 
-      r.normalized_delta_wait = static_cast<std::int64_t>(r.arbiter_predicted_wait) - static_cast<std::int64_t>(r.ymir_wait);
-      r.normalized_delta_total = static_cast<std::int64_t>(r.arbiter_predicted_total) - static_cast<std::int64_t>(r.ymir_elapsed);
+      r.model_vs_trace_wait_delta = static_cast<std::int64_t>(r.model_predicted_wait) - static_cast<std::int64_t>(r.ymir_wait);
+      r.model_vs_trace_total_delta = static_cast<std::int64_t>(r.model_predicted_total) - static_cast<std::int64_t>(r.ymir_elapsed);
 
       const std::uint64_t ymir_start = record.tick_first_attempt;
       const std::uint64_t ymir_end_exclusive = record.tick_complete + 1U;
-      const std::uint64_t arbiter_start = std::max(bus_before_commit, ymir_start);
       r.cumulative_drift_wait = static_cast<std::int64_t>(arbiter_start) - static_cast<std::int64_t>(ymir_start);
       r.cumulative_drift_total = static_cast<std::int64_t>(bus_after_commit) - static_cast<std::int64_t>(ymir_end_exclusive);
 
-      const bool known_byte_gap = (record.size == 1U && r.ymir_retries == 0U && r.normalized_delta_wait > 0);
+      const bool known_byte_gap = (record.size == 1U && record.retries == 0U && r.model_vs_trace_wait_delta > 0);
       if (known_byte_gap) {
-        r.classification = "known_ymir_wait_model_gap";
-        r.known_gap_reason = "byte_access_wait_check_gap";
-        ++known_gap_count;
-        ++known_gap_byte_access_count;
+        r.classification = Classification::KnownYmirWaitModelGap;
+        r.known_gap_reason = KnownGapReason::ByteAccessWaitCheckGap;
+        ++known_gap_count_;
+        ++known_gap_byte_access_count_;
       } else if (r.cumulative_drift_wait == 0 && r.cumulative_drift_total == 0) {
-        r.classification = "agreement";
-        ++cumulative_agreement_count;
+        r.classification = Classification::Agreement;
+        ++cumulative_agreement_count_;
       } else {
-        r.classification = "mismatch";
-        ++cumulative_mismatch_count;
+        r.classification = Classification::Mismatch;
+        ++cumulative_mismatch_count_;
       }
 
-      if (r.normalized_delta_wait == 0) {
-        ++normalized_agreement_count;
+      if (r.model_vs_trace_wait_delta == 0) {
+        ++normalized_agreement_count_;
       } else {
-        ++normalized_mismatch_count;
+        ++normalized_mismatch_count_;
       }
 
-      histogram[region_name(record.addr) + " | " + r.classification] += 1;
-      normalized_by_master[record.master] += (r.normalized_delta_wait == 0 ? 0U : 1U);
-      normalized_by_region[region_name(record.addr)] += (r.normalized_delta_wait == 0 ? 0U : 1U);
-      normalized_by_size[std::to_string(record.size)] += (r.normalized_delta_wait == 0 ? 0U : 1U);
-      const std::string mk = record.master + " | " + region_name(record.addr) + " | " + record.kind;
-      sample_size_by_master_region_access_kind[mk] += 1;
-      if (r.normalized_delta_wait != 0) {
-        normalized_mismatch_by_master_region_access_kind[mk] += 1;
+      histogram_[region_classification_id(record.region, r.classification)] += 1;
+      normalized_by_master_[static_cast<std::size_t>(record.master)] += (r.model_vs_trace_wait_delta == 0 ? 0U : 1U);
+      normalized_by_region_[static_cast<std::size_t>(record.region)] += (r.model_vs_trace_wait_delta == 0 ? 0U : 1U);
+      normalized_by_size_[record.size] += (r.model_vs_trace_wait_delta == 0 ? 0U : 1U);
+      sample_size_by_master_region_access_kind_[mrk_id] += 1;
+      if (r.model_vs_trace_wait_delta != 0) {
+        normalized_mismatch_by_master_region_access_kind_[mrk_id] += 1;
       }
-      normalized_delta_by_access_kind[record.kind].push_back(r.normalized_delta_wait);
-      normalized_wait_deltas.push_back(r.normalized_delta_wait);
+      normalized_delta_by_access_kind_[static_cast<std::size_t>(record.kind)].add(r.model_vs_trace_wait_delta);
+      normalized_wait_deltas_.add(r.model_vs_trace_wait_delta);
     } else {
-      r.classification = (r.ymir_wait > 0U) ? "wait_nonzero" : "wait_zero";
-      histogram[region_name(record.addr) + " | " + r.classification] += 1;
-      ++cumulative_agreement_count;
+      r.classification = (r.ymir_wait > 0U) ? Classification::WaitNonzero : Classification::WaitZero;
+      histogram_[region_classification_id(record.region, r.classification)] += 1;
+      ++cumulative_agreement_count_;
     }
 
-    results.push_back(r);
-    if (options.include_model_comparison) {
-      previous_record_for_normalized = record;
+    sum_base_latency_ += r.model_predicted_service;
+    sum_contention_stall_ += r.model_predicted_wait;
+    sum_total_predicted_ += r.model_predicted_total;
+    final_cumulative_drift_wait_ = r.cumulative_drift_wait;
+    final_cumulative_drift_total_ = r.cumulative_drift_total;
+    ++records_processed_;
+
+    write_annotated(r);
+    if (options_.include_model_comparison) {
+      // Rankings are only reported in model-comparison mode.
+      top_cumulative_.offer(magnitude(r.cumulative_drift_total), r);
+      top_normalized_.offer(magnitude(r.model_vs_trace_wait_delta), r);
+      previous_record_for_normalized_ = record;
+    }
+    last_tick_complete_ = record.tick_complete;
+    const std::size_t rolling_interval = options_.rolling_interval.value_or(0U);
+    if (rolling_interval != 0U && records_processed_ % rolling_interval == 0U) {
+      report_rolling();
     }
   }
 
-  const std::size_t records_processed = results.size();
+  // One progress line for live captures; interval_* counts cover the records
+  // since the previous line.
+  void report_rolling() {
+    std::cout << "rolling: records=" << records_processed_ << " last_tick_complete=" << last_tick_complete_
+              << " observed_wait_nonzero=" << observed_wait_nonzero_count_;
+    if (options_.include_model_comparison) {
+      std::cout << " mismatches=" << cumulative_mismatch_count_ << " known_gaps=" << known_gap_count_
+                << " normalized_mismatches=" << normalized_mismatch_count_
+                << " interval_normalized_mismatches=" << (normalized_mismatch_count_ - rolling_normalized_mismatch_base_)
+                << " final_cumulative_drift_total=" << final_cumulative_drift_total_;
+      rolling_normalized_mismatch_base_ = normalized_mismatch_count_;
+    }
+    std::cout << '\n' << std::flush;
+  }
 
-  if (cumulative_agreement_count + cumulative_mismatch_count + known_gap_count != records_processed) {
-    std::cerr << "error: classification invariant failed\n";
-    return 1;
+private:
+  // Plain counters and count tables in a fixed order, for save/load_state.
+  template <typename Self>
+  static auto counters_of(Self &self) {
+    return std::array{&self.included_events_,           &self.records_processed_,           &self.observed_wait_nonzero_count_,
+                      &self.byte_access_gap_candidates_, &self.known_gap_count_,             &self.known_gap_byte_access_count_,
+                      &self.cumulative_agreement_count_, &self.cumulative_mismatch_count_,   &self.normalized_agreement_count_,
+                      &self.normalized_mismatch_count_,  &self.rolling_normalized_mismatch_base_};
   }
-  if (options.include_model_comparison && normalized_agreement_count + normalized_mismatch_count != records_processed) {
-    std::cerr << "error: normalized invariant failed\n";
-    return 1;
+  template <typename Self>
+  static auto count_tables_of(Self &self) {
+    return std::array{&self.included_master_distribution_,
+                      &self.included_region_distribution_,
+                      &self.included_size_distribution_,
+                      &self.included_rw_distribution_,
+                      &self.included_access_kind_distribution_,
+                      &self.included_master_region_distribution_,
+                      &self.included_cache_bucket_distribution_,
+                      &self.included_master_region_access_kind_cache_bucket_distribution_,
+                      &self.histogram_,
+                      &self.normalized_by_master_,
+                      &self.normalized_by_region_,
+                      &self.normalized_by_size_,
+                      &self.normalized_mismatch_by_master_region_access_kind_,
+                      &self.sample_size_by_master_region_access_kind_};
   }
-
-  std::vector<const ReplayResult *> top_cumulative;
-  top_cumulative.reserve(results.size());
-  std::vector<const ReplayResult *> top_normalized;
-  top_normalized.reserve(results.size());
-  for (const auto &r : results) {
-    top_cumulative.push_back(&r);
-    top_normalized.push_back(&r);
+  auto counters() { return counters_of(*this); }
+  auto counters() const { return counters_of(*this); }
+  auto count_tables() { return count_tables_of(*this); }
+  auto count_tables() const { return count_tables_of(*this); }
+
+public:
+  // Everything consume() accumulates, for --replay-cache. Annotated output
+  // and sweeps are not cached, so their state is not saved.
+  void save_state(trace_replay::StateWriter &out) const {
+    out.put(arbiter_.has_value() ? arbiter_->state() : busarb::ArbiterState{});
+    out.put(previous_record_for_normalized_);
+    out.put(annotated_rows_);
+    for (const std::size_t *counter : counters()) {
+      out.put(*counter);
+    }
+    for (const auto *table : count_tables()) {
+      table->save(out);
+    }
+    out.put_map(excluded_reason_counts_);
+    out.put(sum_base_latency_);
+    out.put(sum_contention_stall_);
+    out.put(sum_total_predicted_);
+    out.put(final_cumulative_drift_wait_);
+    out.put(final_cumulative_drift_total_);
+    out.put(last_tick_complete_);
+    normalized_delta_by_access_kind_.save(out);
+    observed_bucket_stats_by_master_region_access_kind_cache_bucket_.save(out);
+    normalized_wait_deltas_.save(out);
+    top_cumulative_.save(out);
+    top_normalized_.save(out);
   }
 
-  std::stable_sort(top_cumulative.begin(), top_cumulative.end(), [](const ReplayResult *a, const ReplayResult *b) {
-    return std::llabs(a->cumulative_drift_total) > std::llabs(b->cumulative_drift_total);
-  });
-  std::stable_sort(top_normalized.begin(), top_normalized.end(), [](const ReplayResult *a, const ReplayResult *b) {
-    return std::llabs(a->model_vs_trace_wait_delta) > std::llabs(b->model_vs_trace_wait_delta);
-  });
-
-  if (!options.summary_only && options.annotated_output_path.has_value()) {
-    std::ofstream annotated(*options.annotated_output_path);
-    if (!annotated.is_open()) {
-      std::cerr << "Failed to open annotated output path: " << *options.annotated_output_path << '\n';
-      return 1;
+  bool load_state(trace_replay::StateReader &in) {
+    busarb::ArbiterState arbiter_state{};
+    if (!in.get(arbiter_state) || !in.get(previous_record_for_normalized_) || !in.get(annotated_rows_)) {
+      return false;
     }
-
-    const std::size_t emit_limit = options.annotated_limit.has_value() ? std::min(*options.annotated_limit, results.size()) : results.size();
-    for (std::size_t i = 0; i < emit_limit; ++i) {
-      const auto &r = results[i];
-      annotated << "{"
-                << "\"seq\":" << r.record.seq << ','
-                << "\"master\":\"" << json_escape(r.record.master) << "\","
-                << "\"tick_first_attempt\":" << r.record.tick_first_attempt << ','
-                << "\"tick_complete\":" << r.record.tick_complete << ','
-                << "\"addr\":\"" << json_escape(r.record.addr_text) << "\","
-                << "\"size\":" << static_cast<unsigned>(r.record.size) << ','
-                << "\"rw\":\"" << json_escape(r.record.rw) << "\","
-                << "\"kind\":\"" << json_escape(r.record.kind) << "\"," 
-                << "\"service_cycles\":" << r.record.service_cycles << ','
-                << "\"retries\":" << r.record.retries << ','
-                << "\"observed_service_cycles\":" << r.ymir_service_cycles << ','
-                << "\"observed_retries\":" << r.ymir_retries << ','
-                << "\"observed_elapsed\":" << r.ymir_elapsed << ','
-                << "\"observed_wait\":" << r.ymir_wait << ','
-                << "\"observed_wait_metric_kind\":\"" << r.ymir_wait_metric_kind << "\"," 
-                << "\"cache_bucket\":\"" << r.cache_bucket << "\"," 
-                << "\"classification\":\"" << r.classification << "\"";
-      if (options.include_model_comparison) {
-        annotated << ','
-                  << "\"model_predicted_wait\":" << r.arbiter_predicted_wait << ','
-                  << "\"model_predicted_service\":" << r.arbiter_predicted_service << ','
-                  << "\"model_predicted_total\":" << r.arbiter_predicted_total << ','
-                  << "\"model_vs_trace_wait_delta\":" << r.normalized_delta_wait << ','
-                  << "\"model_vs_trace_total_delta\":" << r.normalized_delta_total << ','
-                  << "\"cumulative_drift_wait\":" << r.cumulative_drift_wait << ','
-                  << "\"cumulative_drift_total\":" << r.cumulative_drift_total << ','
-                  << "\"known_gap_reason\":\"" << r.known_gap_reason << "\"";
-      }
-      annotated << "}\n";
+    if (arbiter_.has_value()) {
+      arbiter_->restore(arbiter_state);
+    }
+    for (std::size_t *counter : counters()) {
+      if (!in.get(*counter)) return false;
+    }
+    for (auto *table : count_tables()) {
+      if (!table->load(in)) return false;
     }
+    return in.get_map(excluded_reason_counts_) && in.get(sum_base_latency_) && in.get(sum_contention_stall_) && in.get(sum_total_predicted_) &&
+           in.get(final_cumulative_drift_wait_) && in.get(final_cumulative_drift_total_) && in.get(last_tick_complete_) &&
+           normalized_delta_by_access_kind_.load(in) && observed_bucket_stats_by_master_region_access_kind_cache_bucket_.load(in) &&
+           normalized_wait_deltas_.load(in) && top_cumulative_.load(in) && top_normalized_.load(in) && in.at_end();
   }
 
-  std::uint64_t sum_base_latency = 0;
-  std::uint64_t sum_contention_stall = 0;
-  std::uint64_t sum_total_predicted = 0;
-  for (const auto &r : results) {
-    sum_base_latency += r.base_latency;
-    sum_contention_stall += r.contention_stall;
-    sum_total_predicted += r.total_predicted;
-  }
+  int finish(const InputStats &input_stats) {
+    const std::size_t records_processed = records_processed_;
+    const std::size_t malformed_lines = input_stats.malformed_lines;
+    const std::size_t duplicate_seq_count = input_stats.duplicate_seq_count;
+    const std::size_t non_monotonic_seq_count = input_stats.non_monotonic_seq_count;
+    const std::size_t total_events = input_stats.total_events;
+    const std::size_t included_events = included_events_;
+    const std::size_t excluded_events = total_events >= included_events ? (total_events - included_events) : 0;
+    excluded_reason_counts_["malformed_line"] += malformed_lines;
+
+    // Labels are rendered once here; consume() only touched dense ids.
+    auto master_name = [](std::size_t id) { return master_label(static_cast<Master>(id)); };
+    auto region_label = [](std::size_t id) { return region_name(static_cast<Region>(id)); };
+    auto kind_name = [](std::size_t id) { return kind_label(static_cast<AccessKind>(id)); };
+    const auto included_master_distribution = included_master_distribution_.to_map(master_name);
+    const auto included_region_distribution = included_region_distribution_.to_map(region_label);
+    const auto included_size_distribution = included_size_distribution_.to_map([](std::size_t id) { return size_label(static_cast<std::uint8_t>(id)); });
+    const auto included_rw_distribution = included_rw_distribution_.to_map([](std::size_t id) { return rw_label(static_cast<Rw>(id)); });
+    const auto included_access_kind_distribution = included_access_kind_distribution_.to_map(kind_name);
+    const auto included_master_region_distribution = included_master_region_distribution_.to_map(master_region_label);
+    const auto included_cache_bucket_distribution =
+        included_cache_bucket_distribution_.to_map([](std::size_t id) { return std::string(cache_bucket_name(static_cast<CacheBucket>(id))); });
+    const auto included_master_region_access_kind_cache_bucket_distribution =
+        included_master_region_access_kind_cache_bucket_distribution_.to_map(master_region_kind_bucket_label);
+    const auto histogram = histogram_.to_map(region_classification_label);
+    const auto normalized_by_master = normalized_by_master_.to_map(master_name);
+    const auto normalized_by_region = normalized_by_region_.to_map(region_label);
+    const auto normalized_by_size = normalized_by_size_.to_map([](std::size_t id) { return std::to_string(id); });
+    const auto normalized_mismatch_by_master_region_access_kind = normalized_mismatch_by_master_region_access_kind_.to_map(master_region_kind_label);
+    const auto sample_size_by_master_region_access_kind = sample_size_by_master_region_access_kind_.to_map(master_region_kind_label);
+    const auto normalized_delta_by_access_kind = normalized_delta_by_access_kind_.to_map(kind_name);
+    const auto observed_bucket_stats_by_master_region_access_kind_cache_bucket =
+        observed_bucket_stats_by_master_region_access_kind_cache_bucket_.to_map(master_region_kind_bucket_label);
+    std::map<std::string, std::size_t> known_gap_bucket_counts;
+    if (byte_access_gap_candidates_ != 0U) {
+      known_gap_bucket_counts["byte_access_wait_check_gap_candidate"] = byte_access_gap_candidates_;
+    }
 
-  const double mean_normalized_delta_wait = normalized_wait_deltas.empty()
-                                                ? 0.0
-                                                : static_cast<double>(std::accumulate(normalized_wait_deltas.begin(), normalized_wait_deltas.end(), std::int64_t{0})) /
-                                                      static_cast<double>(normalized_wait_deltas.size());
+    if (cumulative_agreement_count_ + cumulative_mismatch_count_ + known_gap_count_ != records_processed) {
+      std::cerr << "error: classification invariant failed\n";
+      return 1;
+    }
+    if (options_.include_model_comparison && normalized_agreement_count_ + normalized_mismatch_count_ != records_processed) {
+      std::cerr << "error: normalized invariant failed\n";
+      return 1;
+    }
 
-  if (options.summary_output_path.has_value()) {
-    std::ofstream summary(*options.summary_output_path);
-    if (!summary.is_open()) {
-      std::cerr << "Failed to open summary output path: " << *options.summary_output_path << '\n';
+    const std::vector<ReplayResult> top_cumulative = top_cumulative_.sorted();
+    const std::vector<ReplayResult> top_normalized = top_normalized_.sorted();
+
+    if (!annotated_file_.close()) {
+      std::cerr << "error: failed to write annotated output: " << *options_.annotated_output_path << '\n';
       return 1;
     }
 
-    summary << "{\n";
-    summary << "  \"summary_schema_version\": " << kSummarySchemaVersion << ",\n";
-    summary << "  \"records_processed\": " << records_processed << ",\n";
-    summary << "  \"malformed_lines_skipped\": " << malformed_lines << ",\n";
-    summary << "  \"duplicate_seq_count\": " << duplicate_seq_count << ",\n";
-    summary << "  \"non_monotonic_seq_count\": " << non_monotonic_seq_count << ",\n";
-    summary << "  \"total_events\": " << total_events << ",\n";
-    summary << "  \"included_events\": " << included_events << ",\n";
-    summary << "  \"excluded_events\": " << excluded_events << ",\n";
-    summary << "  \"trace_observed\": {\n";
-    summary << "    \"source\": \"TRACE_ONLY\",\n";
-    summary << "    \"records_processed\": " << records_processed << ",\n";
-    summary << "    \"observed_wait_nonzero_count\": " << std::count_if(results.begin(), results.end(), [](const ReplayResult &r) { return r.ymir_wait > 0U; }) << "\n";
-    summary << "  },\n";
-
-    std::map<std::string, std::pair<std::optional<ObservedBucketStats>, std::optional<ObservedBucketStats>>> symmetry_candidates;
-    for (const auto &[key, stats] : observed_bucket_stats_by_master_region_access_kind_cache_bucket) {
-      const std::string delim = " | ";
-      const auto p1 = key.find(delim);
-      if (p1 == std::string::npos) continue;
-      const auto p2 = key.find(delim, p1 + delim.size());
-      if (p2 == std::string::npos) continue;
-      const auto p3 = key.find(delim, p2 + delim.size());
-      if (p3 == std::string::npos) continue;
-      const std::string master = key.substr(0, p1);
-      const std::string rest = key.substr(p1 + delim.size());
-      if (master == "MSH2") {
-        symmetry_candidates[rest].first = stats;
-      } else if (master == "SSH2") {
-        symmetry_candidates[rest].second = stats;
+    const double mean_normalized_delta_wait = normalized_wait_deltas_.empty()
+                                                  ? 0.0
+                                                  : static_cast<double>(normalized_wait_deltas_.sum()) / static_cast<double>(normalized_wait_deltas_.count());
+    const auto &normalized_wait_deltas = normalized_wait_deltas_;
+    const bool has_results = records_processed != 0U;
+
+    if (options_.summary_output_path.has_value()) {
+      std::ofstream summary(*options_.summary_output_path);
+      if (!summary.is_open()) {
+        std::cerr << "Failed to open summary output path: " << *options_.summary_output_path << '\n';
+        return 1;
       }
-    }
-    std::vector<SymmetryCheckEntry> symmetry_checks;
-    for (const auto &[bucket, pair_stats] : symmetry_candidates) {
-      if (!pair_stats.first.has_value() || !pair_stats.second.has_value()) {
-        continue;
+
+      summary << "{\n";
+      summary << "  \"summary_schema_version\": " << kSummarySchemaVersion << ",\n";
+      summary << "  \"records_processed\": " << records_processed << ",\n";
+      summary << "  \"malformed_lines_skipped\": " << malformed_lines << ",\n";
+      summary << "  \"duplicate_seq_count\": " << duplicate_seq_count << ",\n";
+      summary << "  \"non_monotonic_seq_count\": " << non_monotonic_seq_count << ",\n";
+      summary << "  \"total_events\": " << total_events << ",\n";
+      summary << "  \"included_events\": " << included_events << ",\n";
+      summary << "  \"excluded_events\": " << excluded_events << ",\n";
+      summary << "  \"trace_observed\": {\n";
+      summary << "    \"source\": \"TRACE_ONLY\",\n";
+      summary << "    \"records_processed\": " << records_processed << ",\n";
+      summary << "    \"observed_wait_nonzero_count\": " << observed_wait_nonzero_count_ << "\n";
+      summary << "  },\n";
+
+      std::map<std::string, std::pair<std::optional<ObservedBucketStats>, std::optional<ObservedBucketStats>>> symmetry_candidates;
+      for (const auto &[key, stats] : observed_bucket_stats_by_master_region_access_kind_cache_bucket) {
+        const std::string delim = " | ";
+        const auto p1 = key.find(delim);
+        if (p1 == std::string::npos) continue;
+        const auto p2 = key.find(delim, p1 + delim.size());
+        if (p2 == std::string::npos) continue;
+        const auto p3 = key.find(delim, p2 + delim.size());
+        if (p3 == std::string::npos) continue;
+        const std::string master = key.substr(0, p1);
+        const std::string rest = key.substr(p1 + delim.size());
+        if (master == "MSH2") {
+          symmetry_candidates[rest].first = stats;
+        } else if (master == "SSH2") {
+          symmetry_candidates[rest].second = stats;
+        }
       }
-      const auto &msh2 = *pair_stats.first;
-      const auto &ssh2 = *pair_stats.second;
-      if (msh2.sample_size < 100U || ssh2.sample_size < 100U) {
-        continue;
+      std::vector<SymmetryCheckEntry> symmetry_checks;
+      for (const auto &[bucket, pair_stats] : symmetry_candidates) {
+        if (!pair_stats.first.has_value() || !pair_stats.second.has_value()) {
+          continue;
+        }
+        const auto &msh2 = *pair_stats.first;
+        const auto &ssh2 = *pair_stats.second;
+        if (msh2.sample_size < 100U || ssh2.sample_size < 100U) {
+          continue;
+        }
+        SymmetryCheckEntry entry{};
+        entry.bucket = bucket;
+        entry.msh2 = msh2;
+        entry.ssh2 = ssh2;
+        const double msh2_elapsed_p50 = percentile(msh2.observed_elapsed_values, 0.5);
+        const double ssh2_elapsed_p50 = percentile(ssh2.observed_elapsed_values, 0.5);
+        const double msh2_elapsed_p99 = percentile(msh2.observed_elapsed_values, 0.99);
+        const double ssh2_elapsed_p99 = percentile(ssh2.observed_elapsed_values, 0.99);
+        const double msh2_wait_rate = msh2.sample_size == 0 ? 0.0 : static_cast<double>(msh2.observed_wait_nonzero_count) / static_cast<double>(msh2.sample_size);
+        const double ssh2_wait_rate = ssh2.sample_size == 0 ? 0.0 : static_cast<double>(ssh2.observed_wait_nonzero_count) / static_cast<double>(ssh2.sample_size);
+        std::vector<std::string> divergence_notes;
+        if (std::fabs(msh2_elapsed_p50 - ssh2_elapsed_p50) > 1.0) {
+          divergence_notes.push_back("elapsed_p50");
+        }
+        if (std::fabs(msh2_elapsed_p99 - ssh2_elapsed_p99) > 2.0) {
+          divergence_notes.push_back("elapsed_p99");
+        }
+        if (std::fabs(msh2_wait_rate - ssh2_wait_rate) > 0.01) {
+          divergence_notes.push_back("wait_nonzero_rate");
+        }
+        entry.symmetric = divergence_notes.empty();
+        if (!entry.symmetric) {
+          for (std::size_t i = 0; i < divergence_notes.size(); ++i) {
+            if (i > 0) entry.notes += ",";
+            entry.notes += divergence_notes[i];
+          }
+        }
+        symmetry_checks.push_back(std::move(entry));
       }
-      SymmetryCheckEntry entry{};
-      entry.bucket = bucket;
-      entry.msh2 = msh2;
-      entry.ssh2 = ssh2;
-      const double msh2_elapsed_p50 = percentile(msh2.observed_elapsed_values, 0.5);
-      const double ssh2_elapsed_p50 = percentile(ssh2.observed_elapsed_values, 0.5);
-      const double msh2_elapsed_p99 = percentile(msh2.observed_elapsed_values, 0.99);
-      const double ssh2_elapsed_p99 = percentile(ssh2.observed_elapsed_values, 0.99);
-      const double msh2_wait_rate = msh2.sample_size == 0 ? 0.0 : static_cast<double>(msh2.observed_wait_nonzero_count) / static_cast<double>(msh2.sample_size);
-      const double ssh2_wait_rate = ssh2.sample_size == 0 ? 0.0 : static_cast<double>(ssh2.observed_wait_nonzero_count) / static_cast<double>(ssh2.sample_size);
-      std::vector<std::string> divergence_notes;
-      if (std::fabs(msh2_elapsed_p50 - ssh2_elapsed_p50) > 1.0) {
-        divergence_notes.push_back("elapsed_p50");
+
+      auto write_map = [&summary](const std::string &name, const std::map<std::string, std::size_t> &m, bool trailing_comma) {
+        summary << "  \"" << name << "\": {\n";
+        std::size_t i = 0;
+        for (const auto &[k, v] : m) {
+          summary << "    \"" << json_escape(k) << "\": " << v;
+          ++i;
+          if (i < m.size()) summary << ',';
+          summary << "\n";
+        }
+        summary << "  }";
+        if (trailing_comma) summary << ',';
+        summary << "\n";
+      };
+
+      if (options_.include_model_comparison) {
+        summary << "  \"agreement_count\": " << cumulative_agreement_count_ << ",\n";
+        summary << "  \"mismatch_count\": " << cumulative_mismatch_count_ << ",\n";
+        summary << "  \"known_gap_count\": " << known_gap_count_ << ",\n";
+        summary << "  \"known_gap_byte_access_count\": " << known_gap_byte_access_count_ << ",\n";
+        summary << "  \"normalized_agreement_count\": " << normalized_agreement_count_ << ",\n";
+        summary << "  \"normalized_mismatch_count\": " << normalized_mismatch_count_ << ",\n";
+        summary << "  \"mean_base_latency\": " << (records_processed == 0 ? 0.0 : static_cast<double>(sum_base_latency_) / static_cast<double>(records_processed)) << ",\n";
+        summary << "  \"mean_contention_stall\": " << (records_processed == 0 ? 0.0 : static_cast<double>(sum_contention_stall_) / static_cast<double>(records_processed)) << ",\n";
+        summary << "  \"mean_total_predicted\": " << (records_processed == 0 ? 0.0 : static_cast<double>(sum_total_predicted_) / static_cast<double>(records_processed)) << ",\n";
+        summary << "  \"mean_normalized_delta_wait\": " << mean_normalized_delta_wait << ",\n";
+        summary << "  \"median_normalized_delta_wait\": " << percentile(normalized_wait_deltas, 0.5) << ",\n";
+        summary << "  \"max_normalized_delta_wait\": " << (normalized_wait_deltas.empty() ? 0.0 : percentile(normalized_wait_deltas, 1.0)) << ",\n";
+        summary << "  \"p90_normalized_delta_wait\": " << percentile(normalized_wait_deltas, 0.9) << ",\n";
+        summary << "  \"p99_normalized_delta_wait\": " << percentile(normalized_wait_deltas, 0.99) << ",\n";
+        summary << "  \"final_cumulative_drift_wait\": " << (has_results ? final_cumulative_drift_wait_ : 0) << ",\n";
+        summary << "  \"final_cumulative_drift_total\": " << (has_results ? final_cumulative_drift_total_ : 0) << ",\n";
+        summary << "  \"drift_rate_wait_per_record\": " << (has_results ? static_cast<double>(final_cumulative_drift_wait_) / static_cast<double>(records_processed) : 0.0)
+                << ",\n";
+        summary << "  \"drift_rate_total_per_record\": "
+                << (has_results ? static_cast<double>(final_cumulative_drift_total_) / static_cast<double>(records_processed) : 0.0) << ",\n";
+
+      }
+
+      write_map("excluded_reason_counts", excluded_reason_counts_, true);
+      write_map("known_gap_bucket_counts", known_gap_bucket_counts, true);
+      write_map("included_master_distribution", included_master_distribution, true);
+      write_map("included_region_distribution", included_region_distribution, true);
+      write_map("included_size_distribution", included_size_distribution, true);
+      write_map("included_rw_distribution", included_rw_distribution, true);
+      write_map("included_access_kind_distribution", included_access_kind_distribution, true);
+      write_map("included_master_region_distribution", included_master_region_distribution, true);
+      write_map("cache_bucket_distribution", included_cache_bucket_distribution, true);
+      write_map("master_region_access_kind_cache_bucket_distribution", included_master_region_access_kind_cache_bucket_distribution, true);
+
+      summary << "  \"observed_bucket_stats_by_master_region_access_kind_cache_bucket\": {\n";
+      std::size_t observed_bucket_index = 0;
+      for (const auto &[key, stats] : observed_bucket_stats_by_master_region_access_kind_cache_bucket) {
+        const double wait_nonzero_rate = stats.sample_size == 0 ? 0.0 : static_cast<double>(stats.observed_wait_nonzero_count) / static_cast<double>(stats.sample_size);
+        const bool low_sample = stats.sample_size < 100U;
+        summary << "    \"" << json_escape(key) << "\": {"
+                << "\"sample_size\": " << stats.sample_size
+                << ", \"observed_wait_nonzero_count\": " << stats.observed_wait_nonzero_count
+                << ", \"observed_wait_nonzero_rate\": " << wait_nonzero_rate
+                << ", \"observed_elapsed_p50\": " << percentile(stats.observed_elapsed_values, 0.5)
+                << ", \"observed_elapsed_p90\": " << percentile(stats.observed_elapsed_values, 0.9)
+                << ", \"observed_elapsed_p99\": " << percentile(stats.observed_elapsed_values, 0.99)
+                << ", \"observed_wait_p50\": " << percentile(stats.observed_wait_values, 0.5)
+                << ", \"observed_wait_p90\": " << percentile(stats.observed_wait_values, 0.9)
+                << ", \"observed_wait_p99\": " << percentile(stats.observed_wait_values, 0.99)
+                << ", \"low_sample\": " << (low_sample ? "true" : "false")
+                << "}";
+        ++observed_bucket_index;
+        if (observed_bucket_index < observed_bucket_stats_by_master_region_access_kind_cache_bucket.size()) summary << ',';
+        summary << "\n";
       }
-      if (std::fabs(msh2_elapsed_p99 - ssh2_elapsed_p99) > 2.0) {
-        divergence_notes.push_back("elapsed_p99");
+      summary << "  },\n";
+
+      summary << "  \"symmetry_checks\": [\n";
+      for (std::size_t i = 0; i < symmetry_checks.size(); ++i) {
+        const auto &entry = symmetry_checks[i];
+        const double msh2_wait_rate = entry.msh2.sample_size == 0 ? 0.0 : static_cast<double>(entry.msh2.observed_wait_nonzero_count) / static_cast<double>(entry.msh2.sample_size);
+        const double ssh2_wait_rate = entry.ssh2.sample_size == 0 ? 0.0 : static_cast<double>(entry.ssh2.observed_wait_nonzero_count) / static_cast<double>(entry.ssh2.sample_size);
+        summary << "    {\"bucket\": \"" << json_escape(entry.bucket)
+                << "\", \"msh2\": {\"N\": " << entry.msh2.sample_size
+                << ", \"elapsed_p50\": " << percentile(entry.msh2.observed_elapsed_values, 0.5)
+                << ", \"elapsed_p90\": " << percentile(entry.msh2.observed_elapsed_values, 0.9)
+                << ", \"elapsed_p99\": " << percentile(entry.msh2.observed_elapsed_values, 0.99)
+                << ", \"wait_nonzero_rate\": " << msh2_wait_rate
+                << "}, \"ssh2\": {\"N\": " << entry.ssh2.sample_size
+                << ", \"elapsed_p50\": " << percentile(entry.ssh2.observed_elapsed_values, 0.5)
+                << ", \"elapsed_p90\": " << percentile(entry.ssh2.observed_elapsed_values, 0.9)
+                << ", \"elapsed_p99\": " << percentile(entry.ssh2.observed_elapsed_values, 0.99)
+                << ", \"wait_nonzero_rate\": " << ssh2_wait_rate
+                << "}, \"symmetric\": " << (entry.symmetric ? "true" : "false")
+                << ", \"notes\": \"" << json_escape(entry.notes) << "\"}";
+        if (i + 1 < symmetry_checks.size()) summary << ',';
+        summary << "\n";
       }
-      if (std::fabs(msh2_wait_rate - ssh2_wait_rate) > 0.01) {
-        divergence_notes.push_back("wait_nonzero_rate");
+      summary << "  ],\n";
+
+      summary << "  \"delta_histogram\": {\n";
+      std::size_t hist_index = 0;
+      for (const auto &[key, count] : histogram) {
+        summary << "    \"" << json_escape(key) << "\": " << count;
+        ++hist_index;
+        if (hist_index < histogram.size()) summary << ',';
+        summary << "\n";
       }
-      entry.symmetric = divergence_notes.empty();
-      if (!entry.symmetric) {
-        for (std::size_t i = 0; i < divergence_notes.size(); ++i) {
-          if (i > 0) entry.notes += ",";
-          entry.notes += divergence_notes[i];
+      summary << "  }";
+
+      if (options_.include_model_comparison) {
+        summary << ",\n";
+        summary << "  \"model_comparison\": {\n";
+        summary << "    \"source\": \"MODEL_COMPARISON\",\n";
+        summary << "    \"hypothesis_agreement_count\": " << normalized_agreement_count_ << ",\n";
+        summary << "    \"hypothesis_mismatch_count\": " << normalized_mismatch_count_ << ",\n";
+        summary << "    \"known_gap_count\": " << known_gap_count_ << ",\n";
+        summary << "    \"known_gap_byte_access_count\": " << known_gap_byte_access_count_ << ",\n";
+        summary << "    \"mean_model_predicted_service\": " << (records_processed == 0 ? 0.0 : static_cast<double>(sum_base_latency_) / static_cast<double>(records_processed)) << ",\n";
+        summary << "    \"mean_model_predicted_wait\": " << (records_processed == 0 ? 0.0 : static_cast<double>(sum_contention_stall_) / static_cast<double>(records_processed)) << ",\n";
+        summary << "    \"mean_model_predicted_total\": " << (records_processed == 0 ? 0.0 : static_cast<double>(sum_total_predicted_) / static_cast<double>(records_processed)) << ",\n";
+        summary << "    \"mean_model_vs_trace_wait_delta\": " << mean_normalized_delta_wait << ",\n";
+        summary << "    \"median_model_vs_trace_wait_delta\": " << percentile(normalized_wait_deltas, 0.5) << ",\n";
+        summary << "    \"max_model_vs_trace_wait_delta\": " << (normalized_wait_deltas.empty() ? 0.0 : percentile(normalized_wait_deltas, 1.0)) << ",\n";
+        summary << "    \"p90_model_vs_trace_wait_delta\": " << percentile(normalized_wait_deltas, 0.9) << ",\n";
+        summary << "    \"p99_model_vs_trace_wait_delta\": " << percentile(normalized_wait_deltas, 0.99) << ",\n";
+        summary << "    \"final_cumulative_drift_wait\": " << (has_results ? final_cumulative_drift_wait_ : 0) << ",\n";
+        summary << "    \"final_cumulative_drift_total\": " << (has_results ? final_cumulative_drift_total_ : 0) << ",\n";
+        summary << "    \"drift_rate_wait_per_record\": "
+                << (has_results ? static_cast<double>(final_cumulative_drift_wait_) / static_cast<double>(records_processed) : 0.0) << ",\n";
+        summary << "    \"drift_rate_total_per_record\": "
+                << (has_results ? static_cast<double>(final_cumulative_drift_total_) / static_cast<double>(records_processed) : 0.0) << ",\n";
+
+        summary << "    \"hypothesis_mismatch_by_master_region_access_kind\": {\n";
+        std::size_t mk_index = 0;
+        for (const auto &[key, sample_size] : sample_size_by_master_region_access_kind) {
+          const std::size_t mismatch_count = normalized_mismatch_by_master_region_access_kind.count(key) ? normalized_mismatch_by_master_region_access_kind.at(key) : 0U;
+          const double mismatch_rate = sample_size == 0 ? 0.0 : static_cast<double>(mismatch_count) / static_cast<double>(sample_size);
+          summary << "      \"" << json_escape(key) << "\": {\"mismatch_count\": " << mismatch_count
+                  << ", \"sample_size\": " << sample_size
+                  << ", \"mismatch_rate\": " << mismatch_rate << "}";
+          ++mk_index;
+          if (mk_index < sample_size_by_master_region_access_kind.size()) summary << ',';
+          summary << "\n";
+        }
+        summary << "    },\n";
+
+        summary << "    \"model_vs_trace_wait_delta_by_access_kind\": {\n";
+        std::size_t kind_index = 0;
+        for (const auto &[kind, deltas] : normalized_delta_by_access_kind) {
+          summary << "      \"" << json_escape(kind) << "\": {\"sample_size\": " << deltas.count()
+                  << ", \"p90\": " << percentile(deltas, 0.9)
+                  << ", \"p99\": " << percentile(deltas, 0.99) << "}";
+          ++kind_index;
+          if (kind_index < normalized_delta_by_access_kind.size()) summary << ',';
+          summary << "\n";
+        }
+        summary << "    },\n";
+
+        summary << "    \"hypothesis_mismatch_by_master\": {\n";
+        std::size_t by_master_idx = 0;
+        for (const auto &[k, v] : normalized_by_master) {
+          summary << "      \"" << json_escape(k) << "\": " << v;
+          if (++by_master_idx < normalized_by_master.size()) summary << ',';
+          summary << "\n";
         }
+        summary << "    },\n";
+
+        summary << "    \"hypothesis_mismatch_by_region\": {\n";
+        std::size_t by_region_idx = 0;
+        for (const auto &[k, v] : normalized_by_region) {
+          summary << "      \"" << json_escape(k) << "\": " << v;
+          if (++by_region_idx < normalized_by_region.size()) summary << ',';
+          summary << "\n";
+        }
+        summary << "    },\n";
+
+        summary << "    \"hypothesis_mismatch_by_size\": {\n";
+        std::size_t by_size_idx = 0;
+        for (const auto &[k, v] : normalized_by_size) {
+          summary << "      \"" << json_escape(k) << "\": " << v;
+          if (++by_size_idx < normalized_by_size.size()) summary << ',';
+          summary << "\n";
+        }
+        summary << "    },\n";
+
+        summary << "    \"top_cumulative_drifts\": [\n";
+        const std::size_t emit = std::min(options_.top_k, top_cumulative.size());
+        for (std::size_t i = 0; i < emit; ++i) {
+          const auto *r = &top_cumulative[i];
+          summary << "      {\"rank\": " << (i + 1) << ", \"seq\": " << r->record.seq << ", \"master\": \"" << json_escape(master_label(r->record.master))
+                  << "\", \"addr\": \"" << json_escape(addr_text(r->record)) << "\", \"size\": " << static_cast<unsigned>(r->record.size)
+                  << ", \"cumulative_drift_wait\": " << r->cumulative_drift_wait << ", \"cumulative_drift_total\": " << r->cumulative_drift_total
+                  << ", \"model_vs_trace_wait_delta\": " << r->model_vs_trace_wait_delta << ", \"model_vs_trace_total_delta\": " << r->model_vs_trace_total_delta
+                  << ", \"classification\": \"" << classification_name(r->classification) << "\", \"region\": \"" << json_escape(region_name(r->record.region))
+                  << "\"}";
+          if (i + 1 < emit) summary << ',';
+          summary << '\n';
+        }
+        summary << "    ],\n";
+
+        summary << "    \"top_model_vs_trace_wait_deltas\": [\n";
+        const std::size_t emit_norm = std::min(options_.top_k, top_normalized.size());
+        for (std::size_t i = 0; i < emit_norm; ++i) {
+          const auto *r = &top_normalized[i];
+          summary << "      {\"rank\": " << (i + 1) << ", \"seq\": " << r->record.seq << ", \"master\": \"" << json_escape(master_label(r->record.master))
+                  << "\", \"addr\": \"" << json_escape(addr_text(r->record)) << "\", \"size\": " << static_cast<unsigned>(r->record.size)
+                  << ", \"model_vs_trace_wait_delta\": " << r->model_vs_trace_wait_delta << ", \"model_vs_trace_total_delta\": " << r->model_vs_trace_total_delta
+                  << ", \"cumulative_drift_wait\": " << r->cumulative_drift_wait << ", \"cumulative_drift_total\": " << r->cumulative_drift_total
+                  << ", \"classification\": \"" << classification_name(r->classification) << "\", \"region\": \"" << json_escape(region_name(r->record.region))
+                  << "\"}";
+          if (i + 1 < emit_norm) summary << ',';
+          summary << '\n';
+        }
+        summary << "    ]\n";
+        summary << "  }";
       }
-      symmetry_checks.push_back(std::move(entry));
+      if (sweep_.has_value()) {
+        summary << ",\n";
+        write_sweep_summary(summary);
+      }
+      if (cache_sim_.has_value()) {
+        summary << ",\n";
+        write_cache_sim_summary(summary);
+      }
+
+      summary << "\n}\n";
     }
 
-    auto write_map = [&summary](const std::string &name, const std::map<std::string, std::size_t> &m, bool trailing_comma) {
-      summary << "  \"" << name << "\": {\n";
-      std::size_t i = 0;
-      for (const auto &[k, v] : m) {
-        summary << "    \"" << json_escape(k) << "\": " << v;
-        ++i;
-        if (i < m.size()) summary << ',';
-        summary << "\n";
-      }
-      summary << "  }";
-      if (trailing_comma) summary << ',';
-      summary << "\n";
-    };
-
-    if (options.include_model_comparison) {
-      summary << "  \"agreement_count\": " << cumulative_agreement_count << ",\n";
-      summary << "  \"mismatch_count\": " << cumulative_mismatch_count << ",\n";
-      summary << "  \"known_gap_count\": " << known_gap_count << ",\n";
-      summary << "  \"known_gap_byte_access_count\": " << known_gap_byte_access_count << ",\n";
-      summary << "  \"normalized_agreement_count\": " << normalized_agreement_count << ",\n";
-      summary << "  \"normalized_mismatch_count\": " << normalized_mismatch_count << ",\n";
-      summary << "  \"mean_base_latency\": " << (records_processed == 0 ? 0.0 : static_cast<double>(sum_base_latency) / static_cast<double>(records_processed)) << ",\n";
-      summary << "  \"mean_contention_stall\": " << (records_processed == 0 ? 0.0 : static_cast<double>(sum_contention_stall) / static_cast<double>(records_processed)) << ",\n";
-      summary << "  \"mean_total_predicted\": " << (records_processed == 0 ? 0.0 : static_cast<double>(sum_total_predicted) / static_cast<double>(records_processed)) << ",\n";
-      summary << "  \"mean_normalized_delta_wait\": " << mean_normalized_delta_wait << ",\n";
-      summary << "  \"median_normalized_delta_wait\": " << percentile(normalized_wait_deltas, 0.5) << ",\n";
-      summary << "  \"max_normalized_delta_wait\": " << (normalized_wait_deltas.empty() ? 0.0 : percentile(normalized_wait_deltas, 1.0)) << ",\n";
-      summary << "  \"p90_normalized_delta_wait\": " << percentile(normalized_wait_deltas, 0.9) << ",\n";
-      summary << "  \"p99_normalized_delta_wait\": " << percentile(normalized_wait_deltas, 0.99) << ",\n";
-      summary << "  \"final_cumulative_drift_wait\": " << (results.empty() ? 0 : results.back().cumulative_drift_wait) << ",\n";
-      summary << "  \"final_cumulative_drift_total\": " << (results.empty() ? 0 : results.back().cumulative_drift_total) << ",\n";
-      summary << "  \"drift_rate_wait_per_record\": " << (results.empty() ? 0.0 : static_cast<double>(results.back().cumulative_drift_wait) / static_cast<double>(results.size()))
-              << ",\n";
-      summary << "  \"drift_rate_total_per_record\": "
-              << (results.empty() ? 0.0 : static_cast<double>(results.back().cumulative_drift_total) / static_cast<double>(results.size())) << ",\n";
-
-    }
-
-    write_map("excluded_reason_counts", excluded_reason_counts, true);
-    write_map("known_gap_bucket_counts", known_gap_bucket_counts, true);
-    write_map("included_master_distribution", included_master_distribution, true);
-    write_map("included_region_distribution", included_region_distribution, true);
-    write_map("included_size_distribution", included_size_distribution, true);
-    write_map("included_rw_distribution", included_rw_distribution, true);
-    write_map("included_access_kind_distribution", included_access_kind_distribution, true);
-    write_map("included_master_region_distribution", included_master_region_distribution, true);
-    write_map("cache_bucket_distribution", included_cache_bucket_distribution, true);
-    write_map("master_region_access_kind_cache_bucket_distribution", included_master_region_access_kind_cache_bucket_distribution, true);
-
-    summary << "  \"observed_bucket_stats_by_master_region_access_kind_cache_bucket\": {\n";
-    std::size_t observed_bucket_index = 0;
-    for (const auto &[key, stats] : observed_bucket_stats_by_master_region_access_kind_cache_bucket) {
-      const double wait_nonzero_rate = stats.sample_size == 0 ? 0.0 : static_cast<double>(stats.observed_wait_nonzero_count) / static_cast<double>(stats.sample_size);
-      const bool low_sample = stats.sample_size < 100U;
-      summary << "    \"" << json_escape(key) << "\": {"
-              << "\"sample_size\": " << stats.sample_size
-              << ", \"observed_wait_nonzero_count\": " << stats.observed_wait_nonzero_count
-              << ", \"observed_wait_nonzero_rate\": " << wait_nonzero_rate
-              << ", \"observed_elapsed_p50\": " << percentile(stats.observed_elapsed_values, 0.5)
-              << ", \"observed_elapsed_p90\": " << percentile(stats.observed_elapsed_values, 0.9)
-              << ", \"observed_elapsed_p99\": " << percentile(stats.observed_elapsed_values, 0.99)
-              << ", \"observed_wait_p50\": " << percentile(stats.observed_wait_values, 0.5)
-              << ", \"observed_wait_p90\": " << percentile(stats.observed_wait_values, 0.9)
-              << ", \"observed_wait_p99\": " << percentile(stats.observed_wait_values, 0.99)
-              << ", \"low_sample\": " << (low_sample ? "true" : "false")
-              << "}";
-      ++observed_bucket_index;
-      if (observed_bucket_index < observed_bucket_stats_by_master_region_access_kind_cache_bucket.size()) summary << ',';
-      summary << "\n";
+    std::cout << "dataset_hygiene_summary:\n";
+    std::cout << "  total_events: " << total_events << "\n";
+    std::cout << "  included_events: " << included_events << "\n";
+    std::cout << "  excluded_events: " << excluded_events << "\n";
+    std::cout << "  excluded_malformed_line: " << excluded_reason_counts_["malformed_line"] << "\n";
+    std::cout << "  excluded_invalid_master: " << excluded_reason_counts_["invalid_master"] << "\n";
+    std::cout << "  known_gap_bucket_byte_access_wait_check_gap_candidate: "
+              << known_gap_bucket_counts["byte_access_wait_check_gap_candidate"] << "\n";
+    std::cout << "  master_distribution:\n";
+    for (const auto &[key, count] : included_master_distribution) {
+      std::cout << "    " << key << " => " << count << "\n";
     }
-    summary << "  },\n";
-
-    summary << "  \"symmetry_checks\": [\n";
-    for (std::size_t i = 0; i < symmetry_checks.size(); ++i) {
-      const auto &entry = symmetry_checks[i];
-      const double msh2_wait_rate = entry.msh2.sample_size == 0 ? 0.0 : static_cast<double>(entry.msh2.observed_wait_nonzero_count) / static_cast<double>(entry.msh2.sample_size);
-      const double ssh2_wait_rate = entry.ssh2.sample_size == 0 ? 0.0 : static_cast<double>(entry.ssh2.observed_wait_nonzero_count) / static_cast<double>(entry.ssh2.sample_size);
-      summary << "    {\"bucket\": \"" << json_escape(entry.bucket)
-              << "\", \"msh2\": {\"N\": " << entry.msh2.sample_size
-              << ", \"elapsed_p50\": " << percentile(entry.msh2.observed_elapsed_values, 0.5)
-              << ", \"elapsed_p90\": " << percentile(entry.msh2.observed_elapsed_values, 0.9)
-              << ", \"elapsed_p99\": " << percentile(entry.msh2.observed_elapsed_values, 0.99)
-              << ", \"wait_nonzero_rate\": " << msh2_wait_rate
-              << "}, \"ssh2\": {\"N\": " << entry.ssh2.sample_size
-              << ", \"elapsed_p50\": " << percentile(entry.ssh2.observed_elapsed_values, 0.5)
-              << ", \"elapsed_p90\": " << percentile(entry.ssh2.observed_elapsed_values, 0.9)
-              << ", \"elapsed_p99\": " << percentile(entry.ssh2.observed_elapsed_values, 0.99)
-              << ", \"wait_nonzero_rate\": " << ssh2_wait_rate
-              << "}, \"symmetric\": " << (entry.symmetric ? "true" : "false")
-              << ", \"notes\": \"" << json_escape(entry.notes) << "\"}";
-      if (i + 1 < symmetry_checks.size()) summary << ',';
-      summary << "\n";
+    std::cout << "  region_distribution:\n";
+    for (const auto &[key, count] : included_region_distribution) {
+      std::cout << "    " << key << " => " << count << "\n";
+    }
+    std::cout << "  size_distribution:\n";
+    for (const auto &[key, count] : included_size_distribution) {
+      std::cout << "    " << key << " => " << count << "\n";
+    }
+    std::cout << "  rw_distribution:\n";
+    for (const auto &[key, count] : included_rw_distribution) {
+      std::cout << "    " << key << " => " << count << "\n";
+    }
+    std::cout << "  access_kind_distribution:\n";
+    for (const auto &[key, count] : included_access_kind_distribution) {
+      std::cout << "    " << key << " => " << count << "\n";
+    }
+    std::cout << "  cache_bucket_distribution:\n";
+    for (const auto &[key, count] : included_cache_bucket_distribution) {
+      std::cout << "    " << key << " => " << count << "\n";
     }
-    summary << "  ],\n";
 
-    summary << "  \"delta_histogram\": {\n";
-    std::size_t hist_index = 0;
+    std::cout << "records_processed: " << records_processed << "\n";
+    std::cout << "malformed_lines_skipped: " << malformed_lines << "\n";
+    std::cout << "duplicate_seq_count: " << duplicate_seq_count << "\n";
+    std::cout << "non_monotonic_seq_count: " << non_monotonic_seq_count << "\n";
+    if (options_.include_model_comparison) {
+      std::cout << "Model comparison: ENABLED (hypothesis mode)\n";
+      std::cout << "agreement_count: " << cumulative_agreement_count_ << "\n";
+      std::cout << "mismatch_count: " << cumulative_mismatch_count_ << "\n";
+      std::cout << "known_gap_count: " << known_gap_count_ << "\n";
+      std::cout << "normalized_agreement_count: " << normalized_agreement_count_ << "\n";
+      std::cout << "normalized_mismatch_count: " << normalized_mismatch_count_ << "\n";
+      std::cout << "final_cumulative_drift_total: " << (has_results ? final_cumulative_drift_total_ : 0) << "\n";
+    } else {
+      std::cout << "Model comparison: DISABLED (trace-only mode)\n";
+    }
+    std::cout << "delta_histogram:\n";
     for (const auto &[key, count] : histogram) {
-      summary << "    \"" << json_escape(key) << "\": " << count;
-      ++hist_index;
-      if (hist_index < histogram.size()) summary << ',';
-      summary << "\n";
+      std::cout << "  " << key << " => " << count << "\n";
     }
-    summary << "  }";
 
-    if (options.include_model_comparison) {
-      summary << ",\n";
-      summary << "  \"model_comparison\": {\n";
-      summary << "    \"source\": \"MODEL_COMPARISON\",\n";
-      summary << "    \"hypothesis_agreement_count\": " << normalized_agreement_count << ",\n";
-      summary << "    \"hypothesis_mismatch_count\": " << normalized_mismatch_count << ",\n";
-      summary << "    \"known_gap_count\": " << known_gap_count << ",\n";
-      summary << "    \"known_gap_byte_access_count\": " << known_gap_byte_access_count << ",\n";
-      summary << "    \"mean_model_predicted_service\": " << (records_processed == 0 ? 0.0 : static_cast<double>(sum_base_latency) / static_cast<double>(records_processed)) << ",\n";
-      summary << "    \"mean_model_predicted_wait\": " << (records_processed == 0 ? 0.0 : static_cast<double>(sum_contention_stall) / static_cast<double>(records_processed)) << ",\n";
-      summary << "    \"mean_model_predicted_total\": " << (records_processed == 0 ? 0.0 : static_cast<double>(sum_total_predicted) / static_cast<double>(records_processed)) << ",\n";
-      summary << "    \"mean_model_vs_trace_wait_delta\": " << mean_normalized_delta_wait << ",\n";
-      summary << "    \"median_model_vs_trace_wait_delta\": " << percentile(normalized_wait_deltas, 0.5) << ",\n";
-      summary << "    \"max_model_vs_trace_wait_delta\": " << (normalized_wait_deltas.empty() ? 0.0 : percentile(normalized_wait_deltas, 1.0)) << ",\n";
-      summary << "    \"p90_model_vs_trace_wait_delta\": " << percentile(normalized_wait_deltas, 0.9) << ",\n";
-      summary << "    \"p99_model_vs_trace_wait_delta\": " << percentile(normalized_wait_deltas, 0.99) << ",\n";
-      summary << "    \"final_cumulative_drift_wait\": " << (results.empty() ? 0 : results.back().cumulative_drift_wait) << ",\n";
-      summary << "    \"final_cumulative_drift_total\": " << (results.empty() ? 0 : results.back().cumulative_drift_total) << ",\n";
-      summary << "    \"drift_rate_wait_per_record\": "
-              << (results.empty() ? 0.0 : static_cast<double>(results.back().cumulative_drift_wait) / static_cast<double>(results.size())) << ",\n";
-      summary << "    \"drift_rate_total_per_record\": "
-              << (results.empty() ? 0.0 : static_cast<double>(results.back().cumulative_drift_total) / static_cast<double>(results.size())) << ",\n";
-
-      summary << "    \"hypothesis_mismatch_by_master_region_access_kind\": {\n";
-      std::size_t mk_index = 0;
-      for (const auto &[key, sample_size] : sample_size_by_master_region_access_kind) {
-        const std::size_t mismatch_count = normalized_mismatch_by_master_region_access_kind.count(key) ? normalized_mismatch_by_master_region_access_kind.at(key) : 0U;
-        const double mismatch_rate = sample_size == 0 ? 0.0 : static_cast<double>(mismatch_count) / static_cast<double>(sample_size);
-        summary << "      \"" << json_escape(key) << "\": {\"mismatch_count\": " << mismatch_count
-                << ", \"sample_size\": " << sample_size
-                << ", \"mismatch_rate\": " << mismatch_rate << "}";
-        ++mk_index;
-        if (mk_index < sample_size_by_master_region_access_kind.size()) summary << ',';
-        summary << "\n";
+    if (options_.include_model_comparison) {
+      std::cout << "top_cumulative_drifts:\n";
+      for (std::size_t i = 0; i < std::min(options_.top_k, top_cumulative.size()); ++i) {
+        const auto *r = &top_cumulative[i];
+        std::cout << "  #" << (i + 1) << " seq=" << r->record.seq << " cumulative_drift_total=" << r->cumulative_drift_total
+                  << " normalized_delta_wait=" << r->model_vs_trace_wait_delta << " class=" << classification_name(r->classification) << "\n";
       }
-      summary << "    },\n";
-
-      summary << "    \"model_vs_trace_wait_delta_by_access_kind\": {\n";
-      std::size_t kind_index = 0;
-      for (const auto &[kind, deltas] : normalized_delta_by_access_kind) {
-        summary << "      \"" << json_escape(kind) << "\": {\"sample_size\": " << deltas.size()
-                << ", \"p90\": " << percentile(deltas, 0.9)
-                << ", \"p99\": " << percentile(deltas, 0.99) << "}";
-        ++kind_index;
-        if (kind_index < normalized_delta_by_access_kind.size()) summary << ',';
-        summary << "\n";
-      }
-      summary << "    },\n";
 
-      summary << "    \"hypothesis_mismatch_by_master\": {\n";
-      std::size_t by_master_idx = 0;
-      for (const auto &[k, v] : normalized_by_master) {
-        summary << "      \"" << json_escape(k) << "\": " << v;
-        if (++by_master_idx < normalized_by_master.size()) summary << ',';
-        summary << "\n";
+      std::cout << "top_normalized_deltas:\n";
+      for (std::size_t i = 0; i < std::min(options_.top_k, top_normalized.size()); ++i) {
+        const auto *r = &top_normalized[i];
+        std::cout << "  #" << (i + 1) << " seq=" << r->record.seq << " normalized_delta_wait=" << r->model_vs_trace_wait_delta
+                  << " cumulative_drift_total=" << r->cumulative_drift_total << " class=" << classification_name(r->classification) << "\n";
       }
-      summary << "    },\n";
+    }
 
-      summary << "    \"hypothesis_mismatch_by_region\": {\n";
-      std::size_t by_region_idx = 0;
-      for (const auto &[k, v] : normalized_by_region) {
-        summary << "      \"" << json_escape(k) << "\": " << v;
-        if (++by_region_idx < normalized_by_region.size()) summary << ',';
-        summary << "\n";
+    if (sweep_.has_value()) {
+      std::cout << "sweep_ranking:\n";
+      const auto ranked = sweep_->ranked();
+      for (std::size_t i = 0; i < std::min(options_.top_k, ranked.size()); ++i) {
+        const auto &result = ranked[i];
+        std::cout << "  #" << (i + 1);
+        for (const auto &[key, value] : sweep_->variant(result.variant).settings) {
+          std::cout << ' ' << key << '=' << value;
+        }
+        std::cout << " agreement=" << result.agreement_count << " mismatch=" << result.mismatch_count << " known_gap=" << result.known_gap_count
+                  << " normalized_agreement=" << result.normalized_agreement_count << " normalized_mismatch=" << result.normalized_mismatch_count
+                  << " final_cumulative_drift_total=" << result.final_cumulative_drift_total << "\n";
       }
-      summary << "    },\n";
+    }
 
-      summary << "    \"hypothesis_mismatch_by_size\": {\n";
-      std::size_t by_size_idx = 0;
-      for (const auto &[k, v] : normalized_by_size) {
-        summary << "      \"" << json_escape(k) << "\": " << v;
-        if (++by_size_idx < normalized_by_size.size()) summary << ',';
-        summary << "\n";
+    if (cache_sim_.has_value()) {
+      std::cout << "cache_sim:\n";
+      for (const Master master : {Master::MSH2, Master::SSH2}) {
+        const auto &stats = cache_sim_->master_stats(master);
+        std::cout << "  " << master_label(master) << " accesses=" << stats.accesses << " hits=" << stats.hits << " misses=" << stats.misses
+                  << " hit_rate=" << cache_hit_rate(stats) << " evictions=" << stats.evictions << " uncached=" << stats.uncached << "\n";
       }
-      summary << "    },\n";
-
-      summary << "    \"top_cumulative_drifts\": [\n";
-      const std::size_t emit = std::min(options.top_k, top_cumulative.size());
-      for (std::size_t i = 0; i < emit; ++i) {
-        const auto *r = top_cumulative[i];
-        summary << "      {\"rank\": " << (i + 1) << ", \"seq\": " << r->record.seq << ", \"master\": \"" << json_escape(r->record.master)
-                << "\", \"addr\": \"" << json_escape(r->record.addr_text) << "\", \"size\": " << static_cast<unsigned>(r->record.size)
-                << ", \"cumulative_drift_wait\": " << r->cumulative_drift_wait << ", \"cumulative_drift_total\": " << r->cumulative_drift_total
-                << ", \"model_vs_trace_wait_delta\": " << r->normalized_delta_wait << ", \"model_vs_trace_total_delta\": " << r->normalized_delta_total
-                << ", \"classification\": \"" << json_escape(r->classification) << "\", \"region\": \"" << json_escape(region_name(r->record.addr))
-                << "\"}";
-        if (i + 1 < emit) summary << ',';
-        summary << '\n';
+      std::cout << "  observed_bucket_agreement=" << cache_sim_->agreement_count() << "/" << cache_sim_->compared() << "\n";
+      std::cout << "cache_sim_top_miss_lines:\n";
+      const auto lines = cache_sim_->miss_lines().top(options_.top_k);
+      for (std::size_t i = 0; i < lines.size(); ++i) {
+        std::cout << "  #" << (i + 1) << ' ' << master_label(lines[i].master) << " line=" << trace_replay::to_hex32(lines[i].line_addr)
+                  << " misses=" << lines[i].misses << "\n";
       }
-      summary << "    ],\n";
-
-      summary << "    \"top_model_vs_trace_wait_deltas\": [\n";
-      const std::size_t emit_norm = std::min(options.top_k, top_normalized.size());
-      for (std::size_t i = 0; i < emit_norm; ++i) {
-        const auto *r = top_normalized[i];
-        summary << "      {\"rank\": " << (i + 1) << ", \"seq\": " << r->record.seq << ", \"master\": \"" << json_escape(r->record.master)
-                << "\", \"addr\": \"" << json_escape(r->record.addr_text) << "\", \"size\": " << static_cast<unsigned>(r->record.size)
-                << ", \"model_vs_trace_wait_delta\": " << r->normalized_delta_wait << ", \"model_vs_trace_total_delta\": " << r->normalized_delta_total
-                << ", \"cumulative_drift_wait\": " << r->cumulative_drift_wait << ", \"cumulative_drift_total\": " << r->cumulative_drift_total
-                << ", \"classification\": \"" << json_escape(r->classification) << "\", \"region\": \"" << json_escape(region_name(r->record.addr))
-                << "\"}";
-        if (i + 1 < emit_norm) summary << ',';
-        summary << '\n';
+    }
+
+    return 0;
+  }
+
+private:
+  static double cache_hit_rate(const trace_replay::CacheSimMasterStats &stats) {
+    const std::size_t cached = stats.hits + stats.misses;
+    return cached == 0U ? 0.0 : static_cast<double>(stats.hits) / static_cast<double>(cached);
+  }
+
+  void write_cache_sim_summary(std::ostream &summary) const {
+    const auto &sim = *cache_sim_;
+    summary << "  \"cache_sim\": {\n";
+    summary << "    \"model\": \"sh2_4kb_4way_16b_lru\",\n";
+    summary << "    \"by_master\": {\n";
+    for (const Master master : {Master::MSH2, Master::SSH2}) {
+      const auto &stats = sim.master_stats(master);
+      summary << "      \"" << master_label(master) << "\": {\"accesses\": " << stats.accesses << ", \"hits\": " << stats.hits
+              << ", \"misses\": " << stats.misses << ", \"hit_rate\": " << cache_hit_rate(stats) << ", \"evictions\": " << stats.evictions
+              << ", \"uncached\": " << stats.uncached << "}" << (master == Master::MSH2 ? "," : "") << "\n";
+    }
+    summary << "    },\n";
+    summary << "    \"observed_bucket_agreement\": {\"compared\": " << sim.compared() << ", \"agreement_count\": " << sim.agreement_count()
+            << ", \"agreement_rate\": "
+            << (sim.compared() == 0U ? 0.0 : static_cast<double>(sim.agreement_count()) / static_cast<double>(sim.compared())) << "},\n";
+    // "predicted | observed" -> count, nonzero cells only.
+    std::map<std::string, std::size_t> confusion;
+    for (std::size_t p = 0; p < trace_replay::kCachePredictionCount; ++p) {
+      for (std::size_t b = 0; b < trace_replay::kCacheBucketCount; ++b) {
+        const auto prediction = static_cast<trace_replay::CachePrediction>(p);
+        const auto bucket = static_cast<CacheBucket>(b);
+        if (const std::size_t count = sim.confusion(prediction, bucket); count != 0U) {
+          confusion[std::string(trace_replay::cache_prediction_name(prediction)) + " | " + cache_bucket_name(bucket)] = count;
+        }
       }
-      summary << "    ]\n";
-      summary << "  }\n";
-    } else {
+    }
+    summary << "    \"prediction_vs_observed_bucket\": {\n";
+    std::size_t confusion_index = 0;
+    for (const auto &[key, count] : confusion) {
+      summary << "      \"" << key << "\": " << count;
+      if (++confusion_index < confusion.size()) summary << ',';
       summary << "\n";
     }
+    summary << "    },\n";
+    summary << "    \"distinct_miss_lines\": " << sim.miss_lines().size() << ",\n";
+    summary << "    \"top_miss_lines\": [\n";
+    const auto lines = sim.miss_lines().top(options_.top_k);
+    for (std::size_t i = 0; i < lines.size(); ++i) {
+      summary << "      {\"rank\": " << (i + 1) << ", \"master\": \"" << json_escape(master_label(lines[i].master)) << "\", \"line\": \""
+              << trace_replay::to_hex32(lines[i].line_addr) << "\", \"misses\": " << lines[i].misses << "}";
+      if (i + 1 < lines.size()) summary << ',';
+      summary << '\n';
+    }
+    summary << "    ]\n";
+    summary << "  }";
+  }
 
-    summary << "}\n";
+  // Every variant, ranked; stdout shows only the first top_k.
+  void write_sweep_summary(std::ostream &summary) const {
+    const auto ranked = sweep_->ranked();
+    summary << "  \"sweep\": {\n";
+    summary << "    \"variant_count\": " << sweep_->variant_count() << ",\n";
+    summary << "    \"ranking\": [\n";
+    for (std::size_t i = 0; i < ranked.size(); ++i) {
+      const auto &result = ranked[i];
+      summary << "      {\"rank\": " << (i + 1) << ", \"settings\": {";
+      const auto &settings = sweep_->variant(result.variant).settings;
+      for (std::size_t s = 0; s < settings.size(); ++s) {
+        summary << (s == 0U ? "" : ", ") << '"' << json_escape(settings[s].first) << "\": " << settings[s].second;
+      }
+      summary << "}, \"agreement_count\": " << result.agreement_count << ", \"mismatch_count\": " << result.mismatch_count
+              << ", \"known_gap_count\": " << result.known_gap_count << ", \"normalized_agreement_count\": " << result.normalized_agreement_count
+              << ", \"normalized_mismatch_count\": " << result.normalized_mismatch_count
+              << ", \"final_cumulative_drift_total\": " << result.final_cumulative_drift_total << "}";
+      if (i + 1 < ranked.size()) summary << ',';
+      summary << '\n';
+    }
+    summary << "    ]\n";
+    summary << "  }";
   }
 
-  std::cout << "dataset_hygiene_summary:\n";
-  std::cout << "  total_events: " << total_events << "\n";
-  std::cout << "  included_events: " << included_events << "\n";
-  std::cout << "  excluded_events: " << excluded_events << "\n";
-  std::cout << "  excluded_malformed_line: " << excluded_reason_counts["malformed_line"] << "\n";
-  std::cout << "  excluded_invalid_master: " << excluded_reason_counts["invalid_master"] << "\n";
-  std::cout << "  known_gap_bucket_byte_access_wait_check_gap_candidate: "
-            << known_gap_bucket_counts["byte_access_wait_check_gap_candidate"] << "\n";
-  std::cout << "  master_distribution:\n";
-  for (const auto &[key, count] : included_master_distribution) {
-    std::cout << "    " << key << " => " << count << "\n";
+  void write_annotated(const ReplayResult &r) {
+    if (annotated_out_ == nullptr) {
+      return;
+    }
+    if (options_.annotated_limit.has_value() && annotated_rows_ >= *options_.annotated_limit) {
+      return;
+    }
+    ++annotated_rows_;
+    if (options_.annotated_format == trace_replay::AnnotatedFormat::Binary) {
+      write_annotated_binary(*annotated_out_, r);
+    } else {
+      write_annotated_jsonl(*annotated_out_, r);
+    }
+    annotated_file_.commit();
   }
-  std::cout << "  region_distribution:\n";
-  for (const auto &[key, count] : included_region_distribution) {
-    std::cout << "    " << key << " => " << count << "\n";
+
+  void write_annotated_jsonl(trace_replay::OutputBuffer &out, const ReplayResult &r) const {
+    out.append("{\"seq\":");
+    out.append_int(r.record.seq);
+    out.append(",\"master\":\"");
+    out.append_escaped(master_label(r.record.master));
+    out.append("\",\"tick_first_attempt\":");
+    out.append_int(r.record.tick_first_attempt);
+    out.append(",\"tick_complete\":");
+    out.append_int(r.record.tick_complete);
+    out.append(",\"addr\":\"");
+    out.append_escaped(addr_text(r.record));
+    out.append("\",\"size\":");
+    out.append_int(static_cast<unsigned>(r.record.size));
+    out.append(",\"rw\":\"");
+    out.append_escaped(rw_label(r.record.rw));
+    out.append("\",\"kind\":\"");
+    out.append_escaped(kind_label(r.record.kind));
+    out.append("\",\"service_cycles\":");
+    out.append_int(r.record.service_cycles);
+    out.append(",\"retries\":");
+    out.append_int(r.record.retries);
+    out.append(",\"observed_service_cycles\":");
+    out.append_int(r.record.service_cycles);
+    out.append(",\"observed_retries\":");
+    out.append_int(r.record.retries);
+    out.append(",\"observed_elapsed\":");
+    out.append_int(r.ymir_elapsed);
+    out.append(",\"observed_wait\":");
+    out.append_int(r.ymir_wait);
+    out.append(",\"observed_wait_metric_kind\":\"");
+    out.append(wait_metric_kind_name(r.ymir_wait_metric_kind));
+    out.append("\",\"cache_bucket\":\"");
+    out.append(cache_bucket_name(r.cache_bucket));
+    out.append("\",\"classification\":\"");
+    out.append(classification_name(r.classification));
+    out.append('"');
+    if (options_.include_model_comparison) {
+      out.append(",\"model_predicted_wait\":");
+      out.append_int(r.model_predicted_wait);
+      out.append(",\"model_predicted_service\":");
+      out.append_int(r.model_predicted_service);
+      out.append(",\"model_predicted_total\":");
+      out.append_int(r.model_predicted_total);
+      out.append(",\"model_vs_trace_wait_delta\":");
+      out.append_int(r.model_vs_trace_wait_delta);
+      out.append(",\"model_vs_trace_total_delta\":");
+      out.append_int(r.model_vs_trace_total_delta);
+      out.append(",\"cumulative_drift_wait\":");
+      out.append_int(r.cumulative_drift_wait);
+      out.append(",\"cumulative_drift_total\":");
+      out.append_int(r.cumulative_drift_total);
+      out.append(",\"known_gap_reason\":\"");
+      out.append(known_gap_reason_name(r.known_gap_reason));
+      out.append('"');
+    }
+    out.append("}\n");
   }
-  std::cout << "  size_distribution:\n";
-  for (const auto &[key, count] : included_size_distribution) {
-    std::cout << "    " << key << " => " << count << "\n";
+
+  void write_annotated_binary(trace_replay::OutputBuffer &out, const ReplayResult &r) const {
+    trace_replay::BinaryAnnotatedRecordV1 row{};
+    row.seq = r.record.seq;
+    row.tick_first_attempt = r.record.tick_first_attempt;
+    row.tick_complete = r.record.tick_complete;
+    row.model_vs_trace_wait_delta = r.model_vs_trace_wait_delta;
+    row.model_vs_trace_total_delta = r.model_vs_trace_total_delta;
+    row.cumulative_drift_wait = r.cumulative_drift_wait;
+    row.cumulative_drift_total = r.cumulative_drift_total;
+    row.addr = r.record.addr;
+    row.service_cycles = r.record.service_cycles;
+    row.retries = r.record.retries;
+    row.observed_elapsed = r.ymir_elapsed;
+    row.observed_wait = r.ymir_wait;
+    row.model_predicted_wait = r.model_predicted_wait;
+    row.model_predicted_service = r.model_predicted_service;
+    row.model_predicted_total = r.model_predicted_total;
+    row.master = static_cast<std::uint16_t>(r.record.master);
+    row.rw = static_cast<std::uint16_t>(r.record.rw);
+    row.kind = static_cast<std::uint16_t>(r.record.kind);
+    row.size = r.record.size;
+    row.region = static_cast<std::uint8_t>(r.record.region);
+    row.observed_wait_metric_kind = static_cast<std::uint8_t>(r.ymir_wait_metric_kind);
+    row.cache_bucket = static_cast<std::uint8_t>(r.cache_bucket);
+    row.classification = static_cast<std::uint8_t>(r.classification);
+    row.known_gap_reason = static_cast<std::uint8_t>(r.known_gap_reason);
+    row.flags = options_.include_model_comparison ? trace_replay::kAnnotatedHasModel : 0U;
+    out.append_raw(row);
   }
-  std::cout << "  rw_distribution:\n";
-  for (const auto &[key, count] : included_rw_distribution) {
-    std::cout << "    " << key << " => " << count << "\n";
+
+  const Options &options_;
+  const busarb::ArbiterConfig arbiter_config_{};
+  std::optional<busarb::YmirArbiter> arbiter_;
+  std::optional<trace_replay::SweepReplay> sweep_;
+  std::optional<trace_replay::CacheSimulator> cache_sim_;
+  std::optional<TraceRecord> previous_record_for_normalized_;
+  trace_replay::AnnotatedFile annotated_file_;
+  trace_replay::OutputBuffer *annotated_out_ = nullptr;
+  std::ostream *diagnostics_ = &std::cerr;
+  trace_replay::OutputBuffer segment_annotated_;
+  std::ostringstream segment_diagnostics_;
+  std::size_t annotated_rows_ = 0;
+
+  std::size_t included_events_ = 0;
+  std::size_t records_processed_ = 0;
+  std::size_t observed_wait_nonzero_count_ = 0;
+  DenseTable<std::size_t> included_master_distribution_{kCanonicalMasterCount};
+  DenseTable<std::size_t> included_region_distribution_{kRegionCount};
+  DenseTable<std::size_t> included_size_distribution_{5};
+  DenseTable<std::size_t> included_rw_distribution_{2};
+  DenseTable<std::size_t> included_access_kind_distribution_{kCanonicalKindCount};
+  DenseTable<std::size_t> included_master_region_distribution_{kMasterRegionIds};
+  DenseTable<std::size_t> included_cache_bucket_distribution_{kCacheBucketCount};
+  DenseTable<std::size_t> included_master_region_access_kind_cache_bucket_distribution_{kMasterRegionKindIds * kCacheBucketCount};
+  std::map<std::string, std::size_t> excluded_reason_counts_;
+  std::size_t byte_access_gap_candidates_ = 0;
+
+  std::size_t known_gap_count_ = 0;
+  std::size_t known_gap_byte_access_count_ = 0;
+  std::size_t cumulative_agreement_count_ = 0;
+  std::size_t cumulative_mismatch_count_ = 0;
+  std::size_t normalized_agreement_count_ = 0;
+  std::size_t normalized_mismatch_count_ = 0;
+  std::uint64_t sum_base_latency_ = 0;
+  std::uint64_t sum_contention_stall_ = 0;
+  std::uint64_t sum_total_predicted_ = 0;
+  std::int64_t final_cumulative_drift_wait_ = 0;
+  std::int64_t final_cumulative_drift_total_ = 0;
+  std::uint64_t last_tick_complete_ = 0;
+  std::size_t rolling_normalized_mismatch_base_ = 0;
+
+  DenseTable<std::size_t> histogram_{kRegionCount * kClassificationCount};
+  DenseTable<std::size_t> normalized_by_master_{kCanonicalMasterCount};
+  DenseTable<std::size_t> normalized_by_region_{kRegionCount};
+  DenseTable<std::size_t> normalized_by_size_{5};
+  DenseTable<std::size_t> normalized_mismatch_by_master_region_access_kind_{kMasterRegionKindIds};
+  DenseTable<std::size_t> sample_size_by_master_region_access_kind_{kMasterRegionKindIds};
+  DenseTable<QuantileSketch> normalized_delta_by_access_kind_{kCanonicalKindCount};
+  DenseTable<ObservedBucketStats> observed_bucket_stats_by_master_region_access_kind_cache_bucket_{kMasterRegionKindIds * kCacheBucketCount};
+  QuantileSketch normalized_wait_deltas_;
+  TopK<ReplayResult> top_cumulative_;
+  TopK<ReplayResult> top_normalized_;
+};
+
+bool record_order_less(const TraceRecord &a, const TraceRecord &b) {
+  if (a.tick_complete != b.tick_complete) return a.tick_complete < b.tick_complete;
+  return a.seq < b.seq;
+}
+
+// Bounded reorder buffer for --streaming. Records are held in a min-heap keyed
+// on (tick_complete, seq, arrival) and released once they fall more than
+// `window_ticks` behind the newest tick_complete seen, which reproduces the
+// batch stable_sort whenever input disorder stays inside the window.
+class StreamingReorderBuffer {
+public:
+  StreamingReorderBuffer(std::uint64_t window_ticks, ReplaySession &session) : window_ticks_(window_ticks), session_(session) {}
+
+  void push(TraceRecord &&record) {
+    if (released_any_ && record_order_less(record, last_released_)) {
+      ++late_records_;
+      std::cerr << "warning: seq " << record.seq << " arrived outside --stream-window; replay order differs from batch mode\n";
+      session_.consume(record);
+      return;
+    }
+    max_tick_complete_ = std::max(max_tick_complete_, record.tick_complete);
+    heap_.push_back(Entry{std::move(record), next_arrival_++});
+    std::push_heap(heap_.begin(), heap_.end(), entry_greater);
+    while (!heap_.empty() && heap_.front().record.tick_complete + window_ticks_ < max_tick_complete_) {
+      release_top();
+    }
   }
-  std::cout << "  access_kind_distribution:\n";
-  for (const auto &[key, count] : included_access_kind_distribution) {
-    std::cout << "    " << key << " => " << count << "\n";
+
+  void drain() {
+    while (!heap_.empty()) {
+      release_top();
+    }
+    if (late_records_ != 0U) {
+      std::cerr << "warning: " << late_records_ << " record(s) exceeded --stream-window " << window_ticks_ << "\n";
+    }
   }
-  std::cout << "  cache_bucket_distribution:\n";
-  for (const auto &[key, count] : included_cache_bucket_distribution) {
-    std::cout << "    " << key << " => " << count << "\n";
+
+private:
+  struct Entry {
+    TraceRecord record;
+    std::uint64_t arrival = 0;
+  };
+
+  static bool entry_greater(const Entry &a, const Entry &b) {
+    if (record_order_less(b.record, a.record)) return true;
+    if (record_order_less(a.record, b.record)) return false;
+    return a.arrival > b.arrival;
   }
 
-  std::cout << "records_processed: " << records_processed << "\n";
-  std::cout << "malformed_lines_skipped: " << malformed_lines << "\n";
-  std::cout << "duplicate_seq_count: " << duplicate_seq_count << "\n";
-  std::cout << "non_monotonic_seq_count: " << non_monotonic_seq_count << "\n";
-  if (options.include_model_comparison) {
-    std::cout << "Model comparison: ENABLED (hypothesis mode)\n";
-    std::cout << "agreement_count: " << cumulative_agreement_count << "\n";
-    std::cout << "mismatch_count: " << cumulative_mismatch_count << "\n";
-    std::cout << "known_gap_count: " << known_gap_count << "\n";
-    std::cout << "normalized_agreement_count: " << normalized_agreement_count << "\n";
-    std::cout << "normalized_mismatch_count: " << normalized_mismatch_count << "\n";
-    std::cout << "final_cumulative_drift_total: " << (results.empty() ? 0 : results.back().cumulative_drift_total) << "\n";
-  } else {
-    std::cout << "Model comparison: DISABLED (trace-only mode)\n";
+  void release_top() {
+    std::pop_heap(heap_.begin(), heap_.end(), entry_greater);
+    last_released_ = std::move(heap_.back().record);
+    heap_.pop_back();
+    released_any_ = true;
+    session_.consume(last_released_);
   }
-  std::cout << "delta_histogram:\n";
-  for (const auto &[key, count] : histogram) {
-    std::cout << "  " << key << " => " << count << "\n";
+
+  std::uint64_t window_ticks_ = 0;
+  ReplaySession &session_;
+  std::vector<Entry> heap_;
+  std::uint64_t next_arrival_ = 0;
+  std::uint64_t max_tick_complete_ = 0;
+  bool released_any_ = false;
+  TraceRecord last_released_{};
+  std::size_t late_records_ = 0;
+};
+
+// Cuts the sorted records into segments of `segment_records` and notes the
+// input-derived state the serial loop carries into each one.
+std::vector<ReplaySegment> plan_replay_segments(const std::vector<TraceRecord> &records, std::size_t segment_records,
+                                                const busarb::BusMasterTopology &topology) {
+  std::vector<ReplaySegment> segments;
+  ReplaySegment current{};
+  std::optional<std::size_t> previous_valid_index;
+  busarb::BusMasterMask round_robin_last = 0;
+  std::size_t valid = 0;
+  for (std::size_t i = 0; i < records.size(); ++i) {
+    if (i - current.begin == segment_records) {
+      current.end = i;
+      segments.push_back(current);
+      current = ReplaySegment{i, i, std::nullopt, round_robin_last, valid};
+      if (previous_valid_index.has_value()) {
+        current.previous_valid = records[*previous_valid_index];
+      }
+    }
+    const TraceRecord &record = records[i];
+    if (trace_replay::is_valid_master(record.master)) {
+      previous_valid_index = i;
+      ++valid;
+      round_robin_last = busarb::note_round_robin_grant(topology, round_robin_last, static_cast<busarb::BusMasterId>(record.master));
+    }
   }
+  current.end = records.size();
+  segments.push_back(current);
+  return segments;
+}
+
+busarb::ArbiterState segment_entry_state(const ReplaySegment &segment, std::uint64_t bus_free_tick) {
+  return busarb::ArbiterState{bus_free_tick, segment.previous_valid.has_value(), segment.previous_valid.has_value() ? segment.previous_valid->addr : 0U,
+                              segment.round_robin_last};
+}
+
+// Each grant maps the bus-free tick b to max(attempt, b) + duration, so a whole
+// segment maps an entry tick b to max(idle_exit, b + busy_ticks): idle_exit is
+// the exit tick when entered with an idle bus (b = 0) and busy_ticks the sum of
+// its grant durations.
+struct SegmentBusSummary {
+  std::uint64_t idle_exit = 0;
+  std::uint64_t busy_ticks = 0;
+  bool granted = false;
 
+  [[nodiscard]] std::uint64_t exit_tick(std::uint64_t entry_tick) const { return granted ? std::max(idle_exit, entry_tick + busy_ticks) : entry_tick; }
+};
+
+SegmentBusSummary summarize_segment_bus(const std::vector<TraceRecord> &records, const ReplaySegment &segment, const busarb::ArbiterConfig &config) {
+  busarb::YmirArbiter arbiter(busarb::YmirTiming{}, config);
+  arbiter.restore(segment_entry_state(segment, 0U));
+  SegmentBusSummary summary{};
+  for (std::size_t i = segment.begin; i < segment.end; ++i) {
+    const TraceRecord &record = records[i];
+    if (!trace_replay::is_valid_master(record.master)) {
+      continue;
+    }
+    const busarb::BusRequest req{static_cast<busarb::BusMasterId>(record.master), record.addr, record.rw == Rw::W, record.size, record.tick_first_attempt};
+    const std::uint64_t start = arbiter.reserve(req);
+    summary.busy_ticks += arbiter.bus_free_tick() - start;
+    summary.granted = true;
+  }
+  summary.idle_exit = arbiter.bus_free_tick();
+  return summary;
+}
+
+// Batch replay is sequential only through the model arbiter's carried state,
+// and the only part of that state not fixed by the input itself is the
+// bus-free tick. Segments first reduce their grants to a SegmentBusSummary in
+// parallel; a prefix over the summaries yields each segment's exact entry
+// tick, and the segments are then replayed in waves on worker threads from
+// restored snapshots and absorbed in order, matching the serial loop exactly.
+void replay_segmented(const Options &options, const std::vector<TraceRecord> &records, std::size_t threads, ReplaySession &session) {
+  const std::size_t segment_records = std::clamp(records.size() / (threads * 4U), kMinReplaySegmentRecords, kMaxReplaySegmentRecords);
+  const std::vector<ReplaySegment> segments = plan_replay_segments(records, segment_records, session.arbiter_config().topology);
+
+  std::vector<std::uint64_t> entry_ticks(segments.size(), 0U);
   if (options.include_model_comparison) {
-    std::cout << "top_cumulative_drifts:\n";
-    for (std::size_t i = 0; i < std::min(options.top_k, top_cumulative.size()); ++i) {
-      const auto *r = top_cumulative[i];
-      std::cout << "  #" << (i + 1) << " seq=" << r->record.seq << " cumulative_drift_total=" << r->cumulative_drift_total
-                << " normalized_delta_wait=" << r->normalized_delta_wait << " class=" << r->classification << "\n";
+    std::vector<SegmentBusSummary> summaries(segments.size());
+    for (std::size_t first = 0; first < segments.size(); first += threads) {
+      const std::size_t count = std::min(threads, segments.size() - first);
+      trace_replay::run_parallel(count, [&](std::size_t i) {
+        summaries[first + i] = summarize_segment_bus(records, segments[first + i], session.arbiter_config());
+      });
+    }
+    for (std::size_t i = 1; i < segments.size(); ++i) {
+      entry_ticks[i] = summaries[i - 1U].exit_tick(entry_ticks[i - 1U]);
     }
+  }
 
-    std::cout << "top_normalized_deltas:\n";
-    for (std::size_t i = 0; i < std::min(options.top_k, top_normalized.size()); ++i) {
-      const auto *r = top_normalized[i];
-      std::cout << "  #" << (i + 1) << " seq=" << r->record.seq << " normalized_delta_wait=" << r->normalized_delta_wait
-                << " cumulative_drift_total=" << r->cumulative_drift_total << " class=" << r->classification << "\n";
+  const bool annotate = session.annotating();
+  std::vector<std::unique_ptr<ReplaySession>> wave(threads);
+  for (std::size_t first = 0; first < segments.size(); first += threads) {
+    const std::size_t count = std::min(threads, segments.size() - first);
+    trace_replay::run_parallel(count, [&](std::size_t i) {
+      const ReplaySegment &segment = segments[first + i];
+      wave[i] = std::make_unique<ReplaySession>(options);
+      wave[i]->begin_segment(segment, segment_entry_state(segment, entry_ticks[first + i]), annotate);
+      for (std::size_t r = segment.begin; r < segment.end; ++r) {
+        wave[i]->consume(records[r]);
+      }
+    });
+    for (std::size_t i = 0; i < count; ++i) {
+      session.absorb(*wave[i]);
+      wave[i].reset();
+    }
+  }
+}
+
+std::string timing_slot_name(std::size_t slot) {
+  const auto rows = busarb::ymir_region_timings();
+  const std::size_t row = slot / 2U;
+  return std::string(row < rows.size() ? rows[row].name : "unmapped") + ((slot % 2U) != 0U ? " write" : " read");
+}
+
+void write_calibration_residuals(std::ostream &out, const trace_replay::CalibrationResiduals &residuals) {
+  out << "{\"abs_total_delta\": " << residuals.abs_total_delta
+      << ", \"abs_cumulative_drift\": " << residuals.abs_cumulative_drift << ", \"final_cumulative_drift_total\": " << residuals.final_cumulative_drift_total
+      << ", \"agreement_count\": " << residuals.agreement_count << "}";
+}
+
+// --calibrate: fits the timing table and reports it instead of a replay.
+int run_calibration(const Options &options, const std::vector<TraceRecord> &records) {
+  const trace_replay::CalibrationResult result = trace_replay::calibrate_timing(records);
+  const auto rows = busarb::ymir_region_timings();
+  const std::size_t unmapped = rows.size() * 2U;
+
+  auto print_residuals = [](const char *label, const trace_replay::CalibrationResiduals &residuals) {
+    std::cout << label << ": abs_total_delta=" << residuals.abs_total_delta
+              << " abs_cumulative_drift=" << residuals.abs_cumulative_drift << " final_cumulative_drift_total=" << residuals.final_cumulative_drift_total
+              << " agreement_count=" << residuals.agreement_count << "\n";
+  };
+  std::cout << "calibration: records=" << result.before.records << " passes=" << result.passes << " evaluations=" << result.evaluations
+            << " records_touched=" << result.records_touched << "\n";
+  print_residuals("residuals_before", result.before);
+  print_residuals("residuals_after", result.after);
+  std::cout << "changed_slots:\n";
+  for (std::size_t slot = 0; slot < result.suggested.size(); ++slot) {
+    if (result.suggested[slot] != result.initial[slot]) {
+      std::cout << "  " << timing_slot_name(slot) << ": " << result.initial[slot] << " -> " << result.suggested[slot] << " (records=" << result.slot_records[slot]
+                << ")\n";
     }
   }
+  std::cout << "suggested_timing_table:\n";
+  for (std::size_t row = 0; row < rows.size(); ++row) {
+    std::cout << "    {" << trace_replay::to_hex32(rows[row].start) << "U, " << trace_replay::to_hex32(rows[row].end) << "U, " << result.suggested[row * 2U] << "U, "
+              << result.suggested[row * 2U + 1U] << "U, \"" << rows[row].name << "\"},\n";
+  }
+  std::cout << "  unmapped: read=" << result.suggested[unmapped] << " write=" << result.suggested[unmapped + 1U] << "\n";
 
+  if (options.summary_output_path.has_value()) {
+    std::ofstream summary(*options.summary_output_path);
+    if (!summary.is_open()) {
+      std::cerr << "Failed to open summary output path: " << *options.summary_output_path << '\n';
+      return 1;
+    }
+    summary << "{\n";
+    summary << "  \"calibration\": {\n";
+    summary << "    \"records\": " << result.before.records << ",\n";
+    summary << "    \"passes\": " << result.passes << ",\n";
+    summary << "    \"residuals_before\": ";
+    write_calibration_residuals(summary, result.before);
+    summary << ",\n";
+    summary << "    \"residuals_after\": ";
+    write_calibration_residuals(summary, result.after);
+    summary << ",\n";
+    summary << "    \"suggested_timing_table\": [\n";
+    for (std::size_t row = 0; row <= rows.size(); ++row) {
+      const std::size_t slot = row * 2U;
+      summary << "      {\"region\": \"" << json_escape(row < rows.size() ? rows[row].name : "unmapped") << "\"";
+      if (row < rows.size()) {
+        summary << ", \"start\": \"" << trace_replay::to_hex32(rows[row].start) << "\", \"end\": \"" << trace_replay::to_hex32(rows[row].end) << "\"";
+      }
+      summary << ", \"read_cycles\": " << result.suggested[slot] << ", \"write_cycles\": " << result.suggested[slot + 1U]
+              << ", \"baseline_read_cycles\": " << result.initial[slot] << ", \"baseline_write_cycles\": " << result.initial[slot + 1U]
+              << ", \"read_records\": " << result.slot_records[slot] << ", \"write_records\": " << result.slot_records[slot + 1U] << "}";
+      if (row < rows.size()) summary << ',';
+      summary << '\n';
+    }
+    summary << "    ]\n";
+    summary << "  }\n";
+    summary << "}\n";
+  }
   return 0;
 }
+
+// Everything besides the input that a cached session depends on.
+std::uint64_t replay_cache_fingerprint(const Options &options, const ReplaySession &session) {
+  trace_replay::StateWriter key;
+  key.put(kSummarySchemaVersion);
+  key.put(busarb::kApiVersionMajor);
+  key.put(busarb::kApiVersionMinor);
+  key.put(session.arbiter_config());
+  for (const auto &row : busarb::ymir_region_timings()) {
+    key.put(row.start);
+    key.put(row.end);
+    key.put(row.read_cycles);
+    key.put(row.write_cycles);
+  }
+  key.put(options.include_model_comparison);
+  key.put(options.top_k);
+  key.put(sizeof(ReplayResult));
+  return trace_replay::block_hash(std::span(reinterpret_cast<const std::uint8_t *>(key.bytes().data()), key.bytes().size()));
+}
+
+// Batch replay through --replay-cache: restore the cached session, replay only
+// the records read past its checkpoint, and save a checkpoint further along.
+// Serial, because the checkpoint is a snapshot between two records.
+int run_cached_replay(const Options &options) {
+  ReplaySession session(options);
+  trace_replay::ReplayCache cache(*options.replay_cache_path, replay_cache_fingerprint(options, session));
+  InputStats input_stats{};
+  std::vector<TraceRecord> records;
+  if (!cache.read_input(options.input_path, options.ingest_threads, input_stats, records)) {
+    return 1;
+  }
+  if (const std::string *state = cache.resume_state(); state != nullptr) {
+    trace_replay::StateReader reader(std::span(reinterpret_cast<const std::uint8_t *>(state->data()), state->size()));
+    if (!session.load_state(reader)) {
+      std::cerr << "error: replay cache " << *options.replay_cache_path << " holds an unreadable session; delete it and rerun\n";
+      return 1;
+    }
+  }
+  const std::optional<std::size_t> checkpoint = cache.plan_checkpoint(records);
+  std::stable_sort(records.begin(), records.end(), record_order_less);
+
+  if (!session.begin()) {
+    return 1;
+  }
+  for (std::size_t i = 0; i <= records.size(); ++i) {
+    if (checkpoint == i) {
+      trace_replay::StateWriter state;
+      session.save_state(state);
+      if (!cache.write(state.bytes())) {
+        return 1;
+      }
+    }
+    if (i < records.size()) {
+      session.consume(records[i]);
+    }
+  }
+  return session.finish(input_stats);
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  Options options{};
+  if (!parse_options(argc, argv, options)) {
+    print_help();
+    return 1;
+  }
+
+  if (trace_replay::is_stream_input(options.input_path)) {
+    if (options.window.active() || options.index_use == trace_replay::IndexUse::Build || options.calibrate) {
+      std::cerr << "error: --seq-range/--tick-range/--build-index/--calibrate need a seekable input file\n";
+      return 1;
+    }
+    // Live captures cannot be sorted up front; replay through the reorder window.
+    options.streaming = true;
+    if (!options.rolling_interval.has_value()) {
+      options.rolling_interval = kDefaultLiveRollingRecords;
+    }
+  }
+
+  if (options.calibrate &&
+      (options.streaming || options.sweep.has_value() || options.cache_sim || (options.annotated_output_path.has_value() && !options.summary_only))) {
+    std::cerr << "error: --calibrate fits the timing table instead of replaying; it cannot be combined with --streaming, --sweep,\n"
+              << "       --cache-sim or --annotated-output\n";
+    return 1;
+  }
+
+  if (options.replay_cache_path.has_value()) {
+    if (options.streaming || options.window.active() || options.sweep.has_value() || options.cache_sim || options.calibrate ||
+        (options.annotated_output_path.has_value() && !options.summary_only)) {
+      std::cerr << "error: --replay-cache replays whole captures in batch mode; it cannot be combined with --streaming, stdin/FIFO input,\n"
+                << "       --seq-range/--tick-range, --sweep, --cache-sim, --calibrate or --annotated-output\n";
+      return 1;
+    }
+    if (options.index_use == trace_replay::IndexUse::Build && !build_index_sidecar(options)) {
+      return 1;
+    }
+    return run_cached_replay(options);
+  }
+
+  ReplaySession session(options);
+  InputStats input_stats{};
+
+  if (options.streaming) {
+    if (!session.begin()) {
+      return 1;
+    }
+    StreamingReorderBuffer reorder(options.stream_window_ticks, session);
+    if (!read_input_records(options, input_stats, [&reorder](TraceRecord &&rec) { reorder.push(std::move(rec)); })) {
+      return 1;
+    }
+    reorder.drain();
+    return session.finish(input_stats);
+  }
+
+  std::vector<TraceRecord> records;
+  if (!load_input_records(options, records, input_stats)) {
+    return 1;
+  }
+
+  std::stable_sort(records.begin(), records.end(), record_order_less);
+
+  if (options.calibrate) {
+    return run_calibration(options, records);
+  }
+
+  if (!session.begin()) {
+    return 1;
+  }
+  const std::size_t replay_threads = trace_replay::resolve_ingest_threads(options.replay_threads);
+  if (replay_threads > 1U && records.size() >= 2U * kMinReplaySegmentRecords && !options.rolling_interval.has_value() &&
+      !options.sweep.has_value() && !options.cache_sim) {
+    replay_segmented(options, records, replay_threads, session);
+  } else {
+    for (const auto &record : records) {
+      session.consume(record);
+    }
+  }
+  return session.finish(input_stats);
+}